@@ -196,6 +196,7 @@ AtnSimulate::CreateDevices ()
 
   if (pcap)
     {
+      Config::SetDefault ("ns3::PcapFileWrapper::Asynchronous", BooleanValue (true));
       wifiPhy.EnablePcapAll (std::string ("atn-simulator"));
     }
 }
@@ -0,0 +1,203 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "atn-header.h"
+#include <algorithm>
+#include <cmath>
+
+NS_LOG_COMPONENT_DEFINE ("AtnHeader");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (AtnHeader);
+
+/// Перевод метров в сантиметры с округлением до ближайшего целого
+static int32_t
+ToCentimetres (double value)
+{
+  return static_cast<int32_t> (std::floor (value * 100.0 + 0.5));
+}
+
+static double
+FromCentimetres (int32_t value)
+{
+  return value / 100.0;
+}
+
+AtnHeader::AtnHeader ()
+  : m_type (0),
+    m_posX (0),
+    m_posY (0),
+    m_speedX (0),
+    m_speedY (0),
+    m_newNeighbour (uint32_t (0))
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+AtnHeader::SetMessageType (uint8_t type)
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (type));
+  m_type = type;
+}
+uint8_t
+AtnHeader::GetMessageType (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_type;
+}
+
+void
+AtnHeader::SetPosition (const Vector &position)
+{
+  NS_LOG_FUNCTION (this << position);
+  m_posX = ToCentimetres (position.x);
+  m_posY = ToCentimetres (position.y);
+}
+Vector
+AtnHeader::GetPosition (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return Vector (FromCentimetres (m_posX), FromCentimetres (m_posY), 0.0);
+}
+
+void
+AtnHeader::SetVelocity (const Vector &velocity)
+{
+  NS_LOG_FUNCTION (this << velocity);
+  m_speedX = ToCentimetres (velocity.x);
+  m_speedY = ToCentimetres (velocity.y);
+}
+Vector
+AtnHeader::GetVelocity (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return Vector (FromCentimetres (m_speedX), FromCentimetres (m_speedY), 0.0);
+}
+
+void
+AtnHeader::SetNewNeighbour (Ipv4Address neighbour)
+{
+  NS_LOG_FUNCTION (this << neighbour);
+  m_newNeighbour = neighbour;
+}
+Ipv4Address
+AtnHeader::GetNewNeighbour (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_newNeighbour;
+}
+
+void
+AtnHeader::AddRecipient (Ipv4Address recipient)
+{
+  NS_LOG_FUNCTION (this << recipient);
+  NS_ASSERT (m_recipients.size () < 255);
+  m_recipients.push_back (recipient);
+}
+const std::vector<Ipv4Address>&
+AtnHeader::GetRecipients (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_recipients;
+}
+bool
+AtnHeader::IsRecipient (Ipv4Address address) const
+{
+  NS_LOG_FUNCTION (this << address);
+  if (m_recipients.empty ())
+    {
+      return true;
+    }
+  return std::find (m_recipients.begin (), m_recipients.end (), address) != m_recipients.end ();
+}
+
+TypeId
+AtnHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::AtnHeader")
+    .SetParent<Header> ()
+    .AddConstructor<AtnHeader> ()
+  ;
+  return tid;
+}
+TypeId
+AtnHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+void
+AtnHeader::Print (std::ostream &os) const
+{
+  NS_LOG_FUNCTION (this << &os);
+  os << "(type=" << static_cast<uint32_t> (m_type)
+     << " pos=" << GetPosition ()
+     << " speed=" << GetVelocity ()
+     << " neighbour=" << m_newNeighbour;
+  for (std::vector<Ipv4Address>::const_iterator i = m_recipients.begin (); i != m_recipients.end (); ++i)
+    {
+      os << " to=" << *i;
+    }
+  os << ")";
+}
+uint32_t
+AtnHeader::GetSerializedSize (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return 1+4+4+4+4+4+1+4*m_recipients.size ();
+}
+
+void
+AtnHeader::Serialize (Buffer::Iterator start) const
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+  i.WriteU8 (m_type);
+  i.WriteHtonU32 (static_cast<uint32_t> (m_posX));
+  i.WriteHtonU32 (static_cast<uint32_t> (m_posY));
+  i.WriteHtonU32 (static_cast<uint32_t> (m_speedX));
+  i.WriteHtonU32 (static_cast<uint32_t> (m_speedY));
+  i.WriteHtonU32 (m_newNeighbour.Get ());
+  i.WriteU8 (static_cast<uint8_t> (m_recipients.size ()));
+  for (std::vector<Ipv4Address>::const_iterator j = m_recipients.begin (); j != m_recipients.end (); ++j)
+    {
+      i.WriteHtonU32 (j->Get ());
+    }
+}
+uint32_t
+AtnHeader::Deserialize (Buffer::Iterator start)
+{
+  NS_LOG_FUNCTION (this << &start);
+  Buffer::Iterator i = start;
+  m_type = i.ReadU8 ();
+  m_posX = static_cast<int32_t> (i.ReadNtohU32 ());
+  m_posY = static_cast<int32_t> (i.ReadNtohU32 ());
+  m_speedX = static_cast<int32_t> (i.ReadNtohU32 ());
+  m_speedY = static_cast<int32_t> (i.ReadNtohU32 ());
+  m_newNeighbour.Set (i.ReadNtohU32 ());
+  uint8_t n = i.ReadU8 ();
+  m_recipients.clear ();
+  for (uint8_t j = 0; j < n; ++j)
+    {
+      m_recipients.push_back (Ipv4Address (i.ReadNtohU32 ()));
+    }
+  return GetSerializedSize ();
+}
+
+} // namespace ns3
@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ATN_HEADER_H
+#define ATN_HEADER_H
+
+#include "ns3/header.h"
+#include "ns3/vector.h"
+#include "ns3/ipv4-address.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup ATN
+ * \brief Заголовок сообщения ATN переменной длины: фиксированная часть и список получателей.
+ *
+ * Координаты и скорость передаются в сотых долях метра (метра в секунду)
+ * знаковыми 32-битными числами в сетевом порядке байт, что соответствует
+ * точности прежнего текстового формата.
+ *
+ * За фиксированной частью следует список получателей. Он непуст только у
+ * широковещательных сообщений, объединяющих несколько адресных: узлы, не
+ * вошедшие в список, используют из такого сообщения лишь координаты.
+ *
+ * \verbatim
+   +-----+------+------+---------+---------+----------------------------+-----+-----------------+
+   | Тип |  X   |  Y   | Vx      | Vy      | IP Address будущего соседа | N   | Получатели      |
+   | 1 б | 4 б  | 4 б  | 4 б     | 4 б     | 4 б                        | 1 б | N * 4 б         |
+   +-----+------+------+---------+---------+----------------------------+-----+-----------------+
+   \endverbatim
+ */
+class AtnHeader : public Header
+{
+public:
+  AtnHeader ();
+
+  /**
+   * \param type тип сообщения (REQUEST, RESPONSE, ERROR)
+   */
+  void SetMessageType (uint8_t type);
+  /**
+   * \return тип сообщения
+   */
+  uint8_t GetMessageType (void) const;
+
+  /**
+   * \param position координаты отправителя, z не передается
+   */
+  void SetPosition (const Vector &position);
+  /**
+   * \return координаты отправителя
+   */
+  Vector GetPosition (void) const;
+
+  /**
+   * \param velocity вектор скорости отправителя, z не передается
+   */
+  void SetVelocity (const Vector &velocity);
+  /**
+   * \return вектор скорости отправителя
+   */
+  Vector GetVelocity (void) const;
+
+  /**
+   * \param neighbour адрес узла, который входит в зону действия получателя
+   */
+  void SetNewNeighbour (Ipv4Address neighbour);
+  /**
+   * \return адрес будущего соседа
+   */
+  Ipv4Address GetNewNeighbour (void) const;
+
+  /**
+   * \param recipient адрес узла, которому адресовано широковещательное
+   * сообщение; не более 255 адресов
+   */
+  void AddRecipient (Ipv4Address recipient);
+  /**
+   * \return список получателей; пуст у адресных сообщений
+   */
+  const std::vector<Ipv4Address>& GetRecipients (void) const;
+  /**
+   * \param address адрес узла
+   * \return true, если сообщение адресовано узлу address, то есть список
+   * получателей пуст или содержит address
+   */
+  bool IsRecipient (Ipv4Address address) const;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint8_t m_type; //!< Тип сообщения
+  int32_t m_posX; //!< Координата X, см
+  int32_t m_posY; //!< Координата Y, см
+  int32_t m_speedX; //!< Скорость по X, см/с
+  int32_t m_speedY; //!< Скорость по Y, см/с
+  Ipv4Address m_newNeighbour; //!< Адрес будущего соседа
+  std::vector<Ipv4Address> m_recipients; //!< Получатели широковещательного сообщения
+};
+
+} // namespace ns3
+
+#endif /* ATN_HEADER_H */
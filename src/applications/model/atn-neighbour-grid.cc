@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "atn-neighbour-grid.h"
+#include <algorithm>
+#include <cmath>
+
+NS_LOG_COMPONENT_DEFINE ("AtnNeighbourGrid");
+
+namespace ns3 {
+
+AtnNeighbourGrid::AtnNeighbourGrid ()
+  : m_cellSize (600.0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+AtnNeighbourGrid::SetCellSize (double cellSize)
+{
+  NS_LOG_FUNCTION (this << cellSize);
+  NS_ASSERT (cellSize > 0.0);
+  m_cellSize = cellSize;
+  m_entries.clear ();
+  m_cells.clear ();
+}
+
+double
+AtnNeighbourGrid::GetCellSize (void) const
+{
+  return m_cellSize;
+}
+
+AtnNeighbourGrid::Cell
+AtnNeighbourGrid::GetCell (double x, double y) const
+{
+  return Cell (static_cast<int64_t> (std::floor (x / m_cellSize)),
+               static_cast<int64_t> (std::floor (y / m_cellSize)));
+}
+
+void
+AtnNeighbourGrid::RemoveFromCell (const Cell &cell, Ipv4Address node)
+{
+  std::map<Cell, std::vector<Ipv4Address> >::iterator it = m_cells.find (cell);
+  NS_ASSERT (it != m_cells.end ());
+  std::vector<Ipv4Address> &nodes = it->second;
+  std::vector<Ipv4Address>::iterator i = std::find (nodes.begin (), nodes.end (), node);
+  NS_ASSERT (i != nodes.end ());
+  // Порядок внутри ячейки не важен, поэтому удаляем обменом с последним
+  *i = nodes.back ();
+  nodes.pop_back ();
+  if (nodes.empty ())
+    {
+      m_cells.erase (it);
+    }
+}
+
+void
+AtnNeighbourGrid::Update (Ipv4Address node, double x, double y)
+{
+  NS_LOG_FUNCTION (this << node << x << y);
+  Cell cell = GetCell (x, y);
+  std::map<Ipv4Address, Entry>::iterator it = m_entries.find (node);
+  if (it == m_entries.end ())
+    {
+      Entry entry;
+      entry.x = x;
+      entry.y = y;
+      entry.cell = cell;
+      m_entries.insert (std::make_pair (node, entry));
+      m_cells[cell].push_back (node);
+      return;
+    }
+  if (it->second.cell != cell)
+    {
+      RemoveFromCell (it->second.cell, node);
+      m_cells[cell].push_back (node);
+      it->second.cell = cell;
+    }
+  it->second.x = x;
+  it->second.y = y;
+}
+
+void
+AtnNeighbourGrid::Remove (Ipv4Address node)
+{
+  NS_LOG_FUNCTION (this << node);
+  std::map<Ipv4Address, Entry>::iterator it = m_entries.find (node);
+  if (it == m_entries.end ())
+    {
+      return;
+    }
+  RemoveFromCell (it->second.cell, node);
+  m_entries.erase (it);
+}
+
+std::vector<Ipv4Address>
+AtnNeighbourGrid::GetNeighbours (Ipv4Address node, double radius) const
+{
+  NS_LOG_FUNCTION (this << node << radius);
+  std::vector<Ipv4Address> neigh;
+  std::map<Ipv4Address, Entry>::const_iterator self = m_entries.find (node);
+  if (self == m_entries.end ())
+    {
+      return neigh;
+    }
+  double x = self->second.x;
+  double y = self->second.y;
+  double radius2 = radius * radius;
+  const Cell &center = self->second.cell;
+  // Радиус может превышать сторону ячейки, если его изменили после SetCellSize
+  int64_t rings = std::max (static_cast<int64_t> (std::ceil (radius / m_cellSize)), static_cast<int64_t> (1));
+  for (int64_t dx = -rings; dx <= rings; ++dx)
+    {
+      for (int64_t dy = -rings; dy <= rings; ++dy)
+        {
+          std::map<Cell, std::vector<Ipv4Address> >::const_iterator c =
+            m_cells.find (Cell (center.first + dx, center.second + dy));
+          if (c == m_cells.end ())
+            {
+              continue;
+            }
+          for (std::vector<Ipv4Address>::const_iterator i = c->second.begin (); i != c->second.end (); ++i)
+            {
+              if (*i == node)
+                {
+                  continue;
+                }
+              const Entry &e = m_entries.find (*i)->second;
+              double ex = e.x - x;
+              double ey = e.y - y;
+              if (ex * ex + ey * ey < radius2)
+                {
+                  neigh.push_back (*i);
+                }
+            }
+        }
+    }
+  return neigh;
+}
+
+uint32_t
+AtnNeighbourGrid::GetN (void) const
+{
+  return m_entries.size ();
+}
+
+} // namespace ns3
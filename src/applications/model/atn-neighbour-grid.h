@@ -0,0 +1,111 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ATN_NEIGHBOUR_GRID_H
+#define ATN_NEIGHBOUR_GRID_H
+
+#include "ns3/ipv4-address.h"
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup ATN
+ * \brief Равномерная сетка прогнозируемых позиций соседей.
+ *
+ * Плоскость разбивается на квадратные ячейки со стороной, равной радиусу
+ * поиска, поэтому запрос по радиусу просматривает не более 3x3 ячеек
+ * вместо полного перебора всех соседей. Запрос с радиусом больше стороны
+ * ячейки просматривает соответственно больше колец ячеек вокруг узла. Позиции обновляются по мере
+ * прихода сообщений: узел перемещается между ячейками только при смене
+ * ячейки.
+ */
+class AtnNeighbourGrid
+{
+public:
+  AtnNeighbourGrid ();
+
+  /**
+   * \param cellSize сторона ячейки, м. Лучше всего равна радиусу
+   * запросов: при меньшей стороне запрос просматривает больше ячеек.
+   *
+   * Сбрасывает все ранее добавленные узлы.
+   */
+  void SetCellSize (double cellSize);
+  /**
+   * \return сторона ячейки, м
+   */
+  double GetCellSize (void) const;
+
+  /**
+   * \brief Добавить узел или обновить его прогнозируемую позицию
+   * \param node адрес узла
+   * \param x координата X, м
+   * \param y координата Y, м
+   */
+  void Update (Ipv4Address node, double x, double y);
+
+  /**
+   * \brief Удалить узел из индекса
+   * \param node адрес узла
+   */
+  void Remove (Ipv4Address node);
+
+  /**
+   * \brief Найти узлы, находящиеся строго ближе radius к узлу node
+   * \param node адрес узла, относительно которого ведется поиск; сам узел
+   *        в результат не попадает
+   * \param radius радиус поиска, м
+   * \return адреса найденных узлов
+   */
+  std::vector<Ipv4Address> GetNeighbours (Ipv4Address node, double radius) const;
+
+  /**
+   * \return количество узлов в индексе
+   */
+  uint32_t GetN (void) const;
+
+private:
+  /// Индекс ячейки сетки
+  typedef std::pair<int64_t, int64_t> Cell;
+
+  /// Запись об узле
+  struct Entry
+  {
+    double x;  //!< Координата X, м
+    double y;  //!< Координата Y, м
+    Cell cell; //!< Ячейка, в которой лежит узел
+  };
+
+  /**
+   * \param x координата X, м
+   * \param y координата Y, м
+   * \return ячейка, в которую попадает точка
+   */
+  Cell GetCell (double x, double y) const;
+
+  /// Удалить узел из списка ячейки
+  void RemoveFromCell (const Cell &cell, Ipv4Address node);
+
+  double m_cellSize; //!< Сторона ячейки, м
+  std::map<Ipv4Address, Entry> m_entries; //!< Позиции узлов
+  std::map<Cell, std::vector<Ipv4Address> > m_cells; //!< Узлы по ячейкам
+};
+
+} // namespace ns3
+
+#endif /* ATN_NEIGHBOUR_GRID_H */
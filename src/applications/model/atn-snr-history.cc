@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "atn-snr-history.h"
+
+NS_LOG_COMPONENT_DEFINE ("AtnSnrHistory");
+
+namespace ns3 {
+
+AtnSnrHistory::AtnSnrHistory (uint32_t capacity, Time window)
+  : m_samples (capacity),
+    m_head (0),
+    m_count (0),
+    m_window (window),
+    m_sumT (0.0),
+    m_sumS (0.0),
+    m_sumTT (0.0),
+    m_sumTS (0.0)
+{
+  NS_LOG_FUNCTION (this << capacity << window);
+  NS_ASSERT (capacity > 0);
+}
+
+void
+AtnSnrHistory::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_head = 0;
+  m_count = 0;
+  m_sumT = 0.0;
+  m_sumS = 0.0;
+  m_sumTT = 0.0;
+  m_sumTS = 0.0;
+}
+
+void
+AtnSnrHistory::PopOldest (void)
+{
+  const Sample &s = m_samples[m_head];
+  double t = (s.at - m_origin).GetSeconds ();
+  m_sumT -= t;
+  m_sumS -= s.snr;
+  m_sumTT -= t * t;
+  m_sumTS -= t * s.snr;
+  m_head = (m_head + 1) % m_samples.size ();
+  m_count--;
+}
+
+void
+AtnSnrHistory::Rebase (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_origin = m_samples[m_head].at;
+  m_sumT = 0.0;
+  m_sumS = 0.0;
+  m_sumTT = 0.0;
+  m_sumTS = 0.0;
+  for (uint32_t i = 0; i < m_count; ++i)
+    {
+      const Sample &s = m_samples[(m_head + i) % m_samples.size ()];
+      double t = (s.at - m_origin).GetSeconds ();
+      m_sumT += t;
+      m_sumS += s.snr;
+      m_sumTT += t * t;
+      m_sumTS += t * s.snr;
+    }
+}
+
+void
+AtnSnrHistory::Add (Time now, double snr)
+{
+  NS_LOG_FUNCTION (this << now << snr);
+  while (m_count > 0 && m_samples[m_head].at < now - m_window)
+    {
+      PopOldest ();
+    }
+  if (m_count == m_samples.size ())
+    {
+      PopOldest ();
+    }
+  if (m_count == 0)
+    {
+      // Пустой буфер: заодно сбрасываем накопленную погрешность сумм
+      Clear ();
+      m_origin = now;
+    }
+  else if (m_samples[m_head].at - m_origin > m_window)
+    {
+      Rebase ();
+    }
+  double t = (now - m_origin).GetSeconds ();
+  Sample &s = m_samples[(m_head + m_count) % m_samples.size ()];
+  s.at = now;
+  s.snr = snr;
+  m_count++;
+  m_sumT += t;
+  m_sumS += snr;
+  m_sumTT += t * t;
+  m_sumTS += t * snr;
+}
+
+uint32_t
+AtnSnrHistory::GetN (void) const
+{
+  return m_count;
+}
+
+bool
+AtnSnrHistory::IsEmpty (void) const
+{
+  return m_count == 0;
+}
+
+Time
+AtnSnrHistory::GetSpan (void) const
+{
+  if (m_count == 0)
+    {
+      return Seconds (0.0);
+    }
+  return m_samples[(m_head + m_count - 1) % m_samples.size ()].at - m_samples[m_head].at;
+}
+
+double
+AtnSnrHistory::GetLastSnr (void) const
+{
+  NS_ASSERT (m_count > 0);
+  return m_samples[(m_head + m_count - 1) % m_samples.size ()].snr;
+}
+
+bool
+AtnSnrHistory::GetRegression (double &slope, double &intercept) const
+{
+  if (m_count < 2)
+    {
+      return false;
+    }
+  double n = m_count;
+  double denom = n * m_sumTT - m_sumT * m_sumT;
+  // Все отсчеты пришли в один и тот же момент времени
+  if (denom <= 1e-12 * n * m_sumTT)
+    {
+      return false;
+    }
+  slope = (n * m_sumTS - m_sumT * m_sumS) / denom;
+  intercept = (m_sumS - slope * m_sumT) / n;
+  return true;
+}
+
+bool
+AtnSnrHistory::PredictCrossing (double threshold, Time &crossing) const
+{
+  double slope;
+  double intercept;
+  if (!GetRegression (slope, intercept) || slope >= 0.0)
+    {
+      return false;
+    }
+  crossing = m_origin + Seconds ((threshold - intercept) / slope);
+  return true;
+}
+
+} // namespace ns3
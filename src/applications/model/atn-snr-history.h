@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ATN_SNR_HISTORY_H
+#define ATN_SNR_HISTORY_H
+
+#include "ns3/nstime.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup ATN
+ * \brief История SNR соседа фиксированного размера.
+ *
+ * Отсчеты хранятся в кольцевом буфере. Вместе с ними поддерживаются
+ * суммы t, s, t^2 и t*s, так что коэффициенты линейной регрессии SNR по
+ * времени пересчитываются за O(1) при добавлении и вытеснении отсчета.
+ * Отсчеты старше окна Window вытесняются при добавлении новых.
+ *
+ * Время в суммах отсчитывается от m_origin, который переносится на
+ * самый старый отсчет, как только тот отстает от него больше чем на
+ * окно; суммы при этом пересчитываются по буферу заново, так что на
+ * долгом соединении они не теряют точность.
+ */
+class AtnSnrHistory
+{
+public:
+  /**
+   * \param capacity максимальное количество хранимых отсчетов
+   * \param window временное окно, за которое строится регрессия
+   */
+  AtnSnrHistory (uint32_t capacity = 64, Time window = Seconds (5.0));
+
+  /**
+   * \brief Добавить отсчет
+   * \param now время приема
+   * \param snr отношение сигнал/шум
+   */
+  void Add (Time now, double snr);
+
+  /// Удалить все отсчеты
+  void Clear (void);
+
+  /**
+   * \return количество отсчетов в буфере
+   */
+  uint32_t GetN (void) const;
+
+  /**
+   * \return true, если буфер пуст
+   */
+  bool IsEmpty (void) const;
+
+  /**
+   * \return время между самым старым и последним отсчетами
+   */
+  Time GetSpan (void) const;
+
+  /**
+   * \return последнее значение SNR; буфер не должен быть пуст
+   */
+  double GetLastSnr (void) const;
+
+  /**
+   * \brief Коэффициенты регрессии snr = slope * t + intercept
+   * \param slope наклон, 1/с
+   * \param intercept значение в момент времени 0
+   * \return false, если отсчетов меньше двух или все они в один момент
+   */
+  bool GetRegression (double &slope, double &intercept) const;
+
+  /**
+   * \brief Прогноз момента, когда SNR опустится до threshold
+   * \param threshold пороговое значение SNR
+   * \param crossing абсолютное время пересечения порога
+   * \return false, если регрессия не построена или SNR не убывает
+   */
+  bool PredictCrossing (double threshold, Time &crossing) const;
+
+private:
+  /// Отсчет SNR
+  struct Sample
+  {
+    Time at;    //!< Время приема
+    double snr; //!< Значение SNR
+  };
+
+  /// Вытеснить самый старый отсчет
+  void PopOldest (void);
+
+  /// Перенести начало отсчета времени на самый старый отсчет и пересчитать суммы
+  void Rebase (void);
+
+  std::vector<Sample> m_samples; //!< Кольцевой буфер
+  uint32_t m_head;   //!< Индекс самого старого отсчета
+  uint32_t m_count;  //!< Количество отсчетов
+  Time m_window;     //!< Окно регрессии
+  Time m_origin;     //!< Начало отсчета времени
+  double m_sumT;     //!< Сумма t
+  double m_sumS;     //!< Сумма snr
+  double m_sumTT;    //!< Сумма t^2
+  double m_sumTS;    //!< Сумма t*snr
+};
+
+} // namespace ns3
+
+#endif /* ATN_SNR_HISTORY_H */
@@ -22,6 +22,8 @@
 #include "ns3/socket.h"
 #include "ns3/uinteger.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/packet.h"
 #include "ns3/trace-source-accessor.h"
@@ -31,7 +33,9 @@
 #include "math.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include <typeinfo>
+#include <set>
 #include "ns3/atn.h"
+#include "atn-header.h"
 #include "ns3/yans-wifi-phy.h"
 #include "ns3/snr-tag.h"
 #include "ns3/ipv4-header.h"
@@ -55,14 +59,61 @@ Atn::GetTypeId (void)
     .AddAttribute ("Size", "The number of data bytes to be sent, real packet will be 8 (ICMP) + 20 (IP) bytes longer.",
                    UintegerValue (56),
                    MakeUintegerAccessor (&Atn::m_size),
-                   MakeUintegerChecker<uint32_t> (16));
+                   MakeUintegerChecker<uint32_t> (16))
+    .AddAttribute ("AntennaRadius", "Radius of the antenna coverage zone, m.",
+                   DoubleValue (600.0),
+                   MakeDoubleAccessor (&Atn::m_antennaRadius),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("PredictionHorizon", "How far ahead neighbour positions are predicted.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&Atn::m_predictionHorizon),
+                   MakeTimeChecker ())
+    .AddAttribute ("SnrHistorySize", "Maximum number of SNR samples kept per neighbour.",
+                   UintegerValue (64),
+                   MakeUintegerAccessor (&Atn::m_snrHistorySize),
+                   MakeUintegerChecker<uint32_t> (2))
+    .AddAttribute ("SnrHistoryWindow", "Time window of the SNR trend regression.",
+                   TimeValue (Seconds (5.0)),
+                   MakeTimeAccessor (&Atn::m_snrHistoryWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("SingleSocket",
+                   "Send to all neighbours through the listening socket instead of "
+                   "one connected socket per neighbour.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Atn::m_singleSocket),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CoalesceResponses",
+                   "In SingleSocket mode, send RESPONSEs addressed to several "
+                   "neighbours as one broadcast.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Atn::m_coalesceResponses),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PollRoutingTable",
+                   "Poll the OLSR routing table every second instead of "
+                   "reacting to its NeighbourAdded/NeighbourLost trace sources.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Atn::m_pollRoutingTable),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RoutingTableFile",
+                   "File the OLSR routing table is written to on every change "
+                   "(or every poll). Empty disables the dump.",
+                   StringValue (""),
+                   MakeStringAccessor (&Atn::m_routingTableFile),
+                   MakeStringChecker ());
   return tid;
 }
 
 Atn::Atn ()
   : m_size (56),
     m_listenSocket(0),
-    m_verbose (false)
+    m_verbose (false),
+    m_snrHistorySize (64),
+    m_snrHistoryWindow (Seconds (5.0)),
+    m_antennaRadius (600.0),
+    m_predictionHorizon (Seconds (1.0)),
+    m_singleSocket (false),
+    m_coalesceResponses (false),
+    m_pollRoutingTable (false)
     ///m_rtable(Time (1))
 {
   NS_LOG_FUNCTION (this);
@@ -107,95 +158,68 @@ Atn::Receive (Ptr<Socket> socket)
     NS_ASSERT (InetSocketAddress::IsMatchingType (from));
     InetSocketAddress realFrom = InetSocketAddress::ConvertFrom (from);
     sender = realFrom.GetIpv4 ();
-    if (m_senderSockets.find(sender) == m_senderSockets.end ())
-      AddNodeToTable(sender);
-
     Ptr<Ipv4> ip = GetNode()->GetObject<Ipv4>();
     Ipv4Address addri = ip->GetAddress (1,0).GetLocal ();
+    // Собственный широковещательный пакет
+    if (sender == addri)
+      continue;
+
     SnrTag tag;
-    if (packet->PeekPacketTag(tag)) {
-        Ptr<SnrHistory> note = new SnrHistory(tag.Get(), Simulator::Now());
-        m_snrHistory[realFrom.GetIpv4 ()].push_back(note);
-
-        NS_LOG_DEBUG("[node "<<GetNode ()->GetId ()<<"] Received Packet with SNR = " << tag.Get() << " from " << realFrom.GetIpv4 () <<
-                       " to " << addri);
-
-        uint8_t* buffer = new uint8_t[packet->GetSize()];
-        packet->CopyData (buffer, packet->GetSize());
-        std::string s( buffer, buffer + packet->GetSize());
-        NS_LOG_DEBUG("[node "<<GetNode()->GetId ()<<"] Полезная нагрузка: " << s);
-
-
-        // Парсинг строки через удаление пробелов
-        size_t pos = 0;
-        std::string token;
-        int counter = 1;
-        int msgType = 0;
-        ns3::Ipv4Address newNeighbour;
-        if (m_neighbourPos.find (sender) == m_neighbourPos.end ()) {
-          NeighbourPos *neigh = new NeighbourPos();
-          m_neighbourPos.insert (std::pair<ns3::Ipv4Address, NeighbourPos*>(sender, neigh));
-        }
-        while ((pos = s.find(" ")) != std::string::npos) {
-
-            token = s.substr(0, pos);
-            std::cout << token << std::endl;
-            s.erase(0, pos + 1);
-            double temp = 0.0;
-            switch (counter) {
-              case 1:
-                msgType = std::atoi(token.c_str ());
-                break;
-              case 2:
-                temp = std::atof(token.c_str ());
-                m_neighbourPos[sender]->posX = temp;
-                break;
-              case 3:
-                m_neighbourPos[sender]->posY = std::atof(token.c_str ());
-                break;
-              case 4:
-                m_neighbourPos[sender]->speedX = std::atof(token.c_str ());
-                break;
-              case 5:
-                m_neighbourPos[sender]->speedY = std::atof(token.c_str ());
-                break;
-              case 6:
-                newNeighbour.Set ((uint32_t) std::atoi(token.c_str ()));
-                break;
-            }
-
-            counter++;
-        }
-
-
-        // Отправим всем соседям сведение о том, что в радиус их действия вошел sender
-        std::vector<ns3::Ipv4Address> crossNeigh = getCrossNeighbours(sender);
-        if (!crossNeigh.empty ())
-          for (std::vector<ns3::Ipv4Address>::iterator it = crossNeigh.begin (); it != crossNeigh.end (); ++it) {
-            Send(m_senderSockets[*it], RESPONSE, sender.Get ());
-          }
-        SendReply(msgType, sender, &newNeighbour);
-    }
-  }
-}
+    if (!packet->PeekPacketTag(tag))
+      continue;
 
-// Проверим дистанцию, которая будет через секунду и отправим Hello
-std::vector<ns3::Ipv4Address> Atn::getCrossNeighbours(ns3::Ipv4Address sender) {
-  double senderNextX = m_neighbourPos[sender]->posX + m_neighbourPos[sender]->speedX;
-  double senderNextY = m_neighbourPos[sender]->posY + m_neighbourPos[sender]->speedY;
-  std::vector<ns3::Ipv4Address> neigh;
-  for (std::map<ns3::Ipv4Address, NeighbourPos*>::const_iterator it = m_neighbourPos.begin (); it != m_neighbourPos.end (); ++it) {
-    if (it->first == sender)
+    AtnHeader header;
+    packet->RemoveHeader (header);
+    NS_LOG_DEBUG("[node "<<GetNode()->GetId ()<<"] Заголовок: " << header);
+
+    // Объединенное широковещательное сообщение адресовано не нам: берем из него только координаты
+    // уже отслеживаемого узла, не заводя под отправителя запись и не учитывая SNR
+    bool recipient = header.IsRecipient (addri);
+    if (!recipient && m_senderSockets.find(sender) == m_senderSockets.end ())
       continue;
 
-    double nextX = it->second->posX + it->second->speedX;
-    double nextY = it->second->posY + it->second->speedY;
+    if (recipient) {
+      if (m_senderSockets.find(sender) == m_senderSockets.end ()) {
+        AddNodeToTable(sender);
+        // Как и при сверке с таблицей, узел без маршрута OLSR не отслеживается дольше интервала сверки
+        if (!m_pollRoutingTable && !IsRouted (sender))
+          Simulator::Schedule (Seconds (1), &Atn::CheckRoute, this, sender);
+      }
+
+      GetSnrHistory (sender).Add (Simulator::Now (), tag.Get ());
+      NS_LOG_DEBUG("[node "<<GetNode ()->GetId ()<<"] Received Packet with SNR = " << tag.Get() << " from " << sender <<
+                     " to " << addri);
+    }
 
-    double distance = sqrt(pow(senderNextX - nextX, 2) + pow(senderNextY - nextY, 2));
-    if (distance < ANTENNA_RADIUS)
-      neigh.push_back(it->first);
+    if (m_neighbourPos.find (sender) == m_neighbourPos.end ()) {
+      NeighbourPos *neigh = new NeighbourPos();
+      m_neighbourPos.insert (std::pair<ns3::Ipv4Address, NeighbourPos*>(sender, neigh));
+    }
+    Vector pos = header.GetPosition ();
+    Vector speed = header.GetVelocity ();
+    m_neighbourPos[sender]->posX = pos.x;
+    m_neighbourPos[sender]->posY = pos.y;
+    m_neighbourPos[sender]->speedX = speed.x;
+    m_neighbourPos[sender]->speedY = speed.y;
+    double horizon = m_predictionHorizon.GetSeconds ();
+    m_neighbourGrid.Update (sender, pos.x + speed.x * horizon, pos.y + speed.y * horizon);
+
+    if (!recipient)
+      continue;
+
+    int msgType = header.GetMessageType ();
+    ns3::Ipv4Address newNeighbour = header.GetNewNeighbour ();
+    // Отправим всем соседям сведение о том, что в радиус их действия вошел sender
+    std::vector<ns3::Ipv4Address> crossNeigh = getCrossNeighbours(sender);
+    if (!crossNeigh.empty ())
+      SendResponses(crossNeigh, sender);
+    SendReply(msgType, sender, &newNeighbour);
   }
-  return neigh;
+}
+
+// Проверим дистанцию, которая будет через PredictionHorizon и отправим Hello
+std::vector<ns3::Ipv4Address> Atn::getCrossNeighbours(ns3::Ipv4Address sender) {
+  return m_neighbourGrid.GetNeighbours (sender, m_antennaRadius);
 }
 
 void Atn::SendReply(const int &msgType, ns3::Ipv4Address sender, ns3::Ipv4Address *newNeighbour) {
@@ -211,7 +235,7 @@ void Atn::SendReply(const int &msgType, ns3::Ipv4Address sender, ns3::Ipv4Addres
     NS_LOG_DEBUG("[node " << GetNode ()->GetId () << "] Отправляем обратно пакет к " << sender);
 
     if (m_senderSockets.find (sender) != m_senderSockets.end ()) {
-      status = Send(m_senderSockets[sender], RESPONSE, 0);
+      status = Send(sender, RESPONSE, 0);
       if (status < 0) {
         olsrRp->SendHello ();
         NS_LOG_DEBUG("[node " << GetNode ()->GetId () << "] Узла " << sender << " в таблице маршрутизации не имеется."<<
@@ -227,8 +251,7 @@ void Atn::SendReply(const int &msgType, ns3::Ipv4Address sender, ns3::Ipv4Addres
         InterviewNeighbour(olsrRp, sender);
       } else  {
         olsrRp->RemovePath (sender);
-        if (m_snrHistory.find(sender) != m_snrHistory.end())
-          m_snrHistory.erase (sender);
+        m_snrHistory.erase (sender);
         olsrRp->SendHello ();
       }
   }
@@ -237,57 +260,102 @@ void Atn::SendReply(const int &msgType, ns3::Ipv4Address sender, ns3::Ipv4Addres
 void Atn::InterviewNeighbour(Ptr<olsr::RoutingProtocol> olsr, ns3::Ipv4Address sender) {
   Time nextInterview = calculateNextInterview(sender);
   if (nextInterview < Seconds(0.0)) {
-    Send(m_senderSockets[sender], ERROR, 0);
+    Send(sender, ERROR, 0);
     // Требуется заменить на удаление из NeighborSet  в m_state
     // Так как на основе состояния пересчитывается таблица маршрутизации m_route
     olsr->RemovePath (sender);
     m_snrHistory.erase (sender);
     olsr->SendHello ();
   } else {
-    Simulator::Schedule (nextInterview, &Atn::Send, this, m_senderSockets[sender], REQUEST, sender.Get ());
+    Simulator::Schedule (nextInterview, &Atn::Send, this, sender, REQUEST, sender.Get ());
   }
 }
 
 Time Atn::calculateNextInterview(Ipv4Address &node) {
-  Ptr<SnrHistory> s = m_snrHistory[node].back();
-  double snr = s->snr;
-  double time = log(snr/MIN_SNR);
+  std::map<ns3::Ipv4Address, AtnSnrHistory>::const_iterator it = m_snrHistory.find (node);
+  if (it == m_snrHistory.end () || it->second.IsEmpty ())
+    return Seconds(1.0);
+
+  Time interval = GetInterviewInterval (it->second, Simulator::Now ());
+  NS_LOG_DEBUG("Опрос узла " << node << " будет произведен через " << interval);
+  return interval;
+}
+
+Time Atn::GetInterviewInterval (const AtnSnrHistory &history, Time now) {
+  double time = log(history.GetLastSnr ()/MIN_SNR);
+  Time crossing;
+  // Регрессии по нескольким отсчетам, пришедшим почти одновременно, не доверяем
+  if (time > 0.0 && static_cast<int> (history.GetN ()) >= MIN_REGRESSION_SIZE
+      && history.GetSpan () >= Seconds (MIN_REGRESSION_SPAN) && history.PredictCrossing (MIN_SNR, crossing)) {
+    double untilCrossing = (crossing - now).GetSeconds ();
+    if (untilCrossing > 0.0)
+      time = untilCrossing;
+  }
   if (time > 1.0)
     time = 1.0;
-  NS_LOG_DEBUG("Опрос узла " << node << " будет произведен через " << Seconds(time));
   return Seconds(time);
 }
 
+AtnSnrHistory& Atn::GetSnrHistory (ns3::Ipv4Address node) {
+  std::map<ns3::Ipv4Address, AtnSnrHistory>::iterator it = m_snrHistory.find (node);
+  if (it == m_snrHistory.end ())
+    it = m_snrHistory.insert (std::make_pair (node, AtnSnrHistory (m_snrHistorySize, m_snrHistoryWindow))).first;
+  return it->second;
+}
+
 
-// +---------------+--------------+--------------+-------------------+-------------------+----------------------------+
-// | Тип сообщения | Координата Х | Координата Y | Вектор скорости Х | Вектор скорости Y | IP Address будущего соседа |
-// +---------------+--------------+--------------+-------------------+-------------------+----------------------------+
-void Atn::WritePos(const int &msgType, std::string &data, uint32_t newNeighbour) {
+void Atn::WritePos(const int &msgType, AtnHeader &header, uint32_t newNeighbour) {
   Ptr<MobilityModel> mobModel = GetNode()->GetObject<MobilityModel> ();
-  Vector3D pos = mobModel->GetPosition ();
-  Vector3D speed = mobModel->GetVelocity ();
-
-  std::ostringstream strs;
-  strs << msgType << " " << roundf(pos.x * 100) / 100 << " " << roundf(pos.y * 100) / 100 << " " <<
-          roundf(speed.x * 100) / 100 << " " << roundf(speed.y * 100) / 100 << " " << newNeighbour;
-  data = strs.str();
-  NS_LOG_DEBUG("[node " << GetNode ()->GetId () << "] " << data);
+  header.SetMessageType (msgType);
+  header.SetPosition (mobModel->GetPosition ());
+  header.SetVelocity (mobModel->GetVelocity ());
+  header.SetNewNeighbour (Ipv4Address (newNeighbour));
+  NS_LOG_DEBUG("[node " << GetNode ()->GetId () << "] " << header);
 }
 
 int
-Atn::Send (Ptr<ns3::Socket> sock, int msgType, uint32_t newNeighbour)
+Atn::Send (Ipv4Address dest, int msgType, uint32_t newNeighbour)
 {
   NS_LOG_FUNCTION (this << Simulator::Now());
 
-  std::string msg;
-  WritePos(msgType, msg, newNeighbour);
-  Ptr<Packet> p = Create<Packet> ((uint8_t*) msg.c_str(), msg.length());
-  Ptr<ns3::Node> n = GetNode();
-  Ptr<Ipv4> ipv4 = n->GetObject<Ipv4> ();
-  int status = sock->Send(p);
+  // Сосед мог быть удален, пока отправка ожидала в очереди событий
+  std::map<ns3::Ipv4Address, Ptr<Socket> >::iterator it = m_senderSockets.find (dest);
+  if (it == m_senderSockets.end ())
+    return -1;
+
+  AtnHeader header;
+  WritePos(msgType, header, newNeighbour);
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (header);
+  if (m_singleSocket)
+    return m_listenSocket->SendTo (p, 0, InetSocketAddress (dest, ATN_PORT));
+  int status = it->second->Send(p);
   return status;
 }
 
+void
+Atn::SendResponses (const std::vector<ns3::Ipv4Address> &recipients, ns3::Ipv4Address newNeighbour)
+{
+  NS_LOG_FUNCTION (this << recipients.size () << newNeighbour);
+  if (!m_singleSocket || !m_coalesceResponses || recipients.size () < 2) {
+    for (std::vector<ns3::Ipv4Address>::const_iterator it = recipients.begin (); it != recipients.end (); ++it)
+      Send(*it, RESPONSE, newNeighbour.Get ());
+    return;
+  }
+
+  // Список получателей в заголовке ограничен 255 адресами
+  std::vector<ns3::Ipv4Address>::const_iterator it = recipients.begin ();
+  while (it != recipients.end ()) {
+    AtnHeader header;
+    WritePos(RESPONSE, header, newNeighbour.Get ());
+    for (uint32_t n = 0; n < 255 && it != recipients.end (); ++n, ++it)
+      header.AddRecipient (*it);
+    Ptr<Packet> p = Create<Packet> ();
+    p->AddHeader (header);
+    m_listenSocket->SendTo (p, 0, InetSocketAddress (Ipv4Address::GetBroadcast (), ATN_PORT));
+  }
+}
+
 void
 Atn::StartApplication (void)
 {
@@ -297,13 +365,36 @@ Atn::StartApplication (void)
   {
     TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
     m_listenSocket = Socket::CreateSocket (GetNode (), tid);
-    int status = m_listenSocket->Bind (InetSocketAddress (Ipv4Address::GetAny (), 100));
+    int status = m_listenSocket->Bind (InetSocketAddress (Ipv4Address::GetAny (), ATN_PORT));
     NS_ASSERT (status != -1);
+    m_listenSocket->SetAllowBroadcast (m_singleSocket && m_coalesceResponses);
     m_listenSocket->SetRecvCallback (MakeCallback(&Atn::Receive, this));
     m_listenSocket->Listen ();
   }
 
-  Simulator::Schedule(Seconds ((0.1)), &Atn::GetRoutingTable, this);
+  m_neighbourGrid.SetCellSize (m_antennaRadius);
+
+  if (!m_routingTableFile.empty () && m_routingStream == 0)
+    m_routingStream = Create<OutputStreamWrapper>(m_routingTableFile, std::ios::out);
+
+  if (m_pollRoutingTable) {
+    m_routingTablePoll = Simulator::Schedule(Seconds ((0.1)), &Atn::GetRoutingTable, this);
+    return;
+  }
+
+  // Реагируем на изменения таблицы маршрутизации OLSR вместо ее периодического опроса.
+  // Как и при опросе, узел отслеживается, пока до него есть маршрут, а не только пока он сосед
+  Ptr<olsr::RoutingProtocol> olsrRp = GetOlsr ();
+  olsrRp->TraceConnectWithoutContext ("NeighbourAdded", MakeCallback (&Atn::NeighbourAdded, this));
+  olsrRp->TraceConnectWithoutContext ("RouteLost", MakeCallback (&Atn::NeighbourLost, this));
+  if (m_routingStream != 0)
+    olsrRp->TraceConnectWithoutContext ("RoutingTableChanged", MakeCallback (&Atn::DumpRoutingTable, this));
+
+  // Соседи, появившиеся до запуска приложения
+  std::vector<olsr::RoutingTableEntry> allDestination = olsrRp->GetRoutingTableEntries ();
+  for (std::vector<olsr::RoutingTableEntry>::iterator it = allDestination.begin (); it != allDestination.end (); ++it)
+    if ((*it).distance == 1)
+      NeighbourAdded ((*it).destAddr);
 }
 
 void
@@ -311,8 +402,17 @@ Atn::StopApplication (void)
 {
   NS_LOG_FUNCTION (this);
   m_next.Cancel ();
+  m_routingTablePoll.Cancel ();
+  if (!m_pollRoutingTable) {
+    Ptr<olsr::RoutingProtocol> olsrRp = GetOlsr ();
+    olsrRp->TraceDisconnectWithoutContext ("NeighbourAdded", MakeCallback (&Atn::NeighbourAdded, this));
+    olsrRp->TraceDisconnectWithoutContext ("RouteLost", MakeCallback (&Atn::NeighbourLost, this));
+    if (m_routingStream != 0)
+      olsrRp->TraceDisconnectWithoutContext ("RoutingTableChanged", MakeCallback (&Atn::DumpRoutingTable, this));
+  }
   for (std::map<ns3::Ipv4Address, Ptr<Socket> >::iterator it = m_senderSockets.begin() ; it != m_senderSockets.end(); ++it) {
-    it->second->Close();
+    if (it->second != 0)
+      it->second->Close();
     it->second = 0;
   }
   m_listenSocket->Close ();
@@ -321,62 +421,96 @@ Atn::StopApplication (void)
 
 void Atn::GetRoutingTable() {
   NS_LOG_FUNCTION(this << Simulator::Now () << "[node " << GetNode()->GetId());
-  Ptr<ns3::Node> n = GetNode();
-  Ptr<Ipv4> ipv4 = n->GetObject<Ipv4> ();
-  Ptr <ns3::Ipv4RoutingProtocol> rp = ipv4->GetRoutingProtocol ();
-  Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper>("/home/jimmbraddock/rablerouting.txt", std::ios::out);
-  rp->PrintRoutingTable(routingStream);
-  Ptr<olsr::RoutingProtocol> olsrRp;
-
-  olsrRp = DynamicCast<olsr::RoutingProtocol> (rp);
+  Ptr<olsr::RoutingProtocol> olsrRp = GetOlsr ();
+  DumpRoutingTable (0);
   std::vector<olsr::RoutingTableEntry> allDestination = olsrRp->GetRoutingTableEntries ();
 
-  std::vector<Ipv4Address> destAddrForRemoving;
+  std::set<Ipv4Address> destAddrForRemoving;
   for (std::map<ns3::Ipv4Address, Ptr<Socket> >::iterator it = m_senderSockets.begin ();
        it != m_senderSockets.end (); ++it) {
-    destAddrForRemoving.push_back (it->first);
+    destAddrForRemoving.insert (destAddrForRemoving.end (), it->first);
   }
 
   // Нет смысла следить за всеми доступными узлами, будем отслеживать лишь соседей
   for (std::vector<olsr::RoutingTableEntry>::iterator it = allDestination.begin (); it != allDestination.end ();
        ++it) {
-    if ((*it).distance == 1 && m_senderSockets.find ((*it).destAddr) == m_senderSockets.end ()) {
-      NS_LOG_DEBUG("[node " << GetNode ()->GetId () << "] Появился новый узел: " << (*it).destAddr);
-
-      AddNodeToTable((*it).destAddr);
-      Send(m_senderSockets[(*it).destAddr], REQUEST, 0);
-    }
+    if ((*it).distance == 1)
+      NeighbourAdded ((*it).destAddr);
 
     // Удалим узлы до которых по каким-либо причинам уже нет путей и алгоритм это не уследил
-    if (std::find(destAddrForRemoving.begin (), destAddrForRemoving.end(), (*it).destAddr) != destAddrForRemoving.end ())
-      for (std::vector<Ipv4Address>::iterator i = destAddrForRemoving.begin(); i != destAddrForRemoving.end(); ++i)
-        if (*i == (*it).destAddr) {
-          destAddrForRemoving.erase (i);
-          break;
-        }
+    destAddrForRemoving.erase ((*it).destAddr);
   }
 
-  for (std::vector<Ipv4Address>::iterator it = destAddrForRemoving.begin(); it != destAddrForRemoving.end(); ++it) {
-    NS_LOG_DEBUG("Уничтожим " << *it << " в таблице маршрутизации");
-    m_senderSockets[*it]->Close();
-    m_senderSockets[*it] = 0;
-    m_senderSockets.erase (*it);
-    m_snrHistory.erase (*it);
-    m_neighbourPos.erase(*it);
-  }
+  for (std::set<Ipv4Address>::iterator it = destAddrForRemoving.begin(); it != destAddrForRemoving.end(); ++it)
+    NeighbourLost (*it);
 
   // Сверяемся с таблицей маршрутизации каждую секунду, в соответствии со стандартным hello интервалом
-  Simulator::Schedule(Seconds ((1)), &Atn::GetRoutingTable, this);
+  m_routingTablePoll = Simulator::Schedule(Seconds ((1)), &Atn::GetRoutingTable, this);
+}
+
+Ptr<olsr::RoutingProtocol> Atn::GetOlsr (void) const {
+  Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
+  Ptr<olsr::RoutingProtocol> olsrRp = DynamicCast<olsr::RoutingProtocol> (ipv4->GetRoutingProtocol ());
+  NS_ASSERT_MSG (olsrRp != 0, "ATN requires OLSR as the node routing protocol");
+  return olsrRp;
+}
+
+void Atn::DumpRoutingTable (uint32_t size) {
+  if (m_routingStream == 0)
+    return;
+  Ptr<Ipv4RoutingProtocol> rp = GetOlsr ();
+  rp->PrintRoutingTable (m_routingStream);
+}
+
+void Atn::NeighbourAdded (Ipv4Address neighbour) {
+  if (m_senderSockets.find (neighbour) != m_senderSockets.end ())
+    return;
+  NS_LOG_DEBUG("[node " << GetNode ()->GetId () << "] Появился новый узел: " << neighbour);
+  AddNodeToTable(neighbour);
+  Send(neighbour, REQUEST, 0);
+}
+
+void Atn::NeighbourLost (Ipv4Address neighbour) {
+  std::map<ns3::Ipv4Address, Ptr<Socket> >::iterator it = m_senderSockets.find (neighbour);
+  if (it == m_senderSockets.end ())
+    return;
+  NS_LOG_DEBUG("Уничтожим " << neighbour << " в таблице маршрутизации");
+  if (it->second != 0)
+    it->second->Close();
+  m_senderSockets.erase (it);
+  m_snrHistory.erase (neighbour);
+  std::map<ns3::Ipv4Address, NeighbourPos*>::iterator pos = m_neighbourPos.find (neighbour);
+  if (pos != m_neighbourPos.end ()) {
+    delete pos->second;
+    m_neighbourPos.erase (pos);
+  }
+  m_neighbourGrid.Remove (neighbour);
+}
+
+void Atn::CheckRoute (Ipv4Address node) {
+  if (!IsRouted (node))
+    NeighbourLost (node);
+}
+
+bool Atn::IsRouted (Ipv4Address node) const {
+  std::vector<olsr::RoutingTableEntry> allDestination = GetOlsr ()->GetRoutingTableEntries ();
+  for (std::vector<olsr::RoutingTableEntry>::const_iterator it = allDestination.begin (); it != allDestination.end (); ++it)
+    if ((*it).destAddr == node)
+      return true;
+  return false;
 }
 
 void Atn::AddNodeToTable (ns3::Ipv4Address &node) {
-  std::vector<Ptr<SnrHistory> > snr;
-  m_snrHistory[node] = snr;
-  TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
-  Ptr<Socket> senderSocket = Socket::CreateSocket (GetNode (), tid);
-  senderSocket->Bind ();
-  int status = senderSocket->Connect (InetSocketAddress (node, 100));
-  NS_ASSERT(status != -1);
+  GetSnrHistory (node).Clear ();
+  // В режиме общего сокета соседу соответствует лишь запись в таблице
+  Ptr<Socket> senderSocket = 0;
+  if (!m_singleSocket) {
+    TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
+    senderSocket = Socket::CreateSocket (GetNode (), tid);
+    senderSocket->Bind ();
+    int status = senderSocket->Connect (InetSocketAddress (node, ATN_PORT));
+    NS_ASSERT(status != -1);
+  }
   m_senderSockets.insert(std::pair <Ipv4Address, Ptr<Socket> > (node, senderSocket));
 }
 
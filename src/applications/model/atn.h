@@ -23,25 +23,24 @@
 #include "ns3/average.h"
 #include "ns3/simulator.h"
 #include "ns3/olsr-routing-protocol.h"
+#include "atn-neighbour-grid.h"
+#include "atn-snr-history.h"
 #include <map>
 
 
-const int MIN_REGRESSION_SIZE = 20;
+const int MIN_REGRESSION_SIZE = 3;
+const double MIN_REGRESSION_SPAN = 1.0;
 const double MIN_SNR = 10.0;
 const int REQUEST = 1;
 const int RESPONSE = 2;
 const int ERROR = 3;
-const int ANTENNA_RADIUS = 600;
+const uint16_t ATN_PORT = 100;
 
 namespace ns3 {
 
 class Socket;
-
-struct SnrHistory: Object {
-  double snr;
-  Time time;
-  SnrHistory(double newSnr, Time now) : snr(newSnr), time(now) {}
-};
+class OutputStreamWrapper;
+class AtnHeader;
 
 struct NeighbourPos {
   double posX;
@@ -69,9 +68,40 @@ public:
   Atn ();
   virtual ~Atn ();
 
+  /**
+   * @brief Интервал до следующего опроса соседа по его истории SNR.
+   *        По последнему отсчету интервал равен ln(snr/MIN_SNR) с; если в окне не меньше
+   *        MIN_REGRESSION_SIZE отсчетов, охватывающих не меньше MIN_REGRESSION_SPAN с,
+   *        опрос назначается на прогнозируемый по регрессии момент падения SNR до MIN_SNR.
+   *        Интервал не превышает 1 с.
+   * @param history непустая история SNR соседа
+   * @param now текущее время
+   * @return интервал, отрицательный, если SNR уже ниже MIN_SNR
+   */
+  static Time GetInterviewInterval (const AtnSnrHistory &history, Time now);
+
 private:
+  /// Периодическая сверка со списком соседей OLSR, используется при PollRoutingTable
   void GetRoutingTable();
 
+  /// Протокол маршрутизации OLSR узла
+  Ptr<olsr::RoutingProtocol> GetOlsr (void) const;
+
+  /// Запись таблицы маршрутизации в RoutingTableFile, если он задан
+  void DumpRoutingTable (uint32_t size);
+
+  /// Появился сосед на расстоянии одного перехода
+  void NeighbourAdded (Ipv4Address neighbour);
+
+  /// До узла больше нет маршрута OLSR, удаляем все сведения о нем
+  void NeighbourLost (Ipv4Address neighbour);
+
+  /// Удаление узла, если через интервал сверки до него так и не появился маршрут OLSR
+  void CheckRoute (Ipv4Address node);
+
+  /// Есть ли у OLSR маршрут до узла
+  bool IsRouted (Ipv4Address node) const;
+
   // inherited from Application base class.
   virtual void StartApplication (void);
   virtual void StopApplication (void);
@@ -85,16 +115,24 @@ private:
 
   void Receive (Ptr<Socket> socket);
 
-  int Send (Ptr<Socket> sock, int msgType, uint32_t newNeighbour);
+  /**
+   * @brief Отправка сообщения соседу через его сокет или общий сокет в режиме SingleSocket
+   * @return результат отправки, -1 если сосед уже удален из таблицы
+   */
+  int Send (Ipv4Address dest, int msgType, uint32_t newNeighbour);
+
+  /// Отправка RESPONSE с адресом newNeighbour нескольким соседям, при CoalesceResponses одним широковещательным пакетом
+  void SendResponses (const std::vector<ns3::Ipv4Address> &recipients, ns3::Ipv4Address newNeighbour);
 
   /**
-   * @brief Вычисляет через какое время необходимо опросить узел. Данные для анализа берутся за временной промежуток,
-   *        если выборка маленькая, то происходит добор посредством опроса.
+   * @brief Вычисляет через какое время необходимо опросить узел, см. GetInterviewInterval.
+   *        Если истории SNR узла еще нет, опрос происходит через 1 с.
    * @param node опрашиваемый узел
    */
   Time calculateNextInterview(Ipv4Address &node);
 
-  void WritePos(const int &msgType, std::string &data, uint32_t newNeighbour);
+  /// Заполнение заголовка сообщения текущими координатами и скоростью узла
+  void WritePos(const int &msgType, AtnHeader &header, uint32_t newNeighbour);
 
   /// Получение списка ip адресов соседей, радиус зоны передачи которых охватывает sender'a
   std::vector<ns3::Ipv4Address> getCrossNeighbours(ns3::Ipv4Address sender);
@@ -111,10 +149,10 @@ private:
    */
   uint32_t m_size;
 
-  /// Пул передающих сокетов
+  /// Пул передающих сокетов, в режиме SingleSocket сокеты нулевые
   std::map<ns3::Ipv4Address, Ptr<Socket> > m_senderSockets;
 
-  /// Принимающий сокет
+  /// Принимающий сокет, в режиме SingleSocket через него же идет отправка
   Ptr<Socket> m_listenSocket;
 
   /// produce ping-style output if true
@@ -126,11 +164,47 @@ private:
   /// Время следующей отправки
   Time m_nextSend;
 
+  /// Получение истории SNR узла, создается при первом обращении
+  AtnSnrHistory& GetSnrHistory (ns3::Ipv4Address node);
+
   /// История SNR для каждого узла
-  std::map<ns3::Ipv4Address, std::vector< Ptr<SnrHistory> > > m_snrHistory;
+  std::map<ns3::Ipv4Address, AtnSnrHistory> m_snrHistory;
+
+  /// Максимальное количество отсчетов в истории SNR
+  uint32_t m_snrHistorySize;
+
+  /// Окно, за которое строится регрессия SNR
+  Time m_snrHistoryWindow;
 
   /// Таблица маршрутизации
   std::map<ns3::Ipv4Address, NeighbourPos*> m_neighbourPos;
+
+  /// Индекс прогнозируемых позиций соседей
+  AtnNeighbourGrid m_neighbourGrid;
+
+  /// Радиус зоны действия антенны, м
+  double m_antennaRadius;
+
+  /// Горизонт прогноза позиции соседей
+  Time m_predictionHorizon;
+
+  /// Отправка через один неподключенный сокет
+  bool m_singleSocket;
+
+  /// Объединение RESPONSE нескольким соседям в один широковещательный пакет
+  bool m_coalesceResponses;
+
+  /// Опрос таблицы маршрутизации вместо подписки на события OLSR
+  bool m_pollRoutingTable;
+
+  /// Следующий опрос таблицы маршрутизации
+  EventId m_routingTablePoll;
+
+  /// Файл для записи таблицы маршрутизации
+  std::string m_routingTableFile;
+
+  /// Поток записи таблицы маршрутизации
+  Ptr<OutputStreamWrapper> m_routingStream;
 };
 
 } // namespace ns3
@@ -0,0 +1,314 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "ns3/atn.h"
+#include "ns3/atn-header.h"
+#include "ns3/atn-neighbour-grid.h"
+#include "ns3/atn-snr-history.h"
+#include "ns3/packet.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * Test that an ATN header, with and without a recipient list, survives
+ * serialization through a packet.
+ */
+class AtnHeaderTestCase : public TestCase
+{
+public:
+  AtnHeaderTestCase ();
+  virtual ~AtnHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AtnHeaderTestCase::AtnHeaderTestCase ()
+  : TestCase ("Test the ATN header serialization")
+{
+}
+
+AtnHeaderTestCase::~AtnHeaderTestCase ()
+{
+}
+
+void
+AtnHeaderTestCase::DoRun (void)
+{
+  AtnHeader header;
+  header.SetMessageType (2);
+  header.SetPosition (Vector (-1234.567, 89.014, 300.0));
+  header.SetVelocity (Vector (250.5, -0.25, 0.0));
+  header.SetNewNeighbour (Ipv4Address ("10.1.1.7"));
+
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (header);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 22, "Wrong serialized size without recipients");
+
+  AtnHeader copy;
+  p->RemoveHeader (copy);
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (copy.GetMessageType ()), 2, "Wrong message type");
+  NS_TEST_ASSERT_MSG_EQ_TOL (copy.GetPosition ().x, -1234.57, 1e-9, "Wrong X");
+  NS_TEST_ASSERT_MSG_EQ_TOL (copy.GetPosition ().y, 89.01, 1e-9, "Wrong Y");
+  NS_TEST_ASSERT_MSG_EQ_TOL (copy.GetVelocity ().x, 250.5, 1e-9, "Wrong speed X");
+  NS_TEST_ASSERT_MSG_EQ_TOL (copy.GetVelocity ().y, -0.25, 1e-9, "Wrong speed Y");
+  NS_TEST_ASSERT_MSG_EQ (copy.GetNewNeighbour (), Ipv4Address ("10.1.1.7"), "Wrong new neighbour");
+  NS_TEST_ASSERT_MSG_EQ (copy.IsRecipient (Ipv4Address ("10.1.1.9")), true,
+                         "Message without recipients is addressed to everyone");
+
+  header.AddRecipient (Ipv4Address ("10.1.1.2"));
+  header.AddRecipient (Ipv4Address ("10.1.1.3"));
+  p->AddHeader (header);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 30, "Wrong serialized size with recipients");
+  p->RemoveHeader (copy);
+  NS_TEST_ASSERT_MSG_EQ (copy.GetRecipients ().size (), 2, "Wrong number of recipients");
+  NS_TEST_ASSERT_MSG_EQ (copy.IsRecipient (Ipv4Address ("10.1.1.3")), true, "Recipient was lost");
+  NS_TEST_ASSERT_MSG_EQ (copy.IsRecipient (Ipv4Address ("10.1.1.9")), false, "Unexpected recipient");
+}
+
+/**
+ * Test that the neighbour grid returns exactly the nodes a brute force
+ * search over all nodes finds, while nodes move between cells.
+ */
+class AtnNeighbourGridTestCase : public TestCase
+{
+public:
+  AtnNeighbourGridTestCase ();
+  virtual ~AtnNeighbourGridTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AtnNeighbourGridTestCase::AtnNeighbourGridTestCase ()
+  : TestCase ("Test that the ATN neighbour grid matches a brute force radius search")
+{
+}
+
+AtnNeighbourGridTestCase::~AtnNeighbourGridTestCase ()
+{
+}
+
+void
+AtnNeighbourGridTestCase::DoRun (void)
+{
+  const uint32_t nNodes = 200;
+  const double radius = 600.0;
+  Ptr<UniformRandomVariable> rv = CreateObject<UniformRandomVariable> ();
+  rv->SetStream (1);
+
+  AtnNeighbourGrid grid;
+  grid.SetCellSize (radius);
+  std::vector<double> xs (nNodes);
+  std::vector<double> ys (nNodes);
+
+  for (uint32_t round = 0; round < 5; ++round)
+    {
+      for (uint32_t i = 0; i < nNodes; ++i)
+        {
+          xs[i] = rv->GetValue (-3000.0, 3000.0);
+          ys[i] = rv->GetValue (-3000.0, 3000.0);
+          grid.Update (Ipv4Address (i + 1), xs[i], ys[i]);
+        }
+      NS_TEST_ASSERT_MSG_EQ (grid.GetN (), nNodes, "Wrong number of indexed nodes");
+
+      // Радиус запроса может вырасти после задания стороны ячейки
+      const double queries[] = { radius, 2.5 * radius };
+      for (uint32_t q = 0; q < 2; ++q)
+        {
+          for (uint32_t i = 0; i < nNodes; ++i)
+            {
+              std::vector<Ipv4Address> expected;
+              for (uint32_t j = 0; j < nNodes; ++j)
+                {
+                  if (j != i && std::sqrt (std::pow (xs[i] - xs[j], 2) + std::pow (ys[i] - ys[j], 2)) < queries[q])
+                    {
+                      expected.push_back (Ipv4Address (j + 1));
+                    }
+                }
+              std::vector<Ipv4Address> found = grid.GetNeighbours (Ipv4Address (i + 1), queries[q]);
+              std::sort (found.begin (), found.end ());
+              NS_TEST_ASSERT_MSG_EQ (found.size (), expected.size (), "Wrong neighbour count for node " << i <<
+                                     " within " << queries[q] << " m");
+              NS_TEST_ASSERT_MSG_EQ ((found == expected), true, "Wrong neighbours for node " << i <<
+                                     " within " << queries[q] << " m");
+            }
+        }
+    }
+
+  grid.Remove (Ipv4Address (1));
+  NS_TEST_ASSERT_MSG_EQ (grid.GetN (), nNodes - 1, "Node was not removed");
+  NS_TEST_ASSERT_MSG_EQ (grid.GetNeighbours (Ipv4Address (1), radius).size (), 0,
+                         "Removed node must have no neighbours");
+  for (uint32_t i = 1; i < nNodes; ++i)
+    {
+      std::vector<Ipv4Address> found = grid.GetNeighbours (Ipv4Address (i + 1), radius);
+      NS_TEST_ASSERT_MSG_EQ ((std::find (found.begin (), found.end (), Ipv4Address (1)) == found.end ()), true,
+                             "Removed node is still reported as a neighbour");
+    }
+}
+
+/**
+ * Test that the SNR ring buffer keeps a bounded window and that its
+ * running regression matches a batch least squares fit.
+ */
+class AtnSnrHistoryTestCase : public TestCase
+{
+public:
+  AtnSnrHistoryTestCase ();
+  virtual ~AtnSnrHistoryTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AtnSnrHistoryTestCase::AtnSnrHistoryTestCase ()
+  : TestCase ("Test the ATN SNR ring buffer and its running regression")
+{
+}
+
+AtnSnrHistoryTestCase::~AtnSnrHistoryTestCase ()
+{
+}
+
+void
+AtnSnrHistoryTestCase::DoRun (void)
+{
+  AtnSnrHistory history (8, Seconds (100.0));
+  double slope;
+  double intercept;
+  Time crossing;
+
+  NS_TEST_ASSERT_MSG_EQ (history.IsEmpty (), true, "New history must be empty");
+  history.Add (Seconds (10.0), 40.0);
+  NS_TEST_ASSERT_MSG_EQ (history.GetRegression (slope, intercept), false, "One sample is not enough");
+
+  // SNR = 40 - 2 * (t - 10), crosses 10 at t = 25 s
+  for (uint32_t i = 1; i < 20; ++i)
+    {
+      history.Add (Seconds (10.0 + i * 0.5), 40.0 - i * 1.0);
+    }
+  NS_TEST_ASSERT_MSG_EQ (history.GetN (), 8, "Capacity must bound the number of samples");
+  NS_TEST_ASSERT_MSG_EQ_TOL (history.GetLastSnr (), 21.0, 1e-9, "Wrong last sample");
+  NS_TEST_ASSERT_MSG_EQ (history.GetRegression (slope, intercept), true, "Regression must exist");
+  NS_TEST_ASSERT_MSG_EQ_TOL (slope, -2.0, 1e-9, "Wrong slope");
+  NS_TEST_ASSERT_MSG_EQ (history.PredictCrossing (10.0, crossing), true, "Falling SNR must cross");
+  NS_TEST_ASSERT_MSG_EQ_TOL (crossing.GetSeconds (), 25.0, 1e-6, "Wrong crossing time");
+
+  // Samples older than the window are evicted
+  AtnSnrHistory windowed (64, Seconds (1.0));
+  for (uint32_t i = 0; i <= 40; ++i)
+    {
+      windowed.Add (Seconds (i * 0.1), 30.0);
+    }
+  NS_TEST_ASSERT_MSG_EQ (windowed.GetN (), 11, "Window must bound the number of samples");
+  NS_TEST_ASSERT_MSG_EQ (windowed.GetRegression (slope, intercept), true, "Regression must exist");
+  NS_TEST_ASSERT_MSG_EQ_TOL (slope, 0.0, 1e-9, "Constant SNR must have zero slope");
+  NS_TEST_ASSERT_MSG_EQ (windowed.PredictCrossing (10.0, crossing), false, "Constant SNR never crosses");
+
+  windowed.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (windowed.IsEmpty (), true, "Cleared history must be empty");
+
+  // A link which stays up for a long flight keeps an exact regression
+  AtnSnrHistory flight (64, Seconds (5.0));
+  for (uint32_t i = 0; i < 200000; ++i)
+    {
+      flight.Add (Seconds (i * 0.5), 30.0 + (i % 2));
+    }
+  for (uint32_t i = 0; i < 20; ++i)
+    {
+      flight.Add (Seconds (100000.0 + i * 0.5), 40.0 - i * 1.0);
+    }
+  NS_TEST_ASSERT_MSG_EQ (flight.GetN (), 11, "Window must bound the number of samples");
+  NS_TEST_ASSERT_MSG_EQ_TOL (flight.GetSpan ().GetSeconds (), 5.0, 1e-9, "Wrong span");
+  NS_TEST_ASSERT_MSG_EQ (flight.GetRegression (slope, intercept), true, "Regression must exist");
+  NS_TEST_ASSERT_MSG_EQ_TOL (slope, -2.0, 1e-9, "Wrong slope after a long flight");
+  NS_TEST_ASSERT_MSG_EQ (flight.PredictCrossing (10.0, crossing), true, "Falling SNR must cross");
+  NS_TEST_ASSERT_MSG_EQ_TOL (crossing.GetSeconds (), 100015.0, 1e-6, "Wrong crossing time after a long flight");
+}
+
+/**
+ * Test that the interview interval follows the predicted crossing of
+ * MIN_SNR once the window holds enough samples over enough time.
+ */
+class AtnInterviewIntervalTestCase : public TestCase
+{
+public:
+  AtnInterviewIntervalTestCase ();
+  virtual ~AtnInterviewIntervalTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AtnInterviewIntervalTestCase::AtnInterviewIntervalTestCase ()
+  : TestCase ("Test that the predicted SNR crossing shortens the ATN interview interval")
+{
+}
+
+AtnInterviewIntervalTestCase::~AtnInterviewIntervalTestCase ()
+{
+}
+
+void
+AtnInterviewIntervalTestCase::DoRun (void)
+{
+  // SNR = 60 - 30 * t, crosses MIN_SNR = 10 at t = 5/3 s, while
+  // ln (30 / 10) > 1 s from the last sample alone
+  AtnSnrHistory history (64, Seconds (5.0));
+  history.Add (Seconds (0.0), 60.0);
+  history.Add (Seconds (0.5), 45.0);
+  NS_TEST_ASSERT_MSG_EQ (Atn::GetInterviewInterval (history, Seconds (0.5)), Seconds (1.0),
+                         "Two samples must not be trusted");
+  history.Add (Seconds (1.0), 30.0);
+  NS_TEST_ASSERT_MSG_EQ_TOL (Atn::GetInterviewInterval (history, Seconds (1.0)).GetSeconds (), 2.0 / 3.0, 1e-6,
+                             "The predicted crossing must shorten the interval");
+
+  // As many samples received almost at once are not a trend
+  AtnSnrHistory burst (64, Seconds (5.0));
+  burst.Add (Seconds (0.0), 60.0);
+  burst.Add (Seconds (0.1), 45.0);
+  burst.Add (Seconds (0.2), 30.0);
+  NS_TEST_ASSERT_MSG_EQ (Atn::GetInterviewInterval (burst, Seconds (0.2)), Seconds (1.0),
+                         "Samples over a short span must not be trusted");
+
+  // Below MIN_SNR the neighbour is dropped
+  AtnSnrHistory weak (64, Seconds (5.0));
+  weak.Add (Seconds (0.0), 5.0);
+  NS_TEST_ASSERT_MSG_LT (Atn::GetInterviewInterval (weak, Seconds (0.0)), Seconds (0.0),
+                         "SNR below MIN_SNR must give a negative interval");
+}
+
+class AtnTestSuite : public TestSuite
+{
+public:
+  AtnTestSuite ();
+};
+
+AtnTestSuite::AtnTestSuite ()
+  : TestSuite ("atn", UNIT)
+{
+  AddTestCase (new AtnHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new AtnNeighbourGridTestCase, TestCase::QUICK);
+  AddTestCase (new AtnSnrHistoryTestCase, TestCase::QUICK);
+  AddTestCase (new AtnInterviewIntervalTestCase, TestCase::QUICK);
+}
+
+static AtnTestSuite atnTestSuite;
@@ -20,18 +20,165 @@
 
 #include "event-impl.h"
 #include "log.h"
+#include "ns3/core-config.h"
+#include <new>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
 
 NS_LOG_COMPONENT_DEFINE ("EventImpl");
 
 namespace ns3 {
 
+namespace {
+
+/// events are pooled in size classes of this many bytes
+const size_t POOL_GRANULARITY = 16;
+/// number of size classes: larger events use the global allocator
+const uint32_t POOL_CLASSES = 16;
+/// maximum number of free blocks kept per thread and size class
+const uint32_t POOL_MAX_FREE = 4096;
+
+struct FreeBlock
+{
+  FreeBlock *next;
+};
+
+/// The free lists of a thread
+struct EventPool
+{
+  FreeBlock *head[POOL_CLASSES];
+  uint32_t count[POOL_CLASSES];
+};
+
+void
+DestroyEventPool (void *p)
+{
+  EventPool *pool = static_cast<EventPool *> (p);
+  for (uint32_t i = 0; i < POOL_CLASSES; i++)
+    {
+      while (pool->head[i] != 0)
+        {
+          FreeBlock *block = pool->head[i];
+          pool->head[i] = block->next;
+          ::operator delete (block);
+        }
+    }
+  delete pool;
+}
+
+EventPool *
+CreateEventPool (void)
+{
+  EventPool *pool = new EventPool ();
+  for (uint32_t i = 0; i < POOL_CLASSES; i++)
+    {
+      pool->head[i] = 0;
+      pool->count[i] = 0;
+    }
+  return pool;
+}
+
+#ifdef HAVE_PTHREAD_H
+
+__thread EventPool *g_eventPool = 0;
+pthread_key_t g_eventPoolKey;
+pthread_once_t g_eventPoolOnce = PTHREAD_ONCE_INIT;
+
+void
+ReleaseEventPool (void *p)
+{
+  DestroyEventPool (p);
+  // events destroyed later in the exit of the thread get a new pool
+  g_eventPool = 0;
+}
+
+void
+CreateEventPoolKey (void)
+{
+  // the key only serves to release the free lists when a thread exits
+  pthread_key_create (&g_eventPoolKey, &ReleaseEventPool);
+}
+
+EventPool *
+GetEventPool (void)
+{
+  if (g_eventPool == 0)
+    {
+      pthread_once (&g_eventPoolOnce, &CreateEventPoolKey);
+      g_eventPool = CreateEventPool ();
+      pthread_setspecific (g_eventPoolKey, g_eventPool);
+    }
+  return g_eventPool;
+}
+
+#else /* HAVE_PTHREAD_H */
+
+EventPool *
+GetEventPool (void)
+{
+  static EventPool *pool = CreateEventPool ();
+  return pool;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+} // anonymous namespace
+
+void *
+EventImpl::operator new (size_t size)
+{
+  uint32_t sizeClass = (size - 1) / POOL_GRANULARITY;
+  if (sizeClass >= POOL_CLASSES)
+    {
+      return ::operator new (size);
+    }
+  EventPool *pool = GetEventPool ();
+  FreeBlock *block = pool->head[sizeClass];
+  if (block == 0)
+    {
+      return ::operator new ((sizeClass + 1) * POOL_GRANULARITY);
+    }
+  pool->head[sizeClass] = block->next;
+  pool->count[sizeClass]--;
+  return block;
+}
+
+void
+EventImpl::operator delete (void *p, size_t size)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  uint32_t sizeClass = (size - 1) / POOL_GRANULARITY;
+  if (sizeClass >= POOL_CLASSES)
+    {
+      ::operator delete (p);
+      return;
+    }
+  // the block may have been allocated by another thread: all blocks
+  // come from the global allocator, so any thread may keep it.
+  EventPool *pool = GetEventPool ();
+  if (pool->count[sizeClass] >= POOL_MAX_FREE)
+    {
+      ::operator delete (p);
+      return;
+    }
+  FreeBlock *block = static_cast<FreeBlock *> (p);
+  block->next = pool->head[sizeClass];
+  pool->head[sizeClass] = block;
+  pool->count[sizeClass]++;
+}
+
 EventImpl::~EventImpl ()
 {
   NS_LOG_FUNCTION (this);
 }
 
 EventImpl::EventImpl ()
-  : m_cancel (false)
+  : m_cancel (false),
+    m_schedulerIndex (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -60,4 +207,16 @@ EventImpl::IsCancelled (void)
   return m_cancel;
 }
 
+void
+EventImpl::SetSchedulerIndex (uint32_t index)
+{
+  m_schedulerIndex = index;
+}
+
+uint32_t
+EventImpl::GetSchedulerIndex (void) const
+{
+  return m_schedulerIndex;
+}
+
 } // namespace ns3
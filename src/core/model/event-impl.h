@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "simple-ref-count.h"
 
 namespace ns3 {
@@ -35,6 +36,11 @@ namespace ns3 {
  * obviously (there are Ref and Unref methods) reference-counted and
  * most subclasses are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * Since an event is created for each Simulator::Schedule, the memory of
+ * the subclasses, which hold the bound arguments, is recycled through
+ * per-thread free lists sorted by size rather than obtained from the
+ * global allocator each time.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -57,12 +63,37 @@ public:
    * Invoked by the simulation engine before calling Invoke.
    */
   bool IsCancelled (void);
+  /**
+   * \param index an opaque index which the scheduler holding this
+   *        event may use to find it back in constant time.
+   */
+  void SetSchedulerIndex (uint32_t index);
+  /**
+   * \returns the index last stored by SetSchedulerIndex
+   */
+  uint32_t GetSchedulerIndex (void) const;
+
+  /**
+   * \param size the size of the event subclass
+   * \returns memory from the free list of the calling thread for this
+   *          size, or from the global allocator for large events.
+   */
+  static void *operator new (size_t size);
+  /**
+   * \param p memory returned by operator new
+   * \param size the size of the event subclass
+   *
+   * Keep the memory in the free list of the calling thread, or give
+   * it back to the global allocator if that list is full.
+   */
+  static void operator delete (void *p, size_t size);
 
 protected:
   virtual void Notify (void) = 0;
 
 private:
   bool m_cancel;
+  uint32_t m_schedulerIndex;
 };
 
 } // namespace ns3
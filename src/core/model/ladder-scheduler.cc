@@ -0,0 +1,295 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+/// a bucket with more events than this is spread over a new rung
+static const uint32_t THRESHOLD = 50;
+/// maximum number of rungs
+static const uint32_t MAX_RUNGS = 8;
+
+/// order of Bottom, from the latest to the earliest event
+static bool
+IsLater (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return b.key < a.key;
+}
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topStart (0),
+    m_topMin (0),
+    m_topMax (0),
+    m_nRungs (0),
+    m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LadderScheduler::~LadderScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint64_t
+LadderScheduler::GetCurrentStart (const Rung &rung) const
+{
+  return rung.start + rung.current * rung.width;
+}
+
+LadderScheduler::Bucket *
+LadderScheduler::FindBucket (uint64_t ts)
+{
+  // each rung covers the range of the bucket of the rung above it
+  // which was being dequeued when it was created.
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      Rung &rung = m_rungs[i];
+      if (ts >= GetCurrentStart (rung))
+        {
+          uint64_t index = (ts - rung.start) / rung.width;
+          NS_ASSERT (index < rung.nBuckets);
+          return &rung.buckets[index];
+        }
+    }
+  return 0;
+}
+
+void
+LadderScheduler::SpawnRung (Bucket &events, uint64_t start, uint64_t limit)
+{
+  NS_LOG_FUNCTION (this << events.size () << start << limit);
+  NS_ASSERT (!events.empty () && limit > start);
+  if (m_nRungs == m_rungs.size ())
+    {
+      m_rungs.push_back (Rung ());
+    }
+  Rung &rung = m_rungs[m_nRungs];
+  m_nRungs++;
+  uint64_t range = limit - start;
+  uint64_t n = events.size ();
+  rung.start = start;
+  rung.width = std::max<uint64_t> (1, (range + n - 1) / n);
+  rung.current = 0;
+  rung.nBuckets = (range + rung.width - 1) / rung.width;
+  if (rung.buckets.size () < rung.nBuckets)
+    {
+      rung.buckets.resize (rung.nBuckets);
+    }
+  for (Bucket::const_iterator i = events.begin (); i != events.end (); i++)
+    {
+      uint64_t index = (i->key.m_ts - start) / rung.width;
+      NS_ASSERT (index < rung.nBuckets);
+      rung.buckets[index].push_back (*i);
+    }
+  events.clear ();
+}
+
+void
+LadderScheduler::InsertBottom (const Event &ev)
+{
+  m_bottom.insert (std::lower_bound (m_bottom.begin (), m_bottom.end (), ev, IsLater), ev);
+  if (m_bottom.size () > THRESHOLD
+      && m_nRungs < MAX_RUNGS
+      && m_bottom.front ().key.m_ts != m_bottom.back ().key.m_ts)
+    {
+      // too many events arrived below the ladder: keep insertion O(1)
+      // by moving them to a new lowest rung.
+      uint64_t limit = m_nRungs > 0 ? GetCurrentStart (m_rungs[m_nRungs - 1]) : m_topStart;
+      uint64_t start = m_bottom.back ().key.m_ts;
+      Bucket events;
+      events.swap (m_bottom);
+      SpawnRung (events, start, limit);
+    }
+}
+
+void
+LadderScheduler::Refill (void)
+{
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          if (m_top.empty ())
+            {
+              return;
+            }
+          Bucket events;
+          events.swap (m_top);
+          SpawnRung (events, m_topMin, m_topMax + 1);
+          const Rung &rung = m_rungs[0];
+          m_topStart = rung.start + rung.nBuckets * rung.width;
+          // give the (now empty) storage back to Top
+          m_top.swap (events);
+          continue;
+        }
+      Rung &rung = m_rungs[m_nRungs - 1];
+      while (rung.current < rung.nBuckets && rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+        }
+      if (rung.current == rung.nBuckets)
+        {
+          m_nRungs--;
+          continue;
+        }
+      Bucket &bucket = rung.buckets[rung.current];
+      uint64_t bucketEnd = GetCurrentStart (rung) + rung.width;
+      rung.current++;
+      if (bucket.size () > THRESHOLD && rung.width > 1 && m_nRungs < MAX_RUNGS)
+        {
+          Bucket events;
+          events.swap (bucket);
+          uint64_t start = events.front ().key.m_ts;
+          for (Bucket::const_iterator i = events.begin (); i != events.end (); i++)
+            {
+              start = std::min (start, i->key.m_ts);
+            }
+          SpawnRung (events, start, bucketEnd);
+          continue;
+        }
+      m_bottom.swap (bucket);
+      std::sort (m_bottom.begin (), m_bottom.end (), IsLater);
+    }
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  if (m_size == 0)
+    {
+      // start over from an empty ladder
+      m_nRungs = 0;
+      m_topStart = 0;
+    }
+  m_size++;
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ts;
+          m_topMax = ts;
+        }
+      else
+        {
+          m_topMin = std::min (m_topMin, ts);
+          m_topMax = std::max (m_topMax, ts);
+        }
+      m_top.push_back (ev);
+      return;
+    }
+  Bucket *bucket = FindBucket (ts);
+  if (bucket != 0)
+    {
+      bucket->push_back (ev);
+      return;
+    }
+  InsertBottom (ev);
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  // dequeuing work is done lazily, but does not change the content
+  const_cast<LadderScheduler *> (this)->Refill ();
+  return m_bottom.back ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  Refill ();
+  Event next = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_size--;
+  return next;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  Bucket *bucket;
+  if (ts >= m_topStart)
+    {
+      bucket = &m_top;
+    }
+  else
+    {
+      bucket = FindBucket (ts);
+    }
+  if (bucket != 0)
+    {
+      // buckets are not sorted
+      for (Bucket::iterator i = bucket->begin (); i != bucket->end (); i++)
+        {
+          if (i->key.m_uid == ev.key.m_uid)
+            {
+              NS_ASSERT (i->impl == ev.impl);
+              *i = bucket->back ();
+              bucket->pop_back ();
+              m_size--;
+              return;
+            }
+        }
+      NS_ASSERT (false);
+    }
+  for (Bucket::iterator i = m_bottom.begin (); i != m_bottom.end (); i++)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (i->impl == ev.impl);
+          m_bottom.erase (i);
+          m_size--;
+          return;
+        }
+    }
+  NS_ASSERT (false);
+}
+
+} // namespace ns3
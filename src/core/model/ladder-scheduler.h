@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This class implements the Ladder Queue of Tang, Goh and Thng
+ * ("Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation", ACM TOMACS, 2005). Events are kept in
+ * three tiers:
+ *  - Top: an unsorted list of the events later than the range covered
+ *    by the ladder. Inserting there is O(1).
+ *  - Ladder: a stack of rungs, each an array of buckets of equal
+ *    width covering part of the range of the rung above it. Inserting
+ *    there is O(1).
+ *  - Bottom: a small sorted list of the earliest events, from which
+ *    events are dequeued.
+ *
+ * When Bottom is empty, the first non-empty bucket of the lowest rung
+ * is sorted into Bottom or, if it holds more than a threshold of
+ * events, spread over a new rung. When the ladder is empty, Top is
+ * spread over a new first rung whose bucket width is derived from the
+ * actual range and number of the events. Unlike CalendarScheduler,
+ * the structure is never resized as a whole: each event is only moved
+ * a bounded number of times, so insertion and dequeue are O(1)
+ * amortized, whatever the distribution of the timestamps.
+ *
+ * Events of the same timestamp always share a bucket and are ordered
+ * by uid in Bottom, which gives the same order as the other
+ * schedulers. Remove looks the event up in the tier where Insert would
+ * store it, which is a linear search of a single bucket, of Bottom or
+ * of Top.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+  virtual ~LadderScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  typedef std::vector<Event> Bucket;
+
+  /// A rung of the ladder
+  struct Rung
+  {
+    uint64_t start;       //!< timestamp of the start of the first bucket
+    uint64_t width;       //!< width of a bucket
+    uint32_t current;     //!< first bucket not yet dequeued
+    uint32_t nBuckets;    //!< number of buckets in use
+    std::vector<Bucket> buckets;
+  };
+
+  /**
+   * \returns the start of the first bucket of the rung which has not
+   * been dequeued yet: the earlier events are stored in lower rungs.
+   */
+  uint64_t GetCurrentStart (const Rung &rung) const;
+  /**
+   * \returns the bucket where an event of timestamp ts is stored, or
+   * 0 if it belongs to Top or Bottom.
+   */
+  Bucket *FindBucket (uint64_t ts);
+  void InsertBottom (const Event &ev);
+  /**
+   * Spread events over a new lowest rung.
+   * \param events the events, all earlier than limit
+   * \param start the earliest timestamp of the events
+   * \param limit the end of the range the rung must cover
+   */
+  void SpawnRung (Bucket &events, uint64_t start, uint64_t limit);
+  /// Fill Bottom from the ladder or from Top
+  void Refill (void);
+
+  Bucket m_top;
+  uint64_t m_topStart;  //!< events from this timestamp on are stored in Top
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  /// The rungs in use are the m_nRungs first ones; the others are kept for reuse
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+  /// sorted by decreasing key: the next event is the last one
+  Bucket m_bottom;
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "pooled-heap-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("PooledHeapScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (PooledHeapScheduler);
+
+/// number of children of a node of the heap
+static const uint32_t ARITY = 4;
+/// end of the list of free slots
+static const uint32_t NO_SLOT = 0xffffffff;
+
+TypeId
+PooledHeapScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PooledHeapScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<PooledHeapScheduler> ()
+  ;
+  return tid;
+}
+
+PooledHeapScheduler::PooledHeapScheduler ()
+  : m_free (NO_SLOT)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PooledHeapScheduler::~PooledHeapScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+bool
+PooledHeapScheduler::IsLess (const Entry &a, const Entry &b) const
+{
+  return a.ts < b.ts || (a.ts == b.ts && a.uid < b.uid);
+}
+
+void
+PooledHeapScheduler::Place (const Entry &entry, uint32_t position)
+{
+  m_heap[position] = entry;
+  m_slots[entry.slot].position = position;
+}
+
+void
+PooledHeapScheduler::SiftUp (uint32_t position, Entry entry)
+{
+  while (position > 0)
+    {
+      uint32_t parent = (position - 1) / ARITY;
+      if (!IsLess (entry, m_heap[parent]))
+        {
+          break;
+        }
+      Place (m_heap[parent], position);
+      position = parent;
+    }
+  Place (entry, position);
+}
+
+void
+PooledHeapScheduler::SiftDown (uint32_t position, Entry entry)
+{
+  uint32_t size = m_heap.size ();
+  while (true)
+    {
+      uint32_t first = position * ARITY + 1;
+      if (first >= size)
+        {
+          break;
+        }
+      uint32_t last = std::min (first + ARITY, size);
+      uint32_t smallest = first;
+      for (uint32_t child = first + 1; child < last; ++child)
+        {
+          if (IsLess (m_heap[child], m_heap[smallest]))
+            {
+              smallest = child;
+            }
+        }
+      if (!IsLess (m_heap[smallest], entry))
+        {
+          break;
+        }
+      Place (m_heap[smallest], position);
+      position = smallest;
+    }
+  Place (entry, position);
+}
+
+uint32_t
+PooledHeapScheduler::AllocateSlot (void)
+{
+  if (m_free == NO_SLOT)
+    {
+      Slot slot = { 0, 0, 0 };
+      m_slots.push_back (slot);
+      return m_slots.size () - 1;
+    }
+  uint32_t index = m_free;
+  m_free = m_slots[index].position;
+  return index;
+}
+
+Scheduler::Event
+PooledHeapScheduler::ReleaseSlot (const Entry &entry)
+{
+  Slot &slot = m_slots[entry.slot];
+  Event ev;
+  ev.impl = slot.impl;
+  ev.key.m_ts = entry.ts;
+  ev.key.m_uid = entry.uid;
+  ev.key.m_context = slot.context;
+  slot.impl = 0;
+  slot.position = m_free;
+  m_free = entry.slot;
+  return ev;
+}
+
+void
+PooledHeapScheduler::RemoveAt (uint32_t position)
+{
+  Entry removed = m_heap[position];
+  Entry last = m_heap.back ();
+  m_heap.pop_back ();
+  if (position < m_heap.size ())
+    {
+      if (IsLess (last, removed))
+        {
+          SiftUp (position, last);
+        }
+      else
+        {
+          SiftDown (position, last);
+        }
+    }
+}
+
+void
+PooledHeapScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint32_t index = AllocateSlot ();
+  Slot &slot = m_slots[index];
+  slot.impl = ev.impl;
+  slot.context = ev.key.m_context;
+  ev.impl->SetSchedulerIndex (index);
+  Entry entry;
+  entry.ts = ev.key.m_ts;
+  entry.uid = ev.key.m_uid;
+  entry.slot = index;
+  m_heap.push_back (entry);
+  SiftUp (m_heap.size () - 1, entry);
+}
+
+bool
+PooledHeapScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_heap.empty ();
+}
+
+Scheduler::Event
+PooledHeapScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  const Entry &top = m_heap.front ();
+  const Slot &slot = m_slots[top.slot];
+  Event ev;
+  ev.impl = slot.impl;
+  ev.key.m_ts = top.ts;
+  ev.key.m_uid = top.uid;
+  ev.key.m_context = slot.context;
+  return ev;
+}
+
+Scheduler::Event
+PooledHeapScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  Entry top = m_heap.front ();
+  RemoveAt (0);
+  return ReleaseSlot (top);
+}
+
+void
+PooledHeapScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint32_t index = ev.impl->GetSchedulerIndex ();
+  NS_ASSERT (index < m_slots.size () && m_slots[index].impl == ev.impl);
+  uint32_t position = m_slots[index].position;
+  Entry entry = m_heap[position];
+  NS_ASSERT (entry.uid == ev.key.m_uid);
+  RemoveAt (position);
+  ReleaseSlot (entry);
+}
+
+} // namespace ns3
@@ -0,0 +1,88 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef POOLED_HEAP_SCHEDULER_H
+#define POOLED_HEAP_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a 4-ary heap event scheduler with pooled event storage
+ *
+ * The heap itself is an implicit 4-ary heap of small (timestamp, uid,
+ * slot) entries: the four children of a node are contiguous and fit in
+ * a single cache line, and the heap is half as deep as a binary heap.
+ * The rest of each event (its EventImpl and context) is kept in a pool
+ * of slots recycled through a free list, so that, once the pool has
+ * grown to the peak number of pending events, neither Insert nor
+ * RemoveNext allocate memory.
+ *
+ * Each slot records the position of its entry in the heap, and the
+ * slot index is stored in the EventImpl while it is scheduled, so that
+ * Remove is O(log n) instead of a linear search.
+ */
+class PooledHeapScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  PooledHeapScheduler ();
+  virtual ~PooledHeapScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  /// An element of the heap
+  struct Entry
+  {
+    uint64_t ts;
+    uint32_t uid;
+    uint32_t slot;
+  };
+  /// The pooled part of an event
+  struct Slot
+  {
+    EventImpl *impl;
+    uint32_t context;
+    /// position of the entry in the heap, or next free slot
+    uint32_t position;
+  };
+
+  inline bool IsLess (const Entry &a, const Entry &b) const;
+  inline void Place (const Entry &entry, uint32_t position);
+  void SiftUp (uint32_t position, Entry entry);
+  void SiftDown (uint32_t position, Entry entry);
+  uint32_t AllocateSlot (void);
+  Event ReleaseSlot (const Entry &entry);
+  void RemoveAt (uint32_t position);
+
+  std::vector<Entry> m_heap;
+  std::vector<Slot> m_slots;
+  uint32_t m_free; //!< head of the list of free slots
+};
+
+} // namespace ns3
+
+#endif /* POOLED_HEAP_SCHEDULER_H */
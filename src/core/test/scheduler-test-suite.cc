@@ -0,0 +1,168 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/scheduler.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/pooled-heap-scheduler.h"
+#include "ns3/ladder-scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/make-event.h"
+#include "ns3/object-factory.h"
+#include "ns3/random-variable-stream.h"
+
+#include <vector>
+
+using namespace ns3;
+
+static void
+Nothing (void)
+{
+}
+
+/**
+ * Drive a scheduler and a MapScheduler through the same random sequence
+ * of Insert, Remove and RemoveNext, with bursts of events sharing the
+ * same timestamp, and check that both always return the same event.
+ */
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory);
+
+private:
+  virtual void DoRun (void);
+  uint64_t NextTimestamp (uint64_t now);
+
+  ObjectFactory m_schedulerFactory;
+  Ptr<UniformRandomVariable> m_rand;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that " + schedulerFactory.GetTypeId ().GetName () + " orders events as MapScheduler"),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+uint64_t
+SchedulerOrderTestCase::NextTimestamp (uint64_t now)
+{
+  double kind = m_rand->GetValue ();
+  if (kind < 0.2)
+    {
+      // ties: same timestamp as others
+      return now + 1000 * m_rand->GetInteger (0, 3);
+    }
+  else if (kind < 0.8)
+    {
+      // a burst of close events
+      return now + m_rand->GetInteger (0, 50000);
+    }
+  else if (kind < 0.95)
+    {
+      return now + m_rand->GetInteger (0, 1000000000);
+    }
+  // a few events far in the future
+  return now + 1000000000ULL * m_rand->GetInteger (1, 1000);
+}
+
+void
+SchedulerOrderTestCase::DoRun (void)
+{
+  m_rand = CreateObject<UniformRandomVariable> ();
+  m_rand->SetStream (1);
+  Ptr<Scheduler> tested = m_schedulerFactory.Create<Scheduler> ();
+  Ptr<Scheduler> reference = CreateObject<MapScheduler> ();
+  std::vector<Scheduler::Event> pending;
+  uint64_t now = 0;
+  uint32_t uid = 4;
+
+  for (uint32_t i = 0; i < 50000; ++i)
+    {
+      double op = m_rand->GetValue ();
+      // grow the population during the first half, drain it during the second
+      double insertProbability = i < 25000 ? 0.6 : 0.35;
+      if (op < insertProbability || pending.empty ())
+        {
+          Scheduler::Event ev;
+          ev.impl = MakeEvent (&Nothing);
+          ev.key.m_ts = NextTimestamp (now);
+          ev.key.m_uid = uid++;
+          ev.key.m_context = i;
+          tested->Insert (ev);
+          reference->Insert (ev);
+          pending.push_back (ev);
+        }
+      else if (op < insertProbability + 0.1)
+        {
+          uint32_t index = m_rand->GetInteger (0, pending.size () - 1);
+          Scheduler::Event ev = pending[index];
+          pending[index] = pending.back ();
+          pending.pop_back ();
+          tested->Remove (ev);
+          reference->Remove (ev);
+          ev.impl->Unref ();
+        }
+      else
+        {
+          Scheduler::Event expected = reference->PeekNext ();
+          Scheduler::Event peeked = tested->PeekNext ();
+          NS_TEST_ASSERT_MSG_EQ (peeked.key.m_uid, expected.key.m_uid, "Wrong next event at step " << i);
+          Scheduler::Event found = tested->RemoveNext ();
+          reference->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (found.key.m_uid, expected.key.m_uid, "Wrong event removed at step " << i);
+          NS_TEST_ASSERT_MSG_EQ (found.key.m_ts, expected.key.m_ts, "Wrong timestamp at step " << i);
+          NS_TEST_ASSERT_MSG_EQ (found.key.m_context, expected.key.m_context, "Wrong context at step " << i);
+          NS_TEST_ASSERT_MSG_EQ (found.impl, expected.impl, "Wrong event implementation at step " << i);
+          now = found.key.m_ts;
+          for (std::vector<Scheduler::Event>::iterator j = pending.begin (); j != pending.end (); ++j)
+            {
+              if (j->key.m_uid == found.key.m_uid)
+                {
+                  *j = pending.back ();
+                  pending.pop_back ();
+                  break;
+                }
+            }
+          found.impl->Unref ();
+        }
+      NS_TEST_ASSERT_MSG_EQ (tested->IsEmpty (), pending.empty (), "Wrong emptiness at step " << i);
+    }
+
+  while (!reference->IsEmpty ())
+    {
+      Scheduler::Event expected = reference->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ (tested->IsEmpty (), false, "Scheduler lost events");
+      Scheduler::Event found = tested->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ (found.key.m_uid, expected.key.m_uid, "Wrong event while draining");
+      found.impl->Unref ();
+    }
+  NS_TEST_ASSERT_MSG_EQ (tested->IsEmpty (), true, "Scheduler has extra events");
+}
+
+class SchedulerTestSuite : public TestSuite
+{
+public:
+  SchedulerTestSuite ()
+    : TestSuite ("scheduler-order", UNIT)
+  {
+    ObjectFactory factory;
+    factory.SetTypeId (PooledHeapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+  }
+} g_schedulerTestSuite;
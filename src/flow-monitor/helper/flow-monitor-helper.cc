@@ -34,6 +34,7 @@
 namespace ns3 {
 
 FlowMonitorHelper::FlowMonitorHelper ()
+  : m_streamFormat (FlowMonitor::STREAM_CSV)
 {
   m_monitorFactory.SetTypeId ("ns3::FlowMonitor");
 }
@@ -55,6 +56,18 @@ FlowMonitorHelper::SetMonitorAttribute (std::string n1, const AttributeValue &v1
   m_monitorFactory.Set (n1, v1);
 }
 
+void
+FlowMonitorHelper::EnableStreaming (std::string fileName, Time interval, FlowMonitor::StreamFormat format)
+{
+  m_streamFileName = fileName;
+  m_streamInterval = interval;
+  m_streamFormat = format;
+  if (m_flowMonitor)
+    {
+      m_flowMonitor->StartStreaming (m_streamFileName, m_streamInterval, m_streamFormat);
+    }
+}
+
 
 Ptr<FlowMonitor>
 FlowMonitorHelper::GetMonitor ()
@@ -66,6 +79,10 @@ FlowMonitorHelper::GetMonitor ()
       m_flowMonitor->AddFlowClassifier (m_flowClassifier4);
       m_flowClassifier6 = Create<Ipv6FlowClassifier> ();
       m_flowMonitor->AddFlowClassifier (m_flowClassifier6);
+      if (!m_streamFileName.empty ())
+        {
+          m_flowMonitor->StartStreaming (m_streamFileName, m_streamInterval, m_streamFormat);
+        }
     }
   return m_flowMonitor;
 }
@@ -50,6 +50,20 @@ public:
    */
   void SetMonitorAttribute (std::string n1, const AttributeValue &v1);
 
+  /**
+   * \brief Stream the statistics of the flows to a file while the simulation runs
+   *
+   * The FlowMonitor appends what happened to each active flow during
+   * the last interval to the file, at the end of each interval.  See
+   * FlowMonitor::StartStreaming for the content of the file.
+   *
+   * \param fileName name or path of the output file that will be created
+   * \param interval the time between two writes
+   * \param format the format of the file
+   */
+  void EnableStreaming (std::string fileName, Time interval = Seconds (1),
+                        FlowMonitor::StreamFormat format = FlowMonitor::STREAM_CSV);
+
   /**
    * \brief Enable flow monitoring on a set of nodes
    * \param nodes A NodeContainer holding the set of nodes to work with.
@@ -128,6 +142,9 @@ private:
   FlowMonitorHelper& operator= (const FlowMonitorHelper&);
 
   ObjectFactory m_monitorFactory;        //!< Object factory
+  std::string m_streamFileName;          //!< file of EnableStreaming, empty if not streaming
+  Time m_streamInterval;                 //!< interval of EnableStreaming
+  FlowMonitor::StreamFormat m_streamFormat; //!< format of EnableStreaming
   Ptr<FlowMonitor> m_flowMonitor;        //!< the FlowMonitor object
   Ptr<FlowClassifier> m_flowClassifier4; //!< the FlowClassifier object for IPv4
   Ptr<FlowClassifier> m_flowClassifier6; //!< the FlowClassifier object for IPv6
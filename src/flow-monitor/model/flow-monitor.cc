@@ -24,6 +24,9 @@
 #include "ns3/double.h"
 #include <fstream>
 #include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
 
 #define INDENT(level) for (int __xpto = 0; __xpto < level; __xpto++) os << ' ';
 
@@ -81,8 +84,26 @@ FlowMonitor::GetInstanceTypeId (void) const
   return GetTypeId ();
 }
 
+const uint32_t FlowMonitor::STREAM_RECORD_SIZE;
+const uint32_t FlowMonitor::STREAM_MAGIC;
+
+FlowMonitor::IntervalStats::IntervalStats ()
+  : delaySum (Seconds (0)),
+    jitterSum (Seconds (0)),
+    txBytes (0),
+    rxBytes (0),
+    droppedBytes (0),
+    txPackets (0),
+    rxPackets (0),
+    lostPackets (0),
+    droppedPackets (0),
+    timesForwarded (0)
+{
+}
+
 FlowMonitor::FlowMonitor ()
-  : m_enabled (false)
+  : m_streamFormat (STREAM_CSV),
+    m_enabled (false)
 {
   // m_histogramBinWidth=DEFAULT_BIN_WIDTH;
 }
@@ -101,13 +122,38 @@ FlowMonitor::DoDispose (void)
       m_flowProbes[i]->Dispose ();
       m_flowProbes[i] = 0;
     }
+  StopStreaming ();
   Object::DoDispose ();
 }
 
+size_t
+FlowMonitor::TrackedPacketKeyHash::operator () (uint64_t key) const
+{
+  // the packets of a flow have consecutive identifiers, in the low bits
+  // of the key: fold the FlowId over them
+  return size_t ((key & 0xffffffff) ^ ((key >> 32) * 0x9e3779b1));
+}
+
+inline uint64_t
+FlowMonitor::GetTrackedPacketKey (FlowId flowId, FlowPacketId packetId)
+{
+  return (uint64_t (flowId) << 32) | packetId;
+}
+
+inline FlowMonitor::IntervalStats*
+FlowMonitor::GetIntervalStatsForFlow (FlowId flowId)
+{
+  if (!m_stream.is_open ())
+    {
+      return 0;
+    }
+  return &m_intervalStats[flowId];
+}
+
 inline FlowMonitor::FlowStats&
 FlowMonitor::GetStatsForFlow (FlowId flowId)
 {
-  std::map<FlowId, FlowStats>::iterator iter;
+  FlowStatsMap::iterator iter;
   iter = m_flowStats.find (flowId);
   if (iter == m_flowStats.end ())
     {
@@ -142,7 +188,7 @@ FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t pack
       return;
     }
   Time now = Simulator::Now ();
-  TrackedPacket &tracked = m_trackedPackets[std::make_pair (flowId, packetId)];
+  TrackedPacket &tracked = m_trackedPackets[GetTrackedPacketKey (flowId, packetId)];
   tracked.firstSeenTime = now;
   tracked.lastSeenTime = tracked.firstSeenTime;
   tracked.timesForwarded = 0;
@@ -159,6 +205,13 @@ FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t pack
       stats.timeFirstTxPacket = now;
     }
   stats.timeLastTxPacket = now;
+
+  IntervalStats *interval = GetIntervalStatsForFlow (flowId);
+  if (interval != 0)
+    {
+      interval->txBytes += packetSize;
+      interval->txPackets++;
+    }
 }
 
 
@@ -169,8 +222,7 @@ FlowMonitor::ReportForwarding (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t p
     {
       return;
     }
-  std::pair<FlowId, FlowPacketId> key (flowId, packetId);
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (key);
+  TrackedPacketMap::iterator tracked = m_trackedPackets.find (GetTrackedPacketKey (flowId, packetId));
   if (tracked == m_trackedPackets.end ())
     {
       NS_LOG_WARN ("Received packet forward report (flowId=" << flowId << ", packetId=" << packetId
@@ -193,7 +245,7 @@ FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packe
     {
       return;
     }
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (std::make_pair (flowId, packetId));
+  TrackedPacketMap::iterator tracked = m_trackedPackets.find (GetTrackedPacketKey (flowId, packetId));
   if (tracked == m_trackedPackets.end ())
     {
       NS_LOG_WARN ("Received packet last-tx report (flowId=" << flowId << ", packetId=" << packetId
@@ -208,6 +260,7 @@ FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packe
   FlowStats &stats = GetStatsForFlow (flowId);
   stats.delaySum += delay;
   stats.delayHistogram.AddValue (delay.GetSeconds ());
+  Time jitterSum = stats.jitterSum;
   if (stats.rxPackets > 0 )
     {
       Time jitter = stats.lastDelay - delay;
@@ -243,6 +296,16 @@ FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packe
   stats.timeLastRxPacket = now;
   stats.timesForwarded += tracked->second.timesForwarded;
 
+  IntervalStats *interval = GetIntervalStatsForFlow (flowId);
+  if (interval != 0)
+    {
+      interval->delaySum += delay;
+      interval->jitterSum += stats.jitterSum - jitterSum;
+      interval->rxBytes += packetSize;
+      interval->rxPackets++;
+      interval->timesForwarded += tracked->second.timesForwarded;
+    }
+
   NS_LOG_DEBUG ("ReportLastTx: removing tracked packet (flowId="
                 << flowId << ", packetId=" << packetId << ").");
 
@@ -271,7 +334,15 @@ FlowMonitor::ReportDrop (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetI
   stats.bytesDropped[reasonCode] += packetSize;
   NS_LOG_DEBUG ("++stats.packetsDropped[" << reasonCode<< "]; // becomes: " << stats.packetsDropped[reasonCode]);
 
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (std::make_pair (flowId, packetId));
+  IntervalStats *interval = GetIntervalStatsForFlow (flowId);
+  if (interval != 0)
+    {
+      interval->lostPackets++;
+      interval->droppedPackets++;
+      interval->droppedBytes += packetSize;
+    }
+
+  TrackedPacketMap::iterator tracked = m_trackedPackets.find (GetTrackedPacketKey (flowId, packetId));
   if (tracked != m_trackedPackets.end ())
     {
       // we don't need to track this packet anymore
@@ -285,7 +356,7 @@ FlowMonitor::ReportDrop (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetI
 std::map<FlowId, FlowMonitor::FlowStats>
 FlowMonitor::GetFlowStats () const
 {
-  return m_flowStats;
+  return std::map<FlowId, FlowStats> (m_flowStats.begin (), m_flowStats.end ());
 }
 
 
@@ -300,10 +371,15 @@ FlowMonitor::CheckForLostPackets (Time maxDelay)
       if (now - iter->second.lastSeenTime >= maxDelay)
         {
           // packet is considered lost, add it to the loss statistics
-          std::map<FlowId, FlowStats>::iterator
-            flow = m_flowStats.find (iter->first.first);
+          FlowStatsMap::iterator
+            flow = m_flowStats.find (FlowId (iter->first >> 32));
           NS_ASSERT (flow != m_flowStats.end ());
           flow->second.lostPackets++;
+          IntervalStats *interval = GetIntervalStatsForFlow (flow->first);
+          if (interval != 0)
+            {
+              interval->lostPackets++;
+            }
 
           // we won't track it anymore
           m_trackedPackets.erase (iter++);
@@ -399,6 +475,124 @@ FlowMonitor::AddFlowClassifier (Ptr<FlowClassifier> classifier)
   m_classifiers.push_back (classifier);
 }
 
+bool
+FlowMonitor::StartStreaming (std::string fileName, Time interval, enum StreamFormat format)
+{
+  NS_ASSERT_MSG (interval.IsStrictlyPositive (), "The streaming interval must be positive");
+  StopStreaming ();
+
+  m_stream.open (fileName.c_str (), std::ios::out|std::ios::trunc|std::ios::binary);
+  if (!m_stream.is_open ())
+    {
+      NS_LOG_WARN ("Could not create the stream file " << fileName);
+      return false;
+    }
+  m_streamFormat = format;
+  m_streamInterval = interval;
+  m_stream.precision (12);
+  if (format == STREAM_BINARY)
+    {
+      uint32_t magic = STREAM_MAGIC;
+      uint16_t version = 1;
+      uint16_t recordSize = STREAM_RECORD_SIZE;
+      m_stream.write ((char const *)&magic, sizeof (magic));
+      m_stream.write ((char const *)&version, sizeof (version));
+      m_stream.write ((char const *)&recordSize, sizeof (recordSize));
+    }
+  else
+    {
+      m_stream << "time,flowId,txPackets,rxPackets,lostPackets,droppedPackets,timesForwarded,"
+               << "txBytes,rxBytes,droppedBytes,delaySum,jitterSum\n";
+    }
+  m_stream.flush ();
+
+  m_streamEvent = Simulator::Schedule (interval, &FlowMonitor::PeriodicWriteIntervalStats, this);
+  m_streamDestroyEvent = Simulator::ScheduleDestroy (&FlowMonitor::StopStreaming, this);
+  return true;
+}
+
+void
+FlowMonitor::StopStreaming ()
+{
+  if (!m_stream.is_open ())
+    {
+      return;
+    }
+  Simulator::Cancel (m_streamEvent);
+  Simulator::Cancel (m_streamDestroyEvent);
+  WriteIntervalStats ();
+  m_stream.close ();
+}
+
+void
+FlowMonitor::WriteIntervalStats ()
+{
+  // write the flows in FlowId order
+  std::vector<FlowId> flowIds;
+  flowIds.reserve (m_intervalStats.size ());
+  for (IntervalStatsMap::const_iterator iter = m_intervalStats.begin ();
+       iter != m_intervalStats.end (); iter++)
+    {
+      flowIds.push_back (iter->first);
+    }
+  std::sort (flowIds.begin (), flowIds.end ());
+
+  Time now = Simulator::Now ();
+  for (std::vector<FlowId>::const_iterator flowId = flowIds.begin (); flowId != flowIds.end (); flowId++)
+    {
+      IntervalStats const &interval = m_intervalStats[*flowId];
+      if (m_streamFormat == STREAM_BINARY)
+        {
+          uint8_t record[STREAM_RECORD_SIZE];
+          uint8_t *p = record;
+#define PUT(value) do { memcpy (p, &value, sizeof (value)); p += sizeof (value); } while (false)
+          int64_t time = now.GetNanoSeconds ();
+          int64_t delaySum = interval.delaySum.GetNanoSeconds ();
+          int64_t jitterSum = interval.jitterSum.GetNanoSeconds ();
+          PUT (time);
+          PUT (*flowId);
+          PUT (interval.txPackets);
+          PUT (interval.rxPackets);
+          PUT (interval.lostPackets);
+          PUT (interval.droppedPackets);
+          PUT (interval.timesForwarded);
+          PUT (interval.txBytes);
+          PUT (interval.rxBytes);
+          PUT (interval.droppedBytes);
+          PUT (delaySum);
+          PUT (jitterSum);
+#undef PUT
+          NS_ASSERT (p == record + STREAM_RECORD_SIZE);
+          m_stream.write ((char const *)record, STREAM_RECORD_SIZE);
+        }
+      else
+        {
+          m_stream << now.GetSeconds ()
+                   << "," << *flowId
+                   << "," << interval.txPackets
+                   << "," << interval.rxPackets
+                   << "," << interval.lostPackets
+                   << "," << interval.droppedPackets
+                   << "," << interval.timesForwarded
+                   << "," << interval.txBytes
+                   << "," << interval.rxBytes
+                   << "," << interval.droppedBytes
+                   << "," << interval.delaySum.GetSeconds ()
+                   << "," << interval.jitterSum.GetSeconds ()
+                   << "\n";
+        }
+    }
+  m_stream.flush ();
+  m_intervalStats.clear ();
+}
+
+void
+FlowMonitor::PeriodicWriteIntervalStats ()
+{
+  WriteIntervalStats ();
+  m_streamEvent = Simulator::Schedule (m_streamInterval, &FlowMonitor::PeriodicWriteIntervalStats, this);
+}
+
 void
 FlowMonitor::SerializeToXmlStream (std::ostream &os, int indent, bool enableHistograms, bool enableProbes)
 {
@@ -408,8 +602,10 @@ FlowMonitor::SerializeToXmlStream (std::ostream &os, int indent, bool enableHist
   indent += 2;
   INDENT (indent); os << "<FlowStats>\n";
   indent += 2;
-  for (std::map<FlowId, FlowStats>::const_iterator flowI = m_flowStats.begin ();
-       flowI != m_flowStats.end (); flowI++)
+  // list the flows in FlowId order
+  std::map<FlowId, FlowStats> flowStats = GetFlowStats ();
+  for (std::map<FlowId, FlowStats>::const_iterator flowI = flowStats.begin ();
+       flowI != flowStats.end (); flowI++)
     {
 
       INDENT (indent);
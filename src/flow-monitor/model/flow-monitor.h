@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <map>
+#include <fstream>
 
 #include "ns3/ptr.h"
 #include "ns3/object.h"
@@ -31,6 +32,7 @@
 #include "ns3/histogram.h"
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
+#include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
 
@@ -222,6 +224,49 @@ public:
   /// \returns a list of all the probes
   std::vector< Ptr<FlowProbe> > GetAllProbes () const;
 
+  /// Format of the file written by StartStreaming
+  enum StreamFormat
+  {
+    STREAM_CSV,    //!< a header line, then one line of comma-separated values per record
+    STREAM_BINARY  //!< a file header, then one record of STREAM_RECORD_SIZE bytes per record
+  };
+
+  /// Size of a record in a STREAM_BINARY file
+  static const uint32_t STREAM_RECORD_SIZE = 72;
+  /// First four bytes of a STREAM_BINARY file, in host byte order
+  static const uint32_t STREAM_MAGIC = 0x464d5354;
+
+  /// Start appending the statistics of the flows to a file at regular
+  /// intervals, while the simulation runs.  At the end of each interval,
+  /// one record is written for each flow which had some activity during
+  /// the interval, with what happened to the flow during that interval
+  /// only: the time of the end of the interval, the FlowId, the numbers
+  /// of packets and bytes sent, received and dropped, the number of
+  /// packets lost, the number of times the received packets were
+  /// forwarded, and the sums of the delays and jitters of the received
+  /// packets.  The records of an interval are in FlowId order.
+  ///
+  /// The interval counters are reset after each write, and hold only the
+  /// flows active during the interval.  The file is flushed after each
+  /// write, so that the progress of the simulation can be followed.
+  ///
+  /// A STREAM_BINARY file starts with STREAM_MAGIC, a 16 bits version
+  /// (1) and the 16 bits size of a record.  The fields of a record are,
+  /// in host byte order: time (int64, ns), flowId, txPackets, rxPackets,
+  /// lostPackets, droppedPackets, timesForwarded (uint32), txBytes,
+  /// rxBytes, droppedBytes (uint64), delaySum, jitterSum (int64, ns).
+  /// The CSV file has the same columns, with the times in seconds.
+  ///
+  /// \param fileName name or path of the output file that will be created
+  /// \param interval the time between two writes
+  /// \param format the format of the file
+  /// \returns false if the file could not be created
+  bool StartStreaming (std::string fileName, Time interval, enum StreamFormat format);
+  /// Write the statistics of the current interval and close the file
+  /// opened by StartStreaming.  Called when the FlowMonitor is disposed
+  /// of or the simulator destroyed.
+  void StopStreaming ();
+
   /// Serializes the results to an std::ostream in XML format
   /// \param os the output stream
   /// \param indent number of spaces to use as base indentation level
@@ -256,12 +301,47 @@ private:
     uint32_t timesForwarded; //!< number of times the packet was reportedly forwarded
   };
 
+  /// What happened to a flow since the last write of StartStreaming
+  struct IntervalStats
+  {
+    IntervalStats ();
+
+    Time delaySum;            //!< sum of the delays of the received packets
+    Time jitterSum;           //!< sum of the jitters of the received packets
+    uint64_t txBytes;         //!< bytes transmitted
+    uint64_t rxBytes;         //!< bytes received
+    uint64_t droppedBytes;    //!< bytes dropped
+    uint32_t txPackets;       //!< packets transmitted
+    uint32_t rxPackets;       //!< packets received
+    uint32_t lostPackets;     //!< packets dropped or assumed to be lost
+    uint32_t droppedPackets;  //!< packets dropped
+    uint32_t timesForwarded;  //!< times the received packets were forwarded
+  };
+
+  /// Hash function class for the keys of the tracked packets
+  struct TrackedPacketKeyHash : public std::unary_function<uint64_t, size_t>
+  {
+    /// \param key the key of a tracked packet
+    /// \returns the hash of the key
+    size_t operator () (uint64_t key) const;
+  };
+
   /// FlowId --> FlowStats
-  std::map<FlowId, FlowStats> m_flowStats;
+  typedef sgi::hash_map<FlowId, FlowStats> FlowStatsMap;
+  FlowStatsMap m_flowStats; //!< FlowStats of each flow
 
-  /// (FlowId,PacketId) --> TrackedPacket
-  typedef std::map< std::pair<FlowId, FlowPacketId>, TrackedPacket> TrackedPacketMap;
+  /// (FlowId,PacketId) --> TrackedPacket, keyed by GetTrackedPacketKey
+  typedef sgi::hash_map<uint64_t, TrackedPacket, TrackedPacketKeyHash> TrackedPacketMap;
   TrackedPacketMap m_trackedPackets; //!< Tracked packets
+
+  /// FlowId --> IntervalStats, for the flows active since the last write
+  typedef sgi::hash_map<FlowId, IntervalStats> IntervalStatsMap;
+  IntervalStatsMap m_intervalStats; //!< Statistics of the current interval
+  std::ofstream m_stream;           //!< the file of StartStreaming
+  enum StreamFormat m_streamFormat; //!< the format of m_stream
+  Time m_streamInterval;            //!< time between two writes to m_stream
+  EventId m_streamEvent;            //!< next write to m_stream
+  EventId m_streamDestroyEvent;     //!< StopStreaming on Simulator::Destroy
   Time m_maxPerHopDelay; //!< Minimum per-hop delay
   std::vector< Ptr<FlowProbe> > m_flowProbes; //!< all the FlowProbes
 
@@ -282,8 +362,23 @@ private:
   /// \returns the stats of the flow
   FlowStats& GetStatsForFlow (FlowId flowId);
 
+  /// Get the key of a tracked packet
+  /// \param flowId the Flow identification
+  /// \param packetId the Packet identification
+  /// \returns the key of the packet in m_trackedPackets
+  static uint64_t GetTrackedPacketKey (FlowId flowId, FlowPacketId packetId);
+
   /// Periodic function to check for lost packets and prune statistics
   void PeriodicCheckForLostPackets ();
+
+  /// Get the statistics of the current interval for a given flow
+  /// \param flowId the Flow identification
+  /// \returns the interval stats of the flow, null if not streaming
+  IntervalStats* GetIntervalStatsForFlow (FlowId flowId);
+  /// Write the statistics of the current interval to m_stream and reset them
+  void WriteIntervalStats ();
+  /// Periodic function to write the statistics of the current interval
+  void PeriodicWriteIntervalStats ();
 };
 
 
@@ -68,7 +68,7 @@ FlowProbe::AddPacketDropStats (FlowId flowId, uint32_t packetSize, uint32_t reas
 FlowProbe::Stats
 FlowProbe::GetStats () const 
 {
-  return m_stats;
+  return Stats (m_stats.begin (), m_stats.end ());
 }
 
 void
@@ -80,7 +80,9 @@ FlowProbe::SerializeToXmlStream (std::ostream &os, int indent, uint32_t index) c
 
   indent += 2;
 
-  for (Stats::const_iterator iter = m_stats.begin (); iter != m_stats.end (); iter++)
+  // list the flows in FlowId order
+  Stats stats = GetStats ();
+  for (Stats::const_iterator iter = stats.begin (); iter != stats.end (); iter++)
     {
       INDENT (indent);
       os << "<FlowStats "
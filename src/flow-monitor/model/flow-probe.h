@@ -27,6 +27,7 @@
 #include "ns3/object.h"
 #include "ns3/flow-classifier.h"
 #include "ns3/nstime.h"
+#include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
 
@@ -99,8 +100,11 @@ public:
   void SerializeToXmlStream (std::ostream &os, int indent, uint32_t index) const;
 
 protected:
+  /// Container to map FlowId -> FlowStats, looked up for every packet
+  typedef sgi::hash_map<FlowId, FlowStats> StatsMap;
+
   Ptr<FlowMonitor> m_flowMonitor; //!< the FlowMonitor instance
-  Stats m_stats; //!< The flow stats
+  StatsMap m_stats; //!< The flow stats
 
 };
 
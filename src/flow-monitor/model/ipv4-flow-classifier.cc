@@ -94,6 +94,18 @@ bool operator == (const Ipv4FlowClassifier::FiveTuple &t1,
 }
 
 
+size_t
+Ipv4FlowClassifier::FiveTupleHash::operator () (FiveTuple const &x) const
+{
+  // flows between the same pair of hosts only differ by their ports:
+  // mix every field into the hash
+  uint32_t hash = x.sourceAddress.Get ();
+  hash = hash * 31 + x.destinationAddress.Get ();
+  hash = hash * 31 + x.protocol;
+  hash = hash * 31 + ((uint32_t (x.sourcePort) << 16) | x.destinationPort);
+  return hash;
+}
+
 
 Ipv4FlowClassifier::Ipv4FlowClassifier ()
 {
@@ -147,23 +159,25 @@ Ipv4FlowClassifier::Classify (const Ipv4Header &ipHeader, Ptr<const Packet> ipPa
   tuple.destinationPort = dstPort;
 
   // try to insert the tuple, but check if it already exists
-  std::pair<std::map<FiveTuple, FlowId>::iterator, bool> insert
+  std::pair<FlowMap::iterator, bool> insert
     = m_flowMap.insert (std::pair<FiveTuple, FlowId> (tuple, 0));
 
   // if the insertion succeeded, we need to assign this tuple a new flow identifier
   if (insert.second)
     {
       FlowId newFlowId = GetNewFlowId ();
+      NS_ASSERT (newFlowId == m_flows.size () + 1);
       insert.first->second = newFlowId;
-      m_flowPktIdMap[newFlowId] = 0;
+      m_flows.push_back (tuple);
+      m_flowPktIds.push_back (0);
     }
   else
     {
-      m_flowPktIdMap[insert.first->second] ++;
+      m_flowPktIds[insert.first->second - 1]++;
     }
 
   *out_flowId = insert.first->second;
-  *out_packetId = m_flowPktIdMap[*out_flowId];
+  *out_packetId = m_flowPktIds[*out_flowId - 1];
 
   return true;
 }
@@ -172,13 +186,9 @@ Ipv4FlowClassifier::Classify (const Ipv4Header &ipHeader, Ptr<const Packet> ipPa
 Ipv4FlowClassifier::FiveTuple
 Ipv4FlowClassifier::FindFlow (FlowId flowId) const
 {
-  for (std::map<FiveTuple, FlowId>::const_iterator
-       iter = m_flowMap.begin (); iter != m_flowMap.end (); iter++)
+  if (flowId >= 1 && flowId <= m_flows.size ())
     {
-      if (iter->second == flowId)
-        {
-          return iter->first;
-        }
+      return m_flows[flowId - 1];
     }
   NS_FATAL_ERROR ("Could not find the flow with ID " << flowId);
   FiveTuple retval = { Ipv4Address::GetZero (), Ipv4Address::GetZero (), 0, 0, 0 };
@@ -193,16 +203,15 @@ Ipv4FlowClassifier::SerializeToXmlStream (std::ostream &os, int indent) const
   INDENT (indent); os << "<Ipv4FlowClassifier>\n";
 
   indent += 2;
-  for (std::map<FiveTuple, FlowId>::const_iterator
-       iter = m_flowMap.begin (); iter != m_flowMap.end (); iter++)
+  for (uint32_t i = 0; i < m_flows.size (); i++)
     {
       INDENT (indent);
-      os << "<Flow flowId=\"" << iter->second << "\""
-         << " sourceAddress=\"" << iter->first.sourceAddress << "\""
-         << " destinationAddress=\"" << iter->first.destinationAddress << "\""
-         << " protocol=\"" << int(iter->first.protocol) << "\""
-         << " sourcePort=\"" << iter->first.sourcePort << "\""
-         << " destinationPort=\"" << iter->first.destinationPort << "\""
+      os << "<Flow flowId=\"" << i + 1 << "\""
+         << " sourceAddress=\"" << m_flows[i].sourceAddress << "\""
+         << " destinationAddress=\"" << m_flows[i].destinationAddress << "\""
+         << " protocol=\"" << int(m_flows[i].protocol) << "\""
+         << " sourcePort=\"" << m_flows[i].sourcePort << "\""
+         << " destinationPort=\"" << m_flows[i].destinationPort << "\""
          << " />\n";
     }
 
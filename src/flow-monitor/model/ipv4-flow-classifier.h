@@ -23,9 +23,11 @@
 
 #include <stdint.h>
 #include <map>
+#include <vector>
 
 #include "ns3/ipv4-header.h"
 #include "ns3/flow-classifier.h"
+#include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
 
@@ -49,6 +51,14 @@ public:
     uint16_t destinationPort;       //!< Destination port
   };
 
+  /// Hash function class for FiveTuple
+  struct FiveTupleHash : public std::unary_function<FiveTuple, size_t>
+  {
+    /// \param x the tuple to hash
+    /// \returns the hash of the tuple
+    size_t operator () (FiveTuple const &x) const;
+  };
+
   Ipv4FlowClassifier ();
 
   /// \brief try to classify the packet into flow-id and packet-id
@@ -73,9 +83,15 @@ public:
 
 private:
 
+  /// Container to map FiveTuples to FlowIds
+  typedef sgi::hash_map<FiveTuple, FlowId, FiveTupleHash> FlowMap;
+
   /// Map to Flows Identifiers to FlowIds
-  std::map<FiveTuple, FlowId> m_flowMap;
-  std::map<FlowId, FlowPacketId> m_flowPktIdMap;
+  FlowMap m_flowMap;
+  /// The FiveTuple of each flow, indexed by FlowId - 1
+  std::vector<FiveTuple> m_flows;
+  /// The last packet identifier of each flow, indexed by FlowId - 1
+  std::vector<FlowPacketId> m_flowPktIds;
 
 };
 
@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+#include "ns3/flow-monitor.h"
+#include "ns3/flow-probe.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/// A probe which only reports what the test tells it to
+class StreamTestFlowProbe : public FlowProbe
+{
+public:
+  StreamTestFlowProbe (Ptr<FlowMonitor> monitor)
+    : FlowProbe (monitor)
+  {
+  }
+};
+
+class FlowMonitorStreamTestCase : public TestCase
+{
+public:
+  FlowMonitorStreamTestCase (FlowMonitor::StreamFormat format);
+  virtual void DoRun (void);
+
+private:
+  /// Report the packets of two flows over two intervals of a second
+  void Report (Ptr<FlowMonitor> monitor);
+
+  FlowMonitor::StreamFormat m_format;
+};
+
+FlowMonitorStreamTestCase::FlowMonitorStreamTestCase (FlowMonitor::StreamFormat format)
+  : TestCase (format == FlowMonitor::STREAM_CSV ? "Stream interval statistics as CSV"
+              : "Stream interval statistics as binary records"),
+    m_format (format)
+{
+}
+
+void
+FlowMonitorStreamTestCase::Report (Ptr<FlowMonitor> monitor)
+{
+  Ptr<FlowProbe> probe = Create<StreamTestFlowProbe> (monitor);
+  // first interval: flow 1 sends a packet, received 200 ms later, and
+  // flow 2 sends a packet
+  Simulator::Schedule (MilliSeconds (500), &FlowMonitor::ReportFirstTx, monitor, probe, 1, 0, 100);
+  Simulator::Schedule (MilliSeconds (500), &FlowMonitor::ReportFirstTx, monitor, probe, 2, 0, 200);
+  Simulator::Schedule (MilliSeconds (700), &FlowMonitor::ReportLastRx, monitor, probe, 1, 0, 100);
+  // second interval: the packet of flow 2 is dropped, and flow 1 sends
+  // a packet, received 100 ms later
+  Simulator::Schedule (MilliSeconds (1500), &FlowMonitor::ReportDrop, monitor, probe, 2, 0, 200, 0);
+  Simulator::Schedule (MilliSeconds (1500), &FlowMonitor::ReportFirstTx, monitor, probe, 1, 1, 100);
+  Simulator::Schedule (MilliSeconds (1600), &FlowMonitor::ReportForwarding, monitor, probe, 1, 1, 100);
+  Simulator::Schedule (MilliSeconds (1600), &FlowMonitor::ReportLastRx, monitor, probe, 1, 1, 100);
+  // nothing happens during the third interval
+  Simulator::Stop (MilliSeconds (3500));
+}
+
+void
+FlowMonitorStreamTestCase::DoRun (void)
+{
+  std::string fileName = CreateTempDirFilename ("flow-monitor-stream");
+  Ptr<FlowMonitor> monitor = CreateObject<FlowMonitor> ();
+  monitor->StartRightNow ();
+  bool ok = monitor->StartStreaming (fileName, Seconds (1), m_format);
+  NS_TEST_ASSERT_MSG_EQ (ok, true, "Could not create " << fileName);
+
+  Report (monitor);
+  Simulator::Run ();
+  monitor->Dispose ();
+  Simulator::Destroy ();
+
+  std::ifstream in (fileName.c_str (), std::ios::in | std::ios::binary);
+  NS_TEST_ASSERT_MSG_EQ (in.is_open (), true, "Could not read " << fileName);
+  if (m_format == FlowMonitor::STREAM_CSV)
+    {
+      std::vector<std::string> lines;
+      std::string line;
+      while (std::getline (in, line))
+        {
+          lines.push_back (line);
+        }
+      NS_TEST_ASSERT_MSG_EQ (lines.size (), 5, "Unexpected number of lines");
+      NS_TEST_EXPECT_MSG_EQ (lines[0], "time,flowId,txPackets,rxPackets,lostPackets,droppedPackets,timesForwarded,"
+                             "txBytes,rxBytes,droppedBytes,delaySum,jitterSum", "Unexpected header");
+      NS_TEST_EXPECT_MSG_EQ (lines[1], "1,1,1,1,0,0,0,100,100,0,0.2,0", "Unexpected record");
+      NS_TEST_EXPECT_MSG_EQ (lines[2], "1,2,1,0,0,0,0,200,0,0,0,0", "Unexpected record");
+      NS_TEST_EXPECT_MSG_EQ (lines[3], "2,1,1,1,0,0,1,100,100,0,0.1,0.1", "Unexpected record");
+      NS_TEST_EXPECT_MSG_EQ (lines[4], "2,2,0,0,1,1,0,0,0,200,0,0", "Unexpected record");
+    }
+  else
+    {
+      std::ostringstream oss;
+      oss << in.rdbuf ();
+      std::string data = oss.str ();
+      NS_TEST_ASSERT_MSG_EQ (data.size (), 8 + 4 * FlowMonitor::STREAM_RECORD_SIZE, "Unexpected file size");
+
+      uint32_t magic;
+      uint16_t recordSize;
+      std::memcpy (&magic, data.data (), 4);
+      std::memcpy (&recordSize, data.data () + 6, 2);
+      NS_TEST_EXPECT_MSG_EQ (magic, FlowMonitor::STREAM_MAGIC, "Unexpected magic number");
+      NS_TEST_EXPECT_MSG_EQ (recordSize, FlowMonitor::STREAM_RECORD_SIZE, "Unexpected record size");
+
+      // the last record is the drop of the packet of flow 2
+      char const *record = data.data () + 8 + 3 * FlowMonitor::STREAM_RECORD_SIZE;
+      int64_t time;
+      uint32_t flowId, lostPackets, droppedPackets;
+      uint64_t droppedBytes;
+      std::memcpy (&time, record, 8);
+      std::memcpy (&flowId, record + 8, 4);
+      std::memcpy (&lostPackets, record + 20, 4);
+      std::memcpy (&droppedPackets, record + 24, 4);
+      std::memcpy (&droppedBytes, record + 48, 8);
+      NS_TEST_EXPECT_MSG_EQ (time, 2000000000, "Unexpected time");
+      NS_TEST_EXPECT_MSG_EQ (flowId, 2, "Unexpected flow");
+      NS_TEST_EXPECT_MSG_EQ (lostPackets, 1, "Unexpected lost packets");
+      NS_TEST_EXPECT_MSG_EQ (droppedPackets, 1, "Unexpected dropped packets");
+      NS_TEST_EXPECT_MSG_EQ (droppedBytes, 200, "Unexpected dropped bytes");
+    }
+  in.close ();
+  std::remove (fileName.c_str ());
+}
+
+static class FlowMonitorStreamTestSuite : public TestSuite
+{
+public:
+  FlowMonitorStreamTestSuite ()
+    : TestSuite ("flow-monitor-stream", UNIT)
+  {
+    AddTestCase (new FlowMonitorStreamTestCase (FlowMonitor::STREAM_CSV), TestCase::QUICK);
+    AddTestCase (new FlowMonitorStreamTestCase (FlowMonitor::STREAM_BINARY), TestCase::QUICK);
+  }
+} g_flowMonitorStreamTestSuite;
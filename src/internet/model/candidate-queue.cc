@@ -20,6 +20,7 @@
 #include <iostream>
 #include "ns3/log.h"
 #include "ns3/assert.h"
+#include "ns3/fatal-error.h"
 #include "candidate-queue.h"
 #include "global-route-manager-impl.h"
 
@@ -49,24 +50,28 @@ operator<< (std::ostream& os, const SPFVertex::VertexType& t)
 std::ostream& 
 operator<< (std::ostream& os, const CandidateQueue& q)
 {
-  typedef CandidateQueue::CandidateList_t List_t;
-  typedef List_t::const_iterator CIter_t;
-  const CandidateQueue::CandidateList_t& list = q.m_candidates;
+  typedef CandidateQueue::CandidateHeap_t Heap_t;
+  typedef Heap_t::const_iterator CIter_t;
+  Heap_t sorted = q.m_candidates;
+  std::sort (sorted.begin (), sorted.end (), &CandidateQueue::CompareCandidate);
 
   os << "*** CandidateQueue Begin (<id, distance, LSA-type>) ***" << std::endl;
-  for (CIter_t iter = list.begin (); iter != list.end (); iter++)
+  for (CIter_t iter = sorted.begin (); iter != sorted.end (); iter++)
     {
       os << "<" 
-      << (*iter)->GetVertexId () << ", "
-      << (*iter)->GetDistanceFromRoot () << ", "
-      << (*iter)->GetVertexType () << ">" << std::endl;
+      << iter->vertex->GetVertexId () << ", "
+      << iter->vertex->GetDistanceFromRoot () << ", "
+      << iter->vertex->GetVertexType () << ">" << std::endl;
     }
   os << "*** CandidateQueue End ***";
   return os;
 }
 
 CandidateQueue::CandidateQueue()
-  : m_candidates ()
+  : m_candidates (),
+    m_index (),
+    m_sequence (0),
+    m_duplicates (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -87,6 +92,7 @@ CandidateQueue::Clear (void)
       delete p;
       p = 0;
     }
+  m_duplicates = false;
 }
 
 void
@@ -94,11 +100,16 @@ CandidateQueue::Push (SPFVertex *vNew)
 {
   NS_LOG_FUNCTION (this << vNew);
 
-  CandidateList_t::iterator i = std::upper_bound (
-      m_candidates.begin (), m_candidates.end (), vNew,
-      &CandidateQueue::CompareSPFVertex
-      );
-  m_candidates.insert (i, vNew);
+  Candidate c;
+  c.vertex = vNew;
+  c.sequence = m_sequence++;
+  uint32_t i = m_candidates.size ();
+  m_candidates.push_back (c);
+  if (!m_index.insert (std::make_pair (vNew->GetVertexId (), i)).second)
+    {
+      m_duplicates = true;
+    }
+  SiftUp (i);
 }
 
 SPFVertex *
@@ -110,8 +121,32 @@ CandidateQueue::Pop (void)
       return 0;
     }
 
-  SPFVertex *v = m_candidates.front ();
-  m_candidates.pop_front ();
+  uint32_t last = m_candidates.size () - 1;
+  Swap (0, last);
+  SPFVertex *v = m_candidates.back ().vertex;
+  m_candidates.pop_back ();
+
+  CandidateIndex_t::iterator i = m_index.find (v->GetVertexId ());
+  if (i->second == last)
+    {
+      m_index.erase (i);
+      if (m_duplicates)
+        {
+          // index another candidate with the same vertex ID, if any
+          for (uint32_t j = 0; j < m_candidates.size (); j++)
+            {
+              if (m_candidates[j].vertex->GetVertexId () == v->GetVertexId ())
+                {
+                  m_index[v->GetVertexId ()] = j;
+                  break;
+                }
+            }
+        }
+    }
+  if (!m_candidates.empty ())
+    {
+      SiftDown (0);
+    }
   return v;
 }
 
@@ -124,7 +159,7 @@ CandidateQueue::Top (void) const
       return 0;
     }
 
-  return m_candidates.front ();
+  return m_candidates.front ().vertex;
 }
 
 bool
@@ -145,18 +180,22 @@ SPFVertex *
 CandidateQueue::Find (const Ipv4Address addr) const
 {
   NS_LOG_FUNCTION (this);
-  CandidateList_t::const_iterator i = m_candidates.begin ();
-
-  for (; i != m_candidates.end (); i++)
+  CandidateIndex_t::const_iterator i = m_index.find (addr);
+  if (i == m_index.end ())
     {
-      SPFVertex *v = *i;
-      if (v->GetVertexId () == addr)
-        {
-          return v;
-        }
+      return 0;
     }
+  return m_candidates[i->second].vertex;
+}
 
-  return 0;
+void
+CandidateQueue::DecreaseKey (SPFVertex *v)
+{
+  NS_LOG_FUNCTION (this << v);
+
+  uint32_t i = GetPosition (v);
+  m_candidates[i].sequence = m_sequence++;
+  SiftUp (i);
 }
 
 void
@@ -164,11 +203,108 @@ CandidateQueue::Reorder (void)
 {
   NS_LOG_FUNCTION (this);
 
-  m_candidates.sort (&CandidateQueue::CompareSPFVertex);
+  for (uint32_t i = m_candidates.size () / 2; i > 0; i--)
+    {
+      SiftDown (i - 1);
+    }
   NS_LOG_LOGIC ("After reordering the CandidateQueue");
   NS_LOG_LOGIC (*this);
 }
 
+uint32_t
+CandidateQueue::GetPosition (const SPFVertex *v) const
+{
+  CandidateIndex_t::const_iterator i = m_index.find (v->GetVertexId ());
+  NS_ASSERT_MSG (i != m_index.end (), "Vertex " << v->GetVertexId () << " not in the CandidateQueue");
+  if (m_candidates[i->second].vertex == v)
+    {
+      return i->second;
+    }
+  for (uint32_t j = 0; j < m_candidates.size (); j++)
+    {
+      if (m_candidates[j].vertex == v)
+        {
+          return j;
+        }
+    }
+  NS_FATAL_ERROR ("Vertex " << v->GetVertexId () << " not in the CandidateQueue");
+  return 0;
+}
+
+void
+CandidateQueue::Swap (uint32_t i, uint32_t j)
+{
+  CandidateIndex_t::iterator a = m_index.find (m_candidates[i].vertex->GetVertexId ());
+  CandidateIndex_t::iterator b = m_index.find (m_candidates[j].vertex->GetVertexId ());
+  // with duplicate vertex IDs, a and b may be the same entry
+  bool aMoves = (a->second == i);
+  bool bMoves = (b->second == j);
+  std::swap (m_candidates[i], m_candidates[j]);
+  if (aMoves)
+    {
+      a->second = j;
+    }
+  if (bMoves)
+    {
+      b->second = i;
+    }
+}
+
+void
+CandidateQueue::SiftUp (uint32_t i)
+{
+  while (i > 0)
+    {
+      uint32_t parent = (i - 1) / 2;
+      if (!CompareCandidate (m_candidates[i], m_candidates[parent]))
+        {
+          break;
+        }
+      Swap (i, parent);
+      i = parent;
+    }
+}
+
+void
+CandidateQueue::SiftDown (uint32_t i)
+{
+  uint32_t size = m_candidates.size ();
+  for (;;)
+    {
+      uint32_t first = i;
+      uint32_t left = 2 * i + 1;
+      uint32_t right = left + 1;
+      if (left < size && CompareCandidate (m_candidates[left], m_candidates[first]))
+        {
+          first = left;
+        }
+      if (right < size && CompareCandidate (m_candidates[right], m_candidates[first]))
+        {
+          first = right;
+        }
+      if (first == i)
+        {
+          break;
+        }
+      Swap (i, first);
+      i = first;
+    }
+}
+
+bool
+CandidateQueue::CompareCandidate (const Candidate &c1, const Candidate &c2)
+{
+  if (CompareSPFVertex (c1.vertex, c2.vertex))
+    {
+      return true;
+    }
+  if (CompareSPFVertex (c2.vertex, c1.vertex))
+    {
+      return false;
+    }
+  return c1.sequence < c2.sequence;
+}
+
 /*
  * In this implementation, SPFVertex follows the ordering where
  * a vertex is ranked first if its GetDistanceFromRoot () is smaller;
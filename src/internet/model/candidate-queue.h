@@ -22,8 +22,9 @@
 #define CANDIDATE_QUEUE_H
 
 #include <stdint.h>
-#include <list>
+#include <vector>
 #include "ns3/ipv4-address.h"
+#include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
 
@@ -43,8 +44,11 @@ class SPFVertex;
  *
  * Although a STL priority_queue almost does what we want, the requirement
  * for a Find () operation, the dynamic nature of the data and the derived
- * requirement for a Reorder () operation led us to implement this simple 
- * enhanced priority queue.
+ * requirement for a DecreaseKey () operation led us to implement this
+ * enhanced priority queue: a binary heap whose entries are indexed by
+ * vertex ID.  Vertices at the same distance and of the same type are popped
+ * in the order they were pushed, or in the order their distance was last
+ * decreased.
  */
 class CandidateQueue
 {
@@ -140,12 +144,30 @@ public:
  * pointer that points to a vertex having the given IP address.
  * @internal
  *
+ * The lookup is done in constant time.  Vertex IDs are expected to be
+ * unique in the queue; if several vertices have the given IP address, any
+ * of them is returned.
+ *
  * @see SPFVertex
  * @param addr The IP address to search for.
  * @returns The SPFVertex* pointer corresponding to the given IP address.
  */
   SPFVertex* Find (const Ipv4Address addr) const;
 
+/**
+ * @brief Restore the priority of a vertex in the queue whose 
+ * m_distanceFromRoot has just been decreased.
+ * @internal
+ *
+ * The vertex moves towards the top of the queue in logarithmic time.  Among
+ * the vertices at its new distance, it is popped last, as if it had just
+ * been pushed.
+ *
+ * @see SPFVertex
+ * @param v The Shortest Path First Vertex, which must be in the queue.
+ */
+  void DecreaseKey (SPFVertex *v);
+
 /**
  * @brief Reorders the Candidate Queue according to the priority scheme.
  * @internal
@@ -155,8 +177,9 @@ public:
  * m_distanceFromRoot.  Remaining vertices are ordered according to 
  * increasing distance.
  *
- * This method is provided in case the values of m_distanceFromRoot change
- * during the routing calculations.
+ * This method is provided in case the values of m_distanceFromRoot of
+ * several vertices change during the routing calculations.  When a single
+ * distance decreases, DecreaseKey () is cheaper.
  *
  * @see SPFVertex
  */
@@ -192,8 +215,55 @@ private:
  */
   static bool CompareSPFVertex (const SPFVertex* v1, const SPFVertex* v2);
 
-  typedef std::list<SPFVertex*> CandidateList_t; //!< container of SPFVertex pointers
-  CandidateList_t m_candidates;  //!< SPFVertex candidates
+  /// A vertex in the heap, with the order in which it was queued
+  struct Candidate
+  {
+    SPFVertex *vertex; //!< the vertex
+    uint64_t sequence; //!< breaks the ties between equivalent vertices
+  };
+
+  /**
+   * \brief return true if the candidate c1 should be popped before c2
+   * \param c1 first operand
+   * \param c2 second operand
+   * \return True if c1 should be popped before c2; false otherwise
+   */
+  static bool CompareCandidate (const Candidate &c1, const Candidate &c2);
+
+  /**
+   * \brief Move the candidate at the given heap position up to its place.
+   * \param i the heap position
+   */
+  void SiftUp (uint32_t i);
+
+  /**
+   * \brief Move the candidate at the given heap position down to its place.
+   * \param i the heap position
+   */
+  void SiftDown (uint32_t i);
+
+  /**
+   * \brief Exchange two candidates in the heap and update the index.
+   * \param i the heap position of the first candidate
+   * \param j the heap position of the second candidate
+   */
+  void Swap (uint32_t i, uint32_t j);
+
+  /**
+   * \brief Return the heap position of a vertex of the queue.
+   * \param v the vertex
+   * \return the heap position
+   */
+  uint32_t GetPosition (const SPFVertex *v) const;
+
+  typedef std::vector<Candidate> CandidateHeap_t; //!< binary heap of candidates
+  /// heap position of the candidates, by vertex ID
+  typedef sgi::hash_map<Ipv4Address, uint32_t, Ipv4AddressHash> CandidateIndex_t;
+
+  CandidateHeap_t m_candidates;  //!< SPFVertex candidates
+  CandidateIndex_t m_index;      //!< heap position of the candidates
+  uint64_t m_sequence;           //!< sequence number of the next candidate
+  bool m_duplicates;             //!< several candidates have had the same vertex ID
 
   /**
    * \brief Stream insertion operator.
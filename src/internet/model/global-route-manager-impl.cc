@@ -30,11 +30,17 @@
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
+#include "ns3/global-value.h"
+#include "ns3/uinteger.h"
 #include "ns3/node-list.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-list-routing.h"
 #include "ns3/mpi-interface.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#endif /* HAVE_PTHREAD_H */
 #include "global-router-interface.h"
 #include "global-route-manager-impl.h"
 #include "candidate-queue.h"
@@ -44,6 +50,15 @@ NS_LOG_COMPONENT_DEFINE ("GlobalRouteManagerImpl");
 
 namespace ns3 {
 
+/**
+ * \brief The number of threads running the SPF calculations of the
+ * different routers.
+ */
+static GlobalValue g_spfThreads = GlobalValue ("GlobalRoutingSpfThreads",
+                                               "The number of threads computing the global routes of the routers in parallel",
+                                               UintegerValue (1),
+                                               MakeUintegerChecker<uint32_t> (1));
+
 /**
  * \brief Stream insertion operator.
  *
@@ -423,6 +438,7 @@ SPFVertex::ClearVertexProcessed (void)
 GlobalRouteManagerLSDB::GlobalRouteManagerLSDB ()
   :
     m_database (),
+    m_linkData (),
     m_extdatabase ()
 {
   NS_LOG_FUNCTION (this);
@@ -446,6 +462,7 @@ GlobalRouteManagerLSDB::~GlobalRouteManagerLSDB ()
     }
   NS_LOG_LOGIC ("clear map");
   m_database.clear ();
+  m_linkData.clear ();
 }
 
 void
@@ -470,7 +487,32 @@ GlobalRouteManagerLSDB::Insert (Ipv4Address addr, GlobalRoutingLSA* lsa)
     } 
   else
     {
-      m_database.insert (LSDBPair_t (addr, lsa));
+      if (!m_database.insert (LSDBPair_t (addr, lsa)).second)
+        {
+          return;
+        }
+//
+// Index the LSA by the link data of its TransitNetwork records; among the
+// LSAs sharing a link data, the one at the lowest address wins, as in a
+// walk of the database.
+//
+      for (uint32_t j = 0; j < lsa->GetNLinkRecords (); j++)
+        {
+          GlobalRoutingLinkRecord *lr = lsa->GetLinkRecord (j);
+          if (lr->GetLinkType () != GlobalRoutingLinkRecord::TransitNetwork)
+            {
+              continue;
+            }
+          LinkDataMap_t::iterator i = m_linkData.find (lr->GetLinkData ());
+          if (i == m_linkData.end ())
+            {
+              m_linkData.insert (std::make_pair (lr->GetLinkData (), LSDBPair_t (addr, lsa)));
+            }
+          else if (addr < i->second.first)
+            {
+              i->second = LSDBPair_t (addr, lsa);
+            }
+        }
     }
 }
 
@@ -495,13 +537,10 @@ GlobalRouteManagerLSDB::GetLSA (Ipv4Address addr) const
 //
 // Look up an LSA by its address.
 //
-  LSDBMap_t::const_iterator i;
-  for (i= m_database.begin (); i!= m_database.end (); i++)
+  LSDBMap_t::const_iterator i = m_database.find (addr);
+  if (i != m_database.end ())
     {
-      if (i->first == addr)
-        {
-          return i->second;
-        }
+      return i->second;
     }
   return 0;
 }
@@ -511,22 +550,12 @@ GlobalRouteManagerLSDB::GetLSAByLinkData (Ipv4Address addr) const
 {
   NS_LOG_FUNCTION (this << addr);
 //
-// Look up an LSA by its address.
+// Look up an LSA by the link data of its TransitNetwork records.
 //
-  LSDBMap_t::const_iterator i;
-  for (i= m_database.begin (); i!= m_database.end (); i++)
+  LinkDataMap_t::const_iterator i = m_linkData.find (addr);
+  if (i != m_linkData.end ())
     {
-      GlobalRoutingLSA* temp = i->second;
-// Iterate among temp's Link Records
-      for (uint32_t j = 0; j < temp->GetNLinkRecords (); j++)
-        {
-          GlobalRoutingLinkRecord *lr = temp->GetLinkRecord (j);
-          if ( lr->GetLinkType () == GlobalRoutingLinkRecord::TransitNetwork &&
-               lr->GetLinkData () == addr)
-            {
-              return temp;
-            }
-        }
+      return i->second.second;
     }
   return 0;
 }
@@ -539,16 +568,27 @@ GlobalRouteManagerLSDB::GetLSAByLinkData (Ipv4Address addr) const
 
 GlobalRouteManagerImpl::GlobalRouteManagerImpl () 
   :
-    m_spfroot (0)
+    m_spfroot (0),
+    m_ownsLsdb (true)
 {
   NS_LOG_FUNCTION (this);
   m_lsdb = new GlobalRouteManagerLSDB ();
 }
 
+GlobalRouteManagerImpl::GlobalRouteManagerImpl (const GlobalRouteManagerImpl *master)
+  :
+    m_spfroot (0),
+    m_lsdb (master->m_lsdb),
+    m_ownsLsdb (false),
+    m_routers (master->m_routers)
+{
+  NS_LOG_FUNCTION (this << master);
+}
+
 GlobalRouteManagerImpl::~GlobalRouteManagerImpl ()
 {
   NS_LOG_FUNCTION (this);
-  if (m_lsdb)
+  if (m_lsdb && m_ownsLsdb)
     {
       delete m_lsdb;
     }
@@ -700,6 +740,7 @@ GlobalRouteManagerImpl::InitializeRoutes ()
 // Walk the list of nodes in the system.
 //
   NS_LOG_INFO ("About to start SPF calculation");
+  std::vector<Ipv4Address> roots;
   NodeList::Iterator listEnd = NodeList::End ();
   for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
     {
@@ -724,12 +765,107 @@ GlobalRouteManagerImpl::InitializeRoutes ()
 //
       if (rtr && rtr->GetNumLSAs () )
         {
-          SPFCalculate (rtr->GetRouterId ());
+          roots.push_back (rtr->GetRouterId ());
         }
     }
+  CollectRouters ();
+
+  UintegerValue threads;
+  g_spfThreads.GetValue (threads);
+  uint32_t nThreads = std::min<uint32_t> (threads.Get (), roots.size ());
+#ifdef HAVE_PTHREAD_H
+  if (nThreads > 1)
+    {
+//
+// The calculations of the different roots share the LSDB, which they only
+// read, and each writes the routing tables of its own root node: hand the
+// roots out to workers, each with its own SPF state, running on their own
+// threads.  The workers are created, and later destroyed, here so that the
+// reference counts of the nodes are only touched by this thread.
+//
+      NS_LOG_LOGIC ("Running the SPF calculations on " << nThreads << " threads");
+      std::vector<GlobalRouteManagerImpl *> workers;
+      for (uint32_t t = 0; t < nThreads; t++)
+        {
+          workers.push_back (new GlobalRouteManagerImpl (this));
+        }
+      for (uint32_t r = 0; r < roots.size (); r++)
+        {
+          workers[r % nThreads]->m_spfRoots.push_back (roots[r]);
+        }
+      std::vector<Ptr<SystemThread> > systemThreads;
+      for (uint32_t t = 0; t < nThreads; t++)
+        {
+          Ptr<SystemThread> thread = 
+            Create<SystemThread> (MakeCallback (&GlobalRouteManagerImpl::RunSPFWorker, workers[t]));
+          thread->Start ();
+          systemThreads.push_back (thread);
+        }
+      for (uint32_t t = 0; t < nThreads; t++)
+        {
+          systemThreads[t]->Join ();
+          delete workers[t];
+        }
+      m_routers.clear ();
+      NS_LOG_INFO ("Finished SPF calculation");
+      return;
+    }
+#endif /* HAVE_PTHREAD_H */
+  for (uint32_t r = 0; r < roots.size (); r++)
+    {
+      SPFCalculate (roots[r]);
+    }
+  m_routers.clear ();
   NS_LOG_INFO ("Finished SPF calculation");
 }
 
+void
+GlobalRouteManagerImpl::CollectRouters (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_routers.clear ();
+  NodeList::Iterator listEnd = NodeList::End ();
+  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+    {
+      Ptr<GlobalRouter> rtr = (*i)->GetObject<GlobalRouter> ();
+      if (rtr == 0)
+        {
+          NS_LOG_LOGIC ("No GlobalRouter interface on node " << (*i)->GetId ());
+          continue;
+        }
+      // the first node with a router ID gets the routes, as in a walk of
+      // the node list
+      m_routers.insert (std::make_pair (rtr->GetRouterId (), *i));
+    }
+}
+
+void
+GlobalRouteManagerImpl::RunSPFWorker (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t r = 0; r < m_spfRoots.size (); r++)
+    {
+      SPFCalculate (m_spfRoots[r]);
+    }
+}
+
+GlobalRoutingLSA::SPFStatus
+GlobalRouteManagerImpl::GetSPFStatus (GlobalRoutingLSA *lsa) const
+{
+  SPFStatusMap_t::const_iterator i = m_status.find (lsa->GetLinkStateId ());
+  if (i == m_status.end ())
+    {
+      return GlobalRoutingLSA::LSA_SPF_NOT_EXPLORED;
+    }
+  return i->second;
+}
+
+void
+GlobalRouteManagerImpl::SetSPFStatus (GlobalRoutingLSA *lsa, GlobalRoutingLSA::SPFStatus status)
+{
+  m_status[lsa->GetLinkStateId ()] = status;
+}
+
 //
 // This method is derived from quagga ospf_spf_next ().  See RFC2328 Section 
 // 16.1 (2) for further details.
@@ -836,7 +972,7 @@ GlobalRouteManagerImpl::SPFNext (SPFVertex* v, CandidateQueue& candidate)
 // If the link is to a router that is already in the shortest path first tree
 // then we have it covered -- ignore it.
 //
-      if (w_lsa->GetStatus () == GlobalRoutingLSA::LSA_SPF_IN_SPFTREE) 
+      if (GetSPFStatus (w_lsa) == GlobalRoutingLSA::LSA_SPF_IN_SPFTREE) 
         {
           NS_LOG_LOGIC ("Skipping ->  LSA "<< 
                         w_lsa->GetLinkStateId () << " already in SPF tree");
@@ -861,7 +997,7 @@ GlobalRouteManagerImpl::SPFNext (SPFVertex* v, CandidateQueue& candidate)
       NS_LOG_LOGIC ("Considering w_lsa " << w_lsa->GetLinkStateId ());
 
 // Is there already vertex w in candidate list?
-      if (w_lsa->GetStatus () == GlobalRoutingLSA::LSA_SPF_NOT_EXPLORED)
+      if (GetSPFStatus (w_lsa) == GlobalRoutingLSA::LSA_SPF_NOT_EXPLORED)
         {
 // Calculate nexthop to w
 // We need to figure out how to actually get to the new router represented
@@ -873,7 +1009,7 @@ GlobalRouteManagerImpl::SPFNext (SPFVertex* v, CandidateQueue& candidate)
           w = new SPFVertex (w_lsa);
           if (SPFNexthopCalculation (v, w, l, distance))
             {
-              w_lsa->SetStatus (GlobalRoutingLSA::LSA_SPF_CANDIDATE);
+              SetSPFStatus (w_lsa, GlobalRoutingLSA::LSA_SPF_CANDIDATE);
 //
 // Push this new vertex onto the priority queue (ordered by distance from the
 // root node).
@@ -888,7 +1024,7 @@ GlobalRouteManagerImpl::SPFNext (SPFVertex* v, CandidateQueue& candidate)
             NS_ASSERT_MSG (0, "SPFNexthopCalculation never " 
                            << "return false, but it does now!");
         }
-      else if (w_lsa->GetStatus () == GlobalRoutingLSA::LSA_SPF_CANDIDATE)
+      else if (GetSPFStatus (w_lsa) == GlobalRoutingLSA::LSA_SPF_CANDIDATE)
         {
 //
 // We have already considered the link represented by <w>.  What wse have to
@@ -958,9 +1094,9 @@ GlobalRouteManagerImpl::SPFNext (SPFVertex* v, CandidateQueue& candidate)
                 {
 //
 // If we've changed the cost to get to the vertex represented by <w>, we 
-// must reorder the priority queue keyed to that cost.
+// must move it up the priority queue keyed to that cost.
 //
-                  candidate.Reorder ();
+                  candidate.DecreaseKey (cw);
                 }
             } // new lower cost path found
         } // end W is already on the candidate list
@@ -1247,7 +1383,9 @@ void
 GlobalRouteManagerImpl::DebugSPFCalculate (Ipv4Address root)
 {
   NS_LOG_FUNCTION (this << root);
+  CollectRouters ();
   SPFCalculate (root);
+  m_routers.clear ();
 }
 
 //
@@ -1320,9 +1458,7 @@ GlobalRouteManagerImpl::CheckForStubNode (Ipv4Address root)
               if (lr->GetLinkId () == myRouterId)
                 {
                   // Next hop is stored in the LinkID field of lr
-                  Ptr<GlobalRouter> router = rlsa->GetNode ()->GetObject<GlobalRouter> ();
-                  NS_ASSERT (router);
-                  Ptr<Ipv4GlobalRouting> gr = router->GetRoutingProtocol ();
+                  Ptr<Ipv4GlobalRouting> gr = m_spfrootRouting;
                   NS_ASSERT (gr);
                   gr->AddNetworkRouteTo (Ipv4Address ("0.0.0.0"), Ipv4Mask ("0.0.0.0"), lr->GetLinkData (), 
                                          FindOutgoingInterfaceId (transitLink->GetLinkData ()));
@@ -1345,9 +1481,11 @@ GlobalRouteManagerImpl::SPFCalculate (Ipv4Address root)
 
   SPFVertex *v;
 //
-// Initialize the Link State Database.
+// Forget the status of the LSAs in the previous calculation.  The status is
+// not kept in the LSAs themselves, which are shared by the calculations
+// running on other threads.
 //
-  m_lsdb->Initialize ();
+  m_status.clear ();
 //
 // The candidate queue is a priority queue of SPFVertex objects, with the top
 // of the queue being the closest vertex in terms of distance from the root
@@ -1367,8 +1505,24 @@ GlobalRouteManagerImpl::SPFCalculate (Ipv4Address root)
 //
   m_spfroot= v;
   v->SetDistanceFromRoot (0);
-  v->GetLSA ()->SetStatus (GlobalRoutingLSA::LSA_SPF_IN_SPFTREE);
+  SetSPFStatus (v->GetLSA (), GlobalRoutingLSA::LSA_SPF_IN_SPFTREE);
   NS_LOG_LOGIC ("Starting SPFCalculate for node " << root);
+//
+// Look up the node whose router ID is the one of the root: it is the only
+// node whose routing tables this calculation writes.
+//
+  RouterMap_t::const_iterator rootRouter = m_routers.find (root);
+  if (rootRouter != m_routers.end ())
+    {
+      m_spfrootNode = rootRouter->second;
+      m_spfrootIpv4 = m_spfrootNode->GetObject<Ipv4> ();
+      m_spfrootRouting = m_spfrootNode->GetObject<GlobalRouter> ()->GetRoutingProtocol ();
+      NS_LOG_LOGIC ("Setting routes for node " << m_spfrootNode->GetId ());
+    }
+  else
+    {
+      NS_LOG_LOGIC ("Can't find root node " << root);
+    }
 
 //
 // Optimize SPF calculation, for ns-3.
@@ -1377,10 +1531,12 @@ GlobalRouteManagerImpl::SPFCalculate (Ipv4Address root)
 // reached.  Instead, short-circuit this computation and just install
 // a default route in the CheckForStubNode() method.
 //
-  if (NodeList::GetNNodes () > 0 && CheckForStubNode (root))
+  if (m_spfrootNode != 0 && CheckForStubNode (root))
     {
       NS_LOG_LOGIC ("SPFCalculate truncated for stub node " << root);
       delete m_spfroot;
+      m_spfroot = 0;
+      ForgetSPFRoot ();
       return;
     }
 
@@ -1428,7 +1584,7 @@ GlobalRouteManagerImpl::SPFCalculate (Ipv4Address root)
 // Update the status field of the vertex to indicate that it is in the SPF
 // tree.
 //
-      v->GetLSA ()->SetStatus (GlobalRoutingLSA::LSA_SPF_IN_SPFTREE);
+      SetSPFStatus (v->GetLSA (), GlobalRoutingLSA::LSA_SPF_IN_SPFTREE);
 //
 // The current vertex has a parent pointer.  By calling this rather oddly 
 // named method (blame quagga) we add the current vertex to the list of 
@@ -1444,12 +1600,11 @@ GlobalRouteManagerImpl::SPFCalculate (Ipv4Address root)
 //
 // RFC2328 16.1. (4). 
 //
-// This is the method that actually adds the routes.  It'll walk the list
-// of nodes in the system, looking for the node corresponding to the router
-// ID of the root of the tree -- that is the router we're building the routes
-// for.  It looks for the Ipv4 interface of that node and remembers it.  So
-// we are only actually adding routes to that one node at the root of the SPF 
-// tree.
+// This is the method that actually adds the routes.  It uses the node
+// corresponding to the router ID of the root of the tree, found above --
+// that is the router we're building the routes for -- and its Ipv4
+// interface.  So we are only actually adding routes to that one node at the
+// root of the SPF tree.
 //
 // We're going to pop of a pointer to every vertex in the tree except the 
 // root in order of distance from the root.  For each of the vertices, we call
@@ -1502,6 +1657,17 @@ GlobalRouteManagerImpl::SPFCalculate (Ipv4Address root)
 //
   delete m_spfroot;
   m_spfroot = 0;
+  ForgetSPFRoot ();
+}
+
+void
+GlobalRouteManagerImpl::ForgetSPFRoot (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_spfrootNode = 0;
+  m_spfrootIpv4 = 0;
+  m_spfrootRouting = 0;
+  m_status.clear ();
 }
 
 void
@@ -1556,112 +1722,70 @@ GlobalRouteManagerImpl::SPFAddASExternal (GlobalRoutingLSA *extlsa, SPFVertex *v
   NS_LOG_LOGIC ("External is on remote host: " 
                 << extlsa->GetAdvertisingRouter () << "; installing");
 
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
-
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
+  NS_LOG_LOGIC ("Vertex ID = " << m_spfroot->GetVertexId ());
 //
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
+// The node that has the router ID corresponding to the root vertex is the
+// one we're going to write the routing information to.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+  if (m_spfrootNode == 0)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the GlobalRouter interface, so we need
-// to QI for that interface.  If there's no GlobalRouter interface, the node
-// in question cannot be the router we want, so we continue.
-// 
-      Ptr<GlobalRouter> rtr = node->GetObject<GlobalRouter> ();
-
-      if (rtr == 0)
-        {
-          NS_LOG_LOGIC ("No GlobalRouter interface on node " << node->GetId ());
-          continue;
-        }
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId)
-        {
-          NS_LOG_LOGIC ("Setting routes for node " << node->GetId ());
+      NS_LOG_LOGIC ("Can't find root node " << m_spfroot->GetVertexId ());
+      return;
+    }
 //
-// Routing information is updated using the Ipv4 interface.  We need to QI
-// for that interface.  If the node is acting as an IP version 4 router, it
-// should absolutely have an Ipv4 interface.
+// Routing information is updated using the Ipv4 interface.  If the node is
+// acting as an IP version 4 router, it should absolutely have an Ipv4
+// interface.
 //
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
-                         "QI for <Ipv4> interface failed");
+  NS_ASSERT_MSG (m_spfrootIpv4, 
+                 "GlobalRouteManagerImpl::SPFAddASExternal (): "
+                 "QI for <Ipv4> interface failed");
 //
 // Get the Global Router Link State Advertisement from the vertex we're
-// adding the routes to.  The LSA will have a number of attached Global Router
-// Link Records corresponding to links off of that vertex / node.  We're going
-// to be interested in the records corresponding to point-to-point links.
-//
-          NS_ASSERT_MSG (v->GetLSA (), 
-                         "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
-                         "Expected valid LSA in SPFVertex* v");
-          Ipv4Mask tempmask = extlsa->GetNetworkLSANetworkMask ();
-          Ipv4Address tempip = extlsa->GetLinkStateId ();
-          tempip = tempip.CombineMask (tempmask);
-
-//
-// Here's why we did all of that work.  We're going to add a host route to the
-// host address found in the m_linkData field of the point-to-point link
-// record.  In the case of a point-to-point link, this is the local IP address
-// of the node connected to the link.  Each of these point-to-point links
-// will correspond to a local interface that has an IP address to which
-// the node at the root of the SPF tree can send packets.  The vertex <v> 
-// (corresponding to the node that has these links and interfaces) has 
-// an m_nextHop address precalculated for us that is the address to which the
-// root node should send packets to be forwarded to these IP addresses.
-// Similarly, the vertex <v> has an m_rootOif (outbound interface index) to
-// which the packets should be send for forwarding.
-//
-          Ptr<GlobalRouter> router = node->GetObject<GlobalRouter> ();
-          if (router == 0)
-            {
-              continue;
-            }
-          Ptr<Ipv4GlobalRouting> gr = router->GetRoutingProtocol ();
-          NS_ASSERT (gr);
-          // walk through all next-hop-IPs and out-going-interfaces for reaching
-          // the stub network gateway 'v' from the root node
-          for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
-            {
-              SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
-              Ipv4Address nextHop = exit.first;
-              int32_t outIf = exit.second;
-              if (outIf >= 0)
-                {
-                  gr->AddASExternalRouteTo (tempip, tempmask, nextHop, outIf);
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " add external network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " via interface " << outIf);
-                }
-              else
-                {
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " NOT able to add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " since outgoing interface id is negative");
-                }
-            }
-          return;
-        } // if
-    } // for
+// adding the routes to.
+//
+  NS_ASSERT_MSG (v->GetLSA (), 
+                 "GlobalRouteManagerImpl::SPFAddASExternal (): "
+                 "Expected valid LSA in SPFVertex* v");
+  Ipv4Mask tempmask = extlsa->GetNetworkLSANetworkMask ();
+  Ipv4Address tempip = extlsa->GetLinkStateId ();
+  tempip = tempip.CombineMask (tempmask);
+
+//
+// The vertex <v> (corresponding to the node that advertises the external
+// network) has an m_nextHop address precalculated for us that is the address
+// to which the root node should send packets to be forwarded to the external
+// network.  Similarly, the vertex <v> has an m_rootOif (outbound interface
+// index) to which the packets should be send for forwarding.
+//
+  Ptr<Ipv4GlobalRouting> gr = m_spfrootRouting;
+  NS_ASSERT (gr);
+  uint32_t nodeId = m_spfrootNode->GetId ();
+  // walk through all next-hop-IPs and out-going-interfaces for reaching
+  // the stub network gateway 'v' from the root node
+  for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
+    {
+      SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
+      Ipv4Address nextHop = exit.first;
+      int32_t outIf = exit.second;
+      if (outIf >= 0)
+        {
+          gr->AddASExternalRouteTo (tempip, tempmask, nextHop, outIf);
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " add external network route to " << tempip <<
+                        " using next hop " << nextHop <<
+                        " via interface " << outIf);
+        }
+      else
+        {
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " NOT able to add network route to " << tempip <<
+                        " using next hop " << nextHop <<
+                        " since outgoing interface id is negative");
+        }
+    }
 }
 
-
 // Processing logic from RFC 2328, page 166 and quagga ospf_spf_process_stubs ()
 // stub link records will exist for point-to-point interfaces and for
 // broadcast interfaces for which no neighboring router can be found
@@ -1725,111 +1849,68 @@ GlobalRouteManagerImpl::SPFIntraAddStub (GlobalRoutingLinkRecord *l, SPFVertex*
 // going to use this ID to discover which node it is that we're actually going
 // to update.
 //
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
-
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
+  NS_LOG_LOGIC ("Vertex ID = " << m_spfroot->GetVertexId ());
 //
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
+// The node that has the router ID corresponding to the root vertex is the
+// one we're going to write the routing information to.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+  if (m_spfrootNode == 0)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the GlobalRouter interface, so we need
-// to QI for that interface.  If there's no GlobalRouter interface, the node
-// in question cannot be the router we want, so we continue.
-// 
-      Ptr<GlobalRouter> rtr = 
-        node->GetObject<GlobalRouter> ();
-
-      if (rtr == 0)
-        {
-          NS_LOG_LOGIC ("No GlobalRouter interface on node " << 
-                        node->GetId ());
-          continue;
-        }
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId)
-        {
-          NS_LOG_LOGIC ("Setting routes for node " << node->GetId ());
+      NS_LOG_LOGIC ("Can't find root node " << m_spfroot->GetVertexId ());
+      return;
+    }
 //
-// Routing information is updated using the Ipv4 interface.  We need to QI
-// for that interface.  If the node is acting as an IP version 4 router, it
-// should absolutely have an Ipv4 interface.
+// Routing information is updated using the Ipv4 interface.  If the node is
+// acting as an IP version 4 router, it should absolutely have an Ipv4
+// interface.
 //
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
-                         "QI for <Ipv4> interface failed");
+  NS_ASSERT_MSG (m_spfrootIpv4, 
+                 "GlobalRouteManagerImpl::SPFIntraAddStub (): "
+                 "QI for <Ipv4> interface failed");
 //
 // Get the Global Router Link State Advertisement from the vertex we're
-// adding the routes to.  The LSA will have a number of attached Global Router
-// Link Records corresponding to links off of that vertex / node.  We're going
-// to be interested in the records corresponding to point-to-point links.
-//
-          NS_ASSERT_MSG (v->GetLSA (), 
-                         "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
-                         "Expected valid LSA in SPFVertex* v");
-          Ipv4Mask tempmask (l->GetLinkData ().Get ());
-          Ipv4Address tempip = l->GetLinkId ();
-          tempip = tempip.CombineMask (tempmask);
-//
-// Here's why we did all of that work.  We're going to add a host route to the
-// host address found in the m_linkData field of the point-to-point link
-// record.  In the case of a point-to-point link, this is the local IP address
-// of the node connected to the link.  Each of these point-to-point links
-// will correspond to a local interface that has an IP address to which
-// the node at the root of the SPF tree can send packets.  The vertex <v> 
-// (corresponding to the node that has these links and interfaces) has 
-// an m_nextHop address precalculated for us that is the address to which the
-// root node should send packets to be forwarded to these IP addresses.
-// Similarly, the vertex <v> has an m_rootOif (outbound interface index) to
-// which the packets should be send for forwarding.
-//
-
-          Ptr<GlobalRouter> router = node->GetObject<GlobalRouter> ();
-          if (router == 0)
-            {
-              continue;
-            }
-          Ptr<Ipv4GlobalRouting> gr = router->GetRoutingProtocol ();
-          NS_ASSERT (gr);
-          // walk through all next-hop-IPs and out-going-interfaces for reaching
-          // the stub network gateway 'v' from the root node
-          for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
-            {
-              SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
-              Ipv4Address nextHop = exit.first;
-              int32_t outIf = exit.second;
-              if (outIf >= 0)
-                {
-                  gr->AddNetworkRouteTo (tempip, tempmask, nextHop, outIf);
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " via interface " << outIf);
-                }
-              else
-                {
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " NOT able to add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " since outgoing interface id is negative");
-                }
-            }
-          return;
-        } // if
-    } // for
+// adding the routes to.
+//
+  NS_ASSERT_MSG (v->GetLSA (), 
+                 "GlobalRouteManagerImpl::SPFIntraAddStub (): "
+                 "Expected valid LSA in SPFVertex* v");
+  Ipv4Mask tempmask (l->GetLinkData ().Get ());
+  Ipv4Address tempip = l->GetLinkId ();
+  tempip = tempip.CombineMask (tempmask);
+//
+// We're going to add a network route to the stub network found in the
+// link record.  The vertex <v> (corresponding to the node that has the stub
+// network) has an m_nextHop address precalculated for us that is the address
+// to which the root node should send packets to be forwarded to the stub
+// network.  Similarly, the vertex <v> has an m_rootOif (outbound interface
+// index) to which the packets should be send for forwarding.
+//
+  Ptr<Ipv4GlobalRouting> gr = m_spfrootRouting;
+  NS_ASSERT (gr);
+  uint32_t nodeId = m_spfrootNode->GetId ();
+  // walk through all next-hop-IPs and out-going-interfaces for reaching
+  // the stub network gateway 'v' from the root node
+  for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
+    {
+      SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
+      Ipv4Address nextHop = exit.first;
+      int32_t outIf = exit.second;
+      if (outIf >= 0)
+        {
+          gr->AddNetworkRouteTo (tempip, tempmask, nextHop, outIf);
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " add network route to " << tempip <<
+                        " using next hop " << nextHop <<
+                        " via interface " << outIf);
+        }
+      else
+        {
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " NOT able to add network route to " << tempip <<
+                        " using next hop " << nextHop <<
+                        " since outgoing interface id is negative");
+        }
+    }
 }
 
 //
@@ -1844,70 +1925,42 @@ GlobalRouteManagerImpl::FindOutgoingInterfaceId (Ipv4Address a, Ipv4Mask amask)
 {
   NS_LOG_FUNCTION (this << a << amask);
 //
-// We have an IP address <a> and a vertex ID of the root of the SPF tree.
-// The question is what interface index does this address correspond to.
-// The answer is a little complicated since we have to find a pointer to
-// the node corresponding to the vertex ID, find the Ipv4 interface on that
-// node in order to iterate the interfaces and find the one corresponding to
-// the address in question.
-//
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
-//
-// Walk the list of nodes in the system looking for the one corresponding to
-// the node at the root of the SPF tree.  This is the node for which we are
-// building the routing table.
+// We have an IP address <a> and the node at the root of the SPF tree, found
+// from its vertex ID when the calculation started.  The question is what
+// interface index does this address correspond to.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+  if (m_spfrootNode == 0)
     {
-      Ptr<Node> node = *i;
-
-      Ptr<GlobalRouter> rtr = 
-        node->GetObject<GlobalRouter> ();
 //
-// If the node doesn't have a GlobalRouter interface it can't be the one
-// we're interested in.
+// Couldn't find it.
 //
-      if (rtr == 0)
-        {
-          continue;
-        }
-
-      if (rtr->GetRouterId () == routerId)
-        {
+      NS_LOG_LOGIC ("FindOutgoingInterfaceId():Can't find root node " << m_spfroot->GetVertexId ());
+      return -1;
+    }
 //
 // This is the node we're building the routing table for.  We're going to need
 // the Ipv4 interface to look for the ipv4 interface index.  Since this node
 // is participating in routing IP version 4 packets, it certainly must have 
 // an Ipv4 interface.
 //
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "GlobalRouteManagerImpl::FindOutgoingInterfaceId (): "
-                         "GetObject for <Ipv4> interface failed");
+  NS_ASSERT_MSG (m_spfrootIpv4, 
+                 "GlobalRouteManagerImpl::FindOutgoingInterfaceId (): "
+                 "GetObject for <Ipv4> interface failed");
 //
 // Look through the interfaces on this node for one that has the IP address
 // we're looking for.  If we find one, return the corresponding interface
 // index, or -1 if not found.
 //
-          int32_t interface = ipv4->GetInterfaceForPrefix (a, amask);
+  int32_t interface = m_spfrootIpv4->GetInterfaceForPrefix (a, amask);
 
 #if 0
-          if (interface < 0)
-            {
-              NS_FATAL_ERROR ("GlobalRouteManagerImpl::FindOutgoingInterfaceId(): "
-                              "Expected an interface associated with address a:" << a);
-            }
-#endif 
-          return interface;
-        }
+  if (interface < 0)
+    {
+      NS_FATAL_ERROR ("GlobalRouteManagerImpl::FindOutgoingInterfaceId(): "
+                      "Expected an interface associated with address a:" << a);
     }
-//
-// Couldn't find it.
-//
-  NS_LOG_LOGIC ("FindOutgoingInterfaceId():Can't find root node " << routerId);
-  return -1;
+#endif 
+  return interface;
 }
 
 //
@@ -1940,64 +1993,37 @@ GlobalRouteManagerImpl::SPFIntraAddRouter (SPFVertex* v)
 // going to use this ID to discover which node it is that we're actually going
 // to update.
 //
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
-
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
+  NS_LOG_LOGIC ("Vertex ID = " << m_spfroot->GetVertexId ());
 //
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
+// The node that has the router ID corresponding to the root vertex is the
+// one we're going to write the routing information to.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+  if (m_spfrootNode == 0)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the GlobalRouter interface, so we need
-// to GetObject for that interface.  If there's no GlobalRouter interface, 
-// the node in question cannot be the router we want, so we continue.
-// 
-      Ptr<GlobalRouter> rtr = 
-        node->GetObject<GlobalRouter> ();
-
-      if (rtr == 0)
-        {
-          NS_LOG_LOGIC ("No GlobalRouter interface on node " << 
-                        node->GetId ());
-          continue;
-        }
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId)
-        {
-          NS_LOG_LOGIC ("Setting routes for node " << node->GetId ());
+      NS_LOG_LOGIC ("Can't find root node " << m_spfroot->GetVertexId ());
+      return;
+    }
+  uint32_t nodeId = m_spfrootNode->GetId ();
 //
-// Routing information is updated using the Ipv4 interface.  We need to 
-// GetObject for that interface.  If the node is acting as an IP version 4 
-// router, it should absolutely have an Ipv4 interface.
+// Routing information is updated using the Ipv4 interface.  If the node is
+// acting as an IP version 4 router, it should absolutely have an Ipv4
+// interface.
 //
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
-                         "GetObject for <Ipv4> interface failed");
+  NS_ASSERT_MSG (m_spfrootIpv4, 
+                 "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
+                 "GetObject for <Ipv4> interface failed");
 //
 // Get the Global Router Link State Advertisement from the vertex we're
 // adding the routes to.  The LSA will have a number of attached Global Router
 // Link Records corresponding to links off of that vertex / node.  We're going
 // to be interested in the records corresponding to point-to-point links.
 //
-          GlobalRoutingLSA *lsa = v->GetLSA ();
-          NS_ASSERT_MSG (lsa, 
-                         "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
-                         "Expected valid LSA in SPFVertex* v");
+  GlobalRoutingLSA *lsa = v->GetLSA ();
+  NS_ASSERT_MSG (lsa, 
+                 "GlobalRouteManagerImpl::SPFIntraAddRouter (): "
+                 "Expected valid LSA in SPFVertex* v");
 
-          uint32_t nLinkRecords = lsa->GetNLinkRecords ();
+  uint32_t nLinkRecords = lsa->GetNLinkRecords ();
 //
 // Iterate through the link records on the vertex to which we're going to add
 // routes.  To make sure we're being clear, we're going to add routing table
@@ -2006,18 +2032,20 @@ GlobalRouteManagerImpl::SPFIntraAddRouter (SPFVertex* v)
 // the local side of the point-to-point links found on the node described by
 // the vertex <v>.
 //
-          NS_LOG_LOGIC (" Node " << node->GetId () <<
-                        " found " << nLinkRecords << " link records in LSA " << lsa << "with LinkStateId "<< lsa->GetLinkStateId ());
-          for (uint32_t j = 0; j < nLinkRecords; ++j)
-            {
+  NS_LOG_LOGIC (" Node " << nodeId <<
+                " found " << nLinkRecords << " link records in LSA " << lsa << "with LinkStateId "<< lsa->GetLinkStateId ());
+  Ptr<Ipv4GlobalRouting> gr = m_spfrootRouting;
+  NS_ASSERT (gr);
+  for (uint32_t j = 0; j < nLinkRecords; ++j)
+    {
 //
 // We are only concerned about point-to-point links
 //
-              GlobalRoutingLinkRecord *lr = lsa->GetLinkRecord (j);
-              if (lr->GetLinkType () != GlobalRoutingLinkRecord::PointToPoint)
-                {
-                  continue;
-                }
+      GlobalRoutingLinkRecord *lr = lsa->GetLinkRecord (j);
+      if (lr->GetLinkType () != GlobalRoutingLinkRecord::PointToPoint)
+        {
+          continue;
+        }
 //
 // Here's why we did all of that work.  We're going to add a host route to the
 // host address found in the m_linkData field of the point-to-point link
@@ -2031,46 +2059,34 @@ GlobalRouteManagerImpl::SPFIntraAddRouter (SPFVertex* v)
 // Similarly, the vertex <v> has an m_rootOif (outbound interface index) to
 // which the packets should be send for forwarding.
 //
-              Ptr<GlobalRouter> router = node->GetObject<GlobalRouter> ();
-              if (router == 0)
-                {
-                  continue;
-                }
-              Ptr<Ipv4GlobalRouting> gr = router->GetRoutingProtocol ();
-              NS_ASSERT (gr);
-              // walk through all available exit directions due to ECMP,
-              // and add host route for each of the exit direction toward
-              // the vertex 'v'
-              for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
-                {
-                  SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
-                  Ipv4Address nextHop = exit.first;
-                  int32_t outIf = exit.second;
-                  if (outIf >= 0)
-                    {
-                      gr->AddHostRouteTo (lr->GetLinkData (), nextHop,
-                                          outIf);
-                      NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                    " adding host route to " << lr->GetLinkData () <<
-                                    " using next hop " << nextHop <<
-                                    " and outgoing interface " << outIf);
-                    }
-                  else
-                    {
-                      NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                    " NOT able to add host route to " << lr->GetLinkData () <<
-                                    " using next hop " << nextHop <<
-                                    " since outgoing interface id is negative " << outIf);
-                    }
-                } // for all routes from the root the vertex 'v'
+      // walk through all available exit directions due to ECMP,
+      // and add host route for each of the exit direction toward
+      // the vertex 'v'
+      for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
+        {
+          SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
+          Ipv4Address nextHop = exit.first;
+          int32_t outIf = exit.second;
+          if (outIf >= 0)
+            {
+              gr->AddHostRouteTo (lr->GetLinkData (), nextHop,
+                                  outIf);
+              NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                            " adding host route to " << lr->GetLinkData () <<
+                            " using next hop " << nextHop <<
+                            " and outgoing interface " << outIf);
             }
-//
-// Done adding the routes for the selected node.
-//
-          return;
-        }
+          else
+            {
+              NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                            " NOT able to add host route to " << lr->GetLinkData () <<
+                            " using next hop " << nextHop <<
+                            " since outgoing interface id is negative " << outIf);
+            }
+        } // for all routes from the root the vertex 'v'
     }
 }
+
 void
 GlobalRouteManagerImpl::SPFIntraAddTransit (SPFVertex* v)
 {
@@ -2085,99 +2101,63 @@ GlobalRouteManagerImpl::SPFIntraAddTransit (SPFVertex* v)
 // going to use this ID to discover which node it is that we're actually going
 // to update.
 //
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
-
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
+  NS_LOG_LOGIC ("Vertex ID = " << m_spfroot->GetVertexId ());
 //
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
+// The node that has the router ID corresponding to the root vertex is the
+// one we're going to write the routing information to.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+  if (m_spfrootNode == 0)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the GlobalRouter interface, so we need
-// to GetObject for that interface.  If there's no GlobalRouter interface, 
-// the node in question cannot be the router we want, so we continue.
-// 
-      Ptr<GlobalRouter> rtr = 
-        node->GetObject<GlobalRouter> ();
-
-      if (rtr == 0)
-        {
-          NS_LOG_LOGIC ("No GlobalRouter interface on node " << 
-                        node->GetId ());
-          continue;
-        }
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId)
-        {
-          NS_LOG_LOGIC ("setting routes for node " << node->GetId ());
+      NS_LOG_LOGIC ("Can't find root node " << m_spfroot->GetVertexId ());
+      return;
+    }
+  uint32_t nodeId = m_spfrootNode->GetId ();
 //
-// Routing information is updated using the Ipv4 interface.  We need to 
-// GetObject for that interface.  If the node is acting as an IP version 4 
-// router, it should absolutely have an Ipv4 interface.
+// Routing information is updated using the Ipv4 interface.  If the node is
+// acting as an IP version 4 router, it should absolutely have an Ipv4
+// interface.
 //
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "GlobalRouteManagerImpl::SPFIntraAddTransit (): "
-                         "GetObject for <Ipv4> interface failed");
+  NS_ASSERT_MSG (m_spfrootIpv4, 
+                 "GlobalRouteManagerImpl::SPFIntraAddTransit (): "
+                 "GetObject for <Ipv4> interface failed");
 //
 // Get the Global Router Link State Advertisement from the vertex we're
-// adding the routes to.  The LSA will have a number of attached Global Router
-// Link Records corresponding to links off of that vertex / node.  We're going
-// to be interested in the records corresponding to point-to-point links.
-//
-          GlobalRoutingLSA *lsa = v->GetLSA ();
-          NS_ASSERT_MSG (lsa, 
-                         "GlobalRouteManagerImpl::SPFIntraAddTransit (): "
-                         "Expected valid LSA in SPFVertex* v");
-          Ipv4Mask tempmask = lsa->GetNetworkLSANetworkMask ();
-          Ipv4Address tempip = lsa->GetLinkStateId ();
-          tempip = tempip.CombineMask (tempmask);
-          Ptr<GlobalRouter> router = node->GetObject<GlobalRouter> ();
-          if (router == 0)
-            {
-              continue;
-            }
-          Ptr<Ipv4GlobalRouting> gr = router->GetRoutingProtocol ();
-          NS_ASSERT (gr);
-          // walk through all available exit directions due to ECMP,
-          // and add host route for each of the exit direction toward
-          // the vertex 'v'
-          for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
-            {
-              SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
-              Ipv4Address nextHop = exit.first;
-              int32_t outIf = exit.second;
+// adding the routes to: a network LSA, describing the transit network.
+//
+  GlobalRoutingLSA *lsa = v->GetLSA ();
+  NS_ASSERT_MSG (lsa, 
+                 "GlobalRouteManagerImpl::SPFIntraAddTransit (): "
+                 "Expected valid LSA in SPFVertex* v");
+  Ipv4Mask tempmask = lsa->GetNetworkLSANetworkMask ();
+  Ipv4Address tempip = lsa->GetLinkStateId ();
+  tempip = tempip.CombineMask (tempmask);
+  Ptr<Ipv4GlobalRouting> gr = m_spfrootRouting;
+  NS_ASSERT (gr);
+  // walk through all available exit directions due to ECMP,
+  // and add host route for each of the exit direction toward
+  // the vertex 'v'
+  for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
+    {
+      SPFVertex::NodeExit_t exit = v->GetRootExitDirection (i);
+      Ipv4Address nextHop = exit.first;
+      int32_t outIf = exit.second;
 
-              if (outIf >= 0)
-                {
-                  gr->AddNetworkRouteTo (tempip, tempmask, nextHop, outIf);
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " via interface " << outIf);
-                }
-              else
-                {
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " NOT able to add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " since outgoing interface id is negative " << outIf);
-                }
-            }
+      if (outIf >= 0)
+        {
+          gr->AddNetworkRouteTo (tempip, tempmask, nextHop, outIf);
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " add network route to " << tempip <<
+                        " using next hop " << nextHop <<
+                        " via interface " << outIf);
         }
-    } 
+      else
+        {
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " NOT able to add network route to " << tempip <<
+                        " using next hop " << nextHop <<
+                        " since outgoing interface id is negative " << outIf);
+        }
+    }
 }
 
 // Derived from quagga ospf_vertex_add_parents ()
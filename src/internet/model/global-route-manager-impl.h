@@ -30,6 +30,7 @@
 #include "ns3/object.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/sgi-hashmap.h"
 #include "global-router-interface.h"
 
 namespace ns3 {
@@ -38,6 +39,8 @@ const uint32_t SPF_INFINITY = 0xffffffff; //!< "infinite" distance between nodes
 
 class CandidateQueue;
 class Ipv4GlobalRouting;
+class Node;
+class Ipv4;
 
 /**
  * @brief Vertex used in shortest path first (SPF) computations. See \RFC{2328},
@@ -619,7 +622,9 @@ public:
  * @internal
  *
  * The IPV4 address and the GlobalRoutingLSA given as parameters are converted
- * to an STL pair and are inserted into the database map.
+ * to an STL pair and are inserted into the database map.  The link records
+ * of the LSA must have been added: its TransitNetwork records are indexed
+ * for GetLSAByLinkData ().
  *
  * @see GlobalRoutingLSA
  * @see Ipv4Address
@@ -652,6 +657,9 @@ public:
  * of the TransitNetwork link record.
  * @internal
  *
+ * If several LSAs match, the one with the lowest address in the database
+ * is returned.
+ *
  * @see GetLSA
  * @param addr The IP address associated with the LSA.  Typically the Router 
  * @returns A pointer to the Link State Advertisement for the router specified
@@ -665,9 +673,9 @@ public:
  * @internal
  *
  * This function walks the database and resets the status flags of all of the
- * contained Link State Advertisements to LSA_SPF_NOT_EXPLORED.  This is done
- * prior to each SPF calculation to reset the state of the SPFVertex structures
- * that will reference the LSAs during the calculation.
+ * contained Link State Advertisements to LSA_SPF_NOT_EXPLORED.  The SPF
+ * calculations of GlobalRouteManagerImpl, which may run in parallel on the
+ * same database, keep the status of the LSAs on their own instead.
  *
  * @see GlobalRoutingLSA
  * @see SPFVertex
@@ -701,7 +709,11 @@ private:
   typedef std::map<Ipv4Address, GlobalRoutingLSA*> LSDBMap_t; //!< container of IPv4 addresses / Link State Advertisements
   typedef std::pair<Ipv4Address, GlobalRoutingLSA*> LSDBPair_t; //!< pair of IPv4 addresses / Link State Advertisements
 
+  /// Link State Advertisements with a TransitNetwork link record, by link data
+  typedef sgi::hash_map<Ipv4Address, LSDBPair_t, Ipv4AddressHash> LinkDataMap_t;
+
   LSDBMap_t m_database; //!< database of IPv4 addresses / Link State Advertisements
+  LinkDataMap_t m_linkData; //!< index of the database by TransitNetwork link data
   std::vector<GlobalRoutingLSA*> m_extdatabase; //!< database of External Link State Advertisements
 
 /**
@@ -727,6 +739,11 @@ private:
  * and finally configure each of the node's forwarding tables.
  *
  * The design is guided by OSPFv2 \RFC{2328} section 16.1.1 and quagga ospfd.
+ *
+ * The SPF calculations of the different roots only read the Link State
+ * Database and each writes the routing tables of its own root, so they
+ * may run on several threads: see the "GlobalRoutingSpfThreads" global
+ * value.
  */
 class GlobalRouteManagerImpl
 {
@@ -786,8 +803,62 @@ private:
  */
   GlobalRouteManagerImpl& operator= (GlobalRouteManagerImpl& srmi);
 
+/**
+ * @brief Create a worker running SPF calculations on the Link State 
+ * Database of another Global Route Manager Implementation.
+ * @internal
+ * @param master the owner of the Link State Database
+ */
+  GlobalRouteManagerImpl (const GlobalRouteManagerImpl *master);
+
+  /// nodes with a GlobalRouter interface, by router ID
+  typedef sgi::hash_map<Ipv4Address, Ptr<Node>, Ipv4AddressHash> RouterMap_t;
+  /// SPF status of the LSAs, by link state ID
+  typedef sgi::hash_map<Ipv4Address, GlobalRoutingLSA::SPFStatus, Ipv4AddressHash> SPFStatusMap_t;
+
   SPFVertex* m_spfroot; //!< the root node
   GlobalRouteManagerLSDB* m_lsdb; //!< the Link State DataBase (LSDB) of the Global Route Manager
+  bool m_ownsLsdb; //!< false for the workers sharing the LSDB of another instance
+  RouterMap_t m_routers; //!< the nodes with a GlobalRouter interface, by router ID
+  Ptr<Node> m_spfrootNode; //!< the node of the root, or 0 if not in the simulation
+  Ptr<Ipv4> m_spfrootIpv4; //!< the Ipv4 of the root node
+  Ptr<Ipv4GlobalRouting> m_spfrootRouting; //!< the global routing of the root node
+  SPFStatusMap_t m_status; //!< the status of the LSAs explored by the current calculation
+  std::vector<Ipv4Address> m_spfRoots; //!< the roots of the calculations of a worker
+
+  /**
+   * \brief Find the nodes with a GlobalRouter interface, whose routing
+   * tables the SPF calculations write.
+   */
+  void CollectRouters (void);
+
+  /**
+   * \brief Release the objects of the root of the last SPF calculation.
+   */
+  void ForgetSPFRoot (void);
+
+  /**
+   * \brief Run the SPF calculations of the roots given to a worker.
+   */
+  void RunSPFWorker (void);
+
+  /**
+   * \brief Get the status of an LSA in the current SPF calculation.
+   * \param lsa the LSA
+   * \returns the status of the LSA
+   */
+  GlobalRoutingLSA::SPFStatus GetSPFStatus (GlobalRoutingLSA *lsa) const;
+
+  /**
+   * \brief Set the status of an LSA in the current SPF calculation.
+   *
+   * The status is kept here rather than in the LSA, which the calculations
+   * running in parallel share.
+   *
+   * \param lsa the LSA
+   * \param status the status of the LSA
+   */
+  void SetSPFStatus (GlobalRoutingLSA *lsa, GlobalRoutingLSA::SPFStatus status);
 
   /**
    * \brief Test if a node is a stub, from an OSPF sense.
@@ -955,8 +1026,8 @@ private:
   /**
    * \brief Return the interface number corresponding to a given IP address and mask
    *
-   * This is a wrapper around GetInterfaceForPrefix(), but we first
-   * have to find the right node pointer to pass to that function.
+   * This is a wrapper around GetInterfaceForPrefix(), called on the node
+   * at the root of the SPF tree.
    * If no such interface is found, return -1 (note:  unit test framework
    * for routing assumes -1 to be a legal return value)
    *
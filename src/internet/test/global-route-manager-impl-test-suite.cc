@@ -26,7 +26,10 @@
 #include "ns3/global-route-manager-impl.h"
 #include "ns3/candidate-queue.h"
 #include "ns3/simulator.h"
+#include "ns3/random-variable-stream.h"
 #include <cstdlib> // for rand()
+#include <algorithm>
+#include <list>
 
 using namespace ns3;
 
@@ -214,6 +217,93 @@ GlobalRouteManagerImplTestCase::DoRun (void)
 }
 
 
+/// Testcase for the order of the CandidateQueue, against a sorted list
+class CandidateQueueOrderTestCase : public TestCase
+{
+public:
+  CandidateQueueOrderTestCase ();
+  virtual void DoRun (void);
+
+private:
+  /// The order of the SPF calculation: by distance, networks first
+  static bool Compare (const SPFVertex* v1, const SPFVertex* v2);
+};
+
+CandidateQueueOrderTestCase::CandidateQueueOrderTestCase ()
+  : TestCase ("Check the order of the SPF candidate queue")
+{
+}
+
+bool
+CandidateQueueOrderTestCase::Compare (const SPFVertex* v1, const SPFVertex* v2)
+{
+  if (v1->GetDistanceFromRoot () != v2->GetDistanceFromRoot ())
+    {
+      return v1->GetDistanceFromRoot () < v2->GetDistanceFromRoot ();
+    }
+  return v1->GetVertexType () == SPFVertex::VertexNetwork
+         && v2->GetVertexType () == SPFVertex::VertexRouter;
+}
+
+void
+CandidateQueueOrderTestCase::DoRun (void)
+{
+  Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
+  rand->SetStream (1);
+
+  // the reference keeps the vertices sorted, in the order they were pushed
+  // or their distance decreased among equivalent vertices
+  CandidateQueue candidate;
+  std::list<SPFVertex*> reference;
+  uint32_t nextId = 1;
+  for (uint32_t step = 0; step < 5000; step++)
+    {
+      uint32_t op = rand->GetInteger (0, 9);
+      if (op < 4 || reference.empty ())
+        {
+          SPFVertex *v = new SPFVertex;
+          v->SetVertexId (Ipv4Address (nextId++));
+          v->SetVertexType (rand->GetInteger (0, 1) ? SPFVertex::VertexNetwork : SPFVertex::VertexRouter);
+          v->SetDistanceFromRoot (rand->GetInteger (0, 30));
+          candidate.Push (v);
+          reference.insert (std::upper_bound (reference.begin (), reference.end (), v, &Compare), v);
+        }
+      else if (op < 7)
+        {
+          std::list<SPFVertex*>::iterator i = reference.begin ();
+          std::advance (i, rand->GetInteger (0, reference.size () - 1));
+          SPFVertex *v = *i;
+          if (v->GetDistanceFromRoot () == 0)
+            {
+              continue;
+            }
+          v->SetDistanceFromRoot (rand->GetInteger (0, v->GetDistanceFromRoot () - 1));
+          candidate.DecreaseKey (v);
+          reference.erase (i);
+          reference.insert (std::upper_bound (reference.begin (), reference.end (), v, &Compare), v);
+        }
+      else
+        {
+          SPFVertex *v = candidate.Pop ();
+          NS_TEST_ASSERT_MSG_EQ (v, reference.front (), "Wrong vertex popped at step " << step);
+          reference.pop_front ();
+          NS_TEST_ASSERT_MSG_EQ ((candidate.Find (v->GetVertexId ()) == 0), true, "Popped vertex found");
+          delete v;
+        }
+      NS_TEST_ASSERT_MSG_EQ (candidate.Size (), reference.size (), "Wrong queue size");
+      if (!reference.empty ())
+        {
+          NS_TEST_ASSERT_MSG_EQ (candidate.Top (), reference.front (), "Wrong top vertex at step " << step);
+          std::list<SPFVertex*>::iterator i = reference.begin ();
+          std::advance (i, rand->GetInteger (0, reference.size () - 1));
+          NS_TEST_ASSERT_MSG_EQ (candidate.Find ((*i)->GetVertexId ()), *i, "Vertex not found");
+        }
+    }
+  // the queue deletes the remaining vertices
+  candidate.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (candidate.Empty (), true, "Queue not cleared");
+}
+
 static class GlobalRouteManagerImplTestSuite : public TestSuite
 {
 public:
@@ -221,5 +311,6 @@ public:
     : TestSuite ("global-route-manager-impl", UNIT)
   {
     AddTestCase (new GlobalRouteManagerImplTestCase (), TestCase::QUICK);
+    AddTestCase (new CandidateQueueOrderTestCase (), TestCase::QUICK);
   }
 } g_globalRoutingManagerImplTestSuite;
@@ -18,6 +18,7 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "buffer.h"
+#include "slab-allocator.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 
@@ -51,98 +52,22 @@ namespace ns3 {
 
 
 uint32_t Buffer::g_recommendedStart = 0;
-#ifdef BUFFER_FREE_LIST
-/* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
- *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
- *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
- *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
- * which is a typical weakness of lazy evaluation schemes which use 
- * '0' as a special value to indicate both un-initialized and destroyed.
- * Note that it is important to use '0' as the marker for un-initialized state
- * because the variable holding this state information is initialized to zero
- * which the compiler assigns to zero-memory which is initialized to _zero_
- * before the constructors run so this ensures perfect handling of crazy 
- * constructor orderings.
+
+/* The storage of every buffer comes from the size classes of this
+ * allocator: its free lists are kept per thread, and its size classes
+ * include the space taken by the Buffer::Data header. 1600 bytes hold a
+ * full ethernet frame with its headers.
  */
-#define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
-#define IS_DESTROYED(x) (x == (Buffer::FreeList*)MAGIC_DESTROYED)
-#define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
-#define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
-
-Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
-{
-  NS_LOG_FUNCTION (this);
-  if (IS_INITIALIZED (g_freeList))
-    {
-      for (Buffer::FreeList::iterator i = g_freeList->begin ();
-           i != g_freeList->end (); i++)
-        {
-          Buffer::Deallocate (*i);
-        }
-      delete g_freeList;
-      g_freeList = DESTROYED;
-    }
-}
+static const uint32_t g_dataSizes[] = { 64, 128, 256, 512, 1024, 1600, 2048, 4096, 8192, 16384 };
 
-void
-Buffer::Recycle (struct Buffer::Data *data)
+SlabAllocator &
+Buffer::GetDataAllocator (void)
 {
-  NS_LOG_FUNCTION (data);
-  NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED (g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED (g_freeList) ||
-      g_freeList->size () > 1000)
-    {
-      Buffer::Deallocate (data);
-    }
-  else
-    {
-      NS_ASSERT (IS_INITIALIZED (g_freeList));
-      g_freeList->push_back (data);
-    }
+  static SlabAllocator allocator ("Buffer::Data", g_dataSizes,
+                                  sizeof (g_dataSizes) / sizeof (g_dataSizes[0]));
+  return allocator;
 }
 
-Buffer::Data *
-Buffer::Create (uint32_t dataSize)
-{
-  NS_LOG_FUNCTION (dataSize);
-  /* try to find a buffer correctly sized. */
-  if (IS_UNINITIALIZED (g_freeList))
-    {
-      g_freeList = new Buffer::FreeList ();
-    }
-  else if (IS_INITIALIZED (g_freeList))
-    {
-      while (!g_freeList->empty ()) 
-        {
-          struct Buffer::Data *data = g_freeList->back ();
-          g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
-            {
-              data->m_count = 1;
-              return data;
-            }
-          Buffer::Deallocate (data);
-        }
-    }
-  struct Buffer::Data *data = Buffer::Allocate (dataSize);
-  NS_ASSERT (data->m_count == 1);
-  return data;
-}
-#else /* BUFFER_FREE_LIST */
 void
 Buffer::Recycle (struct Buffer::Data *data)
 {
@@ -157,7 +82,6 @@ Buffer::Create (uint32_t size)
   NS_LOG_FUNCTION (size);
   return Allocate (size);
 }
-#endif /* BUFFER_FREE_LIST */
 
 struct Buffer::Data *
 Buffer::Allocate (uint32_t reqSize)
@@ -169,9 +93,11 @@ Buffer::Allocate (uint32_t reqSize)
     }
   NS_ASSERT (reqSize >= 1);
   uint32_t size = reqSize - 1 + sizeof (struct Buffer::Data);
-  uint8_t *b = new uint8_t [size];
-  struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data*>(b);
-  data->m_size = reqSize;
+  uint32_t capacity;
+  void *b = GetDataAllocator ().Allocate (size, capacity);
+  struct Buffer::Data *data = static_cast<struct Buffer::Data*>(b);
+  // the whole block is usable
+  data->m_size = capacity + 1 - sizeof (struct Buffer::Data);
   data->m_count = 1;
   return data;
 }
@@ -181,8 +107,7 @@ Buffer::Deallocate (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
-  uint8_t *buf = reinterpret_cast<uint8_t *> (data);
-  delete [] buf;
+  GetDataAllocator ().Deallocate (data, data->m_size - 1 + sizeof (struct Buffer::Data));
 }
 
 Buffer::Buffer ()
@@ -570,6 +495,25 @@ Buffer::CreateFullCopy (void) const
   return *this;
 }
 
+void
+Buffer::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (CheckInternalState ());
+  if (m_data->m_count == 1)
+    {
+      return;
+    }
+  struct Buffer::Data *newData = Buffer::Create (m_data->m_size);
+  memcpy (newData->m_data + m_start, m_data->m_data + m_start, GetInternalSize ());
+  // the old data is still referenced by the other buffers
+  m_data->m_count--;
+  m_data = newData;
+  m_data->m_dirtyStart = m_start;
+  m_data->m_dirtyEnd = m_end;
+  NS_ASSERT (CheckInternalState ());
+}
+
 uint32_t 
 Buffer::GetSerializedSize (void) const
 {
@@ -25,10 +25,10 @@
 #include <ostream>
 #include "ns3/assert.h"
 
-#define BUFFER_FREE_LIST 1
-
 namespace ns3 {
 
+class SlabAllocator;
+
 /**
  * \ingroup packet
  *
@@ -570,6 +570,11 @@ private:
    */
   Buffer CreateFullCopy (void) const;
 
+  /**
+   * \brief Copy the data of this buffer if other buffers share it.
+   */
+  void Unshare (void);
+
   /**
    * \brief Return the number of bytes required for serialization.
    * \return the number of bytes.
@@ -657,6 +662,16 @@ private:
    */
   Buffer (uint32_t dataSize, bool initialize);
   ~Buffer ();
+
+  /**
+   * \brief Get the allocator of the buffer data storage
+   *
+   * Its size classes may be changed and its statistics queried at any
+   * time.
+   *
+   * \returns the allocator of the buffer data storage
+   */
+  static SlabAllocator &GetDataAllocator (void);
 private:
   /**
    * This data structure is variable-sized through its last member whose size
@@ -796,19 +811,6 @@ private:
    * instance from the start of m_data->m_data
    */
   uint32_t m_end;
-
-#ifdef BUFFER_FREE_LIST
-  /// Container for buffer data
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  /// Local static destructor structure
-  struct LocalStaticDestructor 
-  {
-    ~LocalStaticDestructor ();
-  };
-  static uint32_t g_maxSize; //!< Max observed data size
-  static FreeList *g_freeList; //!< Buffer data container
-  static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
-#endif
 };
 
 } // namespace ns3
@@ -18,14 +18,12 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "byte-tag-list.h"
+#include "slab-allocator.h"
 #include "ns3/log.h"
-#include <vector>
 #include <cstring>
 
 NS_LOG_COMPONENT_DEFINE ("ByteTagList");
 
-#define USE_FREE_LIST 1
-#define FREE_LIST_SIZE 1000
 #define OFFSET_MAX (2147483647)
 
 namespace ns3 {
@@ -44,32 +42,19 @@ struct ByteTagListData {
   uint8_t data[4]; //!< data
 };
 
-#ifdef USE_FREE_LIST
-/**
- * \ingroup packet
- *
- * \brief Container class for struct ByteTagListData
- *
- * Internal use only.
+/* The storage of the tags comes from the size classes of this
+ * allocator, whose free lists are kept per thread. The size classes
+ * include the ByteTagListData header.
  */
-static class ByteTagListDataFreeList : public std::vector<struct ByteTagListData *>
-{
-public:
-  ~ByteTagListDataFreeList ();
-} g_freeList; //!< Container for struct ByteTagListData
-static uint32_t g_maxSize = 0; //!< maximum data size (used for allocation)
+static const uint32_t g_dataSizes[] = { 64, 128, 256, 512, 1024, 2048 };
 
-ByteTagListDataFreeList::~ByteTagListDataFreeList ()
+static SlabAllocator &
+GetDataAllocator (void)
 {
-  NS_LOG_FUNCTION (this);
-  for (ByteTagListDataFreeList::iterator i = begin ();
-       i != end (); i++)
-    {
-      uint8_t *buffer = (uint8_t *)(*i);
-      delete [] buffer;
-    }
+  static SlabAllocator allocator ("ByteTagListData", g_dataSizes,
+                                  sizeof (g_dataSizes) / sizeof (g_dataSizes[0]));
+  return allocator;
 }
-#endif /* USE_FREE_LIST */
 
 ByteTagList::Iterator::Item::Item (TagBuffer buf_)
   : buf (buf_)
@@ -229,6 +214,21 @@ ByteTagList::RemoveAll (void)
   m_used = 0;
 }
 
+void
+ByteTagList::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data == 0 || m_data->count == 1)
+    {
+      return;
+    }
+  struct ByteTagListData *newData = Allocate (m_used);
+  std::memcpy (&newData->data, &m_data->data, m_used);
+  newData->dirty = m_used;
+  Deallocate (m_data);
+  m_data = newData;
+}
+
 ByteTagList::Iterator 
 ByteTagList::BeginAll (void) const
 {
@@ -352,69 +352,16 @@ ByteTagList::AddAtStart (int32_t adjustment, int32_t prependOffset)
   *this = list;
 }
 
-#ifdef USE_FREE_LIST
-
-struct ByteTagListData *
-ByteTagList::Allocate (uint32_t size)
-{
-  NS_LOG_FUNCTION (this << size);
-  while (!g_freeList.empty ())
-    {
-      struct ByteTagListData *data = g_freeList.back ();
-      g_freeList.pop_back ();
-      NS_ASSERT (data != 0);
-      if (data->size >= size)
-        {
-          data->count = 1;
-          data->dirty = 0;
-          return data;
-        }
-      uint8_t *buffer = (uint8_t *)data;
-      delete [] buffer;
-    }
-  uint8_t *buffer = new uint8_t [std::max (size, g_maxSize) + sizeof (struct ByteTagListData) - 4];
-  struct ByteTagListData *data = (struct ByteTagListData *)buffer;
-  data->count = 1;
-  data->size = size;
-  data->dirty = 0;
-  return data;
-}
-
-void 
-ByteTagList::Deallocate (struct ByteTagListData *data)
-{
-  NS_LOG_FUNCTION (this << data);
-  if (data == 0)
-    {
-      return;
-    }
-  g_maxSize = std::max (g_maxSize, data->size);
-  data->count--;
-  if (data->count == 0)
-    {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
-          data->size < g_maxSize)
-        {
-          uint8_t *buffer = (uint8_t *)data;
-          delete [] buffer;
-        }
-      else
-        {
-          g_freeList.push_back (data);
-        }
-    }
-}
-
-#else /* USE_FREE_LIST */
-
 struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
-  uint8_t *buffer = new uint8_t [size + sizeof (struct ByteTagListData) - 4];
-  struct ByteTagListData *data = (struct ByteTagListData *)buffer;
+  uint32_t capacity;
+  void *buffer = GetDataAllocator ().Allocate (size + sizeof (struct ByteTagListData) - 4, capacity);
+  struct ByteTagListData *data = static_cast<struct ByteTagListData *> (buffer);
   data->count = 1;
-  data->size = size;
+  // the whole block is usable
+  data->size = capacity + 4 - sizeof (struct ByteTagListData);
   data->dirty = 0;
   return data;
 }
@@ -430,12 +377,9 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
   data->count--;
   if (data->count == 0)
     {
-      uint8_t *buffer = (uint8_t *)data;
-      delete [] buffer;
+      GetDataAllocator ().Deallocate (data, data->size + sizeof (struct ByteTagListData) - 4);
     }
 }
 
-#endif /* USE_FREE_LIST */
-
 
 } // namespace ns3
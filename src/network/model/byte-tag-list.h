@@ -191,6 +191,11 @@ private:
    */ 
   void RemoveAll (void);
 
+  /**
+   * Copy the tags if other lists share them.
+   */
+  void Unshare (void);
+
   /**
    * \param offsetStart the offset which uniquely identifies the first data byte 
    *        present in the byte buffer associated to this ByteTagList.
@@ -61,4 +61,17 @@ Channel::GetId (void) const
   return m_id;
 }
 
+Time
+Channel::GetLookahead (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return Seconds (0);
+}
+
+void
+Channel::SetPartitions (const std::vector<uint32_t> &nodePartition)
+{
+  NS_LOG_FUNCTION (this);
+}
+
 } // namespace ns3
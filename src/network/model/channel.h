@@ -18,9 +18,11 @@
 #define NS3_CHANNEL_H
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include "ns3/object.h"
 #include "ns3/ptr.h"
+#include "ns3/nstime.h"
 
 namespace ns3 {
 
@@ -74,6 +76,31 @@ public:
    */
   virtual Ptr<NetDevice> GetDevice (uint32_t i) const = 0;
 
+  /**
+   * \returns the minimum delay between a transmission on this channel
+   * and its reception by the device of another node, or zero if the
+   * nodes of this channel must run in the same partition of a parallel
+   * simulator.
+   *
+   * The default implementation returns zero. A channel returning a
+   * positive delay must support SetPartitions.
+   */
+  virtual Time GetLookahead (void) const;
+  /**
+   * \param nodePartition the partition of every node, indexed by node id
+   *
+   * Called by a parallel simulator at Simulator::Run, before any event
+   * is run, when GetLookahead returned a positive delay. The channel
+   * must then reach the devices of a node of another partition only
+   * through Simulator::ScheduleWithContext, with a delay of at least
+   * its lookahead and with arguments which share nothing with the
+   * sending partition, and must not touch their state from the sending
+   * partition.
+   *
+   * The default implementation does nothing.
+   */
+  virtual void SetPartitions (const std::vector<uint32_t> &nodePartition);
+
 private:
   uint32_t m_id; //!< Channel id for this channel
 };
@@ -19,6 +19,7 @@
  */
 #include <utility>
 #include <list>
+#include <algorithm>
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
@@ -26,6 +27,7 @@
 #include "buffer.h"
 #include "header.h"
 #include "trailer.h"
+#include "slab-allocator.h"
 
 NS_LOG_COMPONENT_DEFINE ("PacketMetadata");
 
@@ -33,19 +35,20 @@ namespace ns3 {
 
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
+bool PacketMetadata::m_enableLazy = false;
 bool PacketMetadata::m_metadataSkipped = false;
 uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
 
-PacketMetadata::DataFreeList::~DataFreeList ()
+/* size classes of the metadata storage, including the Data header */
+static const uint32_t g_dataSizes[] = { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+
+SlabAllocator &
+PacketMetadata::GetDataAllocator (void)
 {
-  NS_LOG_FUNCTION (this);
-  for (iterator i = begin (); i != end (); i++)
-    {
-      PacketMetadata::Deallocate (*i);
-    }
-  PacketMetadata::m_enable = false;
+  static SlabAllocator allocator ("PacketMetadata::Data", g_dataSizes,
+                                  sizeof (g_dataSizes) / sizeof (g_dataSizes[0]));
+  return allocator;
 }
 
 void 
@@ -70,6 +73,13 @@ PacketMetadata::EnableChecking (void)
   m_enableChecking = true;
 }
 
+void
+PacketMetadata::SetLazy (bool lazy)
+{
+  NS_LOG_FUNCTION (lazy);
+  m_enableLazy = lazy;
+}
+
 void
 PacketMetadata::ReserveCopy (uint32_t size)
 {
@@ -96,6 +106,15 @@ PacketMetadata::ReserveCopy (uint32_t size)
     }
 }
 void
+PacketMetadata::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data->m_count != 1)
+    {
+      ReserveCopy (0);
+    }
+}
+void
 PacketMetadata::Reserve (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
@@ -506,6 +525,7 @@ PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item,
 
   // create a copy of the packet without its tail.
   PacketMetadata h (m_packetUid, 0);
+  h.m_lazy = false;
   uint16_t current = m_head;
   while (current != 0xffff && current != m_tail)
     {
@@ -576,19 +596,6 @@ PacketMetadata::Create (uint32_t size)
     {
       m_maxSize = size;
     }
-  while (!m_freeList.empty ()) 
-    {
-      struct PacketMetadata::Data *data = m_freeList.back ();
-      m_freeList.pop_back ();
-      if (data->m_size >= size) 
-        {
-          NS_LOG_LOGIC ("create found size="<<data->m_size);
-          data->m_count = 1;
-          return data;
-        }
-      PacketMetadata::Deallocate (data);
-      NS_LOG_LOGIC ("create dealloc size="<<data->m_size);
-    }
   NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
   return PacketMetadata::Allocate (m_maxSize);
 }
@@ -597,22 +604,8 @@ void
 PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
   NS_LOG_FUNCTION (data);
-  if (!m_enable)
-    {
-      PacketMetadata::Deallocate (data);
-      return;
-    } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
   NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
-      data->m_size < m_maxSize) 
-    {
-      PacketMetadata::Deallocate (data);
-    } 
-  else 
-    {
-      m_freeList.push_back (data);
-    }
+  PacketMetadata::Deallocate (data);
 }
 
 struct PacketMetadata::Data *
@@ -625,8 +618,11 @@ PacketMetadata::Allocate (uint32_t n)
       n = PACKET_METADATA_DATA_M_DATA_SIZE;
     }
   size += n - PACKET_METADATA_DATA_M_DATA_SIZE;
-  uint8_t *buf = new uint8_t [size];
+  uint32_t capacity;
+  void *buf = GetDataAllocator ().Allocate (size, capacity);
   struct PacketMetadata::Data *data = (struct PacketMetadata::Data *)buf;
+  // the whole block is usable, as far as m_size can describe it
+  n = std::min<uint32_t> (capacity - sizeof (struct Data) + PACKET_METADATA_DATA_M_DATA_SIZE, 0xffff);
   data->m_size = n;
   data->m_count = 1;
   data->m_dirtyEnd = 0;
@@ -636,10 +632,134 @@ void
 PacketMetadata::Deallocate (struct PacketMetadata::Data *data)
 {
   NS_LOG_FUNCTION (data);
-  uint8_t *buf = (uint8_t *)data;
-  delete [] buf;
+  GetDataAllocator ().Deallocate (data, sizeof (struct Data) + data->m_size - PACKET_METADATA_DATA_M_DATA_SIZE);
 }
 
+void
+PacketMetadata::ReserveLog (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  if (m_data->m_size < m_used + n
+      || (m_data->m_count != 1 && m_data->m_dirtyEnd != m_used))
+    {
+      // not enough room, or records past m_used used by another copy
+      ReserveCopy (n);
+    }
+}
+bool
+PacketMetadata::LogOp (uint8_t type, uint32_t typeUid, uint64_t value, uint16_t chunkUid)
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (type) << typeUid << value << chunkUid);
+  NS_ASSERT (m_lazy);
+  if (m_used + sizeof (struct LazyOp) > LAZY_MAX_OPS * sizeof (struct LazyOp))
+    {
+      Materialize ();
+      return false;
+    }
+  struct LazyOp op;
+  op.type = type;
+  op.unused = 0;
+  op.chunkUid = chunkUid;
+  op.typeUid = typeUid;
+  op.value = value;
+  ReserveLog (sizeof (op));
+  memcpy (&m_data->m_data[m_used], &op, sizeof (op));
+  m_used += sizeof (op);
+  m_data->m_dirtyEnd = m_used;
+  return true;
+}
+bool
+PacketMetadata::PeekLastOp (struct LazyOp *op) const
+{
+  if (m_used < sizeof (struct LazyOp))
+    {
+      return false;
+    }
+  memcpy (op, &m_data->m_data[m_used - sizeof (struct LazyOp)], sizeof (struct LazyOp));
+  return true;
+}
+bool
+PacketMetadata::CancelOp (uint8_t type, uint32_t typeUid, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (type) << typeUid << size);
+  struct LazyOp op;
+  if (!PeekLastOp (&op)
+      || op.type != type
+      || op.typeUid != typeUid
+      || op.value != size)
+    {
+      return false;
+    }
+  // the records past m_used are left to the copies which share them
+  m_used -= sizeof (op);
+  return true;
+}
+void
+PacketMetadata::Materialize (void) const
+{
+  if (!m_lazy)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this << m_used);
+  PacketMetadata *self = const_cast<PacketMetadata *> (this);
+  if (m_used == 0 && m_data->m_count == 1)
+    {
+      self->m_lazy = false;
+      return;
+    }
+  PacketMetadata items (m_packetUid, 0);
+  items.m_lazy = false;
+  items.Replay (m_data->m_data, m_used / sizeof (struct LazyOp));
+  *self = items;
+}
+void
+PacketMetadata::Replay (const uint8_t *log, uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  NS_ASSERT (!m_lazy);
+  uint32_t i = 0;
+  while (i < n)
+    {
+      struct LazyOp op;
+      memcpy (&op, log + i * sizeof (op), sizeof (op));
+      i++;
+      switch (op.type)
+        {
+        case LAZY_ADD_HEADER:
+          DoAddHeaderItem (op.typeUid, op.value, op.chunkUid);
+          break;
+        case LAZY_REMOVE_HEADER:
+          DoRemoveHeader (op.typeUid, op.value);
+          break;
+        case LAZY_ADD_TRAILER:
+          DoAddTrailerItem (op.typeUid, op.value, op.chunkUid);
+          break;
+        case LAZY_REMOVE_TRAILER:
+          DoRemoveTrailer (op.typeUid, op.value);
+          break;
+        case LAZY_REMOVE_AT_START:
+          RemoveAtStart (op.value);
+          break;
+        case LAZY_REMOVE_AT_END:
+          RemoveAtEnd (op.value);
+          break;
+        case LAZY_ADD_AT_END:
+          {
+            PacketMetadata o (op.value, 0);
+            o.m_lazy = false;
+            o.Replay (log + i * sizeof (op), op.typeUid);
+            // skip the LAZY_END_ADD_AT_END record too
+            i += op.typeUid + 1;
+            AddAtEnd (o);
+          }
+          break;
+        default:
+          NS_ASSERT (false);
+          break;
+        }
+    }
+}
 
 PacketMetadata 
 PacketMetadata::CreateFragment (uint32_t start, uint32_t end) const
@@ -669,14 +789,24 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
-
+  uint16_t chunkUid = m_chunkUid;
+  m_chunkUid++;
+  if (m_lazy && LogOp (LAZY_ADD_HEADER, uid, size, chunkUid))
+    {
+      return;
+    }
+  DoAddHeaderItem (uid, size, chunkUid);
+}
+void
+PacketMetadata::DoAddHeaderItem (uint32_t uid, uint32_t size, uint16_t chunkUid)
+{
+  NS_LOG_FUNCTION (this << uid << size << chunkUid);
   struct PacketMetadata::SmallItem item;
   item.next = m_head;
   item.prev = 0xffff;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = chunkUid;
   uint16_t written = AddSmall (&item);
   UpdateHead (written);
 }
@@ -691,6 +821,18 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_lazy
+      && (CancelOp (LAZY_ADD_HEADER, uid, size)
+          || LogOp (LAZY_REMOVE_HEADER, uid, size, 0)))
+    {
+      return;
+    }
+  DoRemoveHeader (uid, size);
+}
+void
+PacketMetadata::DoRemoveHeader (uint32_t uid, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << uid << size);
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
@@ -739,16 +881,27 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  uint16_t chunkUid = m_chunkUid;
+  m_chunkUid++;
+  if (m_lazy && LogOp (LAZY_ADD_TRAILER, uid, size, chunkUid))
+    {
+      return;
+    }
+  DoAddTrailerItem (uid, size, chunkUid);
+  NS_ASSERT (IsStateOk ());
+}
+void
+PacketMetadata::DoAddTrailerItem (uint32_t uid, uint32_t size, uint16_t chunkUid)
+{
+  NS_LOG_FUNCTION (this << uid << size << chunkUid);
   struct PacketMetadata::SmallItem item;
   item.next = 0xffff;
   item.prev = m_tail;
   item.typeUid = uid;
   item.size = size;
-  item.chunkUid = m_chunkUid;
-  m_chunkUid++;
+  item.chunkUid = chunkUid;
   uint16_t written = AddSmall (&item);
   UpdateTail (written);
-  NS_ASSERT (IsStateOk ());
 }
 void 
 PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
@@ -761,6 +914,18 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (m_lazy
+      && (CancelOp (LAZY_ADD_TRAILER, uid, size)
+          || LogOp (LAZY_REMOVE_TRAILER, uid, size, 0)))
+    {
+      return;
+    }
+  DoRemoveTrailer (uid, size);
+}
+void
+PacketMetadata::DoRemoveTrailer (uint32_t uid, uint32_t size)
+{
+  NS_LOG_FUNCTION (this << uid << size);
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
@@ -808,6 +973,31 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
       m_metadataSkipped = true;
       return;
     }
+  if (m_lazy && o.m_lazy)
+    {
+      uint32_t n = o.m_used / sizeof (struct LazyOp);
+      if (m_used / sizeof (struct LazyOp) + 2 + n <= LAZY_MAX_OPS)
+        {
+          // o may be this object
+          uint16_t used = o.m_used;
+          struct LazyOp op;
+          op.type = LAZY_ADD_AT_END;
+          op.unused = 0;
+          op.chunkUid = 0;
+          op.typeUid = n;
+          op.value = o.m_packetUid;
+          ReserveLog (2 * sizeof (op) + used);
+          memcpy (&m_data->m_data[m_used], &op, sizeof (op));
+          memcpy (&m_data->m_data[m_used + sizeof (op)], o.m_data->m_data, used);
+          op.type = LAZY_END_ADD_AT_END;
+          memcpy (&m_data->m_data[m_used + sizeof (op) + used], &op, sizeof (op));
+          m_used += 2 * sizeof (op) + used;
+          m_data->m_dirtyEnd = m_used;
+          return;
+        }
+    }
+  Materialize ();
+  o.Materialize ();
   if (m_tail == 0xffff)
     {
       // We have no items so 'AddAtEnd' is 
@@ -896,6 +1086,21 @@ PacketMetadata::RemoveAtStart (uint32_t start)
       m_metadataSkipped = true;
       return;
     }
+  if (m_lazy)
+    {
+      // drop the headers added last which are removed entirely
+      struct LazyOp op;
+      while (start > 0 && PeekLastOp (&op)
+             && op.type == LAZY_ADD_HEADER && op.value <= start)
+        {
+          start -= op.value;
+          m_used -= sizeof (op);
+        }
+      if (start == 0 || LogOp (LAZY_REMOVE_AT_START, 0, start, 0))
+        {
+          return;
+        }
+    }
   NS_ASSERT (m_data != 0);
   uint32_t leftToRemove = start;
   uint16_t current = m_head;
@@ -923,6 +1128,7 @@ PacketMetadata::RemoveAtStart (uint32_t start)
         {
           // fragment the list item.
           PacketMetadata fragment (m_packetUid, 0);
+          fragment.m_lazy = false;
           extraItem.fragmentStart += leftToRemove;
           leftToRemove = 0;
           uint16_t written = fragment.AddBig (0xffff, fragment.m_tail,
@@ -959,6 +1165,21 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
       m_metadataSkipped = true;
       return;
     }
+  if (m_lazy)
+    {
+      // drop the trailers added last which are removed entirely
+      struct LazyOp op;
+      while (end > 0 && PeekLastOp (&op)
+             && op.type == LAZY_ADD_TRAILER && op.value <= end)
+        {
+          end -= op.value;
+          m_used -= sizeof (op);
+        }
+      if (end == 0 || LogOp (LAZY_REMOVE_AT_END, 0, end, 0))
+        {
+          return;
+        }
+    }
   NS_ASSERT (m_data != 0);
 
   uint32_t leftToRemove = end;
@@ -987,6 +1208,7 @@ PacketMetadata::RemoveAtEnd (uint32_t end)
         {
           // fragment the list item.
           PacketMetadata fragment (m_packetUid, 0);
+          fragment.m_lazy = false;
           NS_ASSERT (extraItem.fragmentEnd > leftToRemove);
           extraItem.fragmentEnd -= leftToRemove;
           leftToRemove = 0;
@@ -1018,6 +1240,7 @@ uint32_t
 PacketMetadata::GetTotalSize (void) const
 {
   NS_LOG_FUNCTION (this);
+  Materialize ();
   uint32_t totalSize = 0;
   uint16_t current = m_head;
   uint16_t tail = m_tail;
@@ -1047,6 +1270,7 @@ PacketMetadata::ItemIterator
 PacketMetadata::BeginItem (Buffer buffer) const
 {
   NS_LOG_FUNCTION (this << &buffer);
+  Materialize ();
   return ItemIterator (this, buffer);
 }
 PacketMetadata::ItemIterator::ItemIterator (const PacketMetadata *metadata, Buffer buffer)
@@ -1150,6 +1374,7 @@ PacketMetadata::GetSerializedSize (void) const
     {
       return totalSize;
     }
+  Materialize ();
 
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
@@ -1183,6 +1408,7 @@ uint32_t
 PacketMetadata::Serialize (uint8_t* buffer, uint32_t maxSize) const
 {
   NS_LOG_FUNCTION (this << &buffer << maxSize);
+  Materialize ();
   uint8_t* start = buffer;
 
   buffer = AddToRawU64 (m_packetUid, start, buffer, maxSize);
@@ -1284,6 +1510,7 @@ uint32_t
 PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
 {
   NS_LOG_FUNCTION (this << &buffer << size);
+  Materialize ();
   const uint8_t* start = buffer;
   uint32_t desSize = size - 4;
 
@@ -34,6 +34,7 @@ class Chunk;
 class Buffer;
 class Header;
 class Trailer;
+class SlabAllocator;
 
 /**
  * \internal
@@ -75,6 +76,16 @@ class Trailer;
  * integers, and some others as variable-size 32-bit integers.
  * The variable-size 32 bit integers are stored using the uleb128
  * encoding.
+ *
+ * In lazy mode (see SetLazy), the same byte buffer holds instead a log
+ * of the operations performed on the packet, as fixed-size records
+ * (struct LazyOp). Removing the header or trailer which was the last one
+ * added simply drops the matching record, and the linked list of items
+ * is rebuilt from the log only when it is needed, that is, when the
+ * items are iterated over or serialized. The metadata of a packet which
+ * is never printed thus costs one record per header or trailer. A
+ * metadata whose log grows beyond LAZY_MAX_OPS records is converted to
+ * the linked list.
  */
 class PacketMetadata 
 {
@@ -160,6 +171,19 @@ private:
    * \brief Enable the packet metadata checking
    */
   static void EnableChecking (void);
+  /**
+   * \brief Record the metadata of the packets created from now on lazily
+   * \param lazy true to enable the lazy mode, false to disable it
+   *
+   * The lazy mode is ignored when the metadata checking is enabled,
+   * since the checks are then performed only when the items are read.
+   */
+  static void SetLazy (bool lazy);
+  /**
+   * \brief Get the allocator of the metadata storage
+   * \returns the allocator of the metadata storage
+   */
+  static SlabAllocator &GetDataAllocator (void);
 
   /**
    * \brief Constructor
@@ -180,6 +204,11 @@ private:
   inline PacketMetadata &operator = (PacketMetadata const& o);
   inline ~PacketMetadata ();
 
+  /**
+   * \brief Copy the metadata storage if other objects share it
+   */
+  void Unshare (void);
+
   /**
    * \brief Add an header
    * \param header header to add
@@ -492,16 +521,6 @@ private:
     uint64_t packetUid;
   };
 
-  /**
-   * \brief Class to hold all the metadata
-   */
-  class DataFreeList : public std::vector<struct Data *>
-  {
-public:
-    ~DataFreeList ();
-  };
-
-  friend DataFreeList::~DataFreeList ();
   friend class ItemIterator;
 
   PacketMetadata ();
@@ -616,6 +635,112 @@ public:
    * \param size header serialized size
    */
   void DoAddHeader (uint32_t uid, uint32_t size);
+  /**
+   * \brief Add an header to the linked list of items
+   * \param uid header's uid to add
+   * \param size header serialized size
+   * \param chunkUid the chunk uid of the header
+   */
+  void DoAddHeaderItem (uint32_t uid, uint32_t size, uint16_t chunkUid);
+  /**
+   * \brief Add a trailer to the linked list of items
+   * \param uid trailer's uid to add
+   * \param size trailer serialized size
+   * \param chunkUid the chunk uid of the trailer
+   */
+  void DoAddTrailerItem (uint32_t uid, uint32_t size, uint16_t chunkUid);
+  /**
+   * \brief Remove an header from the linked list of items
+   * \param uid header's uid to remove
+   * \param size header serialized size
+   */
+  void DoRemoveHeader (uint32_t uid, uint32_t size);
+  /**
+   * \brief Remove a trailer from the linked list of items
+   * \param uid trailer's uid to remove
+   * \param size trailer serialized size
+   */
+  void DoRemoveTrailer (uint32_t uid, uint32_t size);
+
+  /**
+   * \brief Type of the operations of the lazy log
+   */
+  enum LazyOpType
+  {
+    LAZY_ADD_HEADER,
+    LAZY_REMOVE_HEADER,
+    LAZY_ADD_TRAILER,
+    LAZY_REMOVE_TRAILER,
+    LAZY_REMOVE_AT_START,
+    LAZY_REMOVE_AT_END,
+    LAZY_ADD_AT_END,
+    LAZY_END_ADD_AT_END
+  };
+  /**
+   * \brief Maximum number of records of the lazy log
+   */
+  enum
+  {
+    LAZY_MAX_OPS = 64
+  };
+  /**
+   * \brief Record of the lazy log
+   *
+   * A LAZY_ADD_AT_END record is followed by the typeUid records of
+   * the log of the metadata appended, whose packet uid is value, and
+   * by a LAZY_END_ADD_AT_END record. The latter keeps the records of
+   * the appended log from being taken for the last ones of this log.
+   */
+  struct LazyOp
+  {
+    uint8_t type;       //!< the LazyOpType
+    uint8_t unused;     //!< padding
+    uint16_t chunkUid;  //!< chunk uid of an added header or trailer
+    uint32_t typeUid;   //!< uid of a header or trailer, or number of records appended
+    uint64_t value;     //!< size of the operation, or packet uid of the records appended
+  };
+  /**
+   * \brief Append a record to the lazy log
+   * \param type the LazyOpType
+   * \param typeUid uid of the header or trailer
+   * \param value size of the operation
+   * \param chunkUid chunk uid of the header or trailer
+   * \returns false if the log was full, in which case the metadata has
+   *          been converted to the linked list of items instead.
+   */
+  bool LogOp (uint8_t type, uint32_t typeUid, uint64_t value, uint16_t chunkUid);
+  /**
+   * \brief Drop the last record of the lazy log if it matches
+   * \param type the LazyOpType
+   * \param typeUid uid of the header or trailer
+   * \param size size of the header or trailer
+   * \returns true if the record was dropped
+   */
+  bool CancelOp (uint8_t type, uint32_t typeUid, uint32_t size);
+  /**
+   * \brief Read the last record of the lazy log
+   * \param op the record read
+   * \returns false if the log is empty
+   */
+  bool PeekLastOp (struct LazyOp *op) const;
+  /**
+   * \brief Make room for records at the end of the lazy log
+   * \param n size of the records
+   */
+  void ReserveLog (uint32_t n);
+  /**
+   * \brief Convert a lazy log to the linked list of items
+   *
+   * This does not change the content of the metadata, only its
+   * representation, so it may be called on a const metadata.
+   */
+  void Materialize (void) const;
+  /**
+   * \brief Apply the records of a lazy log to the linked list of items
+   * \param log the records
+   * \param n the number of records
+   */
+  void Replay (const uint8_t *log, uint32_t n);
   /**
    * \brief Check if the metadata state is ok
    * \returns true if the internal state is ok
@@ -657,9 +782,9 @@ public:
    */
   static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList; //!< the metadata data storage
   static bool m_enable; //!< Enable the packet metadata
   static bool m_enableChecking; //!< Enable the packet metadata checking
+  static bool m_enableLazy; //!< Record the metadata of new packets lazily
 
   /**
    * Set to true when adding metadata to a packet is skipped because
@@ -680,6 +805,7 @@ public:
   uint16_t m_head; //!< list head
   uint16_t m_tail; //!< list tail
   uint16_t m_used; //!< used portion
+  bool m_lazy; //!< true if m_data holds a lazy log
   uint64_t m_packetUid; //!< packet Uid
 };
 
@@ -692,6 +818,7 @@ PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
     m_head (0xffff),
     m_tail (0xffff),
     m_used (0),
+    m_lazy (m_enableLazy && !m_enableChecking),
     m_packetUid (uid)
 {
   memset (m_data->m_data, 0xff, 4);
@@ -705,6 +832,7 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_head (o.m_head),
     m_tail (o.m_tail),
     m_used (o.m_used),
+    m_lazy (o.m_lazy),
     m_packetUid (o.m_packetUid)
 {
   NS_ASSERT (m_data != 0);
@@ -730,6 +858,7 @@ PacketMetadata::operator = (PacketMetadata const& o)
   m_head = o.m_head;
   m_tail = o.m_tail;
   m_used = o.m_used;
+  m_lazy = o.m_lazy;
   m_packetUid = o.m_packetUid;
   return *this;
 }
@@ -20,7 +20,7 @@
 
 /**
 \file   packet-tag-list.cc
-\brief  Implements a linked list of Packet tags, including copy-on-write semantics.
+\brief  Implements a list of Packet tags, stored inline with a shared spill-over.
 */
 
 #include "packet-tag-list.h"
@@ -28,216 +28,147 @@
 #include "tag.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
-#include <cstring>
+#include <new>
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
 namespace ns3 {
 
-bool
-PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
+uint32_t
+PacketTagList::Find (TypeId tid) const
 {
-  TypeId tid = tag.GetInstanceTypeId ();
-  NS_LOG_FUNCTION (this << tid);
-  NS_LOG_INFO     ("looking for " << tid);
-
-  // trivial case when list is empty
-  if (m_next == 0)
-    {
-      return false;
-    }
-
-  bool found = false;
-
-  struct TagData ** prevNext = &m_next; // previous node's next pointer
-  struct TagData  * cur      =  m_next; // cursor to current node
-  struct TagData  * it = 0;             // utility
-
-  // Search from the head of the list until we find tid or a merge
-  while (cur != 0)
+  for (uint32_t i = 0; i < m_size; i++)
     {
-      if (cur->count > 1)
-        {
-          // found merge
-          NS_LOG_INFO ("found initial merge before tid");
-          break;
-        }
-      else if (cur->tid == tid)
+      if (m_tags[i].tid == tid)
         {
-          NS_LOG_INFO ("found tid before initial merge, calling writer");
-          found = (this->*Writer)(tag, true, cur, prevNext);
-          break;
+          return i;
         }
-      else
+    }
+  if (m_spill != 0)
+    {
+      for (uint32_t i = 0; i < m_spill->size; i++)
         {
-          // no merge or tid found yet, move on
-          prevNext = &cur->next;
-          cur      =  cur->next;
+          if (m_spill->tags[i].tid == tid)
+            {
+              return m_size + i;
+            }
         }
-    }  // while !found && !cow
+      return m_size + m_spill->size;
+    }
+  return m_size;
+}
 
-  // did we find it or run out of tags?
-  if (cur == 0 || found)
+void
+PacketTagList::MakeSpillWritable (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  if (m_spill != 0 && m_spill->count == 1 && m_spill->capacity >= size)
     {
-      NS_LOG_INFO ("returning after header with found: " << found);
-      return found;
+      return;
     }
-
-  // From here on out, we have to copy the list
-  // until we find tid, then link past it
-
-  // Before we do all that work, let's make sure tid really exists
-  for (it = cur; it != 0; it = it->next)
+  uint32_t capacity = INLINE_SIZE;
+  while (capacity < size)
     {
-      if (it->tid == tid)
-        {
-          break;
-        }
+      capacity *= 2;
     }
-  if (it == 0)
+  NS_LOG_INFO ("copying " << (m_spill != 0 ? m_spill->size : 0)
+                          << " spilled tags into a block of " << capacity);
+  void *buffer = ::operator new (sizeof (struct TagSpill)
+                                 + (capacity - 1) * sizeof (struct TagData));
+  struct TagSpill *spill = static_cast<struct TagSpill *> (buffer);
+  spill->count = 1;
+  spill->size = 0;
+  spill->capacity = capacity;
+  if (m_spill != 0)
     {
-      // got to end of list without finding tid
-      NS_LOG_INFO ("tid not found after first merge");
-      return found;
+      spill->size = m_spill->size;
+      for (uint32_t i = 0; i < m_spill->size; i++)
+        {
+          spill->tags[i] = m_spill->tags[i];
+        }
+      ReleaseSpill ();
     }
+  m_spill = spill;
+}
 
-  // At this point cur is a merge, but untested for tid
-  NS_ASSERT (cur != 0);
-  NS_ASSERT (cur->count > 1);
-
-  /*
-     Walk the remainder of the list, copying, until we find tid
-     As we put a copy of the cur node onto our list,
-     we move the merge point down the list.
-
-     Starting position                  End position
-       T1 is a merge                     T1.count decremented
-                                         T2 is a merge
-                                         T1' is a copy of T1
-
-          other                             other
-               \                                 \
-      Prev  ->  T1  ->  T2  -> ...                T1  ->  T2  -> ...
-           /   /                                         /|
-      pNext cur                         Prev  ->  T1' --/ |
-                                                     /    |
-                                                pNext   cur
-
-     When we reach tid, we link past it, decrement count, and we're done.
-  */
-
-  // Should normally check for null cur pointer,
-  // but since we know tid exists, we'll skip this test
-  while ( /* cur && */ cur->tid != tid)
+void
+PacketTagList::ReleaseSpill (void)
+{
+  NS_ASSERT (m_spill != 0 && m_spill->count > 0);
+  m_spill->count--;
+  if (m_spill->count == 0)
     {
-      NS_ASSERT (cur != 0);
-      NS_ASSERT (cur->count > 1);
-      cur->count--;                       // unmerge cur
-      struct TagData * copy = new struct TagData ();
-      copy->tid = cur->tid;
-      copy->count = 1;
-      memcpy (copy->data, cur->data, TagData::MAX_SIZE);
-      copy->next = cur->next;             // merge into tail
-      copy->next->count++;                // mark new merge
-      *prevNext = copy;                   // point prior list at copy
-      prevNext = &copy->next;             // advance
-      cur      =  copy->next;
+      ::operator delete (m_spill);
     }
-  // Sanity check:
-  NS_ASSERT (cur != 0);                 // cur should be non-zero
-  NS_ASSERT (cur->tid == tid);          // cur->tid should be tid
-  NS_ASSERT (cur->count > 1);           // cur should be a merge
-
-  // link around tid, removing it from our list
-  found = (this->*Writer)(tag, false, cur, prevNext);
-  return found;
-
+  m_spill = 0;
 }
 
-bool
-PacketTagList::Remove (Tag & tag)
+void
+PacketTagList::Unshare (void)
 {
-  return COWTraverse (tag, &PacketTagList::RemoveWriter);
+  NS_LOG_FUNCTION (this);
+  if (m_spill != 0 && m_spill->count != 1)
+    {
+      MakeSpillWritable (m_spill->size);
+    }
 }
 
-// COWWriter implementing Remove
 bool
-PacketTagList::RemoveWriter (Tag & tag, bool preMerge,
-                             struct PacketTagList::TagData  * cur,
-                             struct PacketTagList::TagData ** prevNext)
+PacketTagList::Remove (Tag & tag)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-
-  // found tid
-  bool found = true;
-  tag.Deserialize (TagBuffer (cur->data,
-                              cur->data + TagData::MAX_SIZE));
-  *prevNext = cur->next;            // link around cur
-
-  if (preMerge)
+  TypeId tid = tag.GetInstanceTypeId ();
+  NS_LOG_FUNCTION (this << tid);
+  uint32_t i = Find (tid);
+  if (i < m_size)
     {
-      // found tid before first merge, so delete cur
-      delete cur;
+      tag.Deserialize (TagBuffer (m_tags[i].data,
+                                  m_tags[i].data + TagData::MAX_SIZE));
+      m_size--;
+      m_tags[i] = m_tags[m_size];
+      return true;
     }
-  else
+  if (i == GetNTags ())
     {
-      // cur is always a merge at this point
-      // unmerge cur, since we linked around it already
-      cur->count--;
-      if (cur->next != 0)
-        {
-          // there's a next, so make it a merge
-          cur->next->count++;
-        }
+      return false;
+    }
+  i -= m_size;
+  tag.Deserialize (TagBuffer (m_spill->tags[i].data,
+                              m_spill->tags[i].data + TagData::MAX_SIZE));
+  if (m_spill->size == 1)
+    {
+      ReleaseSpill ();
+      return true;
     }
-  return found;
+  MakeSpillWritable (m_spill->size);
+  m_spill->size--;
+  m_spill->tags[i] = m_spill->tags[m_spill->size];
+  return true;
 }
 
 bool
 PacketTagList::Replace (Tag & tag)
 {
-  bool found = COWTraverse (tag, &PacketTagList::ReplaceWriter);
-  if (!found)
+  TypeId tid = tag.GetInstanceTypeId ();
+  NS_LOG_FUNCTION (this << tid);
+  uint32_t i = Find (tid);
+  if (i == GetNTags ())
     {
       Add (tag);
+      return false;
     }
-  return found;
-}
-
-// COWWriter implementing Replace
-bool
-PacketTagList::ReplaceWriter (Tag & tag, bool preMerge,
-                              struct PacketTagList::TagData  * cur,
-                              struct PacketTagList::TagData ** prevNext)
-{
-  NS_LOG_FUNCTION_NOARGS ();
-
-  // found tid
-  bool found = true;
-  if (preMerge)
+  struct TagData *cur;
+  if (i < m_size)
     {
-      // found tid before first merge, so just rewrite
-      tag.Serialize (TagBuffer (cur->data,
-                                cur->data + tag.GetSerializedSize ()));
+      cur = &m_tags[i];
     }
   else
     {
-      // cur is always a merge at this point
-      // need to copy, replace, and link past cur
-      cur->count--;                     // unmerge cur
-      struct TagData * copy = new struct TagData ();
-      copy->tid = tag.GetInstanceTypeId ();
-      copy->count = 1;
-      tag.Serialize (TagBuffer (copy->data,
-                                copy->data + tag.GetSerializedSize ()));
-      copy->next = cur->next;           // merge into tail
-      if (copy->next != 0)
-        {
-          copy->next->count++;          // mark new merge
-        }
-      *prevNext = copy;                 // point prior list at copy
+      MakeSpillWritable (m_spill->size);
+      cur = &m_spill->tags[i - m_size];
     }
-  return found;
+  NS_ASSERT (tag.GetSerializedSize () <= TagData::MAX_SIZE);
+  tag.Serialize (TagBuffer (cur->data, cur->data + tag.GetSerializedSize ()));
+  return true;
 }
 
 void 
@@ -245,44 +176,38 @@ PacketTagList::Add (const Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
   // ensure this id was not yet added
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  NS_ASSERT (Find (tag.GetInstanceTypeId ()) == GetNTags ());
+  PacketTagList *self = const_cast<PacketTagList *> (this);
+  struct TagData *cur;
+  if (m_size < INLINE_SIZE)
     {
-      NS_ASSERT (cur->tid != tag.GetInstanceTypeId ());
+      cur = &self->m_tags[self->m_size++];
     }
-  struct TagData * head = new struct TagData ();
-  head->count = 1;
-  head->next = 0;
-  head->tid = tag.GetInstanceTypeId ();
-  head->next = m_next;
+  else
+    {
+      uint32_t size = m_spill != 0 ? m_spill->size : 0;
+      self->MakeSpillWritable (size + 1);
+      cur = &m_spill->tags[m_spill->size++];
+    }
+  cur->tid = tag.GetInstanceTypeId ();
   NS_ASSERT (tag.GetSerializedSize () <= TagData::MAX_SIZE);
-  tag.Serialize (TagBuffer (head->data, head->data + tag.GetSerializedSize ()));
-
-  const_cast<PacketTagList *> (this)->m_next = head;
+  tag.Serialize (TagBuffer (cur->data, cur->data + tag.GetSerializedSize ()));
 }
 
 bool
 PacketTagList::Peek (Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
-  TypeId tid = tag.GetInstanceTypeId ();
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+  uint32_t i = Find (tag.GetInstanceTypeId ());
+  if (i == GetNTags ())
     {
-      if (cur->tid == tid) 
-        {
-          /* found tag */
-          tag.Deserialize (TagBuffer (cur->data, cur->data + TagData::MAX_SIZE));
-          return true;
-        }
+      /* no tag found */
+      return false;
     }
-  /* no tag found */
-  return false;
-}
-
-const struct PacketTagList::TagData *
-PacketTagList::Head (void) const
-{
-  return m_next;
+  const struct TagData &cur = Get (i);
+  tag.Deserialize (TagBuffer (const_cast<uint8_t *> (cur.data),
+                              const_cast<uint8_t *> (cur.data) + TagData::MAX_SIZE));
+  return true;
 }
 
 } /* namespace ns3 */
-
@@ -22,7 +22,7 @@
 
 /**
 \file   packet-tag-list.h
-\brief  Defines a linked list of Packet tags, including copy-on-write semantics.
+\brief  Defines a list of Packet tags, stored inline with a shared spill-over.
 */
 
 #include <stdint.h>
@@ -43,96 +43,34 @@ class Tag;
  *
  * \internal
  *
- * The implementation of this class is a bit tricky.  Refer to this
- * diagram in the discussion that follows.
+ * Most packets carry only a few tags (a wifi frame typically carries
+ * a QosTag, a SnrTag and a FlowIdTag), so the first #INLINE_SIZE tags
+ * are stored in serialized form inside the PacketTagList itself, and
+ * adding, finding or removing them never allocates memory.
  *
- * \dot
- *    digraph {
- *        rankdir = "LR";
- *        clusterrank = local;
- *        node [ shape = record, fontname="FreeSans", fontsize="10" ];
- *        oth  [ label="<l> Other branch | <n> next | <c> ..." ];
- *        PTL1 [ label="<l> PacketTagList A | <n> m_next" , shape=Mrecord];
- *        PTL2 [ label="<l> PacketTagList B | <n> m_next" , shape=Mrecord];
- *        oth:n  -> T7:l ;
- *        PTL2:n -> T6:l ;
- *        PTL1:n -> T5:l ;
- *        T1   [ label="<l> T1  | <n> next | <c> count = 1" ];
- *        T2   [ label="<l> T2  | <n> next | <c> count = 1" ];
- *        T3   [ label="<l> T3  | <n> next | <c> count = 2" ];
- *        T4   [ label="<l> T4  | <n> next | <c> count = 1" ];
- *        T5   [ label="<l> T5  | <n> next | <c> count = 2" ];
- *        T6   [ label="<l> T6  | <n> next | <c> count = 1" ];
- *        T7   [ label="<l> T7  | <n> next | <c> count = 1" ];
- *        NULL [ label="0", shape = ellipse ];
- *        subgraph cluster_list {
- *          penwidth = 0;
- *          T6:n -> T5:l ;
- *          T5:n -> T4:l ;
- *          T4:n -> T3:l ;
- *          T7:n -> T3:l ;
- *          T3:n -> T2:l ;
- *          T2:n -> T1:l ;
- *          T1:n -> NULL ;
- *        };
- *      };
- * \enddot
+ * The tags beyond these are stored in a spill-over block, a vector of
+ * TagData which is shared between copies of the list:
  *
- *   - Tags are stored in serialized form in a tree of TagData
- *     structures. (<tt>T1-T7</tt> in the diagram)
+ *   - The copy constructor and the assignment copy the inline tags
+ *     and take a reference on the spill-over block, if any.
  *
- *   - Each TagData points (\c next pointers in the diagram)
- *     toward the root of the tree, which is a null pointer.
+ *   - #Add, #Remove and #Replace copy the spill-over block before
+ *     writing to it if it is referenced by another list
+ *     (copy-on-write).
  *
- *   - \c count is the number of incoming pointers to this
- *     TagData.  Branch points, where branches merge or join, have
- *     <tt>count \> 1</tt> (\c T3, \c T5); successive links along
- *     a branch have <tt>count = 1</tt> (\c T1, \c T2, \c T4, \c T6, \c T7).
- *
- *   - Each PacketTagList points to a specific TagData,
- *     which is the most recent Tag added to the packet. (<tt>T5-T7</tt>)
- *
- *   - Conceptually, therefore, each Packet has a PacketTagList which
- *     points to a singly-linked list of TagData.
- *
- * \par <b> Copy-on-write </b> is implemented as follows:
- *
- *   - #Add prepends the new tag to the list (growing that branch of the tree,
- *     as \c T6). This is a constant time operation, and does not affect
- *     any other #PacketTagList's, hence this is a \c const function.
- *
- *   - Copy constructor (PacketTagList(const PacketTagList & o))
- *     and assignment (#operator=(const PacketTagList & o)
- *     simply join the tree at the same place as the original
- *     PacketTagList \c o, incrementing the \c count.
- *     For assignment, the old branch is deleted, up to
- *     the first branch point, which has its \c count decremented.
- *     (PacketTagList \c B started as a copy of PacketTagList \c A,
- *     before \c T6 was added to \c B).
- *
- *   - #Remove and #Replace are a little tricky, depending on where the
- *     target tag is found relative to the first branch point:
- *     - \e Target before <em> the first branch point: </em> \n
- *       The target is just dealt with in place (linked around and deleted,
- *       in the case of #Remove; rewritten in the case of #Replace).
- *     - \e Target at or after <em> the first branch point: </em> \n
- *       The portion of the list between the first branch and the target is
- *       shared. This portion is copied before the #Remove or #Replace is
- *       performed.
+ *   - #Remove moves the last tag of the inline tags, or of the
+ *     spill-over block, in place of the removed tag: the order of
+ *     the tags is not preserved.
  *
  * \par <b> Memory Management: </b>
  * \n
  * Packet tags must serialize to a finite maximum size, see TagData
- *
- * This documentation entitles the original author to a free beer.
  */
 class PacketTagList 
 {
 public:
   /**
-   * Tree node for sharing serialized tags.
-   *
-   * See PacketTagList for a discussion of the data structure.
+   * Serialized form of a tag.
    *
    * See TagData::TagData_e for a discussion of the size limit on
    * tag serialization.
@@ -146,15 +84,10 @@ public:
      * in this constant.
      *
      * \internal
-     * Ideally, TagData would be 32 bytes in size, so they require
-     * no padding on 64-bit architectures.  (The architecture
-     * affects the size because of the \c #next pointer.)
-     * This would leave 18 bytes for \c #data.  However,
-     * ns3:Ipv6PacketInfoTag needs 19 bytes!  The current
-     * implementation allows 20 bytes, which gives TagData
-     * a size of 30 bytes on 32-byte machines (which gets
-     * padded with 2 bytes), and 34 bytes on 64-bit machines, which
-     * gets padded to 40 bytes.
+     * ns3:Ipv6PacketInfoTag needs 19 bytes. The current implementation
+     * allows 20 bytes, which gives TagData a size of 22 bytes with
+     * the TypeId, and makes the inline storage of a PacketTagList
+     * #INLINE_SIZE times this size.
      */
     enum TagData_e
     {
@@ -162,11 +95,17 @@ public:
   };
 
     uint8_t data[MAX_SIZE];   /**< Serialization buffer */
-    struct TagData * next;   /**< Pointer to next in list */
     TypeId tid;               /**< Type of the tag serialized into #data */
-    uint32_t count;           /**< Number of incoming links */
   };  /* struct TagData */
 
+  /**
+   * \brief Number of tags stored inside the PacketTagList
+   */
+  enum
+  {
+    INLINE_SIZE = 4
+  };
+
   /**
    * Create a new PacketTagList.
    */
@@ -176,8 +115,8 @@ public:
    *
    * \param [in] o The PacketTagList to copy.
    *
-   * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * This copies the inline tags of \pname{o} and shares its
+   * spill-over block.
    */
   inline PacketTagList (PacketTagList const &o);
   /**
@@ -187,18 +126,19 @@ public:
    * \returns the copied object
    *
    * This makes a light-weight copy by #RemoveAll, then
-   * pointing to the same \ref TagData as \pname{o}.
+   * copying the inline tags of \pname{o} and sharing its
+   * spill-over block.
    */
   inline PacketTagList &operator = (PacketTagList const &o);
   /**
    * Destructor
    *
-   * #RemoveAll's the tags up to the first merge.
+   * #RemoveAll's the tags.
    */
   inline ~PacketTagList ();
 
   /**
-   * Add a tag to the head of this branch.
+   * Add a tag to the list.
    *
    * \param [in] tag The tag to add
    */
@@ -230,67 +170,58 @@ public:
    */
   bool Peek (Tag &tag) const;
   /**
-   * Remove all tags from this list (up to the first merge).
+   * Remove all tags from this list.
    */
   inline void RemoveAll (void);
   /**
-   * \returns pointer to head of tag list
+   * Copy the spill-over block if other lists share it.
+   */
+  void Unshare (void);
+  /**
+   * \returns the number of tags in the list
+   */
+  inline uint32_t GetNTags (void) const;
+  /**
+   * \param [in] i index of the tag, less than GetNTags
+   * \returns the serialized tag
    */
-  const struct PacketTagList::TagData *Head (void) const;
+  inline const struct PacketTagList::TagData &Get (uint32_t i) const;
 
 private:
   /**
-   * Typedef of method function pointer for copy-on-write operations
-   *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True if operation successful, false otherwise
+   * Shared, variable-sized block of the tags beyond the inline ones.
    */
-  typedef bool (PacketTagList::*COWWriter)
-    (Tag       & tag, bool         preMerge,
-    struct TagData * cur, struct TagData ** prevNext);
+  struct TagSpill
+  {
+    uint32_t count;           /**< Number of lists referencing this block */
+    uint32_t size;            /**< Number of tags in #tags */
+    uint32_t capacity;        /**< Number of tags #tags can hold */
+    struct TagData tags[1];   /**< The tags, really #capacity of them */
+  };
+
   /**
-   * Traverse the list implementing copy-on-write, using \pname{Writer}.
+   * Find a tag.
    *
-   * \param [in] tag The tag type to operate on.
-   * \param [in] Writer The copy-on-write function to use.
-   * \returns True if \pname{tag} found, false otherwise.
+   * \param [in] tid The type of the tag.
+   * \returns the index of the tag, or GetNTags if not found.
    */
-  bool COWTraverse   (Tag & tag, PacketTagList::COWWriter Writer);
+  uint32_t Find (TypeId tid) const;
   /**
-   * Copy-on-write implementing Remove.
+   * Make sure the spill-over block is referenced by this list only and
+   * can hold \pname{size} tags, copying it if needed.
    *
-   * \param [in] tag The target tag type to remove.
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *             false otherwise.
-   * \param [in] cur Pointer to the tag.
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag will definitely be removed.
+   * \param [in] size The number of tags the block must hold.
    */
-  bool RemoveWriter  (Tag       & tag, bool         preMerge,
-                      struct TagData * cur, struct TagData ** prevNext);
+  void MakeSpillWritable (uint32_t size);
   /**
-   * Copy-on-write implementing Replace
-   *
-   * \param [in] tag The target tag type to replace
-   * \param [in] preMerge True if \pname{tag} was found before the first merge,
-   *          false otherwise.
-   * \param [in] cur Pointer to the tag
-   * \param [in] prevNext Pointer to the struct TagData.next pointer
-   *          pointing to \pname{cur}.
-   * \returns True, since tag value will definitely be replaced.
+   * Drop the reference of this list on the spill-over block, which
+   * is deleted if it was the last one.
    */
-  bool ReplaceWriter (Tag & tag, bool preMerge, struct TagData * cur, struct TagData ** prevNext);
+  void ReleaseSpill (void);
 
-  /**
-   * Pointer to first \ref TagData on the list
-   */
-  struct TagData *m_next;
+  struct TagData m_tags[INLINE_SIZE]; //!< the inline tags
+  uint32_t m_size;                    //!< number of inline tags
+  struct TagSpill *m_spill;           //!< the other tags, or null
 };
 
 } // namespace ns3
@@ -302,16 +233,22 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_size (0),
+    m_spill (0)
 {
 }
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
+  : m_size (o.m_size),
+    m_spill (o.m_spill)
 {
-  if (m_next != 0)
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      m_tags[i] = o.m_tags[i];
+    }
+  if (m_spill != 0)
     {
-      m_next->count++;
+      m_spill->count++;
     }
 }
 
@@ -319,15 +256,20 @@ PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o) 
     {
       return *this;
     }
   RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
+  m_size = o.m_size;
+  for (uint32_t i = 0; i < m_size; i++)
     {
-      m_next->count++;
+      m_tags[i] = o.m_tags[i];
+    }
+  m_spill = o.m_spill;
+  if (m_spill != 0) 
+    {
+      m_spill->count++;
     }
   return *this;
 }
@@ -340,25 +282,27 @@ PacketTagList::~PacketTagList ()
 void
 PacketTagList::RemoveAll (void)
 {
-  struct TagData *prev = 0;
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  m_size = 0;
+  if (m_spill != 0) 
     {
-      cur->count--;
-      if (cur->count > 0) 
-        {
-          break;
-        }
-      if (prev != 0) 
-        {
-	  delete prev;
-        }
-      prev = cur;
+      ReleaseSpill ();
     }
-  if (prev != 0) 
+}
+
+uint32_t
+PacketTagList::GetNTags (void) const
+{
+  return m_size + (m_spill != 0 ? m_spill->size : 0);
+}
+
+const struct PacketTagList::TagData &
+PacketTagList::Get (uint32_t i) const
+{
+  if (i < m_size)
     {
-      delete prev;
+      return m_tags[i];
     }
-  m_next = 0;
+  return m_spill->tags[i - m_size];
 }
 
 } // namespace ns3
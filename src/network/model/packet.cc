@@ -18,6 +18,7 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "packet.h"
+#include "ns3/core-config.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
@@ -30,6 +31,17 @@ namespace ns3 {
 
 uint32_t Packet::m_globalUid = 0;
 
+uint32_t
+Packet::AllocateUid (void)
+{
+#ifdef HAVE_PTHREAD_H
+  // the partitions of a multithreaded simulation create packets concurrently
+  return __sync_fetch_and_add (&m_globalUid, 1);
+#else /* HAVE_PTHREAD_H */
+  return m_globalUid++;
+#endif /* HAVE_PTHREAD_H */
+}
+
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
 {
@@ -81,22 +93,23 @@ ByteTagIterator::ByteTagIterator (ByteTagList::Iterator i)
 }
 
 
-PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *head)
-  : m_current (head)
+PacketTagIterator::PacketTagIterator (const PacketTagList *tags)
+  : m_tags (tags),
+    m_current (0)
 {
 }
 bool
 PacketTagIterator::HasNext (void) const
 {
-  return m_current != 0;
+  return m_current < m_tags->GetNTags ();
 }
 PacketTagIterator::Item
 PacketTagIterator::Next (void)
 {
   NS_ASSERT (HasNext ());
-  const struct PacketTagList::TagData *prev = m_current;
-  m_current = m_current->next;
-  return PacketTagIterator::Item (prev);
+  const struct PacketTagList::TagData *current = &m_tags->Get (m_current);
+  m_current++;
+  return PacketTagIterator::Item (current);
 }
 
 PacketTagIterator::Item::Item (const struct PacketTagList::TagData *data)
@@ -127,6 +140,19 @@ Packet::Copy (void) const
   return Ptr<Packet> (new Packet (*this), false);
 }
 
+Ptr<Packet>
+Packet::DeepCopy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  // the copy constructor already copies the nix-vector
+  Ptr<Packet> p = Ptr<Packet> (new Packet (*this), false);
+  p->m_buffer.Unshare ();
+  p->m_byteTagList.Unshare ();
+  p->m_packetTagList.Unshare ();
+  p->m_metadata.Unshare ();
+  return p;
+}
+
 Packet::Packet ()
   : m_buffer (),
     m_byteTagList (),
@@ -137,10 +163,9 @@ Packet::Packet ()
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | AllocateUid (), 0),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 
 Packet::Packet (const Packet &o)
@@ -179,10 +204,9 @@ Packet::Packet (uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
   : m_buffer (0, false),
@@ -205,10 +229,9 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | AllocateUid (), size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
@@ -555,6 +578,14 @@ Packet::EnablePrinting (void)
   PacketMetadata::Enable ();
 }
 
+void
+Packet::EnableLazyPrinting (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  PacketMetadata::Enable ();
+  PacketMetadata::SetLazy (true);
+}
+
 void
 Packet::EnableChecking (void)
 {
@@ -898,7 +929,7 @@ Packet::PrintPacketTags (std::ostream &os) const
 PacketTagIterator 
 Packet::GetPacketTagIterator (void) const
 {
-  return PacketTagIterator (m_packetTagList.Head ());
+  return PacketTagIterator (&m_packetTagList);
 }
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet)
@@ -165,10 +165,11 @@ private:
   friend class Packet;
   /**
    * Constructor
-   * \param head head of the items
+   * \param tags the tags of the packet
    */
-  PacketTagIterator (const struct PacketTagList::TagData *head);
-  const struct PacketTagList::TagData *m_current;  //!< actual position over the set of tags in a packet
+  PacketTagIterator (const PacketTagList *tags);
+  const PacketTagList *m_tags;  //!< the tags of the packet
+  uint32_t m_current;           //!< actual position over the set of tags in a packet
 };
 
 /**
@@ -191,7 +192,9 @@ private:
  * output from Packet::Print. If you wish to only enable
  * checking of metadata, and do not need any printing capability, you can
  * call Packet::EnableChecking: its runtime cost is lower than
- * Packet::EnablePrinting.
+ * Packet::EnablePrinting. If only a few of the packets are printed,
+ * Packet::EnableLazyPrinting defers most of the cost of the metadata
+ * to the packets actually printed.
  *
  * - The set of tags contain simulation-specific information which cannot
  * be stored in the packet byte buffer because the protocol headers or trailers
@@ -435,6 +438,18 @@ public:
    */
   Ptr<Packet> Copy (void) const;
 
+  /**
+   * \brief performs a copy of the packet which shares nothing with it.
+   *
+   * \returns a copy of the packet, with its own buffer, tags and
+   * metadata.
+   *
+   * The datasets shared by COW copies are reference counted without
+   * synchronization, so a packet handed over to another thread must
+   * be such a copy, made before the handover.
+   */
+  Ptr<Packet> DeepCopy (void) const;
+
   /**
    * \brief Returns the packet's Uid.
    *
@@ -492,6 +507,16 @@ public:
    * simulation setup and before any packet is created.
    */
   static void EnablePrinting (void);
+  /**
+   * \brief Enable printing packets metadata, recorded lazily.
+   *
+   * Like EnablePrinting, but the metadata only records which headers
+   * and trailers are added and removed, and is turned into the list
+   * of items needed by the Print methods only when they are called.
+   * This is cheaper when only a few of the packets are printed. It
+   * must also be called before any packet is created.
+   */
+  static void EnableLazyPrinting (void);
   /**
    * \brief Enable packets metadata checking.
    *
@@ -679,6 +704,11 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
+  /**
+   * \returns a new packet uid
+   */
+  static uint32_t AllocateUid (void);
+
   static uint32_t m_globalUid; //!< Global counter of packets Uid
 };
 
@@ -0,0 +1,475 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "slab-allocator.h"
+#include "ns3/core-config.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <new>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+NS_LOG_COMPONENT_DEFINE ("SlabAllocator");
+
+namespace ns3 {
+
+struct SlabAllocator::ThreadCache
+{
+  struct FreeBlock
+  {
+    FreeBlock *next;
+  };
+  FreeBlock *head[MAX_CLASSES];
+  uint32_t count[MAX_CLASSES];
+  uint32_t size[MAX_CLASSES];     //!< size of the blocks of each list
+  Counters counters;              //!< statistics of the thread
+  SlabAllocator *owner;           //!< 0 once the allocator is destroyed
+  ThreadCache *next;              //!< next free lists of the allocator
+
+  ThreadCache (SlabAllocator *allocator)
+    : owner (allocator),
+      next (0)
+  {
+    for (uint32_t i = 0; i < MAX_CLASSES; i++)
+      {
+        head[i] = 0;
+        count[i] = 0;
+        size[i] = 0;
+      }
+    counters.Reset ();
+  }
+  /// Called by the thread which exits
+  void Retire (void)
+  {
+    if (owner != 0)
+      {
+        owner->RetireThreadCache (this);
+      }
+  }
+  /// Give the blocks of a list back to the global allocator
+  void Flush (uint32_t sizeClass)
+  {
+    while (head[sizeClass] != 0)
+      {
+        FreeBlock *block = head[sizeClass];
+        head[sizeClass] = block->next;
+        ::operator delete (block);
+      }
+    count[sizeClass] = 0;
+  }
+  ~ThreadCache ()
+  {
+    for (uint32_t i = 0; i < MAX_CLASSES; i++)
+      {
+        Flush (i);
+      }
+  }
+};
+
+namespace {
+
+/// maximum number of allocators with free lists
+const uint32_t MAX_ALLOCATORS = 8;
+uint32_t g_nAllocators = 0;
+
+#ifdef HAVE_PTHREAD_H
+__thread SlabAllocator::ThreadCache *g_threadCaches[MAX_ALLOCATORS];
+pthread_key_t g_threadCachesKey;
+pthread_once_t g_threadCachesOnce = PTHREAD_ONCE_INIT;
+
+void
+ReleaseThreadCaches (void *)
+{
+  for (uint32_t i = 0; i < MAX_ALLOCATORS; i++)
+    {
+      if (g_threadCaches[i] != 0)
+        {
+          g_threadCaches[i]->Retire ();
+          delete g_threadCaches[i];
+          g_threadCaches[i] = 0;
+        }
+    }
+}
+
+void
+CreateThreadCachesKey (void)
+{
+  // the key only serves to release the free lists when a thread exits
+  pthread_key_create (&g_threadCachesKey, &ReleaseThreadCaches);
+}
+#else /* HAVE_PTHREAD_H */
+SlabAllocator::ThreadCache *g_threadCaches[MAX_ALLOCATORS];
+#endif /* HAVE_PTHREAD_H */
+
+} // anonymous namespace
+
+SlabAllocator::SlabAllocator (const char *name, const uint32_t *sizes, uint32_t nSizes)
+  : m_name (name),
+    m_index (__sync_fetch_and_add (&g_nAllocators, 1)),
+    m_nClasses (0),
+    m_cacheLimit (1000),
+    m_destroyed (false),
+    m_caches (0)
+{
+  NS_LOG_FUNCTION (this << name);
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init (&m_mutex, NULL);
+#endif /* HAVE_PTHREAD_H */
+  SetClassSizes (std::vector<uint32_t> (sizes, sizes + nSizes));
+}
+
+SlabAllocator::~SlabAllocator ()
+{
+  NS_LOG_FUNCTION (this);
+  // the structures of the other threads are deleted when they exit
+  Lock ();
+  for (ThreadCache *cache = m_caches; cache != 0; cache = cache->next)
+    {
+      for (uint32_t i = 0; i < MAX_CLASSES; i++)
+        {
+          cache->Flush (i);
+        }
+      cache->owner = 0;
+    }
+  m_caches = 0;
+  Unlock ();
+  if (m_index < MAX_ALLOCATORS)
+    {
+      delete g_threadCaches[m_index];
+      g_threadCaches[m_index] = 0;
+    }
+  // blocks still held by static objects will be deallocated directly
+  m_destroyed = true;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy (&m_mutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+void
+SlabAllocator::Lock (void) const
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&m_mutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+void
+SlabAllocator::Unlock (void) const
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&m_mutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+void
+SlabAllocator::SetClassSizes (const std::vector<uint32_t> &sizes)
+{
+  NS_LOG_FUNCTION (this << sizes.size ());
+  NS_ASSERT (sizes.size () <= MAX_CLASSES);
+  for (uint32_t i = 0; i < sizes.size (); i++)
+    {
+      NS_ASSERT (sizes[i] >= sizeof (ThreadCache::FreeBlock));
+      NS_ASSERT (i == 0 || sizes[i] > sizes[i - 1]);
+      m_classSize[i] = sizes[i];
+    }
+  m_nClasses = sizes.size ();
+  ResetStats ();
+}
+
+std::vector<uint32_t>
+SlabAllocator::GetClassSizes (void) const
+{
+  return std::vector<uint32_t> (m_classSize, m_classSize + m_nClasses);
+}
+
+void
+SlabAllocator::SetCacheLimit (uint32_t limit)
+{
+  m_cacheLimit = limit;
+}
+
+uint32_t
+SlabAllocator::GetCacheLimit (void) const
+{
+  return m_cacheLimit;
+}
+
+uint32_t
+SlabAllocator::FindClass (uint32_t size) const
+{
+  // there are few classes: a linear search is as fast as a binary one
+  uint32_t i = 0;
+  while (i < m_nClasses && m_classSize[i] < size)
+    {
+      i++;
+    }
+  return i;
+}
+
+uint32_t
+SlabAllocator::FindClassOfCapacity (uint32_t capacity) const
+{
+  uint32_t i = FindClass (capacity);
+  if (i < m_nClasses && m_classSize[i] != capacity)
+    {
+      return m_nClasses;
+    }
+  return i;
+}
+
+SlabAllocator::ThreadCache *
+SlabAllocator::GetThreadCache (void)
+{
+  if (m_index >= MAX_ALLOCATORS || m_destroyed)
+    {
+      return 0;
+    }
+  ThreadCache *cache = g_threadCaches[m_index];
+  if (cache == 0)
+    {
+#ifdef HAVE_PTHREAD_H
+      pthread_once (&g_threadCachesOnce, &CreateThreadCachesKey);
+      pthread_setspecific (g_threadCachesKey, g_threadCaches);
+#endif /* HAVE_PTHREAD_H */
+      cache = new ThreadCache (this);
+      g_threadCaches[m_index] = cache;
+      Lock ();
+      cache->next = m_caches;
+      m_caches = cache;
+      Unlock ();
+    }
+  return cache;
+}
+
+void
+SlabAllocator::RetireThreadCache (ThreadCache *cache)
+{
+  NS_LOG_FUNCTION (this << cache);
+  Lock ();
+  m_retired.Add (cache->counters);
+  ThreadCache **i = &m_caches;
+  while (*i != cache)
+    {
+      i = &(*i)->next;
+    }
+  *i = cache->next;
+  Unlock ();
+}
+
+void *
+SlabAllocator::Allocate (uint32_t size, uint32_t &capacity)
+{
+  NS_LOG_FUNCTION (this << size);
+  uint32_t sizeClass = FindClass (size);
+  ThreadCache *cache = GetThreadCache ();
+  if (sizeClass == m_nClasses)
+    {
+      CountAllocation (cache, sizeClass, true);
+      capacity = size;
+      return ::operator new (size);
+    }
+  capacity = m_classSize[sizeClass];
+  if (cache != 0 && cache->head[sizeClass] != 0)
+    {
+      if (cache->size[sizeClass] == capacity)
+        {
+          ThreadCache::FreeBlock *block = cache->head[sizeClass];
+          cache->head[sizeClass] = block->next;
+          cache->count[sizeClass]--;
+          CountAllocation (cache, sizeClass, false);
+          return block;
+        }
+      // the size classes have changed
+      cache->Flush (sizeClass);
+    }
+  CountAllocation (cache, sizeClass, true);
+  return ::operator new (capacity);
+}
+
+void
+SlabAllocator::Deallocate (void *block, uint32_t capacity)
+{
+  NS_LOG_FUNCTION (this << block << capacity);
+  uint32_t sizeClass = FindClassOfCapacity (capacity);
+  if (m_destroyed)
+    {
+      ::operator delete (block);
+      return;
+    }
+  ThreadCache *cache = GetThreadCache ();
+  CountDeallocation (cache, sizeClass);
+  if (cache == 0 || sizeClass == m_nClasses)
+    {
+      ::operator delete (block);
+      return;
+    }
+  if (cache->size[sizeClass] != capacity)
+    {
+      cache->Flush (sizeClass);
+      cache->size[sizeClass] = capacity;
+    }
+  if (cache->count[sizeClass] >= m_cacheLimit)
+    {
+      ::operator delete (block);
+      return;
+    }
+  ThreadCache::FreeBlock *freeBlock = static_cast<ThreadCache::FreeBlock *> (block);
+  freeBlock->next = cache->head[sizeClass];
+  cache->head[sizeClass] = freeBlock;
+  cache->count[sizeClass]++;
+}
+
+void
+SlabAllocator::Counters::Reset (void)
+{
+  for (uint32_t i = 0; i <= MAX_CLASSES; i++)
+    {
+      allocations[i] = 0;
+      misses[i] = 0;
+      inUse[i] = 0;
+      highWater[i] = 0;
+    }
+}
+
+void
+SlabAllocator::Counters::Add (const Counters &o)
+{
+  for (uint32_t i = 0; i <= MAX_CLASSES; i++)
+    {
+      allocations[i] += o.allocations[i];
+      misses[i] += o.misses[i];
+      inUse[i] += o.inUse[i];
+      highWater[i] += o.highWater[i];
+    }
+}
+
+void
+SlabAllocator::Counters::CountAllocation (uint32_t sizeClass, bool miss)
+{
+  allocations[sizeClass]++;
+  if (miss)
+    {
+      misses[sizeClass]++;
+    }
+  if (++inUse[sizeClass] > highWater[sizeClass])
+    {
+      highWater[sizeClass] = inUse[sizeClass];
+    }
+}
+
+void
+SlabAllocator::Counters::CountDeallocation (uint32_t sizeClass)
+{
+  inUse[sizeClass]--;
+}
+
+void
+SlabAllocator::CountAllocation (ThreadCache *cache, uint32_t sizeClass, bool miss)
+{
+  if (cache != 0)
+    {
+      cache->counters.CountAllocation (sizeClass, miss);
+      return;
+    }
+  if (m_destroyed)
+    {
+      return;
+    }
+  // only the allocators beyond MAX_ALLOCATORS have no free lists
+  Lock ();
+  m_retired.CountAllocation (sizeClass, miss);
+  Unlock ();
+}
+
+void
+SlabAllocator::CountDeallocation (ThreadCache *cache, uint32_t sizeClass)
+{
+  if (cache != 0)
+    {
+      cache->counters.CountDeallocation (sizeClass);
+      return;
+    }
+  if (m_destroyed)
+    {
+      return;
+    }
+  Lock ();
+  m_retired.CountDeallocation (sizeClass);
+  Unlock ();
+}
+
+void
+SlabAllocator::ResetStats (void)
+{
+  Lock ();
+  m_retired.Reset ();
+  for (ThreadCache *cache = m_caches; cache != 0; cache = cache->next)
+    {
+      cache->counters.Reset ();
+    }
+  Unlock ();
+}
+
+std::vector<SlabAllocator::Stats>
+SlabAllocator::GetStats (void) const
+{
+  Lock ();
+  Counters total = m_retired;
+  for (ThreadCache *cache = m_caches; cache != 0; cache = cache->next)
+    {
+      total.Add (cache->counters);
+    }
+  Unlock ();
+  std::vector<Stats> stats;
+  for (uint32_t i = 0; i <= m_nClasses; i++)
+    {
+      Stats s;
+      s.size = i < m_nClasses ? m_classSize[i] : 0;
+      s.allocations = total.allocations[i];
+      s.misses = total.misses[i];
+      // blocks allocated before the statistics were reset are not counted
+      s.inUse = std::max<int64_t> (total.inUse[i], 0);
+      s.highWater = std::max<int64_t> (total.highWater[i], s.inUse);
+      stats.push_back (s);
+    }
+  return stats;
+}
+
+void
+SlabAllocator::PrintStats (std::ostream &os) const
+{
+  std::vector<Stats> stats = GetStats ();
+  os << m_name << ":" << std::endl;
+  for (std::vector<Stats>::const_iterator i = stats.begin (); i != stats.end (); i++)
+    {
+      if (i->size != 0)
+        {
+          os << "  " << i->size << " bytes:";
+        }
+      else
+        {
+          os << "  larger:";
+        }
+      os << " allocations=" << i->allocations
+         << " misses=" << i->misses
+         << " in use=" << i->inUse
+         << " high water=" << i->highWater << std::endl;
+    }
+}
+
+} // namespace ns3
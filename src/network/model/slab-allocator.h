@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include "ns3/core-config.h"
+#include <stdint.h>
+#include <ostream>
+#include <vector>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief a size-class allocator for the variable-sized storage of packets
+ *
+ * Requests are rounded up to the smallest size class which holds them,
+ * and the blocks of each class are recycled through free lists kept
+ * per thread, so that simulation threads never contend for them and
+ * blocks freed by another thread than the one which allocated them are
+ * simply adopted. At most GetCacheLimit blocks are kept per thread and
+ * per class; the others, and the requests larger than the largest
+ * class, go to the global allocator.
+ *
+ * The caller keeps the capacity returned by Allocate and gives it back
+ * to Deallocate: the class of a block is found from its capacity, so the
+ * size classes may be changed at any time.
+ *
+ * The statistics are counted in the free lists of each thread, without
+ * atomic operations, and added up by GetStats. The free lists of a
+ * thread are released when it exits, and those of all the threads when
+ * the allocator is destroyed, by which time the other threads must have
+ * stopped using it.
+ *
+ * All the state of an allocator is plain data, so that it remains
+ * usable while static objects are destroyed: once its destructor has
+ * run, blocks are returned directly to the global allocator.
+ */
+class SlabAllocator
+{
+public:
+  /// maximum number of size classes
+  static const uint32_t MAX_CLASSES = 16;
+
+  /**
+   * \brief Usage statistics of a size class
+   */
+  struct Stats
+  {
+    uint32_t size;            //!< size of the blocks of the class, 0 for the larger blocks
+    uint64_t allocations;     //!< number of blocks handed out
+    uint64_t misses;          //!< number of blocks obtained from the global allocator
+    uint64_t inUse;           //!< number of blocks currently handed out
+    uint64_t highWater;       //!< maximum of inUse
+  };
+
+  /**
+   * \param name name of the allocator, used when printing statistics
+   * \param sizes size classes, in increasing order
+   * \param nSizes number of size classes, at most MAX_CLASSES
+   */
+  SlabAllocator (const char *name, const uint32_t *sizes, uint32_t nSizes);
+  ~SlabAllocator ();
+
+  /**
+   * \param size the minimum size of the block
+   * \param capacity the actual size of the block
+   * \returns a block of at least size bytes
+   */
+  void *Allocate (uint32_t size, uint32_t &capacity);
+  /**
+   * \param block a block returned by Allocate
+   * \param capacity the capacity returned by Allocate
+   */
+  void Deallocate (void *block, uint32_t capacity);
+
+  /**
+   * \param sizes the new size classes, in increasing order, at most
+   *        MAX_CLASSES. The statistics are reset.
+   */
+  void SetClassSizes (const std::vector<uint32_t> &sizes);
+  /**
+   * \returns the size classes
+   */
+  std::vector<uint32_t> GetClassSizes (void) const;
+  /**
+   * \param limit the maximum number of free blocks kept per thread and
+   *        per size class
+   */
+  void SetCacheLimit (uint32_t limit);
+  /**
+   * \returns the maximum number of free blocks kept per thread and per
+   *          size class
+   */
+  uint32_t GetCacheLimit (void) const;
+
+  /**
+   * The counts of threads which are still running are read without
+   * synchronization. When blocks are freed by another thread than the
+   * one which allocated them, the high water is the sum of the high
+   * waters of the threads, an upper bound.
+   *
+   * \returns the statistics of each size class, followed by those of the
+   *          blocks larger than the largest class
+   */
+  std::vector<Stats> GetStats (void) const;
+  /**
+   * \param os the stream to print the statistics to
+   */
+  void PrintStats (std::ostream &os) const;
+
+  /// \internal The free lists of a thread for one allocator
+  struct ThreadCache;
+
+private:
+  /// Statistics of a thread: one more entry for the larger blocks
+  struct Counters
+  {
+    uint64_t allocations[MAX_CLASSES + 1];
+    uint64_t misses[MAX_CLASSES + 1];
+    int64_t inUse[MAX_CLASSES + 1];     //!< negative if other threads allocated the blocks freed
+    int64_t highWater[MAX_CLASSES + 1];
+
+    void Reset (void);
+    /// \param o the counters to add to these ones
+    void Add (const Counters &o);
+    void CountAllocation (uint32_t sizeClass, bool miss);
+    void CountDeallocation (uint32_t sizeClass);
+  };
+
+  /**
+   * \param size a size
+   * \returns the smallest class which holds size, or m_nClasses
+   */
+  uint32_t FindClass (uint32_t size) const;
+  /**
+   * \param capacity the exact size of a block
+   * \returns the class of blocks of this size, or m_nClasses
+   */
+  uint32_t FindClassOfCapacity (uint32_t capacity) const;
+  /// \returns the free lists of the calling thread, created on demand
+  ThreadCache *GetThreadCache (void);
+  /**
+   * Keep the statistics of the free lists of a thread which exits, and
+   * forget them.
+   * \param cache the free lists
+   */
+  void RetireThreadCache (ThreadCache *cache);
+  void CountAllocation (ThreadCache *cache, uint32_t sizeClass, bool miss);
+  void CountDeallocation (ThreadCache *cache, uint32_t sizeClass);
+  void ResetStats (void);
+  void Lock (void) const;
+  void Unlock (void) const;
+
+  const char *m_name;
+  uint32_t m_index;                         //!< index of the free lists of this allocator in each thread
+  uint32_t m_nClasses;
+  uint32_t m_classSize[MAX_CLASSES];
+  uint32_t m_cacheLimit;
+  bool m_destroyed;
+  ThreadCache *m_caches;                    //!< free lists of the running threads
+  Counters m_retired;                       //!< statistics of the exited threads
+#ifdef HAVE_PTHREAD_H
+  mutable pthread_mutex_t m_mutex;          //!< protects m_caches and m_retired
+#endif /* HAVE_PTHREAD_H */
+};
+
+} // namespace ns3
+
+#endif /* SLAB_ALLOCATOR_H */
@@ -321,6 +321,23 @@ BufferTest::DoRun (void)
       NS_TEST_ASSERT_MSG_EQ ( evilBuffer [i], cBuf [i] , "Bad buffer peeked");
     }
   free (cBuf);
+
+  // Unshare gives a buffer its own copy of the data, zero area included
+  buffer = Buffer (3);
+  buffer.AddAtStart (2);
+  i = buffer.Begin ();
+  i.WriteU8 (0x1);
+  i.WriteU8 (0x2);
+  buffer.AddAtEnd (1);
+  i = buffer.End ();
+  i.Prev (1);
+  i.WriteU8 (0x3);
+  other = buffer;
+  other.Unshare ();
+  i = other.Begin ();
+  i.WriteU8 (0x4);
+  ENSURE_WRITTEN_BYTES (buffer, 6, 0x1, 0x2, 0x0, 0x0, 0x0, 0x3);
+  ENSURE_WRITTEN_BYTES (other, 6, 0x4, 0x2, 0x0, 0x0, 0x0, 0x3);
 }
 //-----------------------------------------------------------------------------
 class BufferTestSuite : public TestSuite
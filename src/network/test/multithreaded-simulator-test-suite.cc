@@ -0,0 +1,150 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/default-simulator-impl.h"
+#include "ns3/multithreaded-simulator-impl.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Run the same event pattern, made of events local to a context and of
+ * events exchanged between contexts with a delay of at least the
+ * lookahead, with the default and the multithreaded simulators, and
+ * check that every context sees the same events at the same times.
+ */
+class MultithreadedSimulatorTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorTestCase (uint32_t threads);
+
+private:
+  typedef std::vector<std::pair<uint64_t, uint32_t> > Log;
+
+  virtual void DoRun (void);
+  std::vector<Log> RunScenario (Ptr<SimulatorImpl> impl);
+  void Ping (uint32_t context, uint32_t hop);
+  void Tick (uint32_t context, uint32_t hop);
+  void Cancelled (uint32_t context);
+
+  uint32_t m_threads;
+  std::vector<Log> m_logs;
+};
+
+static const uint32_t N_CONTEXTS = 8;
+static const uint32_t N_HOPS = 200;
+
+MultithreadedSimulatorTestCase::MultithreadedSimulatorTestCase (uint32_t threads)
+  : TestCase ("Check that the multithreaded simulator matches the default one"),
+    m_threads (threads)
+{
+}
+
+void
+MultithreadedSimulatorTestCase::Tick (uint32_t context, uint32_t hop)
+{
+  m_logs[context].push_back (std::make_pair (Simulator::Now ().GetTimeStep (), 1000 + hop));
+}
+
+void
+MultithreadedSimulatorTestCase::Cancelled (uint32_t context)
+{
+  m_logs[context].push_back (std::make_pair (Simulator::Now ().GetTimeStep (), 0));
+}
+
+void
+MultithreadedSimulatorTestCase::Ping (uint32_t context, uint32_t hop)
+{
+  NS_ASSERT (Simulator::GetContext () == context);
+  m_logs[context].push_back (std::make_pair (Simulator::Now ().GetTimeStep (), hop));
+  if (hop >= N_HOPS)
+    {
+      return;
+    }
+  Simulator::Schedule (NanoSeconds (37 * (context + 1) + hop), &MultithreadedSimulatorTestCase::Tick, this, context, hop);
+  EventId ev = Simulator::Schedule (NanoSeconds (500), &MultithreadedSimulatorTestCase::Cancelled, this, context);
+  if (hop % 2 == 0)
+    {
+      Simulator::Remove (ev);
+    }
+  else
+    {
+      ev.Cancel ();
+    }
+  uint32_t to = (context * 3 + 1) % N_CONTEXTS;
+  Simulator::ScheduleWithContext (to, MicroSeconds (10 + (hop * 7 + context) % 13),
+                                  &MultithreadedSimulatorTestCase::Ping, this, to, hop + 1);
+}
+
+std::vector<MultithreadedSimulatorTestCase::Log>
+MultithreadedSimulatorTestCase::RunScenario (Ptr<SimulatorImpl> impl)
+{
+  Simulator::SetImplementation (impl);
+  m_logs.assign (N_CONTEXTS, Log ());
+  for (uint32_t i = 0; i < N_CONTEXTS; ++i)
+    {
+      Simulator::ScheduleWithContext (i, NanoSeconds (i), &MultithreadedSimulatorTestCase::Ping, this, i, 0);
+    }
+  Simulator::Stop (MilliSeconds (2));
+  Simulator::Run ();
+  Time end = Simulator::Now ();
+  Simulator::Destroy ();
+  NS_TEST_EXPECT_MSG_EQ ((end <= MilliSeconds (2)), true, "Simulation ran past Stop");
+  for (uint32_t i = 0; i < N_CONTEXTS; ++i)
+    {
+      std::sort (m_logs[i].begin (), m_logs[i].end ());
+    }
+  return m_logs;
+}
+
+void
+MultithreadedSimulatorTestCase::DoRun (void)
+{
+  std::vector<Log> expected = RunScenario (CreateObject<DefaultSimulatorImpl> ());
+
+  Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+  impl->SetAttribute ("Threads", UintegerValue (m_threads));
+  impl->SetAttribute ("Lookahead", TimeValue (MicroSeconds (10)));
+  std::vector<Log> found = RunScenario (impl);
+
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < N_CONTEXTS; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (found[i].size (), expected[i].size (), "Wrong number of events for context " << i);
+      NS_TEST_ASSERT_MSG_EQ ((found[i] == expected[i]), true, "Wrong events for context " << i);
+      total += found[i].size ();
+    }
+  NS_TEST_ASSERT_MSG_GT (total, N_HOPS, "The scenario ran too few events");
+}
+
+class MultithreadedSimulatorTestSuite : public TestSuite
+{
+public:
+  MultithreadedSimulatorTestSuite ()
+    : TestSuite ("multithreaded-simulator")
+  {
+    AddTestCase (new MultithreadedSimulatorTestCase (1), TestCase::QUICK);
+    AddTestCase (new MultithreadedSimulatorTestCase (2), TestCase::QUICK);
+    AddTestCase (new MultithreadedSimulatorTestCase (4), TestCase::QUICK);
+  }
+} g_multithreadedSimulatorTestSuite;
@@ -252,16 +252,18 @@ HistoryTrailer<N>::Deserialize (Buffer::Iterator start)
 
 class PacketMetadataTest : public TestCase {
 public:
-  PacketMetadataTest ();
+  PacketMetadataTest (bool lazy);
   virtual ~PacketMetadataTest ();
   void CheckHistory (Ptr<Packet> p, const char *file, int line, uint32_t n, ...);
   virtual void DoRun (void);
 private:
   Ptr<Packet> DoAddHeader (Ptr<Packet> p);
+  bool m_lazy;
 };
 
-PacketMetadataTest::PacketMetadataTest ()
-  : TestCase ("Packet metadata")
+PacketMetadataTest::PacketMetadataTest (bool lazy)
+  : TestCase (lazy ? "Packet metadata, recorded lazily" : "Packet metadata"),
+    m_lazy (lazy)
 {
 }
 
@@ -378,6 +380,8 @@ error:
   }
 #define CHECK_HISTORY(p, ...)                                      \
   {                                                                \
+    /* a copy first, whose metadata may still be a lazy log */   \
+    CheckHistory (p->Copy (), __FILE__, __LINE__, __VA_ARGS__);    \
     CheckHistory (p, __FILE__, __LINE__, __VA_ARGS__);             \
     uint32_t size = p->GetSerializedSize ();                       \
     uint8_t* buffer = new uint8_t[size];                           \
@@ -399,6 +403,7 @@ void
 PacketMetadataTest::DoRun (void)
 {
   PacketMetadata::Enable ();
+  PacketMetadata::SetLazy (m_lazy);
 
   Ptr<Packet> p = Create<Packet> (0);
   Ptr<Packet> p1 = Create<Packet> (0);
@@ -821,6 +826,35 @@ PacketMetadataTest::DoRun (void)
                                  p3->GetSize ());
   delete [] buf;
   NS_TEST_EXPECT_MSG_EQ (msg, std::string ("hello world"), "Could not find original data in received packet");
+
+  // the headers and trailers of an appended packet are not the last
+  // ones added to the packet
+  p1 = Create<Packet> (10);
+  ADD_HEADER (p1, 5);
+  p2 = Create<Packet> (20);
+  ADD_HEADER (p2, 5);
+  p1->AddAtEnd (p2);
+  REM_HEADER (p1, 5);
+  ADD_HEADER (p1, 2);
+  CHECK_HISTORY (p1, 4, 2, 10, 5, 20);
+
+  p1 = Create<Packet> (10);
+  ADD_HEADER (p1, 5);
+  p2 = Create<Packet> (20);
+  ADD_HEADER (p2, 3);
+  p1->AddAtEnd (p2);
+  p1->RemoveAtStart (5);
+  CHECK_HISTORY (p1, 3, 10, 3, 20);
+
+  p1 = Create<Packet> (10);
+  ADD_TRAILER (p1, 6);
+  p2 = Create<Packet> (20);
+  ADD_TRAILER (p2, 4);
+  p1->AddAtEnd (p2);
+  p1->RemoveAtEnd (4);
+  ADD_TRAILER (p1, 2);
+  CHECK_HISTORY (p1, 4, 10, 6, 20, 2);
+  PacketMetadata::SetLazy (false);
 }
 //-----------------------------------------------------------------------------
 class PacketMetadataTestSuite : public TestSuite
@@ -832,7 +866,8 @@ public:
 PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
-  AddTestCase (new PacketMetadataTest, TestCase::QUICK);
+  AddTestCase (new PacketMetadataTest (false), TestCase::QUICK);
+  AddTestCase (new PacketMetadataTest (true), TestCase::QUICK);
 }
 
 PacketMetadataTestSuite g_packetMetadataTest;
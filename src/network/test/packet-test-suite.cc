@@ -451,6 +451,33 @@ PacketTest::DoRun (void)
     CHECK (tmp, 1, E (20, 1, 1001));
 #endif
   }
+
+  {
+    // a deep copy keeps the bytes, the tags and the uid of the packet,
+    // spilled packet tags included
+    Ptr<Packet> tmp = Create<Packet> (reinterpret_cast<const uint8_t*> ("hello"), 5);
+    tmp->AddByteTag (ATestTag<20> ());
+    tmp->AddHeader (ATestHeader<2> ());
+    tmp->AddPacketTag (ATestTag<1> (1));
+    tmp->AddPacketTag (ATestTag<2> (2));
+    tmp->AddPacketTag (ATestTag<3> (3));
+    tmp->AddPacketTag (ATestTag<4> (4));
+    tmp->AddPacketTag (ATestTag<5> (5));
+    Ptr<Packet> copy = tmp->Copy ();
+    Ptr<Packet> deep = copy->DeepCopy ();
+    NS_TEST_EXPECT_MSG_EQ (deep->GetUid (), tmp->GetUid (), "Wrong uid");
+    NS_TEST_EXPECT_MSG_EQ (deep->GetSize (), 7, "Wrong size");
+    CHECK (deep, 1, E (20, 2, 7));
+    uint8_t data[7];
+    deep->CopyData (data, 7);
+    NS_TEST_EXPECT_MSG_EQ (std::string (reinterpret_cast<const char *> (data + 2), 5), "hello", "Wrong data");
+    ATestTag<5> t5;
+    NS_TEST_EXPECT_MSG_EQ (deep->PeekPacketTag (t5), true, "Missing spilled tag");
+    NS_TEST_EXPECT_MSG_EQ (t5.GetData (), 5, "Wrong spilled tag");
+    ATestTag<1> t1;
+    deep->RemovePacketTag (t1);
+    NS_TEST_EXPECT_MSG_EQ (tmp->PeekPacketTag (t1), true, "Tag removed from the original");
+  }
 }
 //--------------------------------------
 class PacketTagListTest : public TestCase
@@ -674,6 +701,40 @@ PacketTagListTest::DoRun (void)
     ReplaceCheck (6);
     ReplaceCheck (7);
   }
+
+  { // Iteration
+    std::cout << GetName () << "check iteration over inline and spilled tags"
+              << std::endl;
+    Ptr<Packet> p = Create<Packet> ();
+    p->AddPacketTag (t1);
+    p->AddPacketTag (t2);
+    p->AddPacketTag (t3);
+    p->AddPacketTag (t4);
+    p->AddPacketTag (t5);
+    p->AddPacketTag (t6);
+    Ptr<Packet> copy = p->Copy ();
+    copy->AddPacketTag (t7);
+    p->RemovePacketTag (t5);
+    int n = 0;
+    PacketTagIterator i = copy->GetPacketTagIterator ();
+    while (i.HasNext ())
+      {
+        i.Next ();
+        n++;
+      }
+    NS_TEST_EXPECT_MSG_EQ (n, tagLast, "iteration over the copy");
+    n = 0;
+    i = p->GetPacketTagIterator ();
+    while (i.HasNext ())
+      {
+        NS_TEST_EXPECT_MSG_NE (i.Next ().GetTypeId (), t5.GetTypeId (),
+                               "removed tag still present");
+        n++;
+      }
+    NS_TEST_EXPECT_MSG_EQ (n, 5, "iteration over the original");
+    NS_TEST_EXPECT_MSG_EQ (copy->PeekPacketTag (t5), true,
+                           "spilled tag removed from the copy");
+  }
   
   { // Timing
     std::cout << GetName () << "add+remove timing" << std::endl;
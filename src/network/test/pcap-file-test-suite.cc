@@ -21,10 +21,19 @@
 #include <cstdlib>
 #include <sstream>
 #include <cstring>
+#include <vector>
+#include <fstream>
+#include <unistd.h>
 
 #include "ns3/log.h"
 #include "ns3/test.h"
 #include "ns3/pcap-file.h"
+#include "ns3/pcap-file-wrapper.h"
+#include "ns3/pcap-mapped-file.h"
+#include "ns3/packet.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
 
 using namespace ns3;
 
@@ -1120,6 +1129,378 @@ DiffTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (usec, 3696, "Files are different from 2.3696 seconds");
 }
 
+// ===========================================================================
+// Test case to make sure that the asynchronous writer of PcapFileWrapper
+// writes the same file as PcapFile, and drops whole records when asked to.
+// ===========================================================================
+class AsyncWriteTestCase : public TestCase
+{
+public:
+  AsyncWriteTestCase ();
+
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+  Ptr<PcapFileWrapper> CreateWrapper (std::string filename, bool asynchronous,
+                                      PcapAsyncWriter::Backpressure backpressure);
+  void WritePacket (Ptr<PcapFileWrapper> file, uint32_t i);
+  void WritePackets (Ptr<PcapFileWrapper> file);
+
+  std::string m_syncFilename;
+  std::string m_asyncFilename;
+  std::vector<std::string> m_sharedFilenames;
+};
+
+static const uint32_t N_ASYNC_FILES = 3;
+
+static const uint32_t N_ASYNC_PACKETS = 3000;
+
+AsyncWriteTestCase::AsyncWriteTestCase ()
+  : TestCase ("Check that the asynchronous writer of PcapFileWrapper writes the same file as PcapFile")
+{
+}
+
+void
+AsyncWriteTestCase::DoSetup (void)
+{
+  std::stringstream filename;
+  uint32_t n = rand ();
+  filename << n;
+  m_syncFilename = CreateTempDirFilename (filename.str () + "-sync.pcap");
+  m_asyncFilename = CreateTempDirFilename (filename.str () + "-async.pcap");
+  for (uint32_t i = 0; i < N_ASYNC_FILES; i++)
+    {
+      std::stringstream shared;
+      shared << filename.str () << "-shared-" << i << ".pcap";
+      m_sharedFilenames.push_back (CreateTempDirFilename (shared.str ()));
+    }
+}
+
+void
+AsyncWriteTestCase::DoTeardown (void)
+{
+  if (remove (m_syncFilename.c_str ()))
+    {
+      NS_LOG_ERROR ("Failed to delete file " << m_syncFilename);
+    }
+  if (remove (m_asyncFilename.c_str ()))
+    {
+      NS_LOG_ERROR ("Failed to delete file " << m_asyncFilename);
+    }
+  for (uint32_t i = 0; i < m_sharedFilenames.size (); i++)
+    {
+      if (remove (m_sharedFilenames[i].c_str ()))
+        {
+          NS_LOG_ERROR ("Failed to delete file " << m_sharedFilenames[i]);
+        }
+    }
+  m_sharedFilenames.clear ();
+}
+
+Ptr<PcapFileWrapper>
+AsyncWriteTestCase::CreateWrapper (std::string filename, bool asynchronous,
+                                   PcapAsyncWriter::Backpressure backpressure)
+{
+  Ptr<PcapFileWrapper> file = CreateObject<PcapFileWrapper> ();
+  file->SetAttribute ("Asynchronous", BooleanValue (asynchronous));
+  // the smallest buffer, so that it wraps around and fills up
+  file->SetAttribute ("BufferSize", UintegerValue (1));
+  file->SetAttribute ("Backpressure", EnumValue (backpressure));
+  file->SetAttribute ("CaptureSize", UintegerValue (1000));
+  file->Open (filename, std::ios::out);
+  file->Init (1);
+  return file;
+}
+
+void
+AsyncWriteTestCase::WritePacket (Ptr<PcapFileWrapper> file, uint32_t i)
+{
+  uint8_t data[1500];
+  for (uint32_t j = 0; j < sizeof (data); j++)
+    {
+      data[j] = j;
+    }
+  Time t = MicroSeconds (1000 * i + 7);
+  if (i % 3 == 0)
+    {
+      file->Write (t, data + i % 17, (i * 7) % 1500);
+    }
+  else
+    {
+      file->Write (t, Create<Packet> (data + i % 13, (i * 11) % 1500));
+    }
+}
+
+void
+AsyncWriteTestCase::WritePackets (Ptr<PcapFileWrapper> file)
+{
+  for (uint32_t i = 0; i < N_ASYNC_PACKETS; i++)
+    {
+      WritePacket (file, i);
+    }
+}
+
+void
+AsyncWriteTestCase::DoRun (void)
+{
+  Ptr<PcapFileWrapper> file = CreateWrapper (m_syncFilename, false, PcapAsyncWriter::BLOCK);
+  WritePackets (file);
+  file->Close ();
+
+  file = CreateWrapper (m_asyncFilename, true, PcapAsyncWriter::BLOCK);
+  NS_TEST_ASSERT_MSG_EQ (file->Fail (), false, "Init of the asynchronous writer returns error");
+  NS_TEST_ASSERT_MSG_EQ (file->GetSnapLen (), 1000, "Wrong snaplen");
+  WritePackets (file);
+  file->Close ();
+  NS_TEST_ASSERT_MSG_EQ (file->Fail (), false, "Asynchronous writes return error");
+  NS_TEST_ASSERT_MSG_EQ (file->GetDroppedPackets (), 0, "Packets dropped while blocking");
+
+  uint32_t sec (0), usec (0);
+  bool diff = PcapFile::Diff (m_syncFilename, m_asyncFilename, sec, usec);
+  NS_TEST_ASSERT_MSG_EQ (diff, false, "Asynchronous file differs from " << sec << "." << usec << " seconds");
+
+  //
+  // The files open at the same time share the background thread, and
+  // are closed in another order than they were opened.
+  //
+  std::vector<Ptr<PcapFileWrapper> > files;
+  for (uint32_t i = 0; i < N_ASYNC_FILES; i++)
+    {
+      files.push_back (CreateWrapper (m_sharedFilenames[i], true, PcapAsyncWriter::BLOCK));
+    }
+  for (uint32_t i = 0; i < N_ASYNC_PACKETS; i++)
+    {
+      for (uint32_t j = 0; j < files.size (); j++)
+        {
+          WritePacket (files[j], i);
+        }
+    }
+  for (uint32_t j = 0; j < files.size (); j++)
+    {
+      files[(j + 1) % files.size ()]->Close ();
+    }
+  for (uint32_t j = 0; j < files.size (); j++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (files[j]->Fail (), false, "Asynchronous writes return error");
+      diff = PcapFile::Diff (m_syncFilename, m_sharedFilenames[j], sec, usec);
+      NS_TEST_ASSERT_MSG_EQ (diff, false, "Shared file " << j << " differs from " << sec << "." << usec << " seconds");
+    }
+
+  //
+  // When the records are dropped, the file holds the others in order.
+  //
+  file = CreateWrapper (m_asyncFilename, true, PcapAsyncWriter::DROP);
+  WritePackets (file);
+  file->Close ();
+
+  PcapFile f;
+  f.Open (m_asyncFilename, std::ios::in);
+  NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Open (" << m_asyncFilename << ", \"std::ios::in\") returns error");
+  uint8_t data[1000];
+  uint32_t tsSec, tsUsec, inclLen, origLen, readLen;
+  uint32_t records = 0;
+  uint64_t last = 0;
+  while (true)
+    {
+      f.Read (data, sizeof (data), tsSec, tsUsec, inclLen, origLen, readLen);
+      if (f.Eof ())
+        {
+          break;
+        }
+      NS_TEST_ASSERT_MSG_EQ (f.Fail (), false, "Read() of asynchronous file returns error");
+      uint64_t us = tsSec * 1000000ULL + tsUsec;
+      NS_TEST_ASSERT_MSG_EQ ((us > last), true, "Records out of order");
+      NS_TEST_ASSERT_MSG_EQ (inclLen, std::min<uint32_t> (origLen, 1000), "Record not truncated to the snaplen");
+      last = us;
+      records++;
+    }
+  f.Close ();
+  NS_TEST_ASSERT_MSG_EQ (records + file->GetDroppedPackets (), N_ASYNC_PACKETS, "Records lost");
+}
+
+// ===========================================================================
+// Test case to make sure that PcapMappedFile reads the same records as
+// PcapFile, seeks by time, saves its index, and merges files in order.
+// ===========================================================================
+class MappedFileTestCase : public TestCase
+{
+public:
+  MappedFileTestCase ();
+
+private:
+  virtual void DoSetup (void);
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  std::string m_testFilename[2];
+};
+
+MappedFileTestCase::MappedFileTestCase ()
+  : TestCase ("Check that PcapMappedFile reads, seeks and merges pcap files")
+{
+}
+
+void
+MappedFileTestCase::DoSetup (void)
+{
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      std::stringstream filename;
+      uint32_t n = rand ();
+      filename << n << "-" << i;
+      m_testFilename[i] = CreateTempDirFilename (filename.str () + ".pcap");
+    }
+}
+
+void
+MappedFileTestCase::DoTeardown (void)
+{
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      if (remove (m_testFilename[i].c_str ()))
+        {
+          NS_LOG_ERROR ("Failed to delete file " << m_testFilename[i]);
+        }
+      remove (PcapMappedFile::GetIndexFilename (m_testFilename[i]).c_str ());
+    }
+}
+
+void
+MappedFileTestCase::DoRun (void)
+{
+  //
+  // The known good file reads the same through both classes.
+  //
+  std::string filename = CreateDataDirFilename ("known.pcap");
+  PcapMappedFile mapped;
+  NS_TEST_ASSERT_MSG_EQ (mapped.Open (filename), true, "Open (" << filename << ") returns error");
+  NS_TEST_ASSERT_MSG_EQ (mapped.GetNRecords (), N_KNOWN_PACKETS, "Wrong number of records");
+
+  PcapFile f;
+  f.Open (filename, std::ios::in);
+  NS_TEST_ASSERT_MSG_EQ (mapped.GetSnapLen (), f.GetSnapLen (), "Wrong snaplen");
+  NS_TEST_ASSERT_MSG_EQ (mapped.GetDataLinkType (), f.GetDataLinkType (), "Wrong data link type");
+  uint8_t data[2000];
+  uint32_t tsSec, tsUsec, inclLen, origLen, readLen;
+  for (uint32_t i = 0; i < N_KNOWN_PACKETS; ++i)
+    {
+      f.Read (data, sizeof (data), tsSec, tsUsec, inclLen, origLen, readLen);
+      PcapMappedFile::Record record = mapped.GetRecord (i);
+      NS_TEST_ASSERT_MSG_EQ (record.tsSec, tsSec, "Wrong seconds timestamp");
+      NS_TEST_ASSERT_MSG_EQ (record.tsUsec, tsUsec, "Wrong microseconds timestamp");
+      NS_TEST_ASSERT_MSG_EQ (record.inclLen, inclLen, "Wrong included length");
+      NS_TEST_ASSERT_MSG_EQ (record.origLen, origLen, "Wrong original length");
+      NS_TEST_ASSERT_MSG_EQ (std::memcmp (record.data, data, inclLen), 0, "Wrong packet data");
+      NS_TEST_ASSERT_MSG_EQ (mapped.GetTimestamp (i), tsSec * 1000000000ULL + tsUsec * 1000ULL, "Wrong timestamp");
+    }
+  f.Close ();
+
+  NS_TEST_ASSERT_MSG_EQ (mapped.Seek (0), 0, "Seek before the first record");
+  NS_TEST_ASSERT_MSG_EQ (mapped.Seek (2003801000ULL), 2, "Seek to the timestamp of a record");
+  NS_TEST_ASSERT_MSG_EQ (mapped.Seek (2003801001ULL), 3, "Seek between two records");
+  NS_TEST_ASSERT_MSG_EQ (mapped.Seek (3000000000ULL), N_KNOWN_PACKETS, "Seek after the last record");
+  mapped.Close ();
+
+  //
+  // Two files, one with a record every 2 ms, the other every 3 ms.
+  //
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      PcapFile out;
+      out.Open (m_testFilename[i], std::ios::out);
+      out.Init (1);
+      for (uint32_t j = 0; j < 100; j++)
+        {
+          uint8_t byte = i;
+          out.Write (0, j * (i + 2) * 1000, &byte, 1);
+        }
+      out.Close ();
+    }
+
+  PcapMappedFile files[2];
+  NS_TEST_ASSERT_MSG_EQ (files[0].Open (m_testFilename[0], true), true, "Open returns error");
+  NS_TEST_ASSERT_MSG_EQ (CheckFileExists (PcapMappedFile::GetIndexFilename (m_testFilename[0])), true,
+                         "Index not saved");
+  files[0].Close ();
+  NS_TEST_ASSERT_MSG_EQ (files[0].Open (m_testFilename[0]), true, "Open with a saved index returns error");
+  NS_TEST_ASSERT_MSG_EQ (files[0].GetNRecords (), 100, "Wrong number of records from the saved index");
+  NS_TEST_ASSERT_MSG_EQ (files[0].Seek (11000000), 6, "Wrong seek with the saved index");
+  NS_TEST_ASSERT_MSG_EQ (files[1].Open (m_testFilename[1]), true, "Open returns error");
+
+  std::vector<PcapMappedFile const *> merged;
+  merged.push_back (&files[0]);
+  merged.push_back (&files[1]);
+  uint32_t n = 0;
+  uint64_t last = 0;
+  for (PcapMergeIterator it (merged); !it.IsEnd (); it.Next ())
+    {
+      PcapMappedFile::Record record = it.GetRecord ();
+      NS_TEST_ASSERT_MSG_EQ ((it.GetTimestamp () >= last), true, "Records out of order");
+      NS_TEST_ASSERT_MSG_EQ ((uint32_t)record.data[0], it.GetFile (), "Record of the wrong file");
+      if (n > 0 && it.GetTimestamp () == last)
+        {
+          NS_TEST_ASSERT_MSG_EQ (it.GetFile (), 1, "Records with the same timestamp not in the order of the files");
+        }
+      last = it.GetTimestamp ();
+      n++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (n, 200, "Records missing from the merge");
+
+  PcapMergeIterator it (merged, 250000000);
+  NS_TEST_ASSERT_MSG_EQ (it.GetTimestamp (), 252000000, "Wrong first record of a merge from a timestamp");
+  NS_TEST_ASSERT_MSG_EQ (it.GetFile (), 1, "Wrong first file of a merge from a timestamp");
+  files[0].Close ();
+  files[1].Close ();
+
+  //
+  // A saved index which does not match the records is not used.
+  //
+  std::string indexFilename = PcapMappedFile::GetIndexFilename (m_testFilename[0]);
+  std::fstream index (indexFilename.c_str (), std::ios::in | std::ios::out | std::ios::binary);
+  uint64_t lastOffset;
+  index.seekg (-(int)sizeof (lastOffset), std::ios::end);
+  index.read ((char *)&lastOffset, sizeof (lastOffset));
+  lastOffset++;
+  index.seekp (-(int)sizeof (lastOffset), std::ios::end);
+  index.write ((char const *)&lastOffset, sizeof (lastOffset));
+  index.close ();
+  NS_TEST_ASSERT_MSG_EQ (files[0].Open (m_testFilename[0]), true, "Open with a corrupted index returns error");
+  NS_TEST_ASSERT_MSG_EQ (files[0].GetNRecords (), 100, "Wrong number of records with a corrupted index");
+  NS_TEST_ASSERT_MSG_EQ (files[0].GetTimestamp (99), 198000000, "Wrong last record with a corrupted index");
+  files[0].Close ();
+
+  //
+  // A truncated last record is still compared, as far as it goes.
+  //
+  PcapFile out;
+  out.Open (m_testFilename[1], std::ios::out);
+  out.Init (1);
+  uint8_t bytes[100] = { 0 };
+  for (uint32_t j = 0; j < 100; j++)
+    {
+      out.Write (0, j * 2000, bytes, 1);
+    }
+  out.Write (0, 200000, bytes, sizeof (bytes));
+  out.Close ();
+  NS_TEST_ASSERT_MSG_EQ (truncate (m_testFilename[1].c_str (), 24 + 101 * 16 + 100 + 50), 0, "Unable to truncate");
+  NS_TEST_ASSERT_MSG_EQ (files[1].Open (m_testFilename[1]), true, "Open of a truncated file returns error");
+  NS_TEST_ASSERT_MSG_EQ (files[1].GetNRecords (), 100, "Truncated record indexed");
+  PcapMappedFile::Record truncated;
+  uint32_t available;
+  NS_TEST_ASSERT_MSG_EQ (files[1].GetTruncatedRecord (truncated, available), true, "Truncated record not found");
+  NS_TEST_ASSERT_MSG_EQ (available, 50, "Wrong number of bytes of the truncated record");
+  files[1].Close ();
+  uint32_t sec (0), usec (0);
+  NS_TEST_ASSERT_MSG_EQ (PcapFile::Diff (m_testFilename[0], m_testFilename[1], sec, usec, 16), true,
+                         "Truncated record not compared");
+  NS_TEST_ASSERT_MSG_EQ (usec, 200000, "Wrong timestamp of the difference");
+  NS_TEST_ASSERT_MSG_EQ (PcapFile::Diff (m_testFilename[1], m_testFilename[1], sec, usec, 16), false,
+                         "Truncated record differs from itself");
+  NS_TEST_ASSERT_MSG_EQ (PcapFile::Diff (m_testFilename[0], m_testFilename[1], sec, usec), false,
+                         "Record truncated before the bytes compared");
+}
+
 class PcapFileTestSuite : public TestSuite
 {
 public:
@@ -1137,6 +1518,8 @@ PcapFileTestSuite::PcapFileTestSuite ()
   AddTestCase (new RecordHeaderTestCase, TestCase::QUICK);
   AddTestCase (new ReadFileTestCase, TestCase::QUICK);
   AddTestCase (new DiffTestCase, TestCase::QUICK);
+  AddTestCase (new AsyncWriteTestCase, TestCase::QUICK);
+  AddTestCase (new MappedFileTestCase, TestCase::QUICK);
 }
 
 static PcapFileTestSuite pcapFileTestSuite;
@@ -0,0 +1,234 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/slab-allocator.h"
+#include "ns3/buffer.h"
+#include "ns3/packet.h"
+#include "ns3/test.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#endif /* HAVE_PTHREAD_H */
+#include <cstring>
+
+using namespace ns3;
+
+static const uint32_t g_sizes[] = { 64, 256, 1024 };
+
+//-----------------------------------------------------------------------------
+class SlabAllocatorTest : public TestCase
+{
+public:
+  SlabAllocatorTest ();
+private:
+  virtual void DoRun (void);
+};
+
+SlabAllocatorTest::SlabAllocatorTest ()
+  : TestCase ("Check size classes, recycling and statistics")
+{
+}
+
+void
+SlabAllocatorTest::DoRun (void)
+{
+  SlabAllocator allocator ("test", g_sizes, 3);
+  uint32_t capacity;
+
+  void *a = allocator.Allocate (10, capacity);
+  NS_TEST_ASSERT_MSG_EQ (capacity, 64, "Request not rounded up to the smallest class");
+  std::memset (a, 0xaa, capacity);
+  allocator.Deallocate (a, capacity);
+  void *b = allocator.Allocate (64, capacity);
+  NS_TEST_ASSERT_MSG_EQ (b, a, "Free block not recycled");
+  NS_TEST_ASSERT_MSG_EQ (capacity, 64, "Wrong class");
+
+  void *c = allocator.Allocate (65, capacity);
+  NS_TEST_ASSERT_MSG_EQ (capacity, 256, "Wrong class");
+  void *d = allocator.Allocate (5000, capacity);
+  NS_TEST_ASSERT_MSG_EQ (capacity, 5000, "Large request rounded up");
+  allocator.Deallocate (d, 5000);
+
+  std::vector<SlabAllocator::Stats> stats = allocator.GetStats ();
+  NS_TEST_ASSERT_MSG_EQ (stats.size (), 4, "Wrong number of classes");
+  NS_TEST_ASSERT_MSG_EQ (stats[0].allocations, 2, "Wrong allocation count");
+  NS_TEST_ASSERT_MSG_EQ (stats[0].misses, 1, "Wrong miss count");
+  NS_TEST_ASSERT_MSG_EQ (stats[0].inUse, 1, "Wrong number of blocks in use");
+  NS_TEST_ASSERT_MSG_EQ (stats[1].inUse, 1, "Wrong number of blocks in use");
+  NS_TEST_ASSERT_MSG_EQ (stats[3].size, 0, "Wrong size for large blocks");
+  NS_TEST_ASSERT_MSG_EQ (stats[3].inUse, 0, "Wrong number of large blocks in use");
+  NS_TEST_ASSERT_MSG_EQ (stats[3].highWater, 1, "Wrong high water of large blocks");
+
+  std::vector<void *> blocks;
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      blocks.push_back (allocator.Allocate (1000, capacity));
+    }
+  for (uint32_t i = 0; i < blocks.size (); i++)
+    {
+      allocator.Deallocate (blocks[i], 1024);
+    }
+  stats = allocator.GetStats ();
+  NS_TEST_ASSERT_MSG_EQ (stats[2].inUse, 0, "Wrong number of blocks in use");
+  NS_TEST_ASSERT_MSG_EQ (stats[2].highWater, 10, "Wrong high water");
+
+  // blocks of the old classes are still accepted after a change
+  std::vector<uint32_t> sizes;
+  sizes.push_back (128);
+  sizes.push_back (2048);
+  allocator.SetClassSizes (sizes);
+  NS_TEST_ASSERT_MSG_EQ (allocator.GetClassSizes ().size (), 2, "Wrong number of classes");
+  allocator.Deallocate (b, 64);
+  allocator.Deallocate (c, 256);
+  void *e = allocator.Allocate (100, capacity);
+  NS_TEST_ASSERT_MSG_EQ (capacity, 128, "Wrong class after a change");
+  allocator.Deallocate (e, capacity);
+}
+
+#ifdef HAVE_PTHREAD_H
+//-----------------------------------------------------------------------------
+class SlabAllocatorThreadTest : public TestCase
+{
+public:
+  SlabAllocatorThreadTest ();
+private:
+  virtual void DoRun (void);
+  void Work (void);
+};
+
+SlabAllocatorThreadTest::SlabAllocatorThreadTest ()
+  : TestCase ("Check the allocation of packets from several threads")
+{
+}
+
+void
+SlabAllocatorThreadTest::Work (void)
+{
+  for (uint32_t i = 0; i < 20000; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (i % 1500);
+      p->AddPaddingAtEnd (i % 100);
+      Ptr<Packet> fragment = p->CreateFragment (0, p->GetSize () / 2);
+    }
+}
+
+void
+SlabAllocatorThreadTest::DoRun (void)
+{
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      threads.push_back (Create<SystemThread> (MakeCallback (&SlabAllocatorThreadTest::Work, this)));
+    }
+  for (uint32_t i = 0; i < threads.size (); i++)
+    {
+      threads[i]->Start ();
+    }
+  for (uint32_t i = 0; i < threads.size (); i++)
+    {
+      threads[i]->Join ();
+    }
+  std::vector<SlabAllocator::Stats> stats = Buffer::GetDataAllocator ().GetStats ();
+  uint64_t allocations = 0;
+  for (uint32_t i = 0; i < stats.size (); i++)
+    {
+      allocations += stats[i].allocations;
+      NS_TEST_ASSERT_MSG_EQ ((stats[i].inUse <= stats[i].highWater), true, "In use above the high water");
+    }
+  NS_TEST_ASSERT_MSG_EQ ((allocations >= 80000), true, "Allocations not counted");
+}
+
+//-----------------------------------------------------------------------------
+class SlabAllocatorThreadStatsTest : public TestCase
+{
+public:
+  SlabAllocatorThreadStatsTest ();
+private:
+  virtual void DoRun (void);
+  void Work (void);
+  SlabAllocator *m_allocator;
+  std::vector<void *> m_blocks;
+};
+
+SlabAllocatorThreadStatsTest::SlabAllocatorThreadStatsTest ()
+  : TestCase ("Check the statistics of a thread which has exited")
+{
+}
+
+void
+SlabAllocatorThreadStatsTest::Work (void)
+{
+  uint32_t capacity;
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      m_blocks.push_back (m_allocator->Allocate (100, capacity));
+    }
+  for (uint32_t i = 0; i < m_blocks.size (); i++)
+    {
+      m_allocator->Deallocate (m_blocks[i], capacity);
+    }
+  m_blocks.clear ();
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      m_blocks.push_back (m_allocator->Allocate (100, capacity));
+    }
+}
+
+void
+SlabAllocatorThreadStatsTest::DoRun (void)
+{
+  SlabAllocator allocator ("test-threads", g_sizes, 3);
+  m_allocator = &allocator;
+  Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&SlabAllocatorThreadStatsTest::Work, this));
+  thread->Start ();
+  thread->Join ();
+
+  std::vector<SlabAllocator::Stats> stats = allocator.GetStats ();
+  NS_TEST_ASSERT_MSG_EQ (stats[1].allocations, 15, "Allocations of the thread lost");
+  NS_TEST_ASSERT_MSG_EQ (stats[1].misses, 10, "Misses of the thread lost");
+  NS_TEST_ASSERT_MSG_EQ (stats[1].inUse, 5, "Wrong number of blocks in use");
+  NS_TEST_ASSERT_MSG_EQ (stats[1].highWater, 10, "Wrong high water");
+
+  // blocks freed by another thread than the one which allocated them
+  for (uint32_t i = 0; i < m_blocks.size (); i++)
+    {
+      allocator.Deallocate (m_blocks[i], 256);
+    }
+  stats = allocator.GetStats ();
+  NS_TEST_ASSERT_MSG_EQ (stats[1].allocations, 15, "Wrong allocation count");
+  NS_TEST_ASSERT_MSG_EQ (stats[1].inUse, 0, "Wrong number of blocks in use");
+  NS_TEST_ASSERT_MSG_EQ (stats[1].highWater, 10, "Wrong high water");
+}
+#endif /* HAVE_PTHREAD_H */
+
+//-----------------------------------------------------------------------------
+class SlabAllocatorTestSuite : public TestSuite
+{
+public:
+  SlabAllocatorTestSuite ();
+};
+
+SlabAllocatorTestSuite::SlabAllocatorTestSuite ()
+  : TestSuite ("slab-allocator", UNIT)
+{
+  AddTestCase (new SlabAllocatorTest, TestCase::QUICK);
+#ifdef HAVE_PTHREAD_H
+  AddTestCase (new SlabAllocatorThreadTest, TestCase::QUICK);
+  AddTestCase (new SlabAllocatorThreadStatsTest, TestCase::QUICK);
+#endif /* HAVE_PTHREAD_H */
+}
+
+static SlabAllocatorTestSuite g_slabAllocatorTestSuite;
@@ -246,6 +246,20 @@ Mac48Address Mac48Address::GetMulticast (Ipv6Address addr)
   return etherAddr;
 }
 
+size_t Mac48AddressHash::operator() (Mac48Address const &x) const
+{
+  uint8_t buffer[6];
+  x.CopyTo (buffer);
+  // allocated addresses mostly differ in their last bytes, which end
+  // up in the low bits of the hash.
+  size_t hash = 0;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      hash = (hash << 8) ^ (hash >> 24) ^ buffer[i];
+    }
+  return hash;
+}
+
 std::ostream& operator<< (std::ostream& os, const Mac48Address & address)
 {
   uint8_t ad[6];
@@ -0,0 +1,896 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-simulator-impl.h"
+#include "ns3/channel.h"
+#include "ns3/channel-list.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/make-event.h"
+
+#include "ns3/ptr.h"
+#include "ns3/uinteger.h"
+#include "ns3/assert.h"
+#include "ns3/fatal-error.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+
+// Note: as in DefaultSimulatorImpl, logging in the event path is
+// avoided because of the number of calls made to these functions.
+
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+namespace {
+
+/**
+ * The simulator and the partition run by the calling thread, kept per
+ * thread since GetCurrentPartition is called by every Now and Schedule.
+ */
+__thread const MultithreadedSimulatorImpl *g_simulator = 0;
+__thread int32_t g_partition = -1;
+
+} // anonymous namespace
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("Threads",
+                   "The number of partitions, each run by its own thread.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_threads),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Lookahead",
+                   "The minimum delay of an event scheduled for another partition. "
+                   "If zero, it is derived from the channels whose nodes span partitions, "
+                   "and without such a channel the partitions must not schedule events for each other.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&MultithreadedSimulatorImpl::m_lookahead),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+  : m_global (0),
+    m_eventsWithContextEmpty (true),
+    m_stop (false),
+    m_threads (2),
+    m_currentLookahead (0),
+    m_inWindow (false),
+    m_windowEnd (0),
+    m_generation (0),
+    m_pending (0),
+    m_nextWorker (0),
+    m_exit (false)
+{
+  NS_LOG_FUNCTION (this);
+  m_main = SystemThread::Self ();
+  pthread_mutex_init (&m_barrierMutex, NULL);
+  pthread_cond_init (&m_startCond, NULL);
+  pthread_cond_init (&m_doneCond, NULL);
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+  pthread_cond_destroy (&m_doneCond);
+  pthread_cond_destroy (&m_startCond);
+  pthread_mutex_destroy (&m_barrierMutex);
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::vector<struct Partition>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      while (!i->events->IsEmpty ())
+        {
+          Scheduler::Event next = i->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      for (std::vector<Scheduler::Event>::iterator j = i->inbox.begin (); j != i->inbox.end (); ++j)
+        {
+          j->impl->Unref ();
+        }
+    }
+  m_partitions.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  m_schedulerFactory = schedulerFactory;
+  Repartition (m_threads);
+}
+
+void
+MultithreadedSimulatorImpl::Repartition (uint32_t threads)
+{
+  NS_LOG_FUNCTION (this << threads);
+  std::vector<Scheduler::Event> events;
+  uint64_t currentTs = 0;
+  uint32_t maxUid = 0;
+  for (std::vector<struct Partition>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      NS_ASSERT (i->inbox.empty ());
+      while (!i->events->IsEmpty ())
+        {
+          Scheduler::Event next = i->events->RemoveNext ();
+          maxUid = std::max (maxUid, next.key.m_uid);
+          events.push_back (next);
+        }
+      currentTs = std::max (currentTs, i->currentTs);
+    }
+  for (std::vector<Scheduler::Event>::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      // a partition which has not caught up with the others keeps
+      // events earlier than the clock of the most advanced one.
+      currentTs = std::min (currentTs, i->key.m_ts);
+    }
+
+  // uids are allocated from 4 * stride, as in DefaultSimulatorImpl
+  // uid 0 is "invalid" events
+  // uid 1 is "now" events
+  // uid 2 is "destroy" events
+  uint32_t stride = threads + 1;
+  uint32_t uid = std::max<uint32_t> (4, maxUid / stride + 1);
+  m_partitions.clear ();
+  m_partitions.resize (stride);
+  m_global = threads;
+  for (std::vector<struct Partition>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      i->events = m_schedulerFactory.Create<Scheduler> ();
+      i->uid = uid;
+      // before ::Run is entered, the currentUid will be zero
+      i->currentUid = 0;
+      i->currentTs = currentTs;
+      i->currentContext = 0xffffffff;
+      i->unscheduledEvents = 0;
+    }
+  for (std::vector<Scheduler::Event>::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      struct Partition &partition = m_partitions[GetPartition (i->key.m_context)];
+      partition.events->Insert (*i);
+      partition.unscheduledEvents++;
+    }
+}
+
+// System ID for non-distributed simulation is always zero
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context == 0xffffffff)
+    {
+      return m_global;
+    }
+  if (context < m_nodePartition.size ())
+    {
+      return m_nodePartition[context];
+    }
+  return context % m_global;
+}
+
+static uint32_t
+FindGroup (std::vector<uint32_t> &group, uint32_t node)
+{
+  while (group[node] != node)
+    {
+      group[node] = group[group[node]];
+      node = group[node];
+    }
+  return node;
+}
+
+Time
+MultithreadedSimulatorImpl::AssignPartitions (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_nodePartition.clear ();
+  Time lookahead = GetMaximumSimulationTime ();
+  uint32_t nNodes = NodeList::GetNNodes ();
+  if (nNodes == 0)
+    {
+      return lookahead;
+    }
+
+  // merge the groups of the nodes attached to the same channel, unless
+  // the channel can carry its traffic between partitions
+  std::vector<uint32_t> group (nNodes);
+  for (uint32_t i = 0; i < nNodes; ++i)
+    {
+      group[i] = i;
+    }
+  std::vector<Ptr<Channel> > split;
+  for (ChannelList::Iterator i = ChannelList::Begin (); i != ChannelList::End (); ++i)
+    {
+      Ptr<Channel> channel = *i;
+      if (channel->GetLookahead ().IsStrictlyPositive ())
+        {
+          split.push_back (channel);
+          continue;
+        }
+      uint32_t first = nNodes;
+      for (uint32_t j = 0; j < channel->GetNDevices (); ++j)
+        {
+          Ptr<NetDevice> device = channel->GetDevice (j);
+          if (device == 0 || device->GetNode () == 0)
+            {
+              continue;
+            }
+          uint32_t node = device->GetNode ()->GetId ();
+          if (first == nNodes)
+            {
+              first = node;
+              continue;
+            }
+          uint32_t a = FindGroup (group, first);
+          uint32_t b = FindGroup (group, node);
+          // the smallest node id names the group
+          group[std::max (a, b)] = std::min (a, b);
+        }
+    }
+
+  // largest groups first, each to the least loaded partition
+  std::vector<uint32_t> sizes (nNodes, 0);
+  for (uint32_t i = 0; i < nNodes; ++i)
+    {
+      sizes[FindGroup (group, i)]++;
+    }
+  std::vector<std::pair<uint32_t, uint32_t> > order;
+  for (uint32_t i = 0; i < nNodes; ++i)
+    {
+      if (sizes[i] > 0)
+        {
+          // sort by decreasing size, then by increasing node id
+          order.push_back (std::make_pair (nNodes - sizes[i], i));
+        }
+    }
+  std::sort (order.begin (), order.end ());
+  std::vector<uint32_t> load (m_threads, 0);
+  std::vector<uint32_t> groupPartition (nNodes, 0);
+  for (std::vector<std::pair<uint32_t, uint32_t> >::const_iterator i = order.begin (); i != order.end (); ++i)
+    {
+      uint32_t p = std::min_element (load.begin (), load.end ()) - load.begin ();
+      groupPartition[i->second] = p;
+      load[p] += nNodes - i->first;
+    }
+  m_nodePartition.resize (nNodes);
+  for (uint32_t i = 0; i < nNodes; ++i)
+    {
+      m_nodePartition[i] = groupPartition[FindGroup (group, i)];
+    }
+  NS_LOG_LOGIC (order.size () << " groups of nodes, largest " << nNodes - order.front ().first);
+
+  // only the channels whose nodes did end up in different partitions
+  // bound the lookahead
+  for (std::vector<Ptr<Channel> >::const_iterator i = split.begin (); i != split.end (); ++i)
+    {
+      Ptr<Channel> channel = *i;
+      channel->SetPartitions (m_nodePartition);
+      uint32_t first = m_threads;
+      for (uint32_t j = 0; j < channel->GetNDevices (); ++j)
+        {
+          Ptr<NetDevice> device = channel->GetDevice (j);
+          if (device == 0 || device->GetNode () == 0)
+            {
+              continue;
+            }
+          uint32_t p = m_nodePartition[device->GetNode ()->GetId ()];
+          if (first == m_threads)
+            {
+              first = p;
+            }
+          else if (p != first)
+            {
+              lookahead = std::min (lookahead, channel->GetLookahead ());
+              NS_LOG_LOGIC ("channel " << channel->GetId () << " spans partitions, lookahead "
+                            << channel->GetLookahead ());
+              break;
+            }
+        }
+    }
+  return lookahead;
+}
+
+int32_t
+MultithreadedSimulatorImpl::GetCurrentPartition (void) const
+{
+  if (g_simulator == this)
+    {
+      return g_partition;
+    }
+  // outside of Run, only the main thread may use the simulator
+  return SystemThread::Equals (m_main) ? m_global : -1;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::AllocateUid (uint32_t p)
+{
+  // uids of different partitions never collide, and the order of two
+  // events of the same timestamp does not depend on thread timing.
+  return m_partitions[p].uid++ * m_partitions.size () + p;
+}
+
+void
+MultithreadedSimulatorImpl::Insert (int32_t from, Scheduler::Event ev)
+{
+  uint32_t to = GetPartition (ev.key.m_context);
+  if (to == static_cast<uint32_t> (from) || !m_inWindow)
+    {
+      m_partitions[to].events->Insert (ev);
+      m_partitions[to].unscheduledEvents++;
+      return;
+    }
+  if (ev.key.m_ts < m_windowEnd)
+    {
+      NS_FATAL_ERROR ("Event for context " << ev.key.m_context << " at " << TimeStep (ev.key.m_ts)
+                      << " is earlier than the end of the window " << TimeStep (m_windowEnd)
+                      << "; set ns3::MultithreadedSimulatorImpl::Lookahead to at most the delay "
+                      << "of the events scheduled for another partition");
+    }
+  CriticalSection cs (m_inboxMutex);
+  m_partitions[to].inbox.push_back (ev);
+}
+
+void
+MultithreadedSimulatorImpl::MergeInboxes (void)
+{
+  for (std::vector<struct Partition>::iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      for (std::vector<Scheduler::Event>::const_iterator j = i->inbox.begin (); j != i->inbox.end (); ++j)
+        {
+          i->events->Insert (*j);
+          i->unscheduledEvents++;
+        }
+      i->inbox.clear ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::ProcessEventsWithContext (void)
+{
+  if (m_eventsWithContextEmpty)
+    {
+      return;
+    }
+
+  // swap queues
+  EventsWithContext eventsWithContext;
+  {
+    CriticalSection cs (m_eventsWithContextMutex);
+    m_eventsWithContext.swap (eventsWithContext);
+    m_eventsWithContextEmpty = true;
+  }
+  while (!eventsWithContext.empty ())
+    {
+      EventWithContext event = eventsWithContext.front ();
+      eventsWithContext.pop_front ();
+      struct Partition &partition = m_partitions[GetPartition (event.context)];
+      Scheduler::Event ev;
+      ev.impl = event.event;
+      ev.key.m_ts = std::max (partition.currentTs, m_partitions[m_global].currentTs) + event.timestamp;
+      ev.key.m_context = event.context;
+      ev.key.m_uid = AllocateUid (m_global);
+      partition.events->Insert (ev);
+      partition.unscheduledEvents++;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::ProcessGlobal (uint64_t ts)
+{
+  struct Partition &global = m_partitions[m_global];
+  while (!global.events->IsEmpty () && global.events->PeekNext ().key.m_ts == ts)
+    {
+      Scheduler::Event next = global.events->RemoveNext ();
+      NS_ASSERT (next.key.m_ts >= global.currentTs);
+      global.unscheduledEvents--;
+      global.currentTs = next.key.m_ts;
+      global.currentContext = next.key.m_context;
+      global.currentUid = next.key.m_uid;
+      // events scheduled from now on must sort after the current one
+      global.uid = std::max<uint32_t> (global.uid, next.key.m_uid / m_partitions.size () + 1);
+      next.impl->Invoke ();
+      next.impl->Unref ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::ProcessWindow (uint32_t p)
+{
+  struct Partition &partition = m_partitions[p];
+  while (!partition.events->IsEmpty () && partition.events->PeekNext ().key.m_ts < m_windowEnd)
+    {
+      Scheduler::Event next = partition.events->RemoveNext ();
+      NS_ASSERT (next.key.m_ts >= partition.currentTs);
+      partition.unscheduledEvents--;
+      partition.currentTs = next.key.m_ts;
+      partition.currentContext = next.key.m_context;
+      partition.currentUid = next.key.m_uid;
+      // events scheduled from now on must sort after the current one
+      partition.uid = std::max<uint32_t> (partition.uid, next.key.m_uid / m_partitions.size () + 1);
+      next.impl->Invoke ();
+      next.impl->Unref ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::RunWindow (uint64_t end)
+{
+  pthread_mutex_lock (&m_barrierMutex);
+  m_windowEnd = end;
+  m_inWindow = true;
+  m_pending = m_workers.size ();
+  m_generation++;
+  pthread_cond_broadcast (&m_startCond);
+  pthread_mutex_unlock (&m_barrierMutex);
+
+  // the main thread runs the first partition
+  g_partition = 0;
+  ProcessWindow (0);
+  g_partition = m_global;
+
+  pthread_mutex_lock (&m_barrierMutex);
+  while (m_pending > 0)
+    {
+      pthread_cond_wait (&m_doneCond, &m_barrierMutex);
+    }
+  m_inWindow = false;
+  pthread_mutex_unlock (&m_barrierMutex);
+}
+
+void
+MultithreadedSimulatorImpl::DoWork (void)
+{
+  pthread_mutex_lock (&m_barrierMutex);
+  uint32_t p = m_nextWorker++;
+  g_simulator = this;
+  g_partition = p;
+  uint32_t generation = m_generation;
+  if (--m_pending == 0)
+    {
+      pthread_cond_signal (&m_doneCond);
+    }
+  while (true)
+    {
+      while (m_generation == generation && !m_exit)
+        {
+          pthread_cond_wait (&m_startCond, &m_barrierMutex);
+        }
+      if (m_exit)
+        {
+          break;
+        }
+      generation = m_generation;
+      pthread_mutex_unlock (&m_barrierMutex);
+
+      ProcessWindow (p);
+
+      pthread_mutex_lock (&m_barrierMutex);
+      if (--m_pending == 0)
+        {
+          pthread_cond_signal (&m_doneCond);
+        }
+    }
+  pthread_mutex_unlock (&m_barrierMutex);
+}
+
+void
+MultithreadedSimulatorImpl::StartThreads (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_exit = false;
+  m_nextWorker = 1;
+  m_pending = m_global - 1;
+  for (uint32_t i = 1; i < m_global; ++i)
+    {
+      Ptr<SystemThread> thread =
+        Create<SystemThread> (MakeCallback (&MultithreadedSimulatorImpl::DoWork, this));
+      m_workers.push_back (thread);
+      thread->Start ();
+    }
+  // wait until every worker has taken its partition
+  pthread_mutex_lock (&m_barrierMutex);
+  while (m_pending > 0)
+    {
+      pthread_cond_wait (&m_doneCond, &m_barrierMutex);
+    }
+  pthread_mutex_unlock (&m_barrierMutex);
+}
+
+void
+MultithreadedSimulatorImpl::StopThreads (void)
+{
+  NS_LOG_FUNCTION (this);
+  pthread_mutex_lock (&m_barrierMutex);
+  m_exit = true;
+  pthread_cond_broadcast (&m_startCond);
+  pthread_mutex_unlock (&m_barrierMutex);
+  for (std::vector<Ptr<SystemThread> >::iterator i = m_workers.begin (); i != m_workers.end (); ++i)
+    {
+      (*i)->Join ();
+    }
+  m_workers.clear ();
+}
+
+Time
+MultithreadedSimulatorImpl::GetLookahead (void) const
+{
+  return TimeStep (m_currentLookahead);
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  for (std::vector<struct Partition>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      if (!i->events->IsEmpty ())
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  // Set the current threadId as the main threadId
+  m_main = SystemThread::Self ();
+  Time lookahead = AssignPartitions ();
+  Repartition (m_threads);
+  if (m_lookahead.IsStrictlyPositive ())
+    {
+      lookahead = std::min (lookahead, m_lookahead);
+    }
+  m_currentLookahead = lookahead.GetTimeStep ();
+  NS_LOG_LOGIC ("running " << m_threads << " partitions with lookahead " << lookahead);
+
+  ProcessEventsWithContext ();
+  m_stop = false;
+  StartThreads ();
+  g_simulator = this;
+  g_partition = m_global;
+
+  const uint64_t never = GetMaximumSimulationTime ().GetTimeStep ();
+  struct Partition &global = m_partitions[m_global];
+  while (!m_stop)
+    {
+      uint64_t next = never;
+      for (uint32_t i = 0; i < m_global; ++i)
+        {
+          if (!m_partitions[i].events->IsEmpty ())
+            {
+              next = std::min (next, m_partitions[i].events->PeekNext ().key.m_ts);
+            }
+        }
+      uint64_t nextGlobal = global.events->IsEmpty () ? never : global.events->PeekNext ().key.m_ts;
+      if (next == never && nextGlobal == never)
+        {
+          break;
+        }
+      if (nextGlobal <= next)
+        {
+          ProcessGlobal (nextGlobal);
+        }
+      else
+        {
+          uint64_t end = next < never - m_currentLookahead ? next + m_currentLookahead : never;
+          RunWindow (std::min (end, nextGlobal));
+          MergeInboxes ();
+        }
+      ProcessEventsWithContext ();
+    }
+
+  StopThreads ();
+  g_simulator = 0;
+
+  // After Run, the main thread sees the time of the most advanced partition.
+  for (uint32_t i = 0; i < m_global; ++i)
+    {
+      global.currentTs = std::max (global.currentTs, m_partitions[i].currentTs);
+    }
+
+  // If the simulator stopped naturally by lack of events, make a
+  // consistency test to check that we didn't lose any events along the way.
+  for (std::vector<struct Partition>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); ++i)
+    {
+      NS_ASSERT (!i->events->IsEmpty () || i->unscheduledEvents == 0 || m_stop);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_stop = true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop (Time const &time)
+{
+  NS_LOG_FUNCTION (this << time.GetTimeStep ());
+  int32_t p = GetCurrentPartition ();
+  NS_ASSERT_MSG (p >= 0, "Simulator::Stop Thread-unsafe invocation!");
+  Scheduler::Event ev;
+  ev.impl = MakeEvent (static_cast<void (*) (void)> (&Simulator::Stop));
+  ev.key.m_ts = m_partitions[p].currentTs + time.GetTimeStep ();
+  if (m_inWindow)
+    {
+      // the global partition only runs between two windows
+      ev.key.m_ts = std::max (ev.key.m_ts, m_windowEnd);
+    }
+  ev.key.m_context = 0xffffffff;
+  ev.key.m_uid = AllocateUid (p);
+  Insert (p, ev);
+}
+
+//
+// Schedule an event for a _relative_ time in the future.
+//
+EventId
+MultithreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << time.GetTimeStep () << event);
+  int32_t p = GetCurrentPartition ();
+  NS_ASSERT_MSG (p >= 0, "Simulator::Schedule Thread-unsafe invocation!");
+  struct Partition &partition = m_partitions[p];
+
+  Time tAbsolute = time + TimeStep (partition.currentTs);
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= TimeStep (partition.currentTs));
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+  ev.key.m_context = partition.currentContext;
+  ev.key.m_uid = AllocateUid (p);
+  Insert (p, ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+  int32_t p = GetCurrentPartition ();
+  if (p < 0)
+    {
+      EventWithContext ev;
+      ev.context = context;
+      ev.timestamp = time.GetTimeStep ();
+      ev.event = event;
+      {
+        CriticalSection cs (m_eventsWithContextMutex);
+        m_eventsWithContext.push_back (ev);
+        m_eventsWithContextEmpty = false;
+      }
+      return;
+    }
+  Time tAbsolute = time + TimeStep (m_partitions[p].currentTs);
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+  ev.key.m_context = context;
+  ev.key.m_uid = AllocateUid (p);
+  Insert (p, ev);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  int32_t p = GetCurrentPartition ();
+  NS_ASSERT_MSG (p >= 0, "Simulator::ScheduleNow Thread-unsafe invocation!");
+  struct Partition &partition = m_partitions[p];
+
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = partition.currentTs;
+  ev.key.m_context = partition.currentContext;
+  ev.key.m_uid = AllocateUid (p);
+  Insert (p, ev);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  int32_t p = GetCurrentPartition ();
+  NS_ASSERT_MSG (p >= 0, "Simulator::ScheduleDestroy Thread-unsafe invocation!");
+
+  EventId id (Ptr<EventImpl> (event, false), m_partitions[p].currentTs, 0xffffffff, 2);
+  CriticalSection cs (m_destroyEventsMutex);
+  m_destroyEvents.push_back (id);
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  int32_t p = GetCurrentPartition ();
+  return TimeStep (m_partitions[p < 0 ? m_global : p].currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs ()) - Now ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      CriticalSection cs (m_destroyEventsMutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  int32_t p = GetCurrentPartition ();
+  uint32_t owner = GetPartition (id.GetContext ());
+  if (m_inWindow && owner != static_cast<uint32_t> (p))
+    {
+      // IsExpired only lets global events through: the global
+      // scheduler may not be touched during a window, so the event
+      // stays there but will not be invoked.
+      id.PeekEventImpl ()->Cancel ();
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  m_partitions[owner].events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+
+  m_partitions[owner].unscheduledEvents--;
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0
+          || ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      CriticalSection cs (const_cast<SystemMutex &> (m_destroyEventsMutex));
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  if (ev.PeekEventImpl () == 0)
+    {
+      return true;
+    }
+  uint32_t p = GetPartition (ev.GetContext ());
+  if (m_inWindow && p != m_global && static_cast<int32_t> (p) != GetCurrentPartition ())
+    {
+      // the global partition does not run during a window, but the
+      // others run concurrently
+      NS_FATAL_ERROR ("Event of context " << ev.GetContext () << " checked or cancelled from "
+                      "another partition; partitions may only interact through ScheduleWithContext");
+    }
+  const struct Partition &owner = m_partitions[p];
+  if (ev.GetTs () < owner.currentTs
+      || (ev.GetTs () == owner.currentTs
+          && ev.GetUid () <= owner.currentUid)
+      || ev.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  int32_t p = GetCurrentPartition ();
+  return p < 0 ? 0xffffffff : m_partitions[p].currentContext;
+}
+
+} // namespace ns3
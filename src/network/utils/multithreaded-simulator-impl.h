@@ -0,0 +1,194 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#include "ns3/nstime.h"
+
+#include "ns3/ptr.h"
+
+#include <list>
+#include <vector>
+#include <pthread.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ *
+ * \brief Shared-memory parallel simulator implementation.
+ *
+ * Events are partitioned by the context attached to them, each
+ * partition owning its own scheduler. Events without a context
+ * (0xffffffff, e.g., scheduled from the main program or by
+ * Simulator::Stop) belong to a global partition which is run
+ * serially by the main thread.
+ *
+ * The nodes of a channel usually share packets and the channel state,
+ * none of which is thread-safe, so at Simulator::Run the nodes of the
+ * NodeList are grouped by the devices of the channels of the
+ * ChannelList, and every group is assigned as a whole to a partition,
+ * the largest groups first, each to the partition with the fewest
+ * nodes. A channel whose Channel::GetLookahead is positive does not
+ * group its nodes: it is told the partition of every node through
+ * Channel::SetPartitions and then hands its traffic over between
+ * partitions itself, e.g., YansWifiChannel with a MinimumDistance.
+ * Contexts which are not node ids go to partition context % Threads.
+ *
+ * The partitions advance together in conservative windows: if t is the
+ * earliest pending event of all the partitions, every partition runs,
+ * in its own thread, all its events earlier than t + Lookahead. An
+ * event scheduled for another partition is buffered and handed over at
+ * the end of the window, so it must not be scheduled earlier than the
+ * end of the window: with a delay of at least Lookahead this always
+ * holds. Global events are run once every partition has reached them,
+ * before the partition events of the same timestamp. When the
+ * Lookahead attribute is zero, the lookahead is the smallest one of
+ * the channels whose nodes ended up in different partitions; without
+ * such a channel, the partitions are taken to be independent and a
+ * window only ends at the next global event, an event scheduled for
+ * another partition being then a fatal error. A positive Lookahead
+ * attribute only ever shortens the lookahead of the channels.
+ *
+ * For a fixed number of threads, the execution is deterministic, but
+ * for the packet uids and the streams of random variables created
+ * while the simulation runs. Models must be written so that the nodes
+ * of different partitions only interact through
+ * Simulator::ScheduleWithContext, with immutable arguments: checking or
+ * cancelling an event of another partition is a fatal error.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MultithreadedSimulatorImpl ();
+  ~MultithreadedSimulatorImpl ();
+
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \returns the lookahead used by the last call to Run, the maximum
+   * simulation time if the partitions were independent.
+   */
+  Time GetLookahead (void) const;
+
+private:
+  /// The events and the clock of a partition
+  struct Partition
+  {
+    Ptr<Scheduler> events;
+    std::vector<Scheduler::Event> inbox; //!< events handed over at the end of the window
+    uint32_t uid;
+    uint32_t currentUid;
+    uint64_t currentTs;
+    uint32_t currentContext;
+    // number of events that have been inserted but not yet scheduled
+    int unscheduledEvents;
+  };
+  /// An event scheduled from a thread which is not a simulation thread
+  struct EventWithContext
+  {
+    uint32_t context;
+    uint64_t timestamp;
+    EventImpl *event;
+  };
+  typedef std::list<struct EventWithContext> EventsWithContext;
+  typedef std::list<EventId> DestroyEvents;
+
+  virtual void DoDispose (void);
+  uint32_t GetPartition (uint32_t context) const;
+  /**
+   * \returns the partition run by the calling thread, the global
+   * partition for the main thread outside of a window, or -1 for a
+   * thread unknown to the simulator.
+   */
+  int32_t GetCurrentPartition (void) const;
+  /**
+   * Group the nodes connected by a channel and assign every group to
+   * a partition.
+   *
+   * \returns the smallest lookahead of the channels whose nodes span
+   * partitions, the maximum simulation time if there is none.
+   */
+  Time AssignPartitions (void);
+  void Repartition (uint32_t threads);
+  void Insert (int32_t from, Scheduler::Event ev);
+  uint32_t AllocateUid (uint32_t p);
+  void ProcessEventsWithContext (void);
+  void ProcessGlobal (uint64_t ts);
+  void ProcessWindow (uint32_t p);
+  void RunWindow (uint64_t end);
+  void MergeInboxes (void);
+  void StartThreads (void);
+  void StopThreads (void);
+  void DoWork (void);
+
+  std::vector<struct Partition> m_partitions;
+  uint32_t m_global; //!< index of the global partition
+  std::vector<uint32_t> m_nodePartition; //!< partition of each node context
+  ObjectFactory m_schedulerFactory;
+  DestroyEvents m_destroyEvents;
+  SystemMutex m_destroyEventsMutex;
+  EventsWithContext m_eventsWithContext;
+  bool m_eventsWithContextEmpty;
+  SystemMutex m_eventsWithContextMutex;
+  SystemMutex m_inboxMutex;
+  bool m_stop;
+
+  uint32_t m_threads;
+  Time m_lookahead;
+  uint64_t m_currentLookahead;
+
+  SystemThread::ThreadId m_main;
+  std::vector<Ptr<SystemThread> > m_workers;
+  bool m_inWindow;
+  uint64_t m_windowEnd;
+  pthread_mutex_t m_barrierMutex;
+  pthread_cond_t m_startCond;
+  pthread_cond_t m_doneCond;
+  uint32_t m_generation;
+  uint32_t m_pending;
+  uint32_t m_nextWorker;
+  bool m_exit;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
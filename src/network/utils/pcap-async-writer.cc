@@ -0,0 +1,547 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/buffer.h"
+#include "ns3/header.h"
+#include "ns3/packet.h"
+#include "ns3/core-config.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <time.h>
+#include "ns3/system-thread.h"
+#endif /* HAVE_PTHREAD_H */
+#include "pcap-async-writer.h"
+
+NS_LOG_COMPONENT_DEFINE ("PcapAsyncWriter");
+
+namespace ns3 {
+
+#ifdef HAVE_PTHREAD_H
+/**
+ * \brief The background thread shared by all the open writers
+ *
+ * The writers are linked through m_nextWriter.  They are added at the
+ * head of the list by Add, and unlinked only by the thread itself, so
+ * that the thread walks the list without holding the mutex while it
+ * writes.  The thread is started with the first writer and stops with
+ * the last one.  Every wait is a loop on its predicate under the mutex.
+ */
+class PcapAsyncWriter::WriterThread
+{
+public:
+  /// \param writer a writer which was just opened
+  static void Add (PcapAsyncWriter *writer);
+  /**
+   * Wait until all the records of a writer are written and the thread
+   * has let it go.
+   * \param writer a writer being closed
+   */
+  static void Remove (PcapAsyncWriter *writer);
+  /// Make the thread look at the queues of the writers
+  static void Wake (void);
+  /**
+   * \param writer a writer
+   * \param size the number of bytes needed in the queue of writer
+   */
+  static void WaitForRoom (PcapAsyncWriter *writer, uint32_t size);
+
+private:
+  /// The loop of the thread
+  static void Run (void);
+
+  static pthread_mutex_t m_mutex;       //!< protects the members below
+  static pthread_cond_t m_dataReady;    //!< signalled when m_wake is set
+  static pthread_cond_t m_progress;     //!< broadcast when the thread made room, let a writer go or stops
+  static PcapAsyncWriter *m_writers;    //!< the writers served
+  static bool m_wake;                   //!< set when the queues must be written without waiting
+  static bool m_stopping;               //!< set from the time the thread stops until it is joined
+  static Ptr<SystemThread> m_thread;    //!< the thread, 0 when stopped
+};
+
+pthread_mutex_t PcapAsyncWriter::WriterThread::m_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t PcapAsyncWriter::WriterThread::m_dataReady = PTHREAD_COND_INITIALIZER;
+pthread_cond_t PcapAsyncWriter::WriterThread::m_progress = PTHREAD_COND_INITIALIZER;
+PcapAsyncWriter *PcapAsyncWriter::WriterThread::m_writers = 0;
+bool PcapAsyncWriter::WriterThread::m_wake = false;
+bool PcapAsyncWriter::WriterThread::m_stopping = false;
+Ptr<SystemThread> PcapAsyncWriter::WriterThread::m_thread;
+
+void
+PcapAsyncWriter::WriterThread::Add (PcapAsyncWriter *writer)
+{
+  NS_LOG_FUNCTION (writer);
+  pthread_mutex_lock (&m_mutex);
+  // the thread which served the last writers must be joined first
+  while (m_stopping)
+    {
+      pthread_cond_wait (&m_progress, &m_mutex);
+    }
+  writer->m_nextWriter = m_writers;
+  m_writers = writer;
+  if (m_thread == 0)
+    {
+      m_thread = Create<SystemThread> (MakeCallback (&WriterThread::Run));
+      m_thread->Start ();
+    }
+  pthread_mutex_unlock (&m_mutex);
+}
+
+void
+PcapAsyncWriter::WriterThread::Remove (PcapAsyncWriter *writer)
+{
+  NS_LOG_FUNCTION (writer);
+  pthread_mutex_lock (&m_mutex);
+  writer->m_closing = true;
+  m_wake = true;
+  pthread_cond_signal (&m_dataReady);
+  while (!writer->m_closed)
+    {
+      pthread_cond_wait (&m_progress, &m_mutex);
+    }
+  Ptr<SystemThread> thread;
+  if (m_stopping)
+    {
+      // this was the last writer: the thread has left its loop
+      thread = m_thread;
+      m_thread = 0;
+    }
+  pthread_mutex_unlock (&m_mutex);
+  if (thread != 0)
+    {
+      thread->Join ();
+      pthread_mutex_lock (&m_mutex);
+      m_stopping = false;
+      pthread_cond_broadcast (&m_progress);
+      pthread_mutex_unlock (&m_mutex);
+    }
+}
+
+void
+PcapAsyncWriter::WriterThread::Wake (void)
+{
+  pthread_mutex_lock (&m_mutex);
+  m_wake = true;
+  pthread_cond_signal (&m_dataReady);
+  pthread_mutex_unlock (&m_mutex);
+}
+
+void
+PcapAsyncWriter::WriterThread::WaitForRoom (PcapAsyncWriter *writer, uint32_t size)
+{
+  pthread_mutex_lock (&m_mutex);
+  m_wake = true;
+  pthread_cond_signal (&m_dataReady);
+  while (!writer->HasRoom (size))
+    {
+      pthread_cond_wait (&m_progress, &m_mutex);
+    }
+  pthread_mutex_unlock (&m_mutex);
+}
+
+void
+PcapAsyncWriter::WriterThread::Run (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  pthread_mutex_lock (&m_mutex);
+  while (true)
+    {
+      if (!m_wake)
+        {
+          struct timespec deadline;
+          clock_gettime (CLOCK_REALTIME, &deadline);
+          uint64_t ns = deadline.tv_nsec + FLUSH_INTERVAL_NS;
+          deadline.tv_sec += ns / 1000000000;
+          deadline.tv_nsec = ns % 1000000000;
+          while (!m_wake
+                 && pthread_cond_timedwait (&m_dataReady, &m_mutex, &deadline) != ETIMEDOUT)
+            {
+            }
+        }
+      m_wake = false;
+      PcapAsyncWriter *writers = m_writers;
+      pthread_mutex_unlock (&m_mutex);
+
+      uint64_t written = 0;
+      for (PcapAsyncWriter *writer = writers; writer != 0; writer = writer->m_nextWriter)
+        {
+          written += writer->WriteBuffered ();
+        }
+
+      pthread_mutex_lock (&m_mutex);
+      bool progress = written > 0;
+      // the records committed before Close are visible once m_closing is
+      PcapAsyncWriter **i = &m_writers;
+      while (*i != 0)
+        {
+          PcapAsyncWriter *writer = *i;
+          if (writer->m_closing && writer->IsFlushed ())
+            {
+              *i = writer->m_nextWriter;
+              writer->m_closed = true;
+              progress = true;
+            }
+          else
+            {
+              i = &writer->m_nextWriter;
+            }
+        }
+      if (m_writers == 0)
+        {
+          m_stopping = true;
+          pthread_cond_broadcast (&m_progress);
+          break;
+        }
+      if (progress)
+        {
+          pthread_cond_broadcast (&m_progress);
+        }
+      if (written > 0)
+        {
+          // more records may have been committed in the meantime
+          m_wake = true;
+        }
+    }
+  pthread_mutex_unlock (&m_mutex);
+}
+#endif /* HAVE_PTHREAD_H */
+
+PcapAsyncWriter::PcapAsyncWriter ()
+  : m_fd (-1),
+    m_snapLen (0),
+    m_backpressure (BLOCK),
+    m_capacity (0),
+    m_first (0),
+    m_last (0),
+    m_head (0),
+    m_tail (0),
+    m_put (0),
+    m_dropped (0),
+    m_failed (false),
+    m_closing (false),
+    m_closed (false),
+    m_nextWriter (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PcapAsyncWriter::~PcapAsyncWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+bool
+PcapAsyncWriter::Open (std::string const &filename, uint32_t snapLen,
+                       uint32_t bufferSize, enum Backpressure backpressure)
+{
+  NS_LOG_FUNCTION (this << filename << snapLen << bufferSize << backpressure);
+  NS_ASSERT_MSG (m_fd == -1, "PcapAsyncWriter::Open(): Already open");
+
+  m_fd = open (filename.c_str (), O_WRONLY | O_APPEND);
+  if (m_fd == -1)
+    {
+      NS_LOG_WARN ("Unable to open " << filename << ": " << std::strerror (errno));
+      return false;
+    }
+  m_snapLen = snapLen;
+  m_backpressure = backpressure;
+  m_capacity = bufferSize < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE : bufferSize;
+  m_first = new Chunk;
+  m_first->next = 0;
+  m_last = m_first;
+  m_head = 0;
+  m_tail = 0;
+  m_put = 0;
+  m_dropped = 0;
+  m_failed = false;
+  m_closing = false;
+  m_closed = false;
+#ifdef HAVE_PTHREAD_H
+  WriterThread::Add (this);
+#endif /* HAVE_PTHREAD_H */
+  return true;
+}
+
+void
+PcapAsyncWriter::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_fd == -1)
+    {
+      return;
+    }
+#ifdef HAVE_PTHREAD_H
+  WriterThread::Remove (this);
+#else /* HAVE_PTHREAD_H */
+  while (WriteBuffered () > 0)
+    {
+    }
+#endif /* HAVE_PTHREAD_H */
+  close (m_fd);
+  m_fd = -1;
+  while (m_first != 0)
+    {
+      Chunk *next = m_first->next;
+      delete m_first;
+      m_first = next;
+    }
+  m_last = 0;
+  if (m_dropped > 0)
+    {
+      NS_LOG_WARN ("Dropped " << m_dropped << " records because the buffer was full");
+    }
+}
+
+bool
+PcapAsyncWriter::IsOpen (void) const
+{
+  return m_fd != -1;
+}
+
+bool
+PcapAsyncWriter::Fail (void) const
+{
+  return __atomic_load_n (&m_failed, __ATOMIC_RELAXED);
+}
+
+uint64_t
+PcapAsyncWriter::GetDroppedRecords (void) const
+{
+  return m_dropped;
+}
+
+void
+PcapAsyncWriter::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const *data, uint32_t totalLen)
+{
+  NS_LOG_FUNCTION (this << tsSec << tsUsec << &data << totalLen);
+  uint32_t inclLen;
+  if (BeginRecord (tsSec, tsUsec, totalLen, inclLen))
+    {
+      Put (data, inclLen);
+      Commit ();
+    }
+}
+
+void
+PcapAsyncWriter::Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << tsSec << tsUsec << p);
+  uint32_t inclLen;
+  if (BeginRecord (tsSec, tsUsec, p->GetSize (), inclLen))
+    {
+      Put (p, inclLen);
+      Commit ();
+    }
+}
+
+void
+PcapAsyncWriter::Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << tsSec << tsUsec << &header << p);
+  uint32_t headerSize = header.GetSerializedSize ();
+  uint32_t inclLen;
+  if (!BeginRecord (tsSec, tsUsec, headerSize + p->GetSize (), inclLen))
+    {
+      return;
+    }
+  Buffer headerBuffer;
+  headerBuffer.AddAtStart (headerSize);
+  header.Serialize (headerBuffer.Begin ());
+  uint32_t toCopy = std::min (headerSize, inclLen);
+  m_scratch.resize (toCopy);
+  headerBuffer.CopyData (&m_scratch[0], toCopy);
+  Put (&m_scratch[0], toCopy);
+  Put (p, inclLen - toCopy);
+  Commit ();
+}
+
+bool
+PcapAsyncWriter::BeginRecord (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen, uint32_t &inclLen)
+{
+  NS_ASSERT_MSG (m_fd != -1, "PcapAsyncWriter::Write(): Not open");
+  inclLen = std::min (totalLen, m_snapLen);
+  uint32_t header[4] = { tsSec, tsUsec, inclLen, totalLen };
+  if (!Reserve (sizeof (header) + inclLen))
+    {
+      m_dropped++;
+      return false;
+    }
+  Put (reinterpret_cast<uint8_t const *> (header), sizeof (header));
+  return true;
+}
+
+bool
+PcapAsyncWriter::HasRoom (uint32_t size) const
+{
+  return m_capacity - (m_put - __atomic_load_n (&m_tail, __ATOMIC_ACQUIRE)) >= size;
+}
+
+bool
+PcapAsyncWriter::Reserve (uint32_t size)
+{
+  if (size > m_capacity)
+    {
+      return false;
+    }
+  while (!HasRoom (size))
+    {
+      if (m_backpressure == DROP)
+        {
+          return false;
+        }
+#ifdef HAVE_PTHREAD_H
+      WriterThread::WaitForRoom (this, size);
+#else /* HAVE_PTHREAD_H */
+      WriteBuffered ();
+#endif /* HAVE_PTHREAD_H */
+    }
+  return true;
+}
+
+void
+PcapAsyncWriter::Advance (uint32_t size)
+{
+  m_put += size;
+  if (m_put % CHUNK_SIZE == 0)
+    {
+      // linked before the bytes which follow are committed
+      Chunk *chunk = new Chunk;
+      chunk->next = 0;
+      m_last->next = chunk;
+      m_last = chunk;
+    }
+}
+
+void
+PcapAsyncWriter::Put (uint8_t const *data, uint32_t size)
+{
+  while (size > 0)
+    {
+      uint32_t offset = m_put % CHUNK_SIZE;
+      uint32_t n = std::min (size, CHUNK_SIZE - offset);
+      std::memcpy (m_last->data + offset, data, n);
+      data += n;
+      size -= n;
+      Advance (n);
+    }
+}
+
+void
+PcapAsyncWriter::Put (Ptr<const Packet> p, uint32_t size)
+{
+  uint32_t offset = m_put % CHUNK_SIZE;
+  if (size <= CHUNK_SIZE - offset)
+    {
+      // the common case: the packet is copied once, straight into the chunk
+      p->CopyData (m_last->data + offset, size);
+      Advance (size);
+    }
+  else
+    {
+      m_scratch.resize (size);
+      p->CopyData (&m_scratch[0], size);
+      Put (&m_scratch[0], size);
+    }
+}
+
+void
+PcapAsyncWriter::Commit (void)
+{
+  uint64_t threshold = m_capacity / 4;
+  uint64_t tail = __atomic_load_n (&m_tail, __ATOMIC_ACQUIRE);
+  bool wake = m_head - tail < threshold && m_put - tail >= threshold;
+  __atomic_store_n (&m_head, m_put, __ATOMIC_RELEASE);
+  if (wake)
+    {
+#ifdef HAVE_PTHREAD_H
+      WriterThread::Wake ();
+#else /* HAVE_PTHREAD_H */
+      WriteBuffered ();
+#endif /* HAVE_PTHREAD_H */
+    }
+}
+
+bool
+PcapAsyncWriter::IsFlushed (void) const
+{
+  return __atomic_load_n (&m_head, __ATOMIC_ACQUIRE) == m_tail;
+}
+
+uint32_t
+PcapAsyncWriter::WriteBuffered (void)
+{
+  uint64_t tail = m_tail;
+  uint64_t head = __atomic_load_n (&m_head, __ATOMIC_ACQUIRE);
+  if (head == tail)
+    {
+      return 0;
+    }
+  // the chunks which follow m_first are linked before head is committed
+  struct iovec iov[16];
+  int n = 0;
+  Chunk *chunk = m_first;
+  uint64_t position = tail;
+  while (position < head && n < 16)
+    {
+      uint32_t offset = position % CHUNK_SIZE;
+      uint32_t size = std::min<uint64_t> (head - position, CHUNK_SIZE - offset);
+      iov[n].iov_base = chunk->data + offset;
+      iov[n].iov_len = size;
+      n++;
+      position += size;
+      if (position % CHUNK_SIZE == 0 && position < head)
+        {
+          chunk = chunk->next;
+        }
+    }
+  ssize_t written = writev (m_fd, iov, n);
+  if (written < 0)
+    {
+      if (errno == EINTR)
+        {
+          return 0;
+        }
+      if (!Fail ())
+        {
+          NS_LOG_WARN ("Unable to write pcap records: " << std::strerror (errno));
+        }
+      // discard the records, so that the writing thread never waits forever
+      __atomic_store_n (&m_failed, true, __ATOMIC_RELAXED);
+      written = head - tail;
+    }
+  // free the chunks written entirely: the calling thread fills later ones
+  uint64_t start = tail - tail % CHUNK_SIZE;
+  while (tail + written >= start + CHUNK_SIZE)
+    {
+      Chunk *next = m_first->next;
+      delete m_first;
+      m_first = next;
+      start += CHUNK_SIZE;
+    }
+  __atomic_store_n (&m_tail, tail + written, __ATOMIC_RELEASE);
+  return written;
+}
+
+} // namespace ns3
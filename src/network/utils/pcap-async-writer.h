@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PCAP_ASYNC_WRITER_H
+#define PCAP_ASYNC_WRITER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+class Packet;
+class Header;
+
+/**
+ * \brief Append the records of a pcap file from a background thread
+ *
+ * The records are formatted by the calling thread into a queue of
+ * fixed-size chunks, which a background thread hands to the file in
+ * large write calls.  A single background thread serves all the open
+ * writers.  The queue of a writer has a single producer and a single
+ * consumer and takes no lock: writing a record costs the copy of its
+ * bytes.  The chunks are allocated as the queue grows and freed once
+ * written, so that an idle writer holds a single chunk.
+ *
+ * When a record does not fit in the queue, the calling thread either
+ * waits for the background thread to make room (BLOCK) or drops the
+ * record (DROP).  Either way, the memory used is bounded by the size
+ * given to Open.
+ *
+ * The file header must have been written before Open is called, and the
+ * records are written in the byte order of the host.  Without thread
+ * support, the queue is written from the calling thread whenever it
+ * holds a quarter of its size.
+ */
+class PcapAsyncWriter
+{
+public:
+  /// What to do with a record which does not fit in the queue
+  enum Backpressure
+  {
+    BLOCK,  //!< wait until the background thread has made room
+    DROP    //!< drop the record
+  };
+
+  PcapAsyncWriter ();
+  ~PcapAsyncWriter ();
+
+  /**
+   * \param filename the pcap file to append records to
+   * \param snapLen the maximum length of the packet data of a record
+   * \param bufferSize the largest number of bytes queued, raised to
+   *        MIN_BUFFER_SIZE if smaller
+   * \param backpressure what to do with a record which does not fit in the queue
+   * \returns false if the file could not be opened
+   */
+  bool Open (std::string const &filename, uint32_t snapLen,
+             uint32_t bufferSize, enum Backpressure backpressure);
+  /**
+   * Wait for the background thread to write the records left in the
+   * queue, and close the file.  The thread stops with the last writer.
+   */
+  void Close (void);
+  /**
+   * \returns true if the file is open
+   */
+  bool IsOpen (void) const;
+  /**
+   * \returns true if the file could not be written to.  The records
+   *          written since are discarded.
+   */
+  bool Fail (void) const;
+  /**
+   * \returns the number of records dropped because the queue was full
+   */
+  uint64_t GetDroppedRecords (void) const;
+
+  /**
+   * \param tsSec seconds part of the timestamp
+   * \param tsUsec microseconds part of the timestamp
+   * \param data the packet data
+   * \param totalLen the length of data
+   */
+  void Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const *data, uint32_t totalLen);
+  /**
+   * \param tsSec seconds part of the timestamp
+   * \param tsUsec microseconds part of the timestamp
+   * \param p the packet
+   */
+  void Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p);
+  /**
+   * \param tsSec seconds part of the timestamp
+   * \param tsUsec microseconds part of the timestamp
+   * \param header a header to write before the packet
+   * \param p the packet
+   */
+  void Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Packet> p);
+
+private:
+  /// smallest size of the queue: two records of the largest snaplen
+  static const uint32_t MIN_BUFFER_SIZE = 1 << 17;
+  /// size of the chunks of the queue
+  static const uint32_t CHUNK_SIZE = 1 << 14;
+  /// longest time the background thread sleeps before looking at the queues
+  static const uint64_t FLUSH_INTERVAL_NS = 100000000;
+
+  /// A piece of the queue of records
+  struct Chunk
+  {
+    Chunk *next;                //!< the chunk which follows, set by the calling thread
+    uint8_t data[CHUNK_SIZE];   //!< the bytes of the records
+  };
+  class WriterThread;
+
+  PcapAsyncWriter (const PcapAsyncWriter &);
+  PcapAsyncWriter &operator = (const PcapAsyncWriter &);
+
+  /**
+   * Start a record and make room for it in the queue
+   * \param tsSec seconds part of the timestamp
+   * \param tsUsec microseconds part of the timestamp
+   * \param totalLen the length of the packet
+   * \param inclLen the length of packet data to put in the record
+   * \returns false if the record was dropped
+   */
+  bool BeginRecord (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen, uint32_t &inclLen);
+  /**
+   * \param size the number of bytes needed
+   * \returns true if the queue has room for size more bytes
+   */
+  bool HasRoom (uint32_t size) const;
+  /**
+   * Wait for room in the queue, or not, depending on the backpressure
+   * \param size the number of bytes needed
+   * \returns true if the queue has room for size more bytes
+   */
+  bool Reserve (uint32_t size);
+  /**
+   * Count bytes put in the last chunk, and append a new chunk to the
+   * queue once it is full.
+   * \param size the number of bytes
+   */
+  void Advance (uint32_t size);
+  /**
+   * Copy bytes after the last ones put in the queue.
+   * \param data the bytes
+   * \param size the number of bytes
+   */
+  void Put (uint8_t const *data, uint32_t size);
+  /**
+   * Copy the first bytes of a packet after the last ones put in the queue.
+   * \param p the packet
+   * \param size the number of bytes
+   */
+  void Put (Ptr<const Packet> p, uint32_t size);
+  /// Hand the bytes put in the queue to the background thread.
+  void Commit (void);
+  /**
+   * Write the bytes committed to the queue to the file, and free the
+   * chunks written.
+   * \returns the number of bytes consumed
+   */
+  uint32_t WriteBuffered (void);
+  /// \returns true if all the bytes committed have been written
+  bool IsFlushed (void) const;
+
+  int m_fd;                           //!< the file, -1 when closed
+  uint32_t m_snapLen;                 //!< maximum length of the packet data of a record
+  enum Backpressure m_backpressure;   //!< what to do when the queue is full
+  uint32_t m_capacity;                //!< largest number of bytes queued
+  Chunk *m_first;                     //!< the chunk being written to the file
+  Chunk *m_last;                      //!< the chunk being filled
+  uint64_t m_head;                    //!< bytes committed, written by the calling thread
+  uint64_t m_tail;                    //!< bytes written to the file, written by the background thread
+  uint64_t m_put;                     //!< bytes put in the queue, committed or not
+  uint64_t m_dropped;                 //!< number of records dropped
+  bool m_failed;                      //!< set when a write to the file failed
+  bool m_closing;                     //!< set when the background thread must let the writer go
+  bool m_closed;                      //!< set when the background thread has let the writer go
+  PcapAsyncWriter *m_nextWriter;      //!< the next writer served by the background thread
+  std::vector<uint8_t> m_scratch;     //!< room for data which spans two chunks
+};
+
+} // namespace ns3
+
+#endif /* PCAP_ASYNC_WRITER_H */
@@ -18,6 +18,8 @@
 
 #include "ns3/log.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/buffer.h"
 #include "ns3/header.h"
 #include "pcap-file-wrapper.h"
@@ -39,12 +41,33 @@ PcapFileWrapper::GetTypeId (void)
                    UintegerValue (PcapFile::SNAPLEN_DEFAULT),
                    MakeUintegerAccessor (&PcapFileWrapper::m_snapLen),
                    MakeUintegerChecker<uint32_t> (0, PcapFile::SNAPLEN_DEFAULT))
+    .AddAttribute ("Asynchronous",
+                   "Write the packets to the file from a background thread",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PcapFileWrapper::m_asynchronous),
+                   MakeBooleanChecker ())
+    .AddAttribute ("BufferSize",
+                   "Largest number of bytes of packets waiting to be written "
+                   "by the background thread",
+                   UintegerValue (1 << 20),
+                   MakeUintegerAccessor (&PcapFileWrapper::m_bufferSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Backpressure",
+                   "What to do with a packet which does not fit in the buffer "
+                   "of the background thread",
+                   EnumValue (PcapAsyncWriter::BLOCK),
+                   MakeEnumAccessor (&PcapFileWrapper::m_backpressure),
+                   MakeEnumChecker (PcapAsyncWriter::BLOCK, "Block",
+                                    PcapAsyncWriter::DROP, "Drop"))
   ;
   return tid;
 }
 
 
 PcapFileWrapper::PcapFileWrapper ()
+  : m_asynchronous (false),
+    m_bufferSize (0),
+    m_backpressure (PcapAsyncWriter::BLOCK)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -60,7 +83,7 @@ bool
 PcapFileWrapper::Fail (void) const
 {
   NS_LOG_FUNCTION (this);
-  return m_file.Fail ();
+  return m_file.Fail () || m_writer.Fail ();
 }
 bool 
 PcapFileWrapper::Eof (void) const
@@ -79,13 +102,22 @@ void
 PcapFileWrapper::Close (void)
 {
   NS_LOG_FUNCTION (this);
-  m_file.Close ();
+  if (m_writer.IsOpen ())
+    {
+      // the file itself was closed by Init
+      m_writer.Close ();
+    }
+  else
+    {
+      m_file.Close ();
+    }
 }
 
 void
 PcapFileWrapper::Open (std::string const &filename, std::ios::openmode mode)
 {
   NS_LOG_FUNCTION (this << filename << mode);
+  m_filename = filename;
   m_file.Open (filename, mode);
 }
 
@@ -106,6 +138,23 @@ PcapFileWrapper::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t tzCorrec
     {
       m_file.Init (dataLinkType, m_snapLen, tzCorrection);
     } 
+
+  if (m_asynchronous && !m_file.Fail ())
+    {
+      //
+      // The file header is written: the records are appended by the
+      // asynchronous writer, through a file descriptor of its own.  The
+      // file is closed here to flush the header before any record.
+      //
+      if (m_writer.Open (m_filename, m_file.GetSnapLen (), m_bufferSize, m_backpressure))
+        {
+          m_file.Close ();
+        }
+      else
+        {
+          NS_LOG_WARN ("Writing " << m_filename << " synchronously");
+        }
+    }
 }
 
 void
@@ -116,7 +165,14 @@ PcapFileWrapper::Write (Time t, Ptr<const Packet> p)
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
 
-  m_file.Write (s, us, p);
+  if (m_writer.IsOpen ())
+    {
+      m_writer.Write (s, us, p);
+    }
+  else
+    {
+      m_file.Write (s, us, p);
+    }
 }
 
 void
@@ -127,7 +183,14 @@ PcapFileWrapper::Write (Time t, Header &header, Ptr<const Packet> p)
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
 
-  m_file.Write (s, us, header, p);
+  if (m_writer.IsOpen ())
+    {
+      m_writer.Write (s, us, header, p);
+    }
+  else
+    {
+      m_file.Write (s, us, header, p);
+    }
 }
 
 void
@@ -138,7 +201,14 @@ PcapFileWrapper::Write (Time t, uint8_t const *buffer, uint32_t length)
   uint64_t s = current / 1000000;
   uint64_t us = current % 1000000;
 
-  m_file.Write (s, us, buffer, length);
+  if (m_writer.IsOpen ())
+    {
+      m_writer.Write (s, us, buffer, length);
+    }
+  else
+    {
+      m_file.Write (s, us, buffer, length);
+    }
 }
 
 uint32_t
@@ -190,4 +260,11 @@ PcapFileWrapper::GetDataLinkType (void)
   return m_file.GetDataLinkType ();
 }
 
+uint64_t
+PcapFileWrapper::GetDroppedPackets (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_writer.GetDroppedRecords ();
+}
+
 } // namespace ns3
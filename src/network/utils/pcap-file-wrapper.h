@@ -27,6 +27,7 @@
 #include "ns3/object.h"
 #include "ns3/nstime.h"
 #include "pcap-file.h"
+#include "pcap-async-writer.h"
 
 namespace ns3 {
 
@@ -35,6 +36,13 @@ namespace ns3 {
  * ns-3 interface to the low-level public methods of PcapFile.  Users are
  * encouraged to use this object instead of class ns3::PcapFile in ns-3
  * public APIs.
+ *
+ * When the "Asynchronous" attribute is set, the packets written after Init
+ * are queued, up to "BufferSize" bytes, and written to the file by a
+ * background thread shared by all the files (see ns3::PcapAsyncWriter),
+ * so that tracing many devices does not make the simulation wait for the
+ * disk.  The file is
+ * complete once the wrapper is closed or destroyed.
  */
 class PcapFileWrapper : public Object
 {
@@ -212,9 +220,20 @@ public:
    */ 
   uint32_t GetDataLinkType (void);
 
+  /**
+   * \returns the number of packets dropped because the buffer of the
+   * asynchronous writer was full
+   */
+  uint64_t GetDroppedPackets (void) const;
+
 private:
   PcapFile m_file; //!< Pcap file
   uint32_t m_snapLen; //!< max length of saved packets
+  std::string m_filename; //!< name of the file, for the asynchronous writer
+  bool m_asynchronous; //!< write the packets from a background thread
+  uint32_t m_bufferSize; //!< size of the buffer of the asynchronous writer
+  enum PcapAsyncWriter::Backpressure m_backpressure; //!< what to do when the buffer is full
+  PcapAsyncWriter m_writer; //!< asynchronous writer, open after Init
 };
 
 } // namespace ns3
@@ -20,6 +20,7 @@
 
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 #include "ns3/assert.h"
 #include "ns3/packet.h"
 #include "ns3/fatal-error.h"
@@ -27,6 +28,7 @@
 #include "ns3/header.h"
 #include "ns3/buffer.h"
 #include "pcap-file.h"
+#include "pcap-mapped-file.h"
 #include "ns3/log.h"
 //
 // This file is used as part of the ns-3 test framework, so please refrain from 
@@ -492,83 +494,93 @@ PcapFile::Read (
     }
 }
 
+namespace {
+
+/**
+ * Get a record of a file as PcapFile::Read would: after the records of
+ * the index, a truncated last record still reads if its header and the
+ * bytes to compare are in the file.
+ *
+ * \param pcap the file
+ * \param i the index of the record
+ * \param snapLen the number of bytes to compare
+ * \param record the record
+ * \param readLen the number of bytes of record to compare
+ * \returns false if the file has no such record
+ */
+bool
+GetDiffRecord (PcapMappedFile const &pcap, uint32_t i, uint32_t snapLen,
+               PcapMappedFile::Record &record, uint32_t &readLen)
+{
+  if (i < pcap.GetNRecords ())
+    {
+      record = pcap.GetRecord (i);
+      readLen = std::min (record.inclLen, snapLen);
+      return true;
+    }
+  uint32_t available;
+  if (i > pcap.GetNRecords () || !pcap.GetTruncatedRecord (record, available))
+    {
+      return false;
+    }
+  readLen = std::min (record.inclLen, snapLen);
+  return readLen <= available;
+}
+
+} // anonymous namespace
+
 bool
 PcapFile::Diff (std::string const & f1, std::string const & f2, 
                 uint32_t & sec, uint32_t & usec, 
                 uint32_t snapLen)
 {
   NS_LOG_FUNCTION (f1 << f2 << sec << usec << snapLen);
-  PcapFile pcap1, pcap2;
-  pcap1.Open (f1, std::ios::in);
-  pcap2.Open (f2, std::ios::in);
-  bool bad = pcap1.Fail () || pcap2.Fail ();
-  if (bad)
+  //
+  // The files are compared in place, mapped in memory, rather than read
+  // record by record into buffers.  The indexes saved next to them are
+  // not used: the comparison relies on nothing but the records.
+  //
+  PcapMappedFile pcap1, pcap2;
+  if (!pcap1.Open (f1, false, false) || !pcap2.Open (f2, false, false))
     {
       return true;
     }
 
-  uint8_t *data1 = new uint8_t [snapLen] ();
-  uint8_t *data2 = new uint8_t [snapLen] ();
-  uint32_t tsSec1 = 0;
-  uint32_t tsSec2 = 0;
-  uint32_t tsUsec1 = 0;
-  uint32_t tsUsec2 = 0;
-  uint32_t inclLen1 = 0;
-  uint32_t inclLen2 = 0;
-  uint32_t origLen1 = 0;
-  uint32_t origLen2 = 0;
-  uint32_t readLen1 = 0;
-  uint32_t readLen2 = 0;
-  bool diff = false;
-
-  while (!pcap1.Eof () && !pcap2.Eof ())
+  for (uint32_t i = 0; ; ++i)
     {
-      pcap1.Read (data1, snapLen, tsSec1, tsUsec1, inclLen1, origLen1, readLen1);
-      pcap2.Read (data2, snapLen, tsSec2, tsUsec2, inclLen2, origLen2, readLen2);
-
-      bool same = pcap1.Fail () == pcap2.Fail ();
-      if (!same)
-        {
-          diff = true;
-          break;
-        }
-      if (pcap1.Eof ())
+      PcapMappedFile::Record r1, r2;
+      uint32_t readLen1, readLen2;
+      bool more1 = GetDiffRecord (pcap1, i, snapLen, r1, readLen1);
+      bool more2 = GetDiffRecord (pcap2, i, snapLen, r2, readLen2);
+      if (!more1 || !more2)
         {
-          break;
+          if (more1 != more2)
+            {
+              // One of the files has more packets: report the first of them
+              sec = more1 ? r1.tsSec : r2.tsSec;
+              usec = more1 ? r1.tsUsec : r2.tsUsec;
+              return true;
+            }
+          return false;
         }
+      sec = r1.tsSec;
+      usec = r1.tsUsec;
 
-      if (tsSec1 != tsSec2 || tsUsec1 != tsUsec2)
+      if (r1.tsSec != r2.tsSec || r1.tsUsec != r2.tsUsec)
         {
-          diff = true; // Next packet timestamps do not match
-          break;
+          return true; // Next packet timestamps do not match
         }
 
       if (readLen1 != readLen2)
         {
-          diff = true; // Packet lengths do not match
-          break;
+          return true; // Packet lengths do not match
         }
 
-      if (std::memcmp (data1, data2, readLen1) != 0)
+      if (std::memcmp (r1.data, r2.data, readLen1) != 0)
         {
-          diff = true; // Packet data do not match
-          break;
+          return true; // Packet data do not match
         }
     }
-  sec = tsSec1;
-  usec = tsUsec1;
-
-  bad = pcap1.Fail () || pcap2.Fail ();
-  bool eof = pcap1.Eof () && pcap2.Eof ();
-  if (bad && !eof)
-    {
-      diff = true;
-    }
-
-  delete[] data1;
-  delete[] data2;
-
-  return diff;
 }
 
 } // namespace ns3
@@ -0,0 +1,496 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "pcap-mapped-file.h"
+
+//
+// This file is used as part of the ns-3 test framework, so please refrain from
+// adding any ns-3 specific constructs such as Packet to this file.
+//
+
+NS_LOG_COMPONENT_DEFINE ("PcapMappedFile");
+
+namespace ns3 {
+
+namespace {
+
+const uint32_t MAGIC = 0xa1b2c3d4;            /**< Magic number identifying standard pcap file format */
+const uint32_t SWAPPED_MAGIC = 0xd4c3b2a1;    /**< Looks this way if byte swapping is required */
+const uint32_t NS_MAGIC = 0xa1b23cd4;         /**< Magic number identifying nanosec resolution pcap file format */
+const uint32_t NS_SWAPPED_MAGIC = 0xd43cb2a1; /**< Looks this way if byte swapping is required */
+
+const uint16_t VERSION_MAJOR = 2;             /**< Major version of supported pcap file format */
+const uint16_t VERSION_MINOR = 4;             /**< Minor version of supported pcap file format */
+
+const uint32_t FILE_HEADER_SIZE = 24;         /**< Size of the pcap file header */
+const uint32_t RECORD_HEADER_SIZE = 16;       /**< Size of the pcap record header */
+
+const uint32_t INDEX_MAGIC = 0x70637832;      /**< Magic number identifying a saved index */
+const uint32_t INDEX_SORTED = 1;              /**< Flag of a saved index: the records are sorted */
+
+/**
+ * \brief Header of a saved index, followed by the offsets of the records
+ */
+struct IndexHeader
+{
+  uint32_t magic;       //!< INDEX_MAGIC
+  uint32_t flags;       //!< INDEX_SORTED or 0
+  uint64_t fileSize;    //!< size of the pcap file
+  int64_t mtime;        //!< modification time of the pcap file, in nanoseconds
+  int64_t ctime;        //!< status change time of the pcap file, in nanoseconds
+  uint64_t inode;       //!< inode of the pcap file
+  uint64_t nRecords;    //!< number of offsets following the header
+};
+
+} // anonymous namespace
+
+PcapMappedFile::PcapMappedFile ()
+  : m_data (0),
+    m_size (0),
+    m_mtime (0),
+    m_ctime (0),
+    m_inode (0),
+    m_swapMode (false),
+    m_nanosecond (false),
+    m_sorted (true),
+    m_snapLen (0),
+    m_type (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PcapMappedFile::~PcapMappedFile ()
+{
+  NS_LOG_FUNCTION (this);
+  Close ();
+}
+
+bool
+PcapMappedFile::Open (std::string const &filename, bool saveIndex, bool loadIndex)
+{
+  NS_LOG_FUNCTION (this << filename << saveIndex << loadIndex);
+  Close ();
+
+  int fd = open (filename.c_str (), O_RDONLY);
+  if (fd == -1)
+    {
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) == -1 || st.st_size < (off_t)FILE_HEADER_SIZE)
+    {
+      close (fd);
+      return false;
+    }
+  void *data = mmap (0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+      return false;
+    }
+  m_data = static_cast<uint8_t const *> (data);
+  m_size = st.st_size;
+  m_mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+  m_ctime = st.st_ctim.tv_sec * 1000000000LL + st.st_ctim.tv_nsec;
+  m_inode = st.st_ino;
+
+  uint32_t magic;
+  std::memcpy (&magic, m_data, sizeof (magic));
+  m_swapMode = magic == SWAPPED_MAGIC || magic == NS_SWAPPED_MAGIC;
+  m_nanosecond = magic == NS_MAGIC || magic == NS_SWAPPED_MAGIC;
+  uint16_t major, minor;
+  std::memcpy (&major, m_data + 4, sizeof (major));
+  std::memcpy (&minor, m_data + 6, sizeof (minor));
+  if (m_swapMode)
+    {
+      major = (major >> 8) | (major << 8);
+      minor = (minor >> 8) | (minor << 8);
+    }
+  if ((magic != MAGIC && magic != NS_MAGIC && !m_swapMode)
+      || major != VERSION_MAJOR || minor != VERSION_MINOR)
+    {
+      Close ();
+      return false;
+    }
+  m_snapLen = Read32 (m_data + 16);
+  m_type = Read32 (m_data + 20);
+
+  std::string indexFilename = GetIndexFilename (filename);
+  if (!loadIndex || !LoadIndex (indexFilename))
+    {
+      BuildIndex ();
+      if (saveIndex)
+        {
+          SaveIndex (indexFilename);
+        }
+    }
+  return true;
+}
+
+void
+PcapMappedFile::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data != 0)
+    {
+      munmap (const_cast<uint8_t *> (m_data), m_size);
+      m_data = 0;
+    }
+  m_size = 0;
+  m_offsets.clear ();
+}
+
+bool
+PcapMappedFile::IsOpen (void) const
+{
+  return m_data != 0;
+}
+
+uint32_t
+PcapMappedFile::GetSnapLen (void) const
+{
+  return m_snapLen;
+}
+
+uint32_t
+PcapMappedFile::GetDataLinkType (void) const
+{
+  return m_type;
+}
+
+bool
+PcapMappedFile::IsNanosecond (void) const
+{
+  return m_nanosecond;
+}
+
+uint32_t
+PcapMappedFile::GetNRecords (void) const
+{
+  return m_offsets.size ();
+}
+
+bool
+PcapMappedFile::GetTruncatedRecord (Record &record, uint32_t &available) const
+{
+  uint64_t offset = GetIndexEnd ();
+  if (offset + RECORD_HEADER_SIZE > m_size)
+    {
+      return false;
+    }
+  uint8_t const *header = m_data + offset;
+  record.tsSec = Read32 (header);
+  record.tsUsec = Read32 (header + 4);
+  record.inclLen = Read32 (header + 8);
+  record.origLen = Read32 (header + 12);
+  record.data = header + RECORD_HEADER_SIZE;
+  available = m_size - offset - RECORD_HEADER_SIZE;
+  return true;
+}
+
+PcapMappedFile::Record
+PcapMappedFile::GetRecord (uint32_t i) const
+{
+  NS_ASSERT (i < m_offsets.size ());
+  uint8_t const *header = m_data + m_offsets[i];
+  Record record;
+  record.tsSec = Read32 (header);
+  record.tsUsec = Read32 (header + 4);
+  record.inclLen = Read32 (header + 8);
+  record.origLen = Read32 (header + 12);
+  record.data = header + RECORD_HEADER_SIZE;
+  return record;
+}
+
+uint64_t
+PcapMappedFile::GetTimestamp (uint32_t i) const
+{
+  NS_ASSERT (i < m_offsets.size ());
+  return GetTimestampAt (m_offsets[i]);
+}
+
+uint32_t
+PcapMappedFile::Seek (uint64_t ns) const
+{
+  NS_LOG_FUNCTION (this << ns);
+  if (m_sorted)
+    {
+      uint32_t first = 0;
+      uint32_t last = m_offsets.size ();
+      while (first < last)
+        {
+          uint32_t middle = first + (last - first) / 2;
+          if (GetTimestampAt (m_offsets[middle]) < ns)
+            {
+              first = middle + 1;
+            }
+          else
+            {
+              last = middle;
+            }
+        }
+      return first;
+    }
+  for (uint32_t i = 0; i < m_offsets.size (); i++)
+    {
+      if (GetTimestampAt (m_offsets[i]) >= ns)
+        {
+          return i;
+        }
+    }
+  return m_offsets.size ();
+}
+
+std::string
+PcapMappedFile::GetIndexFilename (std::string const &filename)
+{
+  return filename + ".idx";
+}
+
+uint32_t
+PcapMappedFile::Read32 (uint8_t const *p) const
+{
+  // records are not aligned in the file
+  uint32_t value;
+  std::memcpy (&value, p, sizeof (value));
+  if (m_swapMode)
+    {
+      value = ((value >> 24) & 0x000000ff) | ((value >> 8) & 0x0000ff00)
+        | ((value << 8) & 0x00ff0000) | ((value << 24) & 0xff000000);
+    }
+  return value;
+}
+
+uint64_t
+PcapMappedFile::GetTimestampAt (uint64_t offset) const
+{
+  uint64_t sec = Read32 (m_data + offset);
+  uint64_t frac = Read32 (m_data + offset + 4);
+  return sec * 1000000000 + (m_nanosecond ? frac : frac * 1000);
+}
+
+uint64_t
+PcapMappedFile::GetIndexEnd (void) const
+{
+  if (m_offsets.empty ())
+    {
+      return FILE_HEADER_SIZE;
+    }
+  return m_offsets.back () + RECORD_HEADER_SIZE + Read32 (m_data + m_offsets.back () + 8);
+}
+
+void
+PcapMappedFile::BuildIndex (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_offsets.clear ();
+  m_sorted = true;
+  uint64_t last = 0;
+  uint64_t offset = FILE_HEADER_SIZE;
+  while (offset + RECORD_HEADER_SIZE <= m_size)
+    {
+      uint64_t next = offset + RECORD_HEADER_SIZE + Read32 (m_data + offset + 8);
+      if (next > m_size)
+        {
+          NS_LOG_WARN ("Last record truncated at offset " << offset);
+          break;
+        }
+      uint64_t timestamp = GetTimestampAt (offset);
+      m_sorted = m_sorted && timestamp >= last;
+      last = timestamp;
+      m_offsets.push_back (offset);
+      offset = next;
+    }
+}
+
+bool
+PcapMappedFile::LoadIndex (std::string const &filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream file (filename.c_str (), std::ios::in | std::ios::binary);
+  if (!file)
+    {
+      return false;
+    }
+  IndexHeader header;
+  file.read ((char *)&header, sizeof (header));
+  if (!file || header.magic != INDEX_MAGIC
+      || header.fileSize != m_size || header.mtime != m_mtime
+      || header.ctime != m_ctime || header.inode != m_inode)
+    {
+      NS_LOG_LOGIC ("Index " << filename << " out of date");
+      return false;
+    }
+  m_offsets.resize (header.nRecords);
+  if (header.nRecords > 0)
+    {
+      file.read ((char *)&m_offsets[0], header.nRecords * sizeof (uint64_t));
+    }
+  if (!file || !CheckIndex ())
+    {
+      NS_LOG_LOGIC ("Index " << filename << " does not match the records");
+      m_offsets.clear ();
+      return false;
+    }
+  m_sorted = (header.flags & INDEX_SORTED) != 0;
+  return true;
+}
+
+bool
+PcapMappedFile::CheckIndex (void) const
+{
+  if (m_offsets.empty ())
+    {
+      return m_size < FILE_HEADER_SIZE + RECORD_HEADER_SIZE
+        || FILE_HEADER_SIZE + RECORD_HEADER_SIZE + Read32 (m_data + FILE_HEADER_SIZE + 8) > m_size;
+    }
+  if (m_offsets.front () != FILE_HEADER_SIZE
+      || m_offsets.back () + RECORD_HEADER_SIZE > m_size)
+    {
+      return false;
+    }
+  // every record then lies in the file
+  for (uint32_t i = 1; i < m_offsets.size (); i++)
+    {
+      if (m_offsets[i] < m_offsets[i - 1] + RECORD_HEADER_SIZE)
+        {
+          return false;
+        }
+    }
+  // the last record must be whole, and BuildIndex must have stopped after it
+  uint64_t end = GetIndexEnd ();
+  if (end > m_size)
+    {
+      return false;
+    }
+  if (end + RECORD_HEADER_SIZE <= m_size
+      && end + RECORD_HEADER_SIZE + Read32 (m_data + end + 8) <= m_size)
+    {
+      return false;
+    }
+  // the first record must be followed by the second one
+  return m_offsets.size () < 2
+    || m_offsets[1] == FILE_HEADER_SIZE + RECORD_HEADER_SIZE + Read32 (m_data + FILE_HEADER_SIZE + 8);
+}
+
+void
+PcapMappedFile::SaveIndex (std::string const &filename) const
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ofstream file (filename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  IndexHeader header;
+  header.magic = INDEX_MAGIC;
+  header.flags = m_sorted ? INDEX_SORTED : 0;
+  header.fileSize = m_size;
+  header.mtime = m_mtime;
+  header.ctime = m_ctime;
+  header.inode = m_inode;
+  header.nRecords = m_offsets.size ();
+  file.write ((const char *)&header, sizeof (header));
+  if (!m_offsets.empty ())
+    {
+      file.write ((const char *)&m_offsets[0], m_offsets.size () * sizeof (uint64_t));
+    }
+  if (!file)
+    {
+      NS_LOG_WARN ("Unable to save the index " << filename);
+    }
+}
+
+bool
+PcapMergeIterator::Entry::operator > (const Entry &o) const
+{
+  if (timestamp != o.timestamp)
+    {
+      return timestamp > o.timestamp;
+    }
+  return file > o.file;
+}
+
+PcapMergeIterator::PcapMergeIterator (std::vector<PcapMappedFile const *> const &files, uint64_t ns)
+  : m_files (files)
+{
+  NS_LOG_FUNCTION (this << files.size () << ns);
+  for (uint32_t i = 0; i < m_files.size (); i++)
+    {
+      Entry entry;
+      entry.file = i;
+      entry.index = m_files[i]->Seek (ns);
+      if (entry.index < m_files[i]->GetNRecords ())
+        {
+          entry.timestamp = m_files[i]->GetTimestamp (entry.index);
+          m_heap.push (entry);
+        }
+    }
+}
+
+bool
+PcapMergeIterator::IsEnd (void) const
+{
+  return m_heap.empty ();
+}
+
+void
+PcapMergeIterator::Next (void)
+{
+  NS_ASSERT (!m_heap.empty ());
+  Entry entry = m_heap.top ();
+  m_heap.pop ();
+  entry.index++;
+  if (entry.index < m_files[entry.file]->GetNRecords ())
+    {
+      entry.timestamp = m_files[entry.file]->GetTimestamp (entry.index);
+      m_heap.push (entry);
+    }
+}
+
+uint32_t
+PcapMergeIterator::GetFile (void) const
+{
+  NS_ASSERT (!m_heap.empty ());
+  return m_heap.top ().file;
+}
+
+uint32_t
+PcapMergeIterator::GetIndex (void) const
+{
+  NS_ASSERT (!m_heap.empty ());
+  return m_heap.top ().index;
+}
+
+uint64_t
+PcapMergeIterator::GetTimestamp (void) const
+{
+  NS_ASSERT (!m_heap.empty ());
+  return m_heap.top ().timestamp;
+}
+
+PcapMappedFile::Record
+PcapMergeIterator::GetRecord (void) const
+{
+  NS_ASSERT (!m_heap.empty ());
+  return m_files[m_heap.top ().file]->GetRecord (m_heap.top ().index);
+}
+
+} // namespace ns3
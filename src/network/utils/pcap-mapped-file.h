@@ -0,0 +1,237 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef PCAP_MAPPED_FILE_H
+#define PCAP_MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <functional>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief A read-only pcap file, mapped in memory and indexed
+ *
+ * The file is mapped in memory when it is opened, and the offsets of its
+ * records are collected in an index, which gives random access to them.
+ * The packet data of a record is read in place, without a copy.
+ *
+ * Building the index reads the header of every record.  It may be saved
+ * next to the file (see GetIndexFilename) and is then reused by the next
+ * Open, for as long as the size, the inode and the modification and
+ * status change times (to the nanosecond) of the file are unchanged, and
+ * the records it starts and ends with match the headers found there.
+ *
+ * Timestamps are counted in nanoseconds, whatever the resolution of the
+ * file.  The time searches assume that the records are in timestamp
+ * order, which is how ns-3 writes them; the index notes whether they are,
+ * and the searches fall back on a linear scan otherwise.
+ *
+ * Like PcapFile, this class is used by the test framework and depends on
+ * no other ns-3 construct.
+ */
+class PcapMappedFile
+{
+public:
+  /**
+   * \brief A view of a record of the file
+   */
+  struct Record
+  {
+    uint32_t tsSec;             //!< seconds part of the timestamp
+    uint32_t tsUsec;            //!< microseconds (nanoseconds for a nanosecond file) part of the timestamp
+    uint32_t inclLen;           //!< number of bytes of packet data in the record
+    uint32_t origLen;           //!< length of the original packet
+    uint8_t const *data;        //!< the packet data, valid until the file is closed
+  };
+
+  PcapMappedFile ();
+  ~PcapMappedFile ();
+
+  /**
+   * \param filename the pcap file
+   * \param saveIndex save the index next to the file if it had to be built
+   * \param loadIndex reuse the index saved next to the file, if any
+   * \returns false if the file could not be mapped or is not a pcap file
+   */
+  bool Open (std::string const &filename, bool saveIndex = false, bool loadIndex = true);
+  /**
+   * A last record whose data is cut short is left out of the index.
+   * \param record the view of such a record, whose data is incomplete
+   * \param available the number of bytes of packet data in the file
+   * \returns true if the file ends with such a record, header included
+   */
+  bool GetTruncatedRecord (Record &record, uint32_t &available) const;
+  /**
+   * Unmap the file.  The views of its records become invalid.
+   */
+  void Close (void);
+  /**
+   * \returns true if a file is open
+   */
+  bool IsOpen (void) const;
+
+  /**
+   * \returns the maximum length of the packet data of a record
+   */
+  uint32_t GetSnapLen (void) const;
+  /**
+   * \returns the data link type of the file
+   */
+  uint32_t GetDataLinkType (void) const;
+  /**
+   * \returns true if the timestamps of the file have a nanosecond resolution
+   */
+  bool IsNanosecond (void) const;
+
+  /**
+   * \returns the number of complete records in the file
+   */
+  uint32_t GetNRecords (void) const;
+  /**
+   * \param i the index of a record, less than GetNRecords
+   * \returns a view of the record
+   */
+  Record GetRecord (uint32_t i) const;
+  /**
+   * \param i the index of a record, less than GetNRecords
+   * \returns the timestamp of the record, in nanoseconds
+   */
+  uint64_t GetTimestamp (uint32_t i) const;
+  /**
+   * \param ns a timestamp, in nanoseconds
+   * \returns the index of the first record whose timestamp is not before
+   *          ns, or GetNRecords if there is none
+   */
+  uint32_t Seek (uint64_t ns) const;
+
+  /**
+   * \param filename a pcap file
+   * \returns the name of the file holding the saved index of filename
+   */
+  static std::string GetIndexFilename (std::string const &filename);
+
+private:
+  PcapMappedFile (const PcapMappedFile &);
+  PcapMappedFile &operator = (const PcapMappedFile &);
+
+  /**
+   * \param p four bytes of the file
+   * \returns their value, in the byte order of the host
+   */
+  uint32_t Read32 (uint8_t const *p) const;
+  /**
+   * \param offset the offset of the header of a record
+   * \returns the timestamp of the record, in nanoseconds
+   */
+  uint64_t GetTimestampAt (uint64_t offset) const;
+  /// \returns the offset which follows the last record of the index
+  uint64_t GetIndexEnd (void) const;
+  /// Build the index from the headers of the records.
+  void BuildIndex (void);
+  /// \returns true if the ends of the index match the headers of the records
+  bool CheckIndex (void) const;
+  /**
+   * \param filename the name of the saved index
+   * \returns true if a saved index up to date with the file was read
+   */
+  bool LoadIndex (std::string const &filename);
+  /**
+   * \param filename the name of the saved index
+   */
+  void SaveIndex (std::string const &filename) const;
+
+  uint8_t const *m_data;              //!< the mapped file
+  uint64_t m_size;                    //!< size of the mapped file
+  int64_t m_mtime;                    //!< modification time of the file, in nanoseconds
+  int64_t m_ctime;                    //!< status change time of the file, in nanoseconds
+  uint64_t m_inode;                   //!< inode of the file
+  bool m_swapMode;                    //!< the file is in the other byte order
+  bool m_nanosecond;                  //!< timestamps in nanoseconds
+  bool m_sorted;                      //!< the records are in timestamp order
+  uint32_t m_snapLen;                 //!< maximum length of packet data
+  uint32_t m_type;                    //!< data link type
+  std::vector<uint64_t> m_offsets;    //!< offset of the header of each record
+};
+
+/**
+ * \brief Iterate over the records of several pcap files in timestamp order
+ *
+ * Typically used to merge the per-device traces of a simulation.  The
+ * records of each file must be in timestamp order; records with the same
+ * timestamp come in the order of their files.  The files must stay open
+ * while they are iterated over.
+ */
+class PcapMergeIterator
+{
+public:
+  /**
+   * \param files the files to merge
+   * \param ns the timestamp of the first record to visit, in nanoseconds
+   */
+  PcapMergeIterator (std::vector<PcapMappedFile const *> const &files, uint64_t ns = 0);
+
+  /**
+   * \returns true when all the records have been visited
+   */
+  bool IsEnd (void) const;
+  /**
+   * Move to the next record.
+   */
+  void Next (void);
+  /**
+   * \returns the index, in the files given to the constructor, of the file
+   *          of the current record
+   */
+  uint32_t GetFile (void) const;
+  /**
+   * \returns the index of the current record in its file
+   */
+  uint32_t GetIndex (void) const;
+  /**
+   * \returns the timestamp of the current record, in nanoseconds
+   */
+  uint64_t GetTimestamp (void) const;
+  /**
+   * \returns a view of the current record
+   */
+  PcapMappedFile::Record GetRecord (void) const;
+
+private:
+  /// The next record of a file
+  struct Entry
+  {
+    uint64_t timestamp;       //!< timestamp of the record
+    uint32_t file;            //!< index of the file
+    uint32_t index;           //!< index of the record in its file
+    /**
+     * \param o another entry
+     * \returns true if this entry comes after o
+     */
+    bool operator > (const Entry &o) const;
+  };
+
+  std::vector<PcapMappedFile const *> m_files;  //!< the files
+  /// the next record of each file which has some left, earliest first
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > m_heap;
+};
+
+} // namespace ns3
+
+#endif /* PCAP_MAPPED_FILE_H */
@@ -51,6 +51,8 @@
 #include "ns3/core-module.h"
 #include "math.h"
 #include <typeinfo>
+#include <algorithm>
+#include "ns3/sgi-hashmap.h"
 #include "ns3/snr-tag.h"
 
 /********** Useful macros **********/
@@ -189,6 +191,14 @@ RoutingProtocol::GetTypeId (void)
                      MakeTraceSourceAccessor (&RoutingProtocol::m_txPacketTrace))
     .AddTraceSource ("RoutingTableChanged", "The OLSR routing table has changed.",
                      MakeTraceSourceAccessor (&RoutingProtocol::m_routingTableChanged))
+    .AddTraceSource ("NeighbourAdded", "A one-hop route to a new neighbour appeared.",
+                     MakeTraceSourceAccessor (&RoutingProtocol::m_neighbourAddedTrace))
+    .AddTraceSource ("NeighbourLost", "The one-hop route to a neighbour disappeared.",
+                     MakeTraceSourceAccessor (&RoutingProtocol::m_neighbourLostTrace))
+    .AddTraceSource ("RouteChanged", "The route to a destination was added, removed or changed.",
+                     MakeTraceSourceAccessor (&RoutingProtocol::m_routeChangedTrace))
+    .AddTraceSource ("RouteLost", "The route to a destination was removed.",
+                     MakeTraceSourceAccessor (&RoutingProtocol::m_routeLostTrace))
   ;
   return tid;
 }
@@ -196,6 +206,8 @@ RoutingProtocol::GetTypeId (void)
 
 RoutingProtocol::RoutingProtocol ()
   : m_routingTableAssociation (0),
+    m_routesDirty (ROUTES_DIRTY_HNA | ROUTES_DIRTY_TOPOLOGY | ROUTES_DIRTY_LOCAL),
+    m_localTableExpiry (Time::Max ()),
     m_ipv4 (0),
     m_helloTimer (Timer::CANCEL_ON_DESTROY),
     m_tcTimer (Timer::CANCEL_ON_DESTROY),
@@ -237,6 +249,7 @@ RoutingProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
 
 void RoutingProtocol::DoDispose ()
 {
+  m_routingTableComputationEvent.Cancel ();
   m_ipv4 = 0;
   m_hnaRoutingTable = 0;
   m_routingTableAssociation = 0;
@@ -514,68 +527,82 @@ RoutingProtocol::RecvOlsr (Ptr<Socket> socket)
     }
 
   // After processing all OLSR messages, we must recompute the routing table
-  RoutingTableComputation ();
+  ScheduleRoutingTableComputation ();
 }
 
+namespace {
 ///
-/// \brief This auxiliary function (defined in \RFC{3626}) is used for calculating the MPR Set.
+/// \brief A set of 2-hop neighbors of N2, one bit per 2-hop neighbor. This is a helper type used by MprComputation algorithm.
 ///
-/// \param tuple the neighbor tuple which has the main address of the node we are going to calculate its degree to.
-/// \return the degree of the node.
+typedef std::vector<uint64_t> TwoHopNeighborBits;
+
+inline void
+SetBit (TwoHopNeighborBits &bits, uint32_t i)
+{
+  bits[i / 64] |= uint64_t (1) << (i % 64);
+}
+
+inline bool
+IsBitSet (const TwoHopNeighborBits &bits, uint32_t i)
+{
+  return (bits[i / 64] >> (i % 64)) & 1;
+}
+
 ///
-int
-RoutingProtocol::Degree (NeighborTuple const &tuple)
+/// \brief Remove from bits the 2-hop neighbors in covered.
+///
+void
+ClearBits (TwoHopNeighborBits &bits, const TwoHopNeighborBits &covered)
 {
-  int degree = 0;
-  for (TwoHopNeighborSet::const_iterator it = m_state.GetTwoHopNeighbors ().begin ();
-       it != m_state.GetTwoHopNeighbors ().end (); it++)
+  for (uint32_t i = 0; i < bits.size (); i++)
     {
-      TwoHopNeighborTuple const &nb2hop_tuple = *it;
-      if (nb2hop_tuple.neighborMainAddr == tuple.neighborMainAddr)
-        {
-          const NeighborTuple *nb_tuple =
-            m_state.FindNeighborTuple (nb2hop_tuple.neighborMainAddr);
-          if (nb_tuple == NULL)
-            degree++;
-        }
+      bits[i] &= ~covered[i];
     }
-  return degree;
 }
 
-namespace {
-///
-/// \brief Remove all covered 2-hop neighbors from N2 set. This is a helper function used by MprComputation algorithm.
-///
-void 
-CoverTwoHopNeighbors (Ipv4Address neighborMainAddr, TwoHopNeighborSet & N2)
+bool
+IsEmpty (const TwoHopNeighborBits &bits)
 {
-  // first gather all 2-hop neighbors to be removed
-  std::set<Ipv4Address> toRemove;
-  for (TwoHopNeighborSet::iterator twoHopNeigh = N2.begin (); twoHopNeigh != N2.end (); twoHopNeigh++)
+  for (uint32_t i = 0; i < bits.size (); i++)
     {
-      if (twoHopNeigh->neighborMainAddr == neighborMainAddr)
+      if (bits[i] != 0)
         {
-          toRemove.insert (twoHopNeigh->twoHopNeighborAddr);
+          return false;
         }
     }
-  // Now remove all matching records from N2
-  for (TwoHopNeighborSet::iterator twoHopNeigh = N2.begin (); twoHopNeigh != N2.end (); )
+  return true;
+}
+
+///
+/// \return the number of 2-hop neighbors both in a and in b.
+///
+uint32_t
+CountCommonBits (const TwoHopNeighborBits &a, const TwoHopNeighborBits &b)
+{
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < a.size (); i++)
     {
-      if (toRemove.find (twoHopNeigh->twoHopNeighborAddr) != toRemove.end ())
+      uint64_t word = a[i] & b[i];
+#ifdef __GNUC__
+      count += __builtin_popcountll (word);
+#else
+      for (; word != 0; word &= word - 1)
         {
-          twoHopNeigh = N2.erase (twoHopNeigh);
-        }
-      else
-        {
-          twoHopNeigh++;
+          count++;
         }
+#endif
     }
+  return count;
 }
 } // anonymous namespace
 
 ///
 /// \brief Computates MPR set of a node following \RFC{3626} hints.
 ///
+/// The 2-hop neighbors of N2 are numbered, and the nodes of N each cover
+/// a set of them, kept as a bitset: the 2-hop neighbors still to cover
+/// and the reachability of a node are then computed a word at a time.
+///
 void
 RoutingProtocol::MprComputation ()
 {
@@ -588,11 +615,14 @@ RoutingProtocol::MprComputation ()
   // N is the subset of neighbors of the node, which are
   // neighbor "of the interface I"
   NeighborSet N;
+  // main address -> position in N of the first node with this address
+  sgi::hash_map<Ipv4Address, uint32_t, Ipv4AddressHash> firstInN;
   for (NeighborSet::const_iterator neighbor = m_state.GetNeighbors ().begin ();
        neighbor != m_state.GetNeighbors ().end (); neighbor++)
     {
       if (neighbor->status == NeighborTuple::STATUS_SYM) // I think that we need this check
         {
+          firstInN.insert (std::make_pair (neighbor->neighborMainAddr, uint32_t (N.size ())));
           N.push_back (*neighbor);
         }
     }
@@ -616,25 +646,9 @@ RoutingProtocol::MprComputation ()
 
       //  excluding:
       // (i)   the nodes only reachable by members of N with willingness WILL_NEVER
-      bool ok = false;
-      for (NeighborSet::const_iterator neigh = N.begin ();
-           neigh != N.end (); neigh++)
-        {
-          if (neigh->neighborMainAddr == twoHopNeigh->neighborMainAddr)
-            {
-              if (neigh->willingness == OLSR_WILL_NEVER)
-                {
-                  ok = false;
-                  break;
-                }
-              else
-                {
-                  ok = true;
-                  break;
-                }
-            }
-        }
-      if (!ok)
+      sgi::hash_map<Ipv4Address, uint32_t, Ipv4AddressHash>::const_iterator neigh =
+        firstInN.find (twoHopNeigh->neighborMainAddr);
+      if (neigh == firstInN.end () || N[neigh->second].willingness == OLSR_WILL_NEVER)
         {
           continue;
         }
@@ -642,20 +656,12 @@ RoutingProtocol::MprComputation ()
       // excluding:
       // (iii) all the symmetric neighbors: the nodes for which there exists a symmetric
       //       link to this node on some interface.
-      for (NeighborSet::const_iterator neigh = N.begin ();
-           neigh != N.end (); neigh++)
+      if (firstInN.find (twoHopNeigh->twoHopNeighborAddr) != firstInN.end ())
         {
-          if (neigh->neighborMainAddr == twoHopNeigh->twoHopNeighborAddr)
-            {
-              ok = false;
-              break;
-            }
+          continue;
         }
 
-      if (ok)
-        {
-          N2.push_back (*twoHopNeigh);
-        }
+      N2.push_back (*twoHopNeigh);
     }
 
 #ifdef NS3_LOG_ENABLE
@@ -676,78 +682,127 @@ RoutingProtocol::MprComputation ()
   }
 #endif  //NS3_LOG_ENABLE
 
+  // Number the 2-hop neighbors of N2, and gather the 2-hop neighbors
+  // covered by each node of N, the node which is the only one to
+  // cover each of them, if any, and the tuples of N2 which repeat
+  // another (each counts in the reachability of its node)
+  sgi::hash_map<Ipv4Address, uint32_t, Ipv4AddressHash> bitOf;
+  std::vector<Ipv4Address> twoHopAddrs;
+  for (TwoHopNeighborSet::const_iterator twoHopNeigh = N2.begin (); twoHopNeigh != N2.end (); twoHopNeigh++)
+    {
+      if (bitOf.insert (std::make_pair (twoHopNeigh->twoHopNeighborAddr, uint32_t (twoHopAddrs.size ()))).second)
+        {
+          twoHopAddrs.push_back (twoHopNeigh->twoHopNeighborAddr);
+        }
+    }
+  const uint32_t nWords = (twoHopAddrs.size () + 63) / 64;
+  // the nodes of N with the same address share the coverage of the first of them
+  std::vector<TwoHopNeighborBits> coverage (N.size (), TwoHopNeighborBits (nWords, 0));
+  std::vector<std::vector<uint32_t> > repeated (N.size ());
+  const int32_t NO_PROVIDER = -1;
+  const int32_t SEVERAL_PROVIDERS = -2;
+  std::vector<int32_t> provider (twoHopAddrs.size (), NO_PROVIDER);
+  for (TwoHopNeighborSet::const_iterator twoHopNeigh = N2.begin (); twoHopNeigh != N2.end (); twoHopNeigh++)
+    {
+      uint32_t n = firstInN[twoHopNeigh->neighborMainAddr];
+      uint32_t bit = bitOf[twoHopNeigh->twoHopNeighborAddr];
+      if (IsBitSet (coverage[n], bit))
+        {
+          repeated[n].push_back (bit);
+        }
+      else
+        {
+          SetBit (coverage[n], bit);
+        }
+      if (provider[bit] == NO_PROVIDER)
+        {
+          provider[bit] = n;
+        }
+      else if (provider[bit] != int32_t (n))
+        {
+          provider[bit] = SEVERAL_PROVIDERS;
+        }
+    }
+  std::vector<uint32_t> coverageOf (N.size ());
+  for (uint32_t i = 0; i < N.size (); i++)
+    {
+      coverageOf[i] = firstInN[N[i].neighborMainAddr];
+    }
+
+  // the 2-hop neighbors of N2 not yet covered by a node in the MPR set
+  TwoHopNeighborBits uncovered (nWords, 0);
+  for (uint32_t bit = 0; bit < twoHopAddrs.size (); bit++)
+    {
+      SetBit (uncovered, bit);
+    }
+
   // 1. Start with an MPR set made of all members of N with
   // N_willingness equal to WILL_ALWAYS
-  for (NeighborSet::const_iterator neighbor = N.begin (); neighbor != N.end (); neighbor++)
+  for (uint32_t i = 0; i < N.size (); i++)
     {
-      if (neighbor->willingness == OLSR_WILL_ALWAYS)
+      if (N[i].willingness == OLSR_WILL_ALWAYS)
         {
-          mprSet.insert (neighbor->neighborMainAddr);
+          mprSet.insert (N[i].neighborMainAddr);
           // (not in RFC but I think is needed: remove the 2-hop
           // neighbors reachable by the MPR from N2)
-          CoverTwoHopNeighbors (neighbor->neighborMainAddr, N2);
+          ClearBits (uncovered, coverage[coverageOf[i]]);
         }
     }
 
   // 2. Calculate D(y), where y is a member of N, for all nodes in N.
-  // (we do this later)
+  std::vector<int> degree (N.size (), 0);
+  {
+    // D(y) counts the 2-hop tuples of y whose neighbor is not in the
+    // neighbor set
+    sgi::hash_map<Ipv4Address, int, Ipv4AddressHash> unknown;
+    for (TwoHopNeighborSet::const_iterator twoHopNeigh = m_state.GetTwoHopNeighbors ().begin ();
+         twoHopNeigh != m_state.GetTwoHopNeighbors ().end (); twoHopNeigh++)
+      {
+        if (m_state.FindNeighborTuple (twoHopNeigh->neighborMainAddr) == NULL)
+          {
+            unknown[twoHopNeigh->neighborMainAddr]++;
+          }
+      }
+    for (uint32_t i = 0; i < N.size () && !unknown.empty (); i++)
+      {
+        sgi::hash_map<Ipv4Address, int, Ipv4AddressHash>::const_iterator it =
+          unknown.find (N[i].neighborMainAddr);
+        if (it != unknown.end ())
+          {
+            degree[i] = it->second;
+          }
+      }
+  }
 
   // 3. Add to the MPR set those nodes in N, which are the *only*
   // nodes to provide reachability to a node in N2.
-  std::set<Ipv4Address> coveredTwoHopNeighbors;
-  for (TwoHopNeighborSet::const_iterator twoHopNeigh = N2.begin (); twoHopNeigh != N2.end (); twoHopNeigh++)
+  TwoHopNeighborBits covered (nWords, 0);
+  for (uint32_t bit = 0; bit < twoHopAddrs.size (); bit++)
     {
-      bool onlyOne = true;
-      // try to find another neighbor that can reach twoHopNeigh->twoHopNeighborAddr
-      for (TwoHopNeighborSet::const_iterator otherTwoHopNeigh = N2.begin (); otherTwoHopNeigh != N2.end (); otherTwoHopNeigh++)
-        {
-          if (otherTwoHopNeigh->twoHopNeighborAddr == twoHopNeigh->twoHopNeighborAddr
-              && otherTwoHopNeigh->neighborMainAddr != twoHopNeigh->neighborMainAddr)
-            {
-              onlyOne = false;
-              break;
-            }
-        }
-      if (onlyOne)
+      if (IsBitSet (uncovered, bit) && provider[bit] >= 0)
         {
-          NS_LOG_LOGIC ("Neighbor " << twoHopNeigh->neighborMainAddr
+          const NeighborTuple &neighbor = N[provider[bit]];
+          NS_LOG_LOGIC ("Neighbor " << neighbor.neighborMainAddr
                                     << " is the only that can reach 2-hop neigh. "
-                                    << twoHopNeigh->twoHopNeighborAddr
+                                    << twoHopAddrs[bit]
                                     << " => select as MPR.");
 
-          mprSet.insert (twoHopNeigh->neighborMainAddr);
+          mprSet.insert (neighbor.neighborMainAddr);
 
           // take note of all the 2-hop neighbors reachable by the newly elected MPR
-          for (TwoHopNeighborSet::const_iterator otherTwoHopNeigh = N2.begin ();
-               otherTwoHopNeigh != N2.end (); otherTwoHopNeigh++)
+          const TwoHopNeighborBits &reached = coverage[provider[bit]];
+          for (uint32_t i = 0; i < nWords; i++)
             {
-              if (otherTwoHopNeigh->neighborMainAddr == twoHopNeigh->neighborMainAddr)
-                {
-                  coveredTwoHopNeighbors.insert (otherTwoHopNeigh->twoHopNeighborAddr);
-                }
+              covered[i] |= reached[i];
             }
         }
     }
   // Remove the nodes from N2 which are now covered by a node in the MPR set.
-  for (TwoHopNeighborSet::iterator twoHopNeigh = N2.begin ();
-       twoHopNeigh != N2.end (); )
-    {
-      if (coveredTwoHopNeighbors.find (twoHopNeigh->twoHopNeighborAddr) != coveredTwoHopNeighbors.end ())
-        {
-          // This works correctly only because it is known that twoHopNeigh is reachable by exactly one neighbor, 
-          // so only one record in N2 exists for each of them. This record is erased here.
-          NS_LOG_LOGIC ("2-hop neigh. " << twoHopNeigh->twoHopNeighborAddr << " is already covered by an MPR.");
-          twoHopNeigh = N2.erase (twoHopNeigh);
-        }
-      else
-        {
-          twoHopNeigh++;
-        }
-    }
+  ClearBits (uncovered, covered);
 
   // 4. While there exist nodes in N2 which are not covered by at
   // least one node in the MPR set:
-  while (N2.begin () != N2.end ())
+  while (!IsEmpty (uncovered))
     {
 
 #ifdef NS3_LOG_ENABLE
@@ -757,38 +812,23 @@ RoutingProtocol::MprComputation ()
         for (TwoHopNeighborSet::const_iterator iter = N2.begin ();
              iter != N2.end (); iter++)
           {
-            TwoHopNeighborSet::const_iterator next = iter;
-            next++;
-            os << iter->neighborMainAddr << "->" << iter->twoHopNeighborAddr;
-            if (next != N2.end ())
-              os << ", ";
+            if (IsBitSet (uncovered, bitOf[iter->twoHopNeighborAddr]))
+              {
+                if (os.tellp () > 1)
+                  os << ", ";
+                os << iter->neighborMainAddr << "->" << iter->twoHopNeighborAddr;
+              }
           }
         os << "]";
         NS_LOG_DEBUG ("Step 4 iteration: N2=" << os.str ());
       }
 #endif  //NS3_LOG_ENABLE
 
-
       // 4.1. For each node in N, calculate the reachability, i.e., the
       // number of nodes in N2 which are not yet covered by at
       // least one node in the MPR set, and which are reachable
       // through this 1-hop neighbor
-      std::map<int, std::vector<const NeighborTuple *> > reachability;
-      std::set<int> rs;
-      for (NeighborSet::iterator it = N.begin (); it != N.end (); it++)
-        {
-          NeighborTuple const &nb_tuple = *it;
-          int r = 0;
-          for (TwoHopNeighborSet::iterator it2 = N2.begin (); it2 != N2.end (); it2++)
-            {
-              TwoHopNeighborTuple const &nb2hop_tuple = *it2;
-              if (nb_tuple.neighborMainAddr == nb2hop_tuple.neighborMainAddr)
-                r++;
-            }
-          rs.insert (r);
-          reachability[r].push_back (&nb_tuple);
-        }
-
+      //
       // 4.2. Select as a MPR the node with highest N_willingness among
       // the nodes in N with non-zero reachability. In case of
       // multiple choice select the node which provides
@@ -796,49 +836,37 @@ RoutingProtocol::MprComputation ()
       // case of multiple nodes providing the same amount of
       // reachability, select the node as MPR whose D(y) is
       // greater. Remove the nodes from N2 which are now covered
-      // by a node in the MPR set.
-      NeighborTuple const *max = NULL;
-      int max_r = 0;
-      for (std::set<int>::iterator it = rs.begin (); it != rs.end (); it++)
-        {
-          int r = *it;
+      // by a node in the MPR set.  Among equal nodes, the first
+      // one in N is selected.
+      int32_t max = -1;
+      uint32_t max_r = 0;
+      for (uint32_t i = 0; i < N.size (); i++)
+        {
+          uint32_t c = coverageOf[i];
+          uint32_t r = CountCommonBits (coverage[c], uncovered);
+          for (std::vector<uint32_t>::const_iterator bit = repeated[c].begin ();
+               bit != repeated[c].end (); bit++)
+            {
+              r += IsBitSet (uncovered, *bit);
+            }
           if (r == 0)
             {
               continue;
             }
-          for (std::vector<const NeighborTuple *>::iterator it2 = reachability[r].begin ();
-               it2 != reachability[r].end (); it2++)
+          if (max < 0 || N[i].willingness > N[max].willingness
+              || (N[i].willingness == N[max].willingness
+                  && (r > max_r || (r == max_r && degree[i] > degree[max]))))
             {
-              const NeighborTuple *nb_tuple = *it2;
-              if (max == NULL || nb_tuple->willingness > max->willingness)
-                {
-                  max = nb_tuple;
-                  max_r = r;
-                }
-              else if (nb_tuple->willingness == max->willingness)
-                {
-                  if (r > max_r)
-                    {
-                      max = nb_tuple;
-                      max_r = r;
-                    }
-                  else if (r == max_r)
-                    {
-                      if (Degree (*nb_tuple) > Degree (*max))
-                        {
-                          max = nb_tuple;
-                          max_r = r;
-                        }
-                    }
-                }
+              max = i;
+              max_r = r;
             }
         }
 
-      if (max != NULL)
+      if (max >= 0)
         {
-          mprSet.insert (max->neighborMainAddr);
-          CoverTwoHopNeighbors (max->neighborMainAddr, N2);
-          NS_LOG_LOGIC (N2.size () << " 2-hop neighbors left to cover!");
+          mprSet.insert (N[max].neighborMainAddr);
+          ClearBits (uncovered, coverage[coverageOf[max]]);
+          NS_LOG_LOGIC (CountCommonBits (uncovered, uncovered) << " 2-hop neighbors left to cover!");
         }
     }
 
@@ -884,15 +912,78 @@ RoutingProtocol::GetMainAddress (Ipv4Address iface_addr) const
 ///
 /// \brief Creates the routing table of the node following \RFC{3626} hints.
 ///
+/// Only the parts of the table which depend on the sets changed since
+/// the last computation (see m_routesDirty) are computed again: the routes
+/// to the 1-hop and 2-hop neighbors are kept aside in m_localTable, and
+/// reused as long as the link, neighbor, 2-hop neighbor and interface
+/// association sets are unchanged and none of their links has expired.
+/// Changes of the topology set only compute the routes beyond 2 hops
+/// again, changes of the association sets only the HNA routes.
+///
 void
 RoutingProtocol::RoutingTableComputation ()
 {
+  Simulator::Cancel (m_routingTableComputationEvent);
+
+  if (Simulator::Now () > m_localTableExpiry)
+    {
+      // a link used by the routes to the neighbors has expired
+      SetRoutesDirty (ROUTES_DIRTY_LOCAL);
+    }
+  if (m_routesDirty == 0)
+    {
+      NS_LOG_DEBUG (Simulator::Now ().GetSeconds () << " s: Node " << m_mainAddress
+                                                    << ": RoutingTableComputation: no change.");
+      return;
+    }
   NS_LOG_DEBUG (Simulator::Now ().GetSeconds () << " s: Node " << m_mainAddress
-                                                << ": RoutingTableComputation begin...");
+                                                << ": RoutingTableComputation begin (dirty="
+                                                << int (m_routesDirty) << ")...");
+  uint8_t dirty = m_routesDirty;
+  m_routesDirty = 0;
 
-  // 1. All the entries from the routing table are removed.
+  if (dirty == ROUTES_DIRTY_HNA)
+    {
+      // the routes to the OLSR nodes are unchanged
+      ComputeHnaRoutes ();
+      NS_LOG_DEBUG ("Node " << m_mainAddress << ": RoutingTableComputation end.");
+      return;
+    }
+
+  // 1. All the entries from the routing table are removed. The old table
+  // is kept aside to report per-destination changes at the end.
+  std::map<Ipv4Address, RoutingTableEntry> oldTable;
+  oldTable.swap (m_table);
   Clear ();
 
+  if (dirty & ROUTES_DIRTY_LOCAL)
+    {
+      ComputeLocalRoutes ();
+      m_localTable = m_table;
+    }
+  else
+    {
+      m_table = m_localTable;
+    }
+  ComputeTopologyRoutes ();
+  ComputeHnaRoutes ();
+
+  NS_LOG_DEBUG ("Node " << m_mainAddress << ": RoutingTableComputation end.");
+  NotifyRouteChanges (oldTable);
+  m_routingTableChanged (GetSize ());
+  NS_LOG_DEBUG("Таблица маршрутизации: ");
+  for (std::map<ns3::Ipv4Address, ns3::olsr::RoutingTableEntry>::iterator i = m_table.begin(); i != m_table.end (); ++i)
+    NS_LOG_DEBUG("Узел: " << i->first);
+}
+
+///
+/// \brief Adds the routes to the 1-hop and 2-hop neighbors to the routing table.
+///
+void
+RoutingProtocol::ComputeLocalRoutes ()
+{
+  m_localTableExpiry = Time::Max ();
+
   // 2. The new routing entries are added starting with the
   // symmetric neighbors (h=1) as the destination nodes.
   const NeighborSet &neighborSet = m_state.GetNeighbors ();
@@ -915,6 +1006,7 @@ RoutingProtocol::RoutingTableComputation ()
               if ((GetMainAddress (link_tuple.neighborIfaceAddr) == nb_tuple.neighborMainAddr)
                   && link_tuple.time >= Simulator::Now ())
                 {
+                  m_localTableExpiry = std::min (m_localTableExpiry, link_tuple.time);
                   NS_LOG_LOGIC ("Link tuple matches neighbor " << nb_tuple.neighborMainAddr
                                                                << " => adding routing table entry to neighbor");
                   lt = &link_tuple;
@@ -1034,28 +1126,71 @@ RoutingProtocol::RoutingTableComputation ()
                         << " not found in the routing table)");
         }
     }
+}
+
+///
+/// \brief Adds the routes to the nodes beyond 2 hops and to the other interfaces
+/// of the nodes to the routing table.
+///
+void
+RoutingProtocol::ComputeTopologyRoutes ()
+{
+  // 3.1. For each topology entry in the topology table, if its
+  // T_dest_addr does not correspond to R_dest_addr of any
+  // route entry in the routing table AND its T_last_addr
+  // corresponds to R_dest_addr of a route entry whose R_dist
+  // is equal to h, then a new route entry MUST be recorded in
+  // the routing table (if it does not already exist).
+  //
+  // This is done for h = 2, 3... until no entry is added.  Rather than
+  // scanning the whole topology set for each h, the tuples are grouped
+  // by T_last_addr once, and each round only looks at the tuples whose
+  // T_last_addr was reached by the previous round, in the order of the
+  // topology set, so that the same routes are chosen.
+  const TopologySet &topology = m_state.GetTopologySet ();
+  std::map<Ipv4Address, std::vector<uint32_t> > tuplesByLastAddr;
+  for (uint32_t i = 0; i < topology.size (); i++)
+    {
+      tuplesByLastAddr[topology[i].lastAddr].push_back (i);
+    }
 
-  for (uint32_t h = 2;; h++)
+  std::vector<Ipv4Address> reached;
+  for (std::map<Ipv4Address, RoutingTableEntry>::const_iterator it = m_table.begin ();
+       it != m_table.end (); it++)
     {
-      bool added = false;
+      if (it->second.distance == 2)
+        {
+          reached.push_back (it->first);
+        }
+    }
+
+  for (uint32_t h = 2; !reached.empty (); h++)
+    {
+      std::vector<uint32_t> candidates;
+      for (std::vector<Ipv4Address>::const_iterator addr = reached.begin ();
+           addr != reached.end (); addr++)
+        {
+          std::map<Ipv4Address, std::vector<uint32_t> >::const_iterator tuples =
+            tuplesByLastAddr.find (*addr);
+          if (tuples != tuplesByLastAddr.end ())
+            {
+              candidates.insert (candidates.end (), tuples->second.begin (), tuples->second.end ());
+            }
+        }
+      std::sort (candidates.begin (), candidates.end ());
 
-      // 3.1. For each topology entry in the topology table, if its
-      // T_dest_addr does not correspond to R_dest_addr of any
-      // route entry in the routing table AND its T_last_addr
-      // corresponds to R_dest_addr of a route entry whose R_dist
-      // is equal to h, then a new route entry MUST be recorded in
-      // the routing table (if it does not already exist)
-      const TopologySet &topology = m_state.GetTopologySet ();
-      for (TopologySet::const_iterator it = topology.begin ();
-           it != topology.end (); it++)
+      reached.clear ();
+      for (std::vector<uint32_t>::const_iterator i = candidates.begin ();
+           i != candidates.end (); i++)
         {
-          const TopologyTuple &topology_tuple = *it;
+          const TopologyTuple &topology_tuple = topology[*i];
           NS_LOG_LOGIC ("Looking at topology tuple: " << topology_tuple);
 
           RoutingTableEntry destAddrEntry, lastAddrEntry;
           bool have_destAddrEntry = Lookup (topology_tuple.destAddr, destAddrEntry);
           bool have_lastAddrEntry = Lookup (topology_tuple.lastAddr, lastAddrEntry);
-          if (!have_destAddrEntry && have_lastAddrEntry && lastAddrEntry.distance == h)
+          NS_ASSERT (have_lastAddrEntry && lastAddrEntry.distance == h);
+          if (!have_destAddrEntry)
             {
               NS_LOG_LOGIC ("Adding routing table entry based on the topology tuple.");
               // then a new route entry MUST be recorded in
@@ -1072,20 +1207,14 @@ RoutingProtocol::RoutingTableComputation ()
                         lastAddrEntry.nextAddr,
                         lastAddrEntry.interface,
                         h + 1);
-              added = true;
+              reached.push_back (topology_tuple.destAddr);
             }
           else
             {
               NS_LOG_LOGIC ("NOT adding routing table entry based on the topology tuple: "
-                            "have_destAddrEntry=" << have_destAddrEntry
-                                                  << " have_lastAddrEntry=" << have_lastAddrEntry
-                                                  << " lastAddrEntry.distance=" << (int) lastAddrEntry.distance
-                                                  << " (h=" << h << ")");
+                            "destination already in the routing table (h=" << h << ")");
             }
         }
-
-      if (!added)
-        break;
     }
 
   // 4. For each entry in the multiple interface association base
@@ -1115,7 +1244,14 @@ RoutingProtocol::RoutingTableComputation ()
                     entry1.distance);
         }
     }
+}
 
+///
+/// \brief Computes the routes to the networks announced by HNA messages.
+///
+void
+RoutingProtocol::ComputeHnaRoutes ()
+{
   // 5. For each tuple in the association set,
   //    If there is no entry in the routing table with:
   //        R_dest_addr     == A_network_addr/A_netmask
@@ -1193,12 +1329,39 @@ RoutingProtocol::RoutingTableComputation ()
 
         }
     }
+}
 
-  NS_LOG_DEBUG ("Node " << m_mainAddress << ": RoutingTableComputation end.");
-  m_routingTableChanged (GetSize ());
-  NS_LOG_DEBUG("Таблица маршрутизации: ");
-  for (std::map<ns3::Ipv4Address, ns3::olsr::RoutingTableEntry>::iterator i = m_table.begin(); i != m_table.end (); ++i)
-    NS_LOG_DEBUG("Узел: " << i->first);
+///
+/// \brief Schedules RoutingTableComputation, if something changed since the last one.
+///
+/// The computation is deferred to an event of the current time, so that all
+/// the changes of the current event (e.g. the messages of a packet, and the
+/// neighbor losses they cause) are handled by a single computation.
+///
+void
+RoutingProtocol::ScheduleRoutingTableComputation ()
+{
+  if (m_routesDirty == 0 && Simulator::Now () <= m_localTableExpiry)
+    {
+      return;
+    }
+  if (!m_routingTableComputationEvent.IsRunning ())
+    {
+      m_routingTableComputationEvent =
+        Simulator::ScheduleNow (&RoutingProtocol::RoutingTableComputation, this);
+    }
+}
+
+///
+/// \brief Runs the scheduled RoutingTableComputation now, before the routing table is used.
+///
+void
+RoutingProtocol::FlushRoutingTableComputation ()
+{
+  if (m_routingTableComputationEvent.IsRunning ())
+    {
+      RoutingTableComputation ();
+    }
 }
 
 
@@ -1302,7 +1465,12 @@ RoutingProtocol::ProcessTc (const olsr::MessageHeader &msg,
   //    T_last_addr == originator address AND
   //    T_seq       <  ANSN
   // MUST be removed from the topology set.
+  uint32_t topologySize = m_state.GetTopologySet ().size ();
   m_state.EraseOlderTopologyTuples (msg.GetOriginatorAddress (), tc.ansn);
+  if (m_state.GetTopologySet ().size () != topologySize)
+    {
+      SetRoutesDirty (ROUTES_DIRTY_TOPOLOGY);
+    }
 
   // 4. For each of the advertised neighbor main address received in
   // the TC message:
@@ -1424,13 +1592,14 @@ RoutingProtocol::ProcessMid (const olsr::MessageHeader &msg,
   // 3. (not part of the RFC) iterate over all NeighborTuple's and
   // TwoHopNeighborTuples, update the neighbor addresses taking into account
   // the new MID information.
-  NeighborSet &neighbors = m_state.GetNeighbors ();
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
+  NeighborSet &neighbors = m_state.GetNeighborsMutable ();
   for (NeighborSet::iterator neighbor = neighbors.begin (); neighbor != neighbors.end (); neighbor++)
     {
       neighbor->neighborMainAddr = GetMainAddress (neighbor->neighborMainAddr);
     }
 
-  TwoHopNeighborSet &twoHopNeighbors = m_state.GetTwoHopNeighbors ();
+  TwoHopNeighborSet &twoHopNeighbors = m_state.GetTwoHopNeighborsMutable ();
   for (TwoHopNeighborSet::iterator twoHopNeighbor = twoHopNeighbors.begin ();
        twoHopNeighbor != twoHopNeighbors.end (); twoHopNeighbor++)
     {
@@ -1912,6 +2081,7 @@ RoutingProtocol::AddHostNetworkAssociation (Ipv4Address networkAddr, Ipv4Mask ne
   // If the tuple does not already exist, add it to the list of local HNA associations.
   NS_LOG_INFO ("Adding HNA association for network " << networkAddr << "/" << netmask << ".");
   m_state.InsertAssociation ( (Association) { networkAddr, netmask} );
+  SetRoutesDirty (ROUTES_DIRTY_HNA);
 }
 
 ///
@@ -1924,6 +2094,7 @@ RoutingProtocol::RemoveHostNetworkAssociation (Ipv4Address networkAddr, Ipv4Mask
 {
   NS_LOG_INFO ("Removing HNA association for network " << networkAddr << "/" << netmask << ".");
   m_state.EraseAssociation ( (Association) { networkAddr, netmask} );
+  SetRoutesDirty (ROUTES_DIRTY_HNA);
 }
 
 ///
@@ -2013,6 +2184,7 @@ RoutingProtocol::LinkSensing (const olsr::MessageHeader &msg,
 
   NS_ASSERT (msg.GetVTime () > Seconds (0));
   LinkTuple *link_tuple = m_state.FindLinkTuple (senderIface);
+  Time timeBefore;
   if (link_tuple == NULL)
     {
       LinkTuple newLinkTuple;
@@ -2028,6 +2200,7 @@ RoutingProtocol::LinkSensing (const olsr::MessageHeader &msg,
   else
     {
       NS_LOG_LOGIC ("Existing link tuple already exists => will update it");
+      timeBefore = link_tuple->time;
       updated = true;
     }
 
@@ -2114,6 +2287,11 @@ RoutingProtocol::LinkSensing (const olsr::MessageHeader &msg,
       NS_LOG_DEBUG ("Link tuple updated: " << int (updated));
     }
   link_tuple->time = std::max (link_tuple->time, link_tuple->asymTime);
+  if (!created && (timeBefore < now || link_tuple->time < timeBefore))
+    {
+      // the link is valid again, or expires sooner
+      SetRoutesDirty (ROUTES_DIRTY_LOCAL);
+    }
 
   if (updated)
     {
@@ -2140,9 +2318,10 @@ RoutingProtocol::PopulateNeighborSet (const olsr::MessageHeader &msg,
                                       const olsr::MessageHeader::Hello &hello)
 {
   NeighborTuple *nb_tuple = m_state.FindNeighborTuple (msg.GetOriginatorAddress ());
-  if (nb_tuple != NULL)
+  if (nb_tuple != NULL && nb_tuple->willingness != hello.willingness)
     {
       nb_tuple->willingness = hello.willingness;
+      SetRoutesDirty (ROUTES_DIRTY_LOCAL);
     }
 }
 
@@ -2244,6 +2423,7 @@ RoutingProtocol::PopulateTwoHopNeighborSet (const olsr::MessageHeader &msg,
                   // 2-hop neighbor are deleted.
                   NS_LOG_LOGIC ("2-hop neighbor is NOT_NEIGH => deleting matching 2-hop neighbor state");
                   m_state.EraseTwoHopNeighborTuples (msg.GetOriginatorAddress (), nb2hop_addr);
+                  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
                 }
               else
                 {
@@ -2371,9 +2551,10 @@ RoutingProtocol::NeighborLoss (const LinkTuple &tuple)
   LinkTupleUpdated (tuple, OLSR_WILL_DEFAULT);
   m_state.EraseTwoHopNeighborTuples (GetMainAddress (tuple.neighborIfaceAddr));
   m_state.EraseMprSelectorTuples (GetMainAddress (tuple.neighborIfaceAddr));
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
 
   MprComputation ();
-  RoutingTableComputation ();
+  ScheduleRoutingTableComputation ();
 }
 
 ///
@@ -2442,6 +2623,7 @@ RoutingProtocol::RemoveLinkTuple (const LinkTuple &tuple)
 
   m_state.EraseLinkTuple (tuple);
   m_state.EraseNeighborTuple (GetMainAddress (tuple.neighborIfaceAddr));
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
 
 }
 
@@ -2500,6 +2682,10 @@ RoutingProtocol::LinkTupleUpdated (const LinkTuple &tuple, uint8_t willingness)
           NS_LOG_DEBUG (*nb_tuple << "->status = STATUS_NOT_SYM; changed:"
                                   << int (statusBefore != nb_tuple->status));
         }
+      if (statusBefore != nb_tuple->status)
+        {
+          SetRoutesDirty (ROUTES_DIRTY_LOCAL);
+        }
     }
   else
     {
@@ -2522,6 +2708,7 @@ RoutingProtocol::AddNeighborTuple (const NeighborTuple &tuple)
 //         ((tuple->status() == OLSR_STATUS_SYM) ? "sym" : "not_sym"));
 
   m_state.InsertNeighborTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
   IncrementAnsn ();
 }
 
@@ -2540,6 +2727,7 @@ RoutingProtocol::RemoveNeighborTuple (const NeighborTuple &tuple)
 //         ((tuple->status() == OLSR_STATUS_SYM) ? "sym" : "not_sym"));
 
   m_state.EraseNeighborTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
   IncrementAnsn ();
 }
 
@@ -2558,6 +2746,7 @@ RoutingProtocol::AddTwoHopNeighborTuple (const TwoHopNeighborTuple &tuple)
 //         OLSR::node_id(tuple->twoHopNeighborAddr));
 
   m_state.InsertTwoHopNeighborTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
 }
 
 ///
@@ -2575,6 +2764,7 @@ RoutingProtocol::RemoveTwoHopNeighborTuple (const TwoHopNeighborTuple &tuple)
 //         OLSR::node_id(tuple->twoHopNeighborAddr));
 
   m_state.EraseTwoHopNeighborTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
 }
 
 void
@@ -2637,6 +2827,7 @@ RoutingProtocol::AddTopologyTuple (const TopologyTuple &tuple)
 //         tuple->seq());
 
   m_state.InsertTopologyTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_TOPOLOGY);
 }
 
 ///
@@ -2655,6 +2846,7 @@ RoutingProtocol::RemoveTopologyTuple (const TopologyTuple &tuple)
 //         tuple->seq());
 
   m_state.EraseTopologyTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_TOPOLOGY);
 }
 
 ///
@@ -2672,6 +2864,7 @@ RoutingProtocol::AddIfaceAssocTuple (const IfaceAssocTuple &tuple)
 //         OLSR::node_id(tuple->iface_addr()));
 
   m_state.InsertIfaceAssocTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
 }
 
 ///
@@ -2689,6 +2882,7 @@ RoutingProtocol::RemoveIfaceAssocTuple (const IfaceAssocTuple &tuple)
 //         OLSR::node_id(tuple->iface_addr()));
 
   m_state.EraseIfaceAssocTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
 }
 
 ///
@@ -2700,6 +2894,7 @@ void
 RoutingProtocol::AddAssociationTuple (const AssociationTuple &tuple)
 {
   m_state.InsertAssociationTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_HNA);
 }
 
 ///
@@ -2711,6 +2906,7 @@ void
 RoutingProtocol::RemoveAssociationTuple (const AssociationTuple &tuple)
 {
   m_state.EraseAssociationTuple (tuple);
+  SetRoutesDirty (ROUTES_DIRTY_HNA);
 }
 
 
@@ -3065,6 +3261,7 @@ RoutingProtocol::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDe
   RoutingTableEntry entry1, entry2;
   bool found = false;
 
+  FlushRoutingTableComputation ();
   if (Lookup (header.GetDestination (), entry1) != 0)
     {
       bool foundSendEntry = FindSendEntry (entry1, entry2);
@@ -3142,6 +3339,7 @@ bool RoutingProtocol::RouteInput  (Ptr<const Packet> p,
 
   Ipv4Address dst = header.GetDestination ();
   Ipv4Address origin = header.GetSource ();
+  FlushRoutingTableComputation ();
 
   // Consume self-originated packets
   if (IsMyOwnAddress (origin) == true)
@@ -3243,10 +3441,16 @@ RoutingProtocol::NotifyInterfaceDown (uint32_t i)
 {}
 void 
 RoutingProtocol::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
-{}
+{
+  // the routes refer to the interfaces by their addresses
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
+}
 void 
 RoutingProtocol::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
-{}
+{
+  // the routes refer to the interfaces by their addresses
+  SetRoutesDirty (ROUTES_DIRTY_LOCAL);
+}
 
 
 ///
@@ -3381,6 +3585,57 @@ RoutingProtocol::Dump (void)
 #endif  //NS3_LOG_ENABLE
 }
 
+void
+RoutingProtocol::NotifyRouteChanges (const std::map<Ipv4Address, RoutingTableEntry> &oldTable)
+{
+  NS_LOG_FUNCTION (this);
+  // Both tables are sorted by destination, so a single merge pass finds
+  // every added, removed and changed route.
+  std::map<Ipv4Address, RoutingTableEntry>::const_iterator o = oldTable.begin ();
+  std::map<Ipv4Address, RoutingTableEntry>::const_iterator n = m_table.begin ();
+  while (o != oldTable.end () || n != m_table.end ())
+    {
+      if (n == m_table.end () || (o != oldTable.end () && o->first < n->first))
+        {
+          if (o->second.distance == 1)
+            {
+              m_neighbourLostTrace (o->first);
+            }
+          m_routeChangedTrace (o->first);
+          m_routeLostTrace (o->first);
+          ++o;
+        }
+      else if (o == oldTable.end () || n->first < o->first)
+        {
+          if (n->second.distance == 1)
+            {
+              m_neighbourAddedTrace (n->first);
+            }
+          m_routeChangedTrace (n->first);
+          ++n;
+        }
+      else
+        {
+          const RoutingTableEntry &oe = o->second;
+          const RoutingTableEntry &ne = n->second;
+          if (oe.distance == 1 && ne.distance != 1)
+            {
+              m_neighbourLostTrace (n->first);
+            }
+          else if (oe.distance != 1 && ne.distance == 1)
+            {
+              m_neighbourAddedTrace (n->first);
+            }
+          if (oe.nextAddr != ne.nextAddr || oe.interface != ne.interface || oe.distance != ne.distance)
+            {
+              m_routeChangedTrace (n->first);
+            }
+          ++o;
+          ++n;
+        }
+    }
+}
+
 void RoutingProtocol::RemovePath (const Ipv4Address &dest) {
   if (m_state.FindLinkTuple(dest) != NULL)
     RemoveLinkTuple (*m_state.FindLinkTuple(dest));
@@ -34,6 +34,7 @@
 #include "ns3/event-garbage-collector.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/timer.h"
+#include "ns3/event-id.h"
 #include "ns3/traced-callback.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-routing-protocol.h"
@@ -44,6 +45,8 @@
 
 /// Testcase for MPR computation mechanism
 class OlsrMprTestCase;
+/// Testcase for MPR computation mechanism on random neighborhoods
+class OlsrMprRandomTestCase;
 
 namespace ns3 {
 namespace olsr {
@@ -77,6 +80,7 @@ class RoutingProtocol : public Ipv4RoutingProtocol
 {
 public:
   friend class ::OlsrMprTestCase;
+  friend class ::OlsrMprRandomTestCase;
   static TypeId GetTypeId (void);
 
   RoutingProtocol ();
@@ -149,6 +153,22 @@ private:
 
   Ptr<Ipv4StaticRouting> m_hnaRoutingTable;
 
+  /// The sets which changed since the last routing table computation.
+  enum RoutesDirty
+  {
+    ROUTES_DIRTY_HNA = 1,       ///< the association sets
+    ROUTES_DIRTY_TOPOLOGY = 2,  ///< the topology set
+    ROUTES_DIRTY_LOCAL = 4      ///< the link, neighbor, 2-hop neighbor or interface association sets
+  };
+  /// Combination of RoutesDirty flags.
+  uint8_t m_routesDirty;
+  /// The routes to the 1-hop and 2-hop neighbors, from the last computation.
+  std::map<Ipv4Address, RoutingTableEntry> m_localTable;
+  /// The first time a link used by m_localTable expires.
+  Time m_localTableExpiry;
+  /// The pending routing table computation.
+  EventId m_routingTableComputationEvent;
+
   EventGarbageCollector m_events;
 	
   /// Packets sequence number counter.
@@ -224,6 +244,13 @@ private:
 
   void MprComputation ();
   void RoutingTableComputation ();
+  void ComputeLocalRoutes ();
+  void ComputeTopologyRoutes ();
+  void ComputeHnaRoutes ();
+  void ScheduleRoutingTableComputation ();
+  void FlushRoutingTableComputation ();
+  /// Notes that some sets used by the routing table changed.
+  void SetRoutesDirty (uint8_t flags) { m_routesDirty |= flags; }
   Ipv4Address GetMainAddress (Ipv4Address iface_addr) const;
   bool UsesNonOlsrOutgoingInterface (const Ipv4RoutingTableEntry &route);
 
@@ -308,7 +335,6 @@ private:
   void PopulateMprSelectorSet (const olsr::MessageHeader &msg,
                                const olsr::MessageHeader::Hello &hello);
 
-  int Degree (NeighborTuple const &tuple);
   /// Check that address is one of my interfaces
   bool IsMyOwnAddress (const Ipv4Address & a) const;
 
@@ -324,6 +350,21 @@ private:
   TracedCallback <const PacketHeader &,
                   const MessageList &> m_txPacketTrace;
   TracedCallback <uint32_t> m_routingTableChanged;
+  /// A destination became reachable in one hop
+  TracedCallback <Ipv4Address> m_neighbourAddedTrace;
+  /// A destination is no longer reachable in one hop
+  TracedCallback <Ipv4Address> m_neighbourLostTrace;
+  /// The route to a destination was added, removed or changed
+  TracedCallback <Ipv4Address> m_routeChangedTrace;
+  /// A destination is no longer reachable at all
+  TracedCallback <Ipv4Address> m_routeLostTrace;
+
+  /**
+   * \brief Fires the per-destination trace sources for the difference
+   * between oldTable and the freshly computed m_table.
+   * \param oldTable routing table before the last computation
+   */
+  void NotifyRouteChanges (const std::map<Ipv4Address, RoutingTableEntry> &oldTable);
 
   /// Provides uniform random variables.
   Ptr<UniformRandomVariable> m_uniformRandomVariable;  
@@ -27,6 +27,7 @@
 ///
 
 #include "olsr-state.h"
+#include <algorithm>
 
 
 namespace ns3 {
@@ -37,43 +38,27 @@ namespace olsr {
 MprSelectorTuple*
 OlsrState::FindMprSelectorTuple (Ipv4Address const &mainAddr)
 {
-  for (MprSelectorSet::iterator it = m_mprSelectorSet.begin ();
-       it != m_mprSelectorSet.end (); it++)
-    {
-      if (it->mainAddr == mainAddr)
-        return &(*it);
-    }
-  return NULL;
+  int32_t pos = m_mprSelectorIndex.Find (m_mprSelectorSet, mainAddr.Get ());
+  return pos < 0 ? NULL : &m_mprSelectorSet[pos];
 }
 
 void
 OlsrState::EraseMprSelectorTuple (const MprSelectorTuple &tuple)
 {
-  for (MprSelectorSet::iterator it = m_mprSelectorSet.begin ();
-       it != m_mprSelectorSet.end (); it++)
+  int32_t pos = m_mprSelectorIndex.Find (m_mprSelectorSet, GetTupleKey (tuple));
+  if (pos >= 0)
     {
-      if (*it == tuple)
-        {
-          m_mprSelectorSet.erase (it);
-          break;
-        }
+      m_mprSelectorIndex.Erase (m_mprSelectorSet, pos);
     }
 }
 
 void
 OlsrState::EraseMprSelectorTuples (const Ipv4Address &mainAddr)
 {
-  for (MprSelectorSet::iterator it = m_mprSelectorSet.begin ();
-       it != m_mprSelectorSet.end ();)
+  int32_t pos;
+  while ((pos = m_mprSelectorIndex.Find (m_mprSelectorSet, mainAddr.Get ())) >= 0)
     {
-      if (it->mainAddr == mainAddr)
-        {
-          it = m_mprSelectorSet.erase (it);
-        }
-      else
-        {
-          it++;
-        }
+      m_mprSelectorIndex.Erase (m_mprSelectorSet, pos);
     }
 }
 
@@ -81,6 +66,7 @@ void
 OlsrState::InsertMprSelectorTuple (MprSelectorTuple const &tuple)
 {
   m_mprSelectorSet.push_back (tuple);
+  m_mprSelectorIndex.Appended (m_mprSelectorSet);
 }
 
 std::string
@@ -107,23 +93,30 @@ OlsrState::PrintMprSelectorSet () const
 NeighborTuple*
 OlsrState::FindNeighborTuple (Ipv4Address const &mainAddr)
 {
-  for (NeighborSet::iterator it = m_neighborSet.begin ();
-       it != m_neighborSet.end (); it++)
-    {
-      if (it->neighborMainAddr == mainAddr)
-        return &(*it);
-    }
-  return NULL;
+  int32_t pos = m_neighborIndex.Find (m_neighborSet, mainAddr.Get ());
+  return pos < 0 ? NULL : &m_neighborSet[pos];
 }
 
 const NeighborTuple*
 OlsrState::FindSymNeighborTuple (Ipv4Address const &mainAddr) const
 {
-  for (NeighborSet::const_iterator it = m_neighborSet.begin ();
-       it != m_neighborSet.end (); it++)
+  int32_t pos = m_neighborIndex.Find (m_neighborSet, mainAddr.Get ());
+  if (pos < 0)
     {
-      if (it->neighborMainAddr == mainAddr && it->status == NeighborTuple::STATUS_SYM)
-        return &(*it);
+      return NULL;
+    }
+  if (m_neighborSet[pos].status == NeighborTuple::STATUS_SYM)
+    {
+      return &m_neighborSet[pos];
+    }
+  if (m_neighborIndex.HasDuplicates (m_neighborSet))
+    {
+      for (NeighborSet::const_iterator it = m_neighborSet.begin () + pos + 1;
+           it != m_neighborSet.end (); it++)
+        {
+          if (it->neighborMainAddr == mainAddr && it->status == NeighborTuple::STATUS_SYM)
+            return &(*it);
+        }
     }
   return NULL;
 }
@@ -131,11 +124,23 @@ OlsrState::FindSymNeighborTuple (Ipv4Address const &mainAddr) const
 NeighborTuple*
 OlsrState::FindNeighborTuple (Ipv4Address const &mainAddr, uint8_t willingness)
 {
-  for (NeighborSet::iterator it = m_neighborSet.begin ();
-       it != m_neighborSet.end (); it++)
+  int32_t pos = m_neighborIndex.Find (m_neighborSet, mainAddr.Get ());
+  if (pos < 0)
     {
-      if (it->neighborMainAddr == mainAddr && it->willingness == willingness)
-        return &(*it);
+      return NULL;
+    }
+  if (m_neighborSet[pos].willingness == willingness)
+    {
+      return &m_neighborSet[pos];
+    }
+  if (m_neighborIndex.HasDuplicates (m_neighborSet))
+    {
+      for (NeighborSet::iterator it = m_neighborSet.begin () + pos + 1;
+           it != m_neighborSet.end (); it++)
+        {
+          if (it->neighborMainAddr == mainAddr && it->willingness == willingness)
+            return &(*it);
+        }
     }
   return NULL;
 }
@@ -143,45 +148,31 @@ OlsrState::FindNeighborTuple (Ipv4Address const &mainAddr, uint8_t willingness)
 void
 OlsrState::EraseNeighborTuple (const NeighborTuple &tuple)
 {
-  for (NeighborSet::iterator it = m_neighborSet.begin ();
-       it != m_neighborSet.end (); it++)
-    {
-      if (*it == tuple)
-        {
-          m_neighborSet.erase (it);
-          break;
-        }
-    }
+  m_neighborIndex.Erase (m_neighborSet, tuple);
 }
 
 void
 OlsrState::EraseNeighborTuple (const Ipv4Address &mainAddr)
 {
-  for (NeighborSet::iterator it = m_neighborSet.begin ();
-       it != m_neighborSet.end (); it++)
+  int32_t pos = m_neighborIndex.Find (m_neighborSet, mainAddr.Get ());
+  if (pos >= 0)
     {
-      if (it->neighborMainAddr == mainAddr)
-        {
-          it = m_neighborSet.erase (it);
-          break;
-        }
+      m_neighborIndex.Erase (m_neighborSet, pos);
     }
 }
 
 void
 OlsrState::InsertNeighborTuple (NeighborTuple const &tuple)
 {
-  for (NeighborSet::iterator it = m_neighborSet.begin ();
-       it != m_neighborSet.end (); it++)
+  int32_t pos = m_neighborIndex.Find (m_neighborSet, GetTupleKey (tuple));
+  if (pos >= 0)
     {
-      if (it->neighborMainAddr == tuple.neighborMainAddr)
-        {
-          // Update it
-          *it = tuple;
-          return;
-        }
+      // Update it
+      m_neighborSet[pos] = tuple;
+      return;
     }
   m_neighborSet.push_back (tuple);
+  m_neighborIndex.Appended (m_neighborSet);
 }
 
 /********** Neighbor 2 Hop Set Manipulation **********/
@@ -190,29 +181,20 @@ TwoHopNeighborTuple*
 OlsrState::FindTwoHopNeighborTuple (Ipv4Address const &neighborMainAddr,
                                     Ipv4Address const &twoHopNeighborAddr)
 {
-  for (TwoHopNeighborSet::iterator it = m_twoHopNeighborSet.begin ();
-       it != m_twoHopNeighborSet.end (); it++)
-    {
-      if (it->neighborMainAddr == neighborMainAddr
-          && it->twoHopNeighborAddr == twoHopNeighborAddr)
-        {
-          return &(*it);
-        }
-    }
-  return NULL;
+  TwoHopNeighborTuple key;
+  key.neighborMainAddr = neighborMainAddr;
+  key.twoHopNeighborAddr = twoHopNeighborAddr;
+  int32_t pos = m_twoHopNeighborIndex.Find (m_twoHopNeighborSet, GetTupleKey (key));
+  return pos < 0 ? NULL : &m_twoHopNeighborSet[pos];
 }
 
 void
 OlsrState::EraseTwoHopNeighborTuple (const TwoHopNeighborTuple &tuple)
 {
-  for (TwoHopNeighborSet::iterator it = m_twoHopNeighborSet.begin ();
-       it != m_twoHopNeighborSet.end (); it++)
+  int32_t pos = m_twoHopNeighborIndex.Find (m_twoHopNeighborSet, GetTupleKey (tuple));
+  if (pos >= 0)
     {
-      if (*it == tuple)
-        {
-          m_twoHopNeighborSet.erase (it);
-          break;
-        }
+      m_twoHopNeighborIndex.Erase (m_twoHopNeighborSet, pos);
     }
 }
 
@@ -220,42 +202,40 @@ void
 OlsrState::EraseTwoHopNeighborTuples (const Ipv4Address &neighborMainAddr,
                                       const Ipv4Address &twoHopNeighborAddr)
 {
-  for (TwoHopNeighborSet::iterator it = m_twoHopNeighborSet.begin ();
-       it != m_twoHopNeighborSet.end ();)
+  TwoHopNeighborTuple key;
+  key.neighborMainAddr = neighborMainAddr;
+  key.twoHopNeighborAddr = twoHopNeighborAddr;
+  int32_t pos;
+  while ((pos = m_twoHopNeighborIndex.Find (m_twoHopNeighborSet, GetTupleKey (key))) >= 0)
     {
-      if (it->neighborMainAddr == neighborMainAddr
-          && it->twoHopNeighborAddr == twoHopNeighborAddr)
-        {
-          it = m_twoHopNeighborSet.erase (it);
-        }
-      else
-        {
-          it++;
-        }
+      m_twoHopNeighborIndex.Erase (m_twoHopNeighborSet, pos);
     }
 }
 
 void
 OlsrState::EraseTwoHopNeighborTuples (const Ipv4Address &neighborMainAddr)
 {
+  TwoHopNeighborSet::iterator last = m_twoHopNeighborSet.begin ();
   for (TwoHopNeighborSet::iterator it = m_twoHopNeighborSet.begin ();
-       it != m_twoHopNeighborSet.end ();)
+       it != m_twoHopNeighborSet.end (); it++)
     {
-      if (it->neighborMainAddr == neighborMainAddr)
-        {
-          it = m_twoHopNeighborSet.erase (it);
-        }
-      else
+      if (it->neighborMainAddr != neighborMainAddr)
         {
-          it++;
+          *last++ = *it;
         }
     }
+  if (last != m_twoHopNeighborSet.end ())
+    {
+      m_twoHopNeighborSet.erase (last, m_twoHopNeighborSet.end ());
+      m_twoHopNeighborIndex.Invalidate ();
+    }
 }
 
 void
 OlsrState::InsertTwoHopNeighborTuple (TwoHopNeighborTuple const &tuple)
 {
   m_twoHopNeighborSet.push_back (tuple);
+  m_twoHopNeighborIndex.Appended (m_twoHopNeighborSet);
 }
 
 /********** MPR Set Manipulation **********/
@@ -283,26 +263,20 @@ OlsrState::GetMprSet () const
 DuplicateTuple*
 OlsrState::FindDuplicateTuple (Ipv4Address const &addr, uint16_t sequenceNumber)
 {
-  for (DuplicateSet::iterator it = m_duplicateSet.begin ();
-       it != m_duplicateSet.end (); it++)
-    {
-      if (it->address == addr && it->sequenceNumber == sequenceNumber)
-        return &(*it);
-    }
-  return NULL;
+  DuplicateTuple key;
+  key.address = addr;
+  key.sequenceNumber = sequenceNumber;
+  int32_t pos = m_duplicateIndex.Find (m_duplicateSet, GetTupleKey (key));
+  return pos < 0 ? NULL : &m_duplicateSet[pos];
 }
 
 void
 OlsrState::EraseDuplicateTuple (const DuplicateTuple &tuple)
 {
-  for (DuplicateSet::iterator it = m_duplicateSet.begin ();
-       it != m_duplicateSet.end (); it++)
+  int32_t pos = m_duplicateIndex.Find (m_duplicateSet, GetTupleKey (tuple));
+  if (pos >= 0)
     {
-      if (*it == tuple)
-        {
-          m_duplicateSet.erase (it);
-          break;
-        }
+      m_duplicateIndex.Erase (m_duplicateSet, pos);
     }
 }
 
@@ -310,6 +284,7 @@ void
 OlsrState::InsertDuplicateTuple (DuplicateTuple const &tuple)
 {
   m_duplicateSet.push_back (tuple);
+  m_duplicateIndex.Appended (m_duplicateSet);
 }
 
 /********** Link Set Manipulation **********/
@@ -317,28 +292,17 @@ OlsrState::InsertDuplicateTuple (DuplicateTuple const &tuple)
 LinkTuple*
 OlsrState::FindLinkTuple (Ipv4Address const & ifaceAddr)
 {
-  for (LinkSet::iterator it = m_linkSet.begin ();
-       it != m_linkSet.end (); it++)
-    {
-      if (it->neighborIfaceAddr == ifaceAddr)
-        return &(*it);
-    }
-  return NULL;
+  int32_t pos = m_linkIndex.Find (m_linkSet, ifaceAddr.Get ());
+  return pos < 0 ? NULL : &m_linkSet[pos];
 }
 
 LinkTuple*
 OlsrState::FindSymLinkTuple (Ipv4Address const &ifaceAddr, Time now)
 {
-  for (LinkSet::iterator it = m_linkSet.begin ();
-       it != m_linkSet.end (); it++)
+  LinkTuple *tuple = FindLinkTuple (ifaceAddr);
+  if (tuple != NULL && tuple->symTime > now)
     {
-      if (it->neighborIfaceAddr == ifaceAddr)
-        {
-          if (it->symTime > now)
-            return &(*it);
-          else
-            break;
-        }
+      return tuple;
     }
   return NULL;
 }
@@ -346,21 +310,14 @@ OlsrState::FindSymLinkTuple (Ipv4Address const &ifaceAddr, Time now)
 void
 OlsrState::EraseLinkTuple (const LinkTuple &tuple)
 {
-  for (LinkSet::iterator it = m_linkSet.begin ();
-       it != m_linkSet.end (); it++)
-    {
-      if (*it == tuple)
-        {
-          m_linkSet.erase (it);
-          break;
-        }
-    }
+  m_linkIndex.Erase (m_linkSet, tuple);
 }
 
 LinkTuple&
 OlsrState::InsertLinkTuple (LinkTuple const &tuple)
 {
   m_linkSet.push_back (tuple);
+  m_linkIndex.Appended (m_linkSet);
   return m_linkSet.back ();
 }
 
@@ -370,18 +327,22 @@ TopologyTuple*
 OlsrState::FindTopologyTuple (Ipv4Address const &destAddr,
                               Ipv4Address const &lastAddr)
 {
-  for (TopologySet::iterator it = m_topologySet.begin ();
-       it != m_topologySet.end (); it++)
-    {
-      if (it->destAddr == destAddr && it->lastAddr == lastAddr)
-        return &(*it);
-    }
-  return NULL;
+  TopologyTuple key;
+  key.destAddr = destAddr;
+  key.lastAddr = lastAddr;
+  int32_t pos = m_topologyIndex.Find (m_topologySet, GetTupleKey (key));
+  return pos < 0 ? NULL : &m_topologySet[pos];
 }
 
 TopologyTuple*
 OlsrState::FindNewerTopologyTuple (Ipv4Address const & lastAddr, uint16_t ansn)
 {
+  sgi::hash_map<uint32_t, TopologySequences>::const_iterator sequences =
+    m_topologySequences.find (lastAddr.Get ());
+  if (sequences == m_topologySequences.end () || sequences->second.max <= ansn)
+    {
+      return NULL;
+    }
   for (TopologySet::iterator it = m_topologySet.begin ();
        it != m_topologySet.end (); it++)
     {
@@ -394,38 +355,76 @@ OlsrState::FindNewerTopologyTuple (Ipv4Address const & lastAddr, uint16_t ansn)
 void
 OlsrState::EraseTopologyTuple (const TopologyTuple &tuple)
 {
-  for (TopologySet::iterator it = m_topologySet.begin ();
-       it != m_topologySet.end (); it++)
+  if (!m_topologyIndex.Erase (m_topologySet, tuple))
     {
-      if (*it == tuple)
-        {
-          m_topologySet.erase (it);
-          break;
-        }
+      return;
+    }
+  TopologySequences &sequences = m_topologySequences[tuple.lastAddr.Get ()];
+  if (--sequences.count == 0)
+    {
+      m_topologySequences.erase (tuple.lastAddr.Get ());
     }
 }
 
 void
 OlsrState::EraseOlderTopologyTuples (const Ipv4Address &lastAddr, uint16_t ansn)
 {
+  sgi::hash_map<uint32_t, TopologySequences>::iterator sequences =
+    m_topologySequences.find (lastAddr.Get ());
+  if (sequences == m_topologySequences.end () || sequences->second.min >= ansn)
+    {
+      return;
+    }
+  // erase the older tuples, and narrow the range of the others
+  TopologySequences remaining = { 0, 0, 0 };
+  TopologySet::iterator last = m_topologySet.begin ();
   for (TopologySet::iterator it = m_topologySet.begin ();
-       it != m_topologySet.end ();)
+       it != m_topologySet.end (); it++)
     {
-      if (it->lastAddr == lastAddr && it->sequenceNumber < ansn)
+      if (it->lastAddr != lastAddr)
         {
-          it = m_topologySet.erase (it);
+          *last++ = *it;
         }
-      else
+      else if (it->sequenceNumber >= ansn)
         {
-          it++;
+          remaining.min = remaining.count == 0 ? it->sequenceNumber : std::min (remaining.min, it->sequenceNumber);
+          remaining.max = remaining.count == 0 ? it->sequenceNumber : std::max (remaining.max, it->sequenceNumber);
+          remaining.count++;
+          *last++ = *it;
         }
     }
+  if (remaining.count == 0)
+    {
+      m_topologySequences.erase (sequences);
+    }
+  else
+    {
+      sequences->second = remaining;
+    }
+  if (last != m_topologySet.end ())
+    {
+      m_topologySet.erase (last, m_topologySet.end ());
+      m_topologyIndex.Invalidate ();
+    }
 }
 
 void
 OlsrState::InsertTopologyTuple (TopologyTuple const &tuple)
 {
   m_topologySet.push_back (tuple);
+  m_topologyIndex.Appended (m_topologySet);
+  TopologySequences &sequences = m_topologySequences[tuple.lastAddr.Get ()];
+  if (sequences.count == 0)
+    {
+      sequences.min = tuple.sequenceNumber;
+      sequences.max = tuple.sequenceNumber;
+    }
+  else
+    {
+      sequences.min = std::min (sequences.min, tuple.sequenceNumber);
+      sequences.max = std::max (sequences.max, tuple.sequenceNumber);
+    }
+  sequences.count++;
 }
 
 /********** Interface Association Set Manipulation **********/
@@ -433,45 +432,28 @@ OlsrState::InsertTopologyTuple (TopologyTuple const &tuple)
 IfaceAssocTuple*
 OlsrState::FindIfaceAssocTuple (Ipv4Address const &ifaceAddr)
 {
-  for (IfaceAssocSet::iterator it = m_ifaceAssocSet.begin ();
-       it != m_ifaceAssocSet.end (); it++)
-    {
-      if (it->ifaceAddr == ifaceAddr)
-        return &(*it);
-    }
-  return NULL;
+  int32_t pos = m_ifaceAssocIndex.Find (m_ifaceAssocSet, ifaceAddr.Get ());
+  return pos < 0 ? NULL : &m_ifaceAssocSet[pos];
 }
 
 const IfaceAssocTuple*
 OlsrState::FindIfaceAssocTuple (Ipv4Address const &ifaceAddr) const
 {
-  for (IfaceAssocSet::const_iterator it = m_ifaceAssocSet.begin ();
-       it != m_ifaceAssocSet.end (); it++)
-    {
-      if (it->ifaceAddr == ifaceAddr)
-        return &(*it);
-    }
-  return NULL;
+  int32_t pos = m_ifaceAssocIndex.Find (m_ifaceAssocSet, ifaceAddr.Get ());
+  return pos < 0 ? NULL : &m_ifaceAssocSet[pos];
 }
 
 void
 OlsrState::EraseIfaceAssocTuple (const IfaceAssocTuple &tuple)
 {
-  for (IfaceAssocSet::iterator it = m_ifaceAssocSet.begin ();
-       it != m_ifaceAssocSet.end (); it++)
-    {
-      if (*it == tuple)
-        {
-          m_ifaceAssocSet.erase (it);
-          break;
-        }
-    }
+  m_ifaceAssocIndex.Erase (m_ifaceAssocSet, tuple);
 }
 
 void
 OlsrState::InsertIfaceAssocTuple (const IfaceAssocTuple &tuple)
 {
   m_ifaceAssocSet.push_back (tuple);
+  m_ifaceAssocIndex.Appended (m_ifaceAssocSet);
 }
 
 std::vector<Ipv4Address>
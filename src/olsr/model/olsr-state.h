@@ -26,10 +26,227 @@
 #define OLSR_STATE_H
 
 #include "olsr-repositories.h"
+#include "ns3/sgi-hashmap.h"
+#include <algorithm>
+#include <functional>
 
 namespace ns3 {
 namespace olsr {
 
+/// \returns the key of a link tuple in the index of its set.
+inline uint64_t
+GetTupleKey (const LinkTuple &tuple)
+{
+  return tuple.neighborIfaceAddr.Get ();
+}
+
+/// \returns the key of a neighbor tuple in the index of its set.
+inline uint64_t
+GetTupleKey (const NeighborTuple &tuple)
+{
+  return tuple.neighborMainAddr.Get ();
+}
+
+/// \returns the key of a 2-hop neighbor tuple in the index of its set.
+inline uint64_t
+GetTupleKey (const TwoHopNeighborTuple &tuple)
+{
+  return (uint64_t (tuple.neighborMainAddr.Get ()) << 32) | tuple.twoHopNeighborAddr.Get ();
+}
+
+/// \returns the key of an MPR selector tuple in the index of its set.
+inline uint64_t
+GetTupleKey (const MprSelectorTuple &tuple)
+{
+  return tuple.mainAddr.Get ();
+}
+
+/// \returns the key of a duplicate tuple in the index of its set.
+inline uint64_t
+GetTupleKey (const DuplicateTuple &tuple)
+{
+  return (uint64_t (tuple.address.Get ()) << 32) | tuple.sequenceNumber;
+}
+
+/// \returns the key of a topology tuple in the index of its set.
+inline uint64_t
+GetTupleKey (const TopologyTuple &tuple)
+{
+  return (uint64_t (tuple.destAddr.Get ()) << 32) | tuple.lastAddr.Get ();
+}
+
+/// \returns the key of an interface association tuple in the index of its set.
+inline uint64_t
+GetTupleKey (const IfaceAssocTuple &tuple)
+{
+  return tuple.ifaceAddr.Get ();
+}
+
+/**
+ * \brief A hash index of the tuples of a set.
+ *
+ * Every tuple indexed gets a handle, which grows with each tuple appended
+ * to the set.  The index maps the key of a tuple (see GetTupleKey) to the
+ * handle of the first tuple with that key, and keeps the handles of the
+ * tuples in the order of the set, where a binary search finds the
+ * position of a handle.  The sets keep their order, which the protocol
+ * depends on (e.g. for the choice between routes of the same length), so
+ * erasing a tuple moves the handles which follow it as the set moves the
+ * tuples, but leaves their handles, and the hash, untouched.  After a
+ * change of the set the index did not follow (see Invalidate), or while
+ * several tuples share a key, the index is rebuilt by the next lookup.
+ */
+template <typename Tuple>
+class TupleIndex
+{
+public:
+  typedef std::vector<Tuple> Set; ///< The indexed set type.
+
+  TupleIndex ()
+    : m_valid (false),
+      m_duplicates (false),
+      m_nextHandle (0)
+  {
+  }
+
+  /**
+   * \param set the indexed set
+   * \param key a key
+   * \returns the position of the first tuple of the set with the key, or -1
+   */
+  int32_t Find (const Set &set, uint64_t key)
+  {
+    if (!m_valid)
+      {
+        Rebuild (set);
+      }
+    typename Map::const_iterator it = m_handles.find (key);
+    if (it == m_handles.end ())
+      {
+        return -1;
+      }
+    return std::lower_bound (m_order.begin (), m_order.end (), it->second) - m_order.begin ();
+  }
+  /// \returns true if some tuples of the set share a key.
+  bool HasDuplicates (const Set &set)
+  {
+    if (!m_valid)
+      {
+        Rebuild (set);
+      }
+    return m_duplicates;
+  }
+  /**
+   * Index the last tuple of the set, which was just appended to it.
+   * \param set the indexed set
+   */
+  void Appended (const Set &set)
+  {
+    if (!m_valid)
+      {
+        return;
+      }
+    if (!m_handles.insert (std::make_pair (GetTupleKey (set.back ()), m_nextHandle)).second)
+      {
+        m_duplicates = true;
+      }
+    m_order.push_back (m_nextHandle++);
+  }
+  /**
+   * Erase a tuple from the set, keeping the order of the others.
+   * \param set the indexed set
+   * \param pos the position of the tuple
+   */
+  void Erase (Set &set, uint32_t pos)
+  {
+    if (m_valid && !m_duplicates)
+      {
+        m_handles.erase (GetTupleKey (set[pos]));
+        m_order.erase (m_order.begin () + pos);
+      }
+    else
+      {
+        m_valid = false;
+      }
+    set.erase (set.begin () + pos);
+  }
+  /**
+   * Erase a tuple from the set, keeping the order of the others.
+   * \param set the indexed set
+   * \param tuple a tuple equal to the one to erase
+   * \returns false if the set holds no such tuple
+   */
+  bool Erase (Set &set, const Tuple &tuple)
+  {
+    int32_t pos = Find (set, GetTupleKey (tuple));
+    if (pos < 0)
+      {
+        return false;
+      }
+    if (!(set[pos] == tuple))
+      {
+        if (!m_duplicates)
+          {
+            return false;
+          }
+        for (pos++; pos < int32_t (set.size ()); pos++)
+          {
+            if (set[pos] == tuple)
+              break;
+          }
+        if (pos == int32_t (set.size ()))
+          {
+            return false;
+          }
+      }
+    Erase (set, pos);
+    return true;
+  }
+  /// Note that the set, or the keys of its tuples, changed.
+  void Invalidate (void)
+  {
+    m_valid = false;
+  }
+
+private:
+  /// Hash of the keys, which often hold two addresses
+  struct KeyHash : public std::unary_function<uint64_t, size_t>
+  {
+    /// \param key a key
+    /// \returns the hash of the key
+    size_t operator () (uint64_t key) const
+    {
+      return size_t ((key & 0xffffffff) ^ ((key >> 32) * 0x9e3779b1));
+    }
+  };
+  /// key --> handle of the first tuple with the key
+  typedef sgi::hash_map<uint64_t, uint64_t, KeyHash> Map;
+
+  /// Index all the tuples of the set.
+  void Rebuild (const Set &set)
+  {
+    m_handles.clear ();
+    m_order.clear ();
+    m_duplicates = false;
+    for (uint32_t i = 0; i < set.size (); i++)
+      {
+        if (!m_handles.insert (std::make_pair (GetTupleKey (set[i]), uint64_t (i))).second)
+          {
+            m_duplicates = true;
+          }
+        m_order.push_back (i);
+      }
+    m_nextHandle = set.size ();
+    m_valid = true;
+  }
+
+  Map m_handles;                  ///< the handles of the tuples
+  std::vector<uint64_t> m_order;  ///< the handles of the tuples, in the order of the set
+  bool m_valid;                   ///< the index follows the set
+  bool m_duplicates;              ///< some tuples share a key
+  uint64_t m_nextHandle;          ///< the handle of the next tuple appended
+};
+
 /// This class encapsulates all data structures needed for maintaining internal state of an OLSR node.
 class OlsrState
 {
@@ -47,6 +264,26 @@ protected:
   AssociationSet m_associationSet; ///<	Association Set (\RFC{3626}, section12.2). Associations obtained from HNA messages generated by other nodes.
   Associations m_associations;  ///< The node's local Host Network Associations that will be advertised using HNA messages.
 
+  // The indices of the sets, which the const lookups may have to rebuild.
+  mutable TupleIndex<LinkTuple> m_linkIndex;                  ///< Index of m_linkSet.
+  mutable TupleIndex<NeighborTuple> m_neighborIndex;          ///< Index of m_neighborSet.
+  mutable TupleIndex<TwoHopNeighborTuple> m_twoHopNeighborIndex; ///< Index of m_twoHopNeighborSet.
+  mutable TupleIndex<TopologyTuple> m_topologyIndex;          ///< Index of m_topologySet.
+  mutable TupleIndex<MprSelectorTuple> m_mprSelectorIndex;    ///< Index of m_mprSelectorSet.
+  mutable TupleIndex<DuplicateTuple> m_duplicateIndex;        ///< Index of m_duplicateSet.
+  mutable TupleIndex<IfaceAssocTuple> m_ifaceAssocIndex;      ///< Index of m_ifaceAssocSet.
+
+  /// The range of the sequence numbers of the topology tuples of a last address.
+  struct TopologySequences
+  {
+    uint32_t count;   ///< number of topology tuples with the last address
+    uint16_t min;     ///< no tuple has a smaller sequence number
+    uint16_t max;     ///< no tuple has a larger sequence number
+  };
+  /// T_last_addr --> range of T_seq, to skip the scans of the set for the TC messages
+  /// which neither are outdated nor outdate a tuple.
+  sgi::hash_map<uint32_t, TopologySequences> m_topologySequences;
+
 public:
 
   OlsrState ()
@@ -68,8 +305,10 @@ public:
   {
     return m_neighborSet;
   }
-  NeighborSet & GetNeighbors ()
+  /// The caller may change the neighbor tuples, including their addresses.
+  NeighborSet & GetNeighborsMutable ()
   {
+    m_neighborIndex.Invalidate ();
     return m_neighborSet;
   }
   NeighborTuple* FindNeighborTuple (const Ipv4Address &mainAddr);
@@ -85,8 +324,10 @@ public:
   {
     return m_twoHopNeighborSet;
   }
-  TwoHopNeighborSet & GetTwoHopNeighbors ()
+  /// The caller may change the 2-hop neighbor tuples, including their addresses.
+  TwoHopNeighborSet & GetTwoHopNeighborsMutable ()
   {
+    m_twoHopNeighborIndex.Invalidate ();
     return m_twoHopNeighborSet;
   }
   TwoHopNeighborTuple* FindTwoHopNeighborTuple (const Ipv4Address &neighbor,
@@ -141,6 +382,7 @@ public:
   }
   IfaceAssocSet & GetIfaceAssocSetMutable ()
   {
+    m_ifaceAssocIndex.Invalidate ();
     return m_ifaceAssocSet;
   }
   IfaceAssocTuple* FindIfaceAssocTuple (const Ipv4Address &ifaceAddr);
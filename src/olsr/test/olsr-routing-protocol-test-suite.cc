@@ -23,6 +23,8 @@
 #include "ns3/test.h"
 #include "ns3/olsr-routing-protocol.h"
 #include "ns3/ipv4-header.h"
+#include "ns3/random-variable-stream.h"
+#include <set>
 
 /********** Willingness **********/
 
@@ -167,6 +169,284 @@ OlsrMprTestCase::DoRun ()
   NS_TEST_EXPECT_MSG_EQ ((mpr.find ("10.0.0.9") == mpr.end ()), true, "Node 1 must NOT select node 8 as MPR");
 }
 
+/// Testcase comparing the MPR computation with the step by step
+/// algorithm of \RFC{3626} on many random neighborhoods
+class OlsrMprRandomTestCase : public TestCase {
+public:
+  OlsrMprRandomTestCase ();
+  /// \brief Run test case
+  virtual void DoRun (void);
+
+private:
+  /**
+   * \param state the state of the node
+   * \param mainAddress the main address of the node
+   * \returns the MPR set computed by scanning the neighbor sets, as
+   *          RoutingProtocol::MprComputation has always selected it
+   */
+  static MprSet ReferenceMprSet (const OlsrState &state, Ipv4Address mainAddress);
+  /**
+   * \param N2 the uncovered 2-hop neighbors
+   * \param neighborMainAddr a neighbor selected as MPR
+   */
+  static void Cover (TwoHopNeighborSet &N2, Ipv4Address neighborMainAddr);
+  /**
+   * \param state the state of the node
+   * \param tuple a neighbor
+   * \returns the number of 2-hop tuples of the neighbor whose neighbor
+   *          is not in the neighbor set
+   */
+  static int Degree (const OlsrState &state, const NeighborTuple &tuple);
+};
+
+OlsrMprRandomTestCase::OlsrMprRandomTestCase ()
+  : TestCase ("Check OLSR MPR computing mechanism on random neighborhoods")
+{
+}
+
+void
+OlsrMprRandomTestCase::Cover (TwoHopNeighborSet &N2, Ipv4Address neighborMainAddr)
+{
+  std::set<Ipv4Address> toRemove;
+  for (TwoHopNeighborSet::const_iterator it = N2.begin (); it != N2.end (); it++)
+    {
+      if (it->neighborMainAddr == neighborMainAddr)
+        {
+          toRemove.insert (it->twoHopNeighborAddr);
+        }
+    }
+  for (TwoHopNeighborSet::iterator it = N2.begin (); it != N2.end (); )
+    {
+      if (toRemove.find (it->twoHopNeighborAddr) != toRemove.end ())
+        {
+          it = N2.erase (it);
+        }
+      else
+        {
+          it++;
+        }
+    }
+}
+
+int
+OlsrMprRandomTestCase::Degree (const OlsrState &state, const NeighborTuple &tuple)
+{
+  int degree = 0;
+  for (TwoHopNeighborSet::const_iterator it = state.GetTwoHopNeighbors ().begin ();
+       it != state.GetTwoHopNeighbors ().end (); it++)
+    {
+      if (it->neighborMainAddr != tuple.neighborMainAddr)
+        {
+          continue;
+        }
+      bool found = false;
+      for (NeighborSet::const_iterator neigh = state.GetNeighbors ().begin ();
+           neigh != state.GetNeighbors ().end (); neigh++)
+        {
+          found = found || neigh->neighborMainAddr == it->neighborMainAddr;
+        }
+      degree += !found;
+    }
+  return degree;
+}
+
+MprSet
+OlsrMprRandomTestCase::ReferenceMprSet (const OlsrState &state, Ipv4Address mainAddress)
+{
+  MprSet mprSet;
+  NeighborSet N;
+  for (NeighborSet::const_iterator it = state.GetNeighbors ().begin (); it != state.GetNeighbors ().end (); it++)
+    {
+      if (it->status == NeighborTuple::STATUS_SYM)
+        {
+          N.push_back (*it);
+        }
+    }
+
+  TwoHopNeighborSet N2;
+  for (TwoHopNeighborSet::const_iterator it = state.GetTwoHopNeighbors ().begin ();
+       it != state.GetTwoHopNeighbors ().end (); it++)
+    {
+      if (it->twoHopNeighborAddr == mainAddress)
+        {
+          continue;
+        }
+      bool ok = false;
+      for (NeighborSet::const_iterator neigh = N.begin (); neigh != N.end (); neigh++)
+        {
+          if (neigh->neighborMainAddr == it->neighborMainAddr)
+            {
+              ok = (neigh->willingness != OLSR_WILL_NEVER);
+              break;
+            }
+        }
+      for (NeighborSet::const_iterator neigh = N.begin (); ok && neigh != N.end (); neigh++)
+        {
+          if (neigh->neighborMainAddr == it->twoHopNeighborAddr)
+            {
+              ok = false;
+            }
+        }
+      if (ok)
+        {
+          N2.push_back (*it);
+        }
+    }
+
+  // 1. the neighbors with willingness WILL_ALWAYS
+  for (NeighborSet::const_iterator it = N.begin (); it != N.end (); it++)
+    {
+      if (it->willingness == OLSR_WILL_ALWAYS)
+        {
+          mprSet.insert (it->neighborMainAddr);
+          Cover (N2, it->neighborMainAddr);
+        }
+    }
+
+  // 3. the only neighbors to reach a 2-hop neighbor
+  std::set<Ipv4Address> covered;
+  for (TwoHopNeighborSet::const_iterator it = N2.begin (); it != N2.end (); it++)
+    {
+      bool onlyOne = true;
+      for (TwoHopNeighborSet::const_iterator other = N2.begin (); other != N2.end (); other++)
+        {
+          if (other->twoHopNeighborAddr == it->twoHopNeighborAddr
+              && other->neighborMainAddr != it->neighborMainAddr)
+            {
+              onlyOne = false;
+              break;
+            }
+        }
+      if (onlyOne)
+        {
+          mprSet.insert (it->neighborMainAddr);
+          for (TwoHopNeighborSet::const_iterator other = N2.begin (); other != N2.end (); other++)
+            {
+              if (other->neighborMainAddr == it->neighborMainAddr)
+                {
+                  covered.insert (other->twoHopNeighborAddr);
+                }
+            }
+        }
+    }
+  for (TwoHopNeighborSet::iterator it = N2.begin (); it != N2.end (); )
+    {
+      if (covered.find (it->twoHopNeighborAddr) != covered.end ())
+        {
+          it = N2.erase (it);
+        }
+      else
+        {
+          it++;
+        }
+    }
+
+  // 4. the neighbors of highest willingness, reachability and degree,
+  // by increasing reachability then in the order of N
+  while (!N2.empty ())
+    {
+      std::map<int, std::vector<const NeighborTuple *> > reachability;
+      for (NeighborSet::const_iterator it = N.begin (); it != N.end (); it++)
+        {
+          int r = 0;
+          for (TwoHopNeighborSet::const_iterator it2 = N2.begin (); it2 != N2.end (); it2++)
+            {
+              if (it->neighborMainAddr == it2->neighborMainAddr)
+                {
+                  r++;
+                }
+            }
+          reachability[r].push_back (&*it);
+        }
+      const NeighborTuple *max = NULL;
+      int max_r = 0;
+      for (std::map<int, std::vector<const NeighborTuple *> >::const_iterator it = reachability.begin ();
+           it != reachability.end (); it++)
+        {
+          int r = it->first;
+          for (uint32_t i = 0; r != 0 && i < it->second.size (); i++)
+            {
+              const NeighborTuple *tuple = it->second[i];
+              if (max == NULL || tuple->willingness > max->willingness
+                  || (tuple->willingness == max->willingness
+                      && (r > max_r || (r == max_r && Degree (state, *tuple) > Degree (state, *max)))))
+                {
+                  max = tuple;
+                  max_r = r;
+                }
+            }
+        }
+      mprSet.insert (max->neighborMainAddr);
+      Cover (N2, max->neighborMainAddr);
+    }
+  return mprSet;
+}
+
+void
+OlsrMprRandomTestCase::DoRun ()
+{
+  Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
+  rand->SetStream (1);
+  const uint8_t willingness[] = { OLSR_WILL_NEVER, OLSR_WILL_LOW, OLSR_WILL_DEFAULT, OLSR_WILL_DEFAULT,
+                                  OLSR_WILL_DEFAULT, OLSR_WILL_HIGH, OLSR_WILL_ALWAYS };
+
+  for (uint32_t run = 0; run < 200; run++)
+    {
+      Ptr<RoutingProtocol> protocol = CreateObject<RoutingProtocol> ();
+      protocol->m_mainAddress = Ipv4Address ("10.0.0.1");
+      OlsrState &state = protocol->m_state;
+
+      // up to 100 neighbors, 10.0.1.x, some of them not symmetric, and
+      // up to 200 2-hop neighbors, 10.0.2.x, with a few neighbors and
+      // the node itself among them
+      uint32_t nNeighbors = rand->GetInteger (1, 100);
+      uint32_t nTwoHops = rand->GetInteger (1, 200);
+      uint32_t links = rand->GetInteger (1, 8);
+      for (uint32_t i = 0; i < nNeighbors; i++)
+        {
+          NeighborTuple neighbor;
+          neighbor.neighborMainAddr = Ipv4Address (0x0a000100 + i);
+          neighbor.status = rand->GetInteger (0, 9) ? NeighborTuple::STATUS_SYM : NeighborTuple::STATUS_NOT_SYM;
+          neighbor.willingness = willingness[rand->GetInteger (0, 6)];
+          state.InsertNeighborTuple (neighbor);
+        }
+      if (run % 10 == 0)
+        {
+          // a second tuple for the same neighbor
+          NeighborTuple neighbor = state.GetNeighbors ()[0];
+          neighbor.willingness = willingness[rand->GetInteger (0, 6)];
+          state.GetNeighborsMutable ().push_back (neighbor);
+        }
+      for (uint32_t i = 0; i < nNeighbors * links; i++)
+        {
+          TwoHopNeighborTuple tuple;
+          tuple.expirationTime = Seconds (3600);
+          tuple.neighborMainAddr = Ipv4Address (0x0a000100 + rand->GetInteger (0, nNeighbors));
+          uint32_t twoHop = rand->GetInteger (0, nTwoHops + 1);
+          if (twoHop == nTwoHops)
+            {
+              tuple.twoHopNeighborAddr = Ipv4Address (0x0a000100 + rand->GetInteger (0, nNeighbors - 1));
+            }
+          else if (twoHop == nTwoHops + 1)
+            {
+              tuple.twoHopNeighborAddr = protocol->m_mainAddress;
+            }
+          else
+            {
+              tuple.twoHopNeighborAddr = Ipv4Address (0x0a000200 + twoHop);
+            }
+          state.InsertTwoHopNeighborTuple (tuple);
+        }
+
+      MprSet expected = ReferenceMprSet (state, protocol->m_mainAddress);
+      protocol->MprComputation ();
+      MprSet mpr = state.GetMprSet ();
+      NS_TEST_EXPECT_MSG_EQ (mpr.size (), expected.size (), "Wrong number of MPRs in run " << run);
+      NS_TEST_EXPECT_MSG_EQ ((mpr == expected), true, "Wrong MPR set in run " << run);
+      protocol->Dispose ();
+    }
+}
+
 static class OlsrProtocolTestSuite : public TestSuite
 {
 public:
@@ -177,4 +457,5 @@ OlsrProtocolTestSuite::OlsrProtocolTestSuite()
   : TestSuite ("routing-olsr", UNIT)
 {
   AddTestCase (new OlsrMprTestCase (), TestCase::QUICK);
+  AddTestCase (new OlsrMprRandomTestCase (), TestCase::QUICK);
 }
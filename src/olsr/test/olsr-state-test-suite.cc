@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/olsr-state.h"
+#include "ns3/simulator.h"
+
+using namespace ns3;
+using namespace olsr;
+
+/// Testcase for the lookups of OlsrState after insertions and erasures
+class OlsrStateIndexTestCase : public TestCase
+{
+public:
+  OlsrStateIndexTestCase ();
+  /// \brief Run test case
+  virtual void DoRun (void);
+};
+
+OlsrStateIndexTestCase::OlsrStateIndexTestCase ()
+  : TestCase ("Check the lookups of the OLSR state")
+{
+}
+
+void
+OlsrStateIndexTestCase::DoRun (void)
+{
+  OlsrState state;
+
+  // topology tuples from two last addresses
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      TopologyTuple tuple;
+      tuple.destAddr = Ipv4Address (0x0a000100 + i);
+      tuple.lastAddr = Ipv4Address (i % 2 ? "10.0.0.1" : "10.0.0.2");
+      tuple.sequenceNumber = 5;
+      tuple.expirationTime = Seconds (1);
+      state.InsertTopologyTuple (tuple);
+    }
+  NS_TEST_EXPECT_MSG_EQ ((state.FindTopologyTuple (Ipv4Address (0x0a000103), "10.0.0.1") != 0), true,
+                         "Topology tuple not found");
+  NS_TEST_EXPECT_MSG_EQ ((state.FindTopologyTuple (Ipv4Address (0x0a000103), "10.0.0.2") == 0), true,
+                         "Unexpected topology tuple");
+  NS_TEST_EXPECT_MSG_EQ ((state.FindNewerTopologyTuple ("10.0.0.1", 5) == 0), true,
+                         "Unexpected newer topology tuple");
+  NS_TEST_EXPECT_MSG_EQ ((state.FindNewerTopologyTuple ("10.0.0.1", 4) != 0), true,
+                         "Newer topology tuple not found");
+
+  // erasing a tuple keeps the order of the others, which are still found
+  TopologyTuple erased = state.GetTopologySet ()[3];
+  state.EraseTopologyTuple (erased);
+  NS_TEST_ASSERT_MSG_EQ (state.GetTopologySet ().size (), 19, "Topology tuple not erased");
+  NS_TEST_EXPECT_MSG_EQ ((state.FindTopologyTuple (erased.destAddr, erased.lastAddr) == 0), true,
+                         "Erased topology tuple found");
+  for (uint32_t i = 0; i < state.GetTopologySet ().size (); i++)
+    {
+      const TopologyTuple &tuple = state.GetTopologySet ()[i];
+      NS_TEST_EXPECT_MSG_EQ (tuple.destAddr, Ipv4Address (0x0a000100 + (i < 3 ? i : i + 1)),
+                             "Topology set out of order");
+      NS_TEST_EXPECT_MSG_EQ (state.FindTopologyTuple (tuple.destAddr, tuple.lastAddr), &tuple,
+                             "Topology tuple not found after an erasure");
+    }
+
+  // a newer TC message of 10.0.0.1 outdates its tuples only
+  state.EraseOlderTopologyTuples ("10.0.0.1", 6);
+  NS_TEST_ASSERT_MSG_EQ (state.GetTopologySet ().size (), 10, "Older topology tuples not erased");
+  for (uint32_t i = 0; i < state.GetTopologySet ().size (); i++)
+    {
+      const TopologyTuple &tuple = state.GetTopologySet ()[i];
+      NS_TEST_EXPECT_MSG_EQ (tuple.lastAddr, Ipv4Address ("10.0.0.2"), "Wrong topology tuple erased");
+      NS_TEST_EXPECT_MSG_EQ (state.FindTopologyTuple (tuple.destAddr, tuple.lastAddr), &tuple,
+                             "Topology tuple not found after erasures");
+    }
+  NS_TEST_EXPECT_MSG_EQ ((state.FindNewerTopologyTuple ("10.0.0.1", 0) == 0), true,
+                         "Erased topology tuple found");
+
+  // the tuples of the duplicate set are still found after erasures
+  for (uint16_t seq = 0; seq < 100; seq++)
+    {
+      DuplicateTuple tuple;
+      tuple.address = Ipv4Address ("10.0.0.3");
+      tuple.sequenceNumber = seq;
+      tuple.retransmitted = false;
+      tuple.expirationTime = Seconds (1);
+      state.InsertDuplicateTuple (tuple);
+    }
+  for (uint16_t seq = 0; seq < 100; seq += 2)
+    {
+      state.EraseDuplicateTuple (*state.FindDuplicateTuple ("10.0.0.3", seq));
+    }
+  for (uint16_t seq = 0; seq < 100; seq++)
+    {
+      DuplicateTuple *tuple = state.FindDuplicateTuple ("10.0.0.3", seq);
+      NS_TEST_EXPECT_MSG_EQ ((tuple == 0), (seq % 2 == 0), "Wrong duplicate tuple lookup");
+      if (tuple != 0)
+        {
+          NS_TEST_EXPECT_MSG_EQ (tuple->sequenceNumber, seq, "Wrong duplicate tuple found");
+        }
+    }
+
+  // the addresses of the neighbors may be changed through the mutable set
+  NeighborTuple neighbor;
+  neighbor.neighborMainAddr = Ipv4Address ("10.0.0.4");
+  neighbor.status = NeighborTuple::STATUS_SYM;
+  neighbor.willingness = 3;
+  state.InsertNeighborTuple (neighbor);
+  neighbor.neighborMainAddr = Ipv4Address ("10.0.0.5");
+  state.InsertNeighborTuple (neighbor);
+  NS_TEST_EXPECT_MSG_EQ ((state.FindSymNeighborTuple ("10.0.0.5") != 0), true, "Neighbor tuple not found");
+  state.GetNeighborsMutable ()[1].neighborMainAddr = Ipv4Address ("10.0.0.6");
+  NS_TEST_EXPECT_MSG_EQ ((state.FindNeighborTuple ("10.0.0.5") == 0), true, "Renamed neighbor tuple found");
+  NS_TEST_EXPECT_MSG_EQ ((state.FindNeighborTuple ("10.0.0.6") != 0), true, "Renamed neighbor tuple not found");
+  state.EraseNeighborTuple (Ipv4Address ("10.0.0.4"));
+  NS_TEST_EXPECT_MSG_EQ (state.FindNeighborTuple ("10.0.0.6"), &state.GetNeighbors ()[0],
+                         "Neighbor tuple not found after an erasure");
+
+  // of the tuples which share a key, the one equal to the tuple is erased
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      LinkTuple link;
+      link.localIfaceAddr = Ipv4Address (0x0a000200 + i);
+      link.neighborIfaceAddr = Ipv4Address ("10.0.0.7");
+      link.time = Seconds (i);
+      state.InsertLinkTuple (link);
+    }
+  LinkTuple link = state.GetLinks ()[1];
+  state.EraseLinkTuple (link);
+  NS_TEST_ASSERT_MSG_EQ (state.GetLinks ().size (), 2, "Link tuple not erased");
+  NS_TEST_EXPECT_MSG_EQ (state.GetLinks ()[0].localIfaceAddr, Ipv4Address ("10.0.2.0"), "Wrong link tuple erased");
+  NS_TEST_EXPECT_MSG_EQ (state.GetLinks ()[1].localIfaceAddr, Ipv4Address ("10.0.2.2"), "Wrong link tuple erased");
+  state.EraseLinkTuple (link);
+  NS_TEST_EXPECT_MSG_EQ (state.GetLinks ().size (), 2, "Link tuple erased twice");
+  NS_TEST_EXPECT_MSG_EQ (state.FindLinkTuple ("10.0.0.7"), &state.GetLinks ()[0], "Wrong link tuple found");
+}
+
+/// Test suite for the OLSR state
+static class OlsrStateTestSuite : public TestSuite
+{
+public:
+  OlsrStateTestSuite ();
+} g_olsrStateTestSuite;
+
+OlsrStateTestSuite::OlsrStateTestSuite ()
+  : TestSuite ("routing-olsr-state", UNIT)
+{
+  AddTestCase (new OlsrStateIndexTestCase (), TestCase::QUICK);
+}
@@ -65,6 +65,26 @@ std::ostream& operator<< (std::ostream& lhs, TxSpectrumModelInfoMap_t& rhs)
   return lhs;
 }
 
+/**
+ * \param txParams the parameters of a transmitted signal
+ * \param psd the power spectral density of the signal, in the
+ *        SpectrumModel of the receiver
+ * \returns a copy of the parameters, with a copy of psd
+ */
+static Ptr<SpectrumSignalParameters>
+CopySignalParameters (Ptr<SpectrumSignalParameters> txParams, Ptr<SpectrumValue> psd)
+{
+  NS_LOG_LOGIC (" copying signal parameters " << txParams);
+  // SpectrumSignalParameters::Copy copies the power spectral density
+  // of the transmitter, which is psd when no conversion is needed
+  Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
+  if (psd != txParams->psd)
+    {
+      rxParams->psd = Copy<SpectrumValue> (psd);
+    }
+  return rxParams;
+}
+
 TxSpectrumModelInfo::TxSpectrumModelInfo (Ptr<const SpectrumModel> txSpectrumModel)
   : m_txSpectrumModel (txSpectrumModel)
 {
@@ -291,20 +311,20 @@ MultiModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
 
           if ((*rxPhyIterator) != txParams->txPhy)
             {
-              NS_LOG_LOGIC (" copying signal parameters " << txParams);
-              Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
-              rxParams->psd = Copy<SpectrumValue> (convertedTxPowerSpectrum);
               Time delay = MicroSeconds (0);
 
               Ptr<MobilityModel> receiverMobility = (*rxPhyIterator)->GetMobility ();
+              // the signal parameters are only copied for the receivers in
+              // range, which get their own power spectral density
+              Ptr<SpectrumSignalParameters> rxParams;
 
               if (txMobility && receiverMobility)
                 {
                   double pathLossDb = 0;
-                  if (rxParams->txAntenna != 0)
+                  if (txParams->txAntenna != 0)
                     {
                       Angles txAngles (receiverMobility->GetPosition (), txMobility->GetPosition ());
-                      double txAntennaGain = rxParams->txAntenna->GetGainDb (txAngles);
+                      double txAntennaGain = txParams->txAntenna->GetGainDb (txAngles);
                       NS_LOG_LOGIC ("txAntennaGain = " << txAntennaGain << " dB");
                       pathLossDb -= txAntennaGain;
                     }
@@ -329,6 +349,7 @@ MultiModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
                       // beyond range
                       continue;
                     }
+                  rxParams = CopySignalParameters (txParams, convertedTxPowerSpectrum);
                   double pathGainLinear = std::pow (10.0, (-pathLossDb) / 10.0);
                   *(rxParams->psd) *= pathGainLinear;              
 
@@ -342,6 +363,10 @@ MultiModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
                       delay = m_propagationDelay->GetDelay (txMobility, receiverMobility);
                     }
                 }
+              else
+                {
+                  rxParams = CopySignalParameters (txParams, convertedTxPowerSpectrum);
+                }
 
               Ptr<NetDevice> netDev = (*rxPhyIterator)->GetDevice ();
               if (netDev)
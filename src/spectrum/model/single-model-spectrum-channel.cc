@@ -138,16 +138,17 @@ SingleModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
           Time delay  = MicroSeconds (0);
 
           Ptr<MobilityModel> receiverMobility = (*rxPhyIterator)->GetMobility ();
-          NS_LOG_LOGIC ("copying signal parameters " << txParams);
-          Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
+          // the signal parameters are only copied for the receivers in
+          // range, which get their own power spectral density
+          Ptr<SpectrumSignalParameters> rxParams;
 
           if (senderMobility && receiverMobility)
             {
               double pathLossDb = 0;
-              if (rxParams->txAntenna != 0)
+              if (txParams->txAntenna != 0)
                 {
                   Angles txAngles (receiverMobility->GetPosition (), senderMobility->GetPosition ());
-                  double txAntennaGain = rxParams->txAntenna->GetGainDb (txAngles);
+                  double txAntennaGain = txParams->txAntenna->GetGainDb (txAngles);
                   NS_LOG_LOGIC ("txAntennaGain = " << txAntennaGain << " dB");
                   pathLossDb -= txAntennaGain;
                 }
@@ -172,6 +173,8 @@ SingleModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
                   // beyond range
                   continue;
                 }
+              NS_LOG_LOGIC ("copying signal parameters " << txParams);
+              rxParams = txParams->Copy ();
               double pathGainLinear = std::pow (10.0, (-pathLossDb) / 10.0);
               *(rxParams->psd) *= pathGainLinear;              
 
@@ -185,6 +188,11 @@ SingleModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
                   delay = m_propagationDelay->GetDelay (senderMobility, receiverMobility);
                 }
             }
+          else
+            {
+              NS_LOG_LOGIC ("copying signal parameters " << txParams);
+              rxParams = txParams->Copy ();
+            }
 
 
           Ptr<NetDevice> netDev = (*rxPhyIterator)->GetDevice ();
@@ -14,15 +14,19 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <sstream>
+#include <string>
 #include <vector>
 #include "ns3/boolean.h"
 #include "ns3/config.h"
 #include "ns3/csma-helper.h"
 #include "ns3/flow-monitor.h"
 #include "ns3/flow-monitor-helper.h"
+#include "ns3/global-router-interface.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-global-routing.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/ipv4-static-routing-helper.h"
 #include "ns3/node.h"
@@ -385,6 +389,106 @@ GlobalRoutingSlash32TestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class GlobalRoutingThreadsTestCase : public TestCase
+{
+public:
+  GlobalRoutingThreadsTestCase ();
+  virtual ~GlobalRoutingThreadsTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /// Return the global routes of the nodes, in the order they were added
+  std::vector<std::string> GetRoutes (NodeContainer nodes);
+};
+
+GlobalRoutingThreadsTestCase::GlobalRoutingThreadsTestCase ()
+  : TestCase ("Global routes computed on several threads")
+{
+}
+
+GlobalRoutingThreadsTestCase::~GlobalRoutingThreadsTestCase ()
+{
+}
+
+std::vector<std::string>
+GlobalRoutingThreadsTestCase::GetRoutes (NodeContainer nodes)
+{
+  std::vector<std::string> routes;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Ipv4GlobalRouting> gr = nodes.Get (i)->GetObject<GlobalRouter> ()->GetRoutingProtocol ();
+      std::ostringstream oss;
+      for (uint32_t j = 0; j < gr->GetNRoutes (); j++)
+        {
+          oss << *gr->GetRoute (j) << std::endl;
+        }
+      routes.push_back (oss.str ());
+    }
+  return routes;
+}
+
+// A 6x6 grid of point-to-point links, whose equal cost paths give several
+// routes to most destinations, and a ring of five routers with a LAN of
+// hosts on one of them
+void
+GlobalRoutingThreadsTestCase::DoRun (void)
+{
+  const uint32_t side = 6;
+  NodeContainer grid;
+  grid.Create (side * side);
+  NodeContainer ring;
+  ring.Create (5);
+  NodeContainer hosts;
+  hosts.Create (2);
+  NodeContainer nodes (grid, ring, hosts);
+  InternetStackHelper internet;
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.0.0", "255.255.255.252");
+  for (uint32_t row = 0; row < side; row++)
+    {
+      for (uint32_t col = 0; col < side; col++)
+        {
+          uint32_t n = row * side + col;
+          if (col + 1 < side)
+            {
+              ipv4.Assign (p2p.Install (grid.Get (n), grid.Get (n + 1)));
+              ipv4.NewNetwork ();
+            }
+          if (row + 1 < side)
+            {
+              ipv4.Assign (p2p.Install (grid.Get (n), grid.Get (n + side)));
+              ipv4.NewNetwork ();
+            }
+        }
+    }
+  for (uint32_t i = 0; i < ring.GetN (); i++)
+    {
+      ipv4.Assign (p2p.Install (ring.Get (i), ring.Get ((i + 1) % ring.GetN ())));
+      ipv4.NewNetwork ();
+    }
+  CsmaHelper csma;
+  ipv4.SetBase ("10.2.0.0", "255.255.255.0");
+  ipv4.Assign (csma.Install (NodeContainer (ring.Get (0), hosts)));
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  std::vector<std::string> serial = GetRoutes (nodes);
+  NS_TEST_ASSERT_MSG_NE (serial[side + 1], "", "No global routes computed");
+  NS_TEST_ASSERT_MSG_NE (serial[nodes.GetN () - 1], "", "No global routes computed across the LAN");
+
+  Config::SetGlobal ("GlobalRoutingSpfThreads", UintegerValue (4));
+  Ipv4GlobalRoutingHelper::RecomputeRoutingTables ();
+  Config::SetGlobal ("GlobalRoutingSpfThreads", UintegerValue (1));
+  std::vector<std::string> parallel = GetRoutes (nodes);
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (parallel[i], serial[i], "Different routes on node " << i);
+    }
+  Simulator::Destroy ();
+}
+
 
 class GlobalRoutingTestSuite : public TestSuite
 {
@@ -397,6 +501,7 @@ GlobalRoutingTestSuite::GlobalRoutingTestSuite ()
 {
   AddTestCase (new DynamicGlobalRoutingTestCase, TestCase::QUICK);
   AddTestCase (new GlobalRoutingSlash32TestCase, TestCase::QUICK);
+  AddTestCase (new GlobalRoutingThreadsTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
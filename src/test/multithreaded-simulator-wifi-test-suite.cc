@@ -0,0 +1,344 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <pthread.h>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include "ns3/default-simulator-impl.h"
+#include "ns3/double.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/multithreaded-simulator-impl.h"
+#include "ns3/node-container.h"
+#include "ns3/olsr-helper.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+#include "ns3/udp-client-server-helper.h"
+#include "ns3/uinteger.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/yans-wifi-channel.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/nqos-wifi-mac-helper.h"
+
+using namespace ns3;
+
+/**
+ * Run two disjoint ad hoc networks, each with its own channel and
+ * OLSR routing a multi-hop UDP flow, with the default and the
+ * multithreaded simulators. Their nodes are interleaved in the node
+ * list, so each network must be kept whole in its own partition, and
+ * every node must see the same receptions at the same times.
+ */
+class MultithreadedSimulatorWifiTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorWifiTestCase ();
+
+private:
+  typedef std::vector<std::pair<int64_t, uint32_t> > Log;
+
+  virtual void DoRun (void);
+  void RunScenario (Ptr<SimulatorImpl> impl);
+  static void PhyRxEnd (Log *log, pthread_t *thread, Ptr<const Packet> packet);
+
+  std::vector<Log> m_logs;
+  std::vector<pthread_t> m_threads;
+  std::vector<uint32_t> m_received;
+};
+
+static const uint32_t N_NETWORKS = 2;
+static const uint32_t N_NODES = 4;
+
+// Nodes 0, 1, 4, 5 form the first network and 2, 3, 6, 7 the second:
+// partitioning by node id modulo 2 would split both.
+static uint32_t
+GetNetwork (uint32_t id)
+{
+  return (id / 2) % N_NETWORKS;
+}
+
+MultithreadedSimulatorWifiTestCase::MultithreadedSimulatorWifiTestCase ()
+  : TestCase ("Check that disjoint wifi networks run in parallel partitions as with the default simulator")
+{
+}
+
+void
+MultithreadedSimulatorWifiTestCase::PhyRxEnd (Log *log, pthread_t *thread, Ptr<const Packet> packet)
+{
+  log->push_back (std::make_pair (Simulator::Now ().GetTimeStep (), packet->GetSize ()));
+  *thread = pthread_self ();
+}
+
+void
+MultithreadedSimulatorWifiTestCase::RunScenario (Ptr<SimulatorImpl> impl)
+{
+  Simulator::SetImplementation (impl);
+  m_logs.assign (N_NETWORKS * N_NODES, Log ());
+  m_threads.assign (N_NETWORKS * N_NODES, pthread_t ());
+  m_received.assign (N_NETWORKS, 0);
+
+  NodeContainer all;
+  all.Create (N_NETWORKS * N_NODES);
+  std::vector<Ptr<UdpServer> > servers;
+  for (uint32_t k = 0; k < N_NETWORKS; ++k)
+    {
+      NodeContainer nodes;
+      for (uint32_t id = 0; id < all.GetN (); ++id)
+        {
+          if (GetNetwork (id) == k)
+            {
+              nodes.Add (all.Get (id));
+            }
+        }
+
+      YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+      YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+      phy.SetChannel (channel.Create ());
+      NqosWifiMacHelper mac = NqosWifiMacHelper::Default ();
+      mac.SetType ("ns3::AdhocWifiMac");
+      WifiHelper wifi = WifiHelper::Default ();
+      wifi.SetStandard (WIFI_PHY_STANDARD_80211a);
+      wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                    "DataMode", StringValue ("OfdmRate6Mbps"),
+                                    "ControlMode", StringValue ("OfdmRate6Mbps"));
+      NetDeviceContainer devices = wifi.Install (phy, mac, nodes);
+      wifi.AssignStreams (devices, 100 * k);
+
+      MobilityHelper mobility;
+      mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                     "DeltaX", DoubleValue (100.0),
+                                     "GridWidth", UintegerValue (N_NODES));
+      mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+      mobility.Install (nodes);
+
+      OlsrHelper olsr;
+      InternetStackHelper internet;
+      internet.SetRoutingHelper (olsr);
+      internet.Install (nodes);
+      olsr.AssignStreams (nodes, 100 * k + 20);
+      internet.AssignStreams (nodes, 100 * k + 40);
+
+      Ipv4AddressHelper address;
+      std::ostringstream network;
+      network << "10.1." << k + 1 << ".0";
+      address.SetBase (network.str ().c_str (), "255.255.255.0");
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+      UdpServerHelper server (9);
+      ApplicationContainer serverApp = server.Install (nodes.Get (N_NODES - 1));
+      serverApp.Start (Seconds (1.0));
+      servers.push_back (DynamicCast<UdpServer> (serverApp.Get (0)));
+      UdpClientHelper client (interfaces.GetAddress (N_NODES - 1), 9);
+      client.SetAttribute ("MaxPackets", UintegerValue (40));
+      client.SetAttribute ("Interval", TimeValue (MilliSeconds (250)));
+      client.SetAttribute ("PacketSize", UintegerValue (200 + 100 * k));
+      ApplicationContainer clientApp = client.Install (nodes.Get (0));
+      clientApp.Start (Seconds (15.0));
+
+      for (uint32_t i = 0; i < N_NODES; ++i)
+        {
+          uint32_t id = nodes.Get (i)->GetId ();
+          Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (devices.Get (i));
+          device->GetPhy ()->TraceConnectWithoutContext ("PhyRxEnd",
+                                                         MakeBoundCallback (&PhyRxEnd, &m_logs[id], &m_threads[id]));
+        }
+    }
+
+  Simulator::Stop (Seconds (30.0));
+  Simulator::Run ();
+  for (uint32_t k = 0; k < N_NETWORKS; ++k)
+    {
+      m_received[k] = servers[k]->GetReceived ();
+    }
+  Simulator::Destroy ();
+}
+
+void
+MultithreadedSimulatorWifiTestCase::DoRun (void)
+{
+  RunScenario (CreateObject<DefaultSimulatorImpl> ());
+  std::vector<Log> expected = m_logs;
+  std::vector<uint32_t> expectedReceived = m_received;
+
+  Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+  impl->SetAttribute ("Threads", UintegerValue (N_NETWORKS));
+  RunScenario (impl);
+
+  for (uint32_t k = 0; k < N_NETWORKS; ++k)
+    {
+      NS_TEST_ASSERT_MSG_GT (expectedReceived[k], 0, "OLSR did not route the flow of network " << k);
+      NS_TEST_ASSERT_MSG_EQ (m_received[k], expectedReceived[k], "Wrong number of packets received in network " << k);
+    }
+  for (uint32_t id = 0; id < N_NETWORKS * N_NODES; ++id)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_logs[id].size (), expected[id].size (), "Wrong number of receptions for node " << id);
+      NS_TEST_ASSERT_MSG_EQ ((m_logs[id] == expected[id]), true, "Wrong receptions for node " << id);
+      // every network runs in a single thread, each in its own
+      uint32_t first = 2 * GetNetwork (id);
+      NS_TEST_ASSERT_MSG_NE (pthread_equal (m_threads[id], m_threads[first]), 0,
+                             "The nodes of a network ran in different threads");
+      if (first != 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (pthread_equal (m_threads[id], m_threads[0]), 0,
+                                 "Disjoint networks ran in the same thread");
+        }
+    }
+}
+
+/**
+ * Run a single ad hoc network, with OLSR routing a multi-hop UDP flow
+ * over a YansWifiChannel with a MinimumDistance, with the default and
+ * the multithreaded simulators. Neighbours run in different
+ * partitions, the channel handing its frames over with the propagation
+ * delay over MinimumDistance as lookahead, and every node must see the
+ * same receptions at the same times.
+ */
+class MultithreadedSimulatorWifiSplitTestCase : public TestCase
+{
+public:
+  MultithreadedSimulatorWifiSplitTestCase ();
+
+private:
+  typedef std::vector<std::pair<int64_t, uint32_t> > Log;
+
+  virtual void DoRun (void);
+  void RunScenario (Ptr<SimulatorImpl> impl);
+  static void PhyRxEnd (Log *log, pthread_t *thread, Ptr<const Packet> packet);
+
+  std::vector<Log> m_logs;
+  std::vector<pthread_t> m_threads;
+  uint32_t m_received;
+};
+
+static const double SPLIT_DISTANCE = 100.0;
+
+MultithreadedSimulatorWifiSplitTestCase::MultithreadedSimulatorWifiSplitTestCase ()
+  : TestCase ("Check that a wifi channel spans partitions with a lookahead derived from its propagation delay")
+{
+}
+
+void
+MultithreadedSimulatorWifiSplitTestCase::PhyRxEnd (Log *log, pthread_t *thread, Ptr<const Packet> packet)
+{
+  log->push_back (std::make_pair (Simulator::Now ().GetTimeStep (), packet->GetSize ()));
+  *thread = pthread_self ();
+}
+
+void
+MultithreadedSimulatorWifiSplitTestCase::RunScenario (Ptr<SimulatorImpl> impl)
+{
+  Simulator::SetImplementation (impl);
+  m_logs.assign (N_NODES, Log ());
+  m_threads.assign (N_NODES, pthread_t ());
+
+  NodeContainer nodes;
+  nodes.Create (N_NODES);
+
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  YansWifiPhyHelper phy = YansWifiPhyHelper::Default ();
+  Ptr<YansWifiChannel> wifiChannel = channel.Create ();
+  wifiChannel->SetAttribute ("MinimumDistance", DoubleValue (SPLIT_DISTANCE));
+  phy.SetChannel (wifiChannel);
+  NqosWifiMacHelper mac = NqosWifiMacHelper::Default ();
+  mac.SetType ("ns3::AdhocWifiMac");
+  WifiHelper wifi = WifiHelper::Default ();
+  wifi.SetStandard (WIFI_PHY_STANDARD_80211a);
+  wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                "DataMode", StringValue ("OfdmRate6Mbps"),
+                                "ControlMode", StringValue ("OfdmRate6Mbps"));
+  NetDeviceContainer devices = wifi.Install (phy, mac, nodes);
+  wifi.AssignStreams (devices, 0);
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                 "DeltaX", DoubleValue (SPLIT_DISTANCE),
+                                 "GridWidth", UintegerValue (N_NODES));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  OlsrHelper olsr;
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (olsr);
+  internet.Install (nodes);
+  olsr.AssignStreams (nodes, 20);
+  internet.AssignStreams (nodes, 40);
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  UdpServerHelper server (9);
+  ApplicationContainer serverApp = server.Install (nodes.Get (N_NODES - 1));
+  serverApp.Start (Seconds (1.0));
+  UdpClientHelper client (interfaces.GetAddress (N_NODES - 1), 9);
+  client.SetAttribute ("MaxPackets", UintegerValue (40));
+  client.SetAttribute ("Interval", TimeValue (MilliSeconds (250)));
+  client.SetAttribute ("PacketSize", UintegerValue (200));
+  ApplicationContainer clientApp = client.Install (nodes.Get (0));
+  clientApp.Start (Seconds (15.0));
+
+  for (uint32_t i = 0; i < N_NODES; ++i)
+    {
+      Ptr<WifiNetDevice> device = DynamicCast<WifiNetDevice> (devices.Get (i));
+      device->GetPhy ()->TraceConnectWithoutContext ("PhyRxEnd",
+                                                     MakeBoundCallback (&PhyRxEnd, &m_logs[i], &m_threads[i]));
+    }
+
+  Simulator::Stop (Seconds (30.0));
+  Simulator::Run ();
+  m_received = DynamicCast<UdpServer> (serverApp.Get (0))->GetReceived ();
+  Simulator::Destroy ();
+}
+
+void
+MultithreadedSimulatorWifiSplitTestCase::DoRun (void)
+{
+  RunScenario (CreateObject<DefaultSimulatorImpl> ());
+  std::vector<Log> expected = m_logs;
+  uint32_t expectedReceived = m_received;
+
+  Ptr<MultithreadedSimulatorImpl> impl = CreateObject<MultithreadedSimulatorImpl> ();
+  impl->SetAttribute ("Threads", UintegerValue (2));
+  RunScenario (impl);
+
+  NS_TEST_ASSERT_MSG_EQ (impl->GetLookahead (), Seconds (SPLIT_DISTANCE / 299792458.0),
+                         "The lookahead is not the propagation delay over the minimum distance");
+  NS_TEST_ASSERT_MSG_GT (expectedReceived, 0, "OLSR did not route the flow");
+  NS_TEST_ASSERT_MSG_EQ (m_received, expectedReceived, "Wrong number of packets received");
+  for (uint32_t id = 0; id < N_NODES; ++id)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_logs[id].size (), expected[id].size (), "Wrong number of receptions for node " << id);
+      NS_TEST_ASSERT_MSG_EQ ((m_logs[id] == expected[id]), true, "Wrong receptions for node " << id);
+      // neighbours run in different threads
+      NS_TEST_ASSERT_MSG_EQ ((pthread_equal (m_threads[id], m_threads[0]) != 0), (id % 2 == 0),
+                             "Node " << id << " ran in the wrong thread");
+    }
+}
+
+class MultithreadedSimulatorWifiTestSuite : public TestSuite
+{
+public:
+  MultithreadedSimulatorWifiTestSuite ()
+    : TestSuite ("multithreaded-simulator-wifi", SYSTEM)
+  {
+    AddTestCase (new MultithreadedSimulatorWifiTestCase, TestCase::QUICK);
+    AddTestCase (new MultithreadedSimulatorWifiSplitTestCase, TestCase::QUICK);
+  }
+} g_multithreadedSimulatorWifiTestSuite;
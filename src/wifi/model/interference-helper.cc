@@ -98,7 +98,8 @@ InterferenceHelper::Event::GetTxVector (void) const
 
 InterferenceHelper::NiChange::NiChange (Time time, double delta)
   : m_time (time),
-    m_delta (delta)
+    m_delta (delta),
+    m_power (0.0)
 {
 }
 Time
@@ -111,6 +112,16 @@ InterferenceHelper::NiChange::GetDelta (void) const
 {
   return m_delta;
 }
+double
+InterferenceHelper::NiChange::GetPower (void) const
+{
+  return m_power;
+}
+void
+InterferenceHelper::NiChange::SetPower (double power)
+{
+  m_power = power;
+}
 bool
 InterferenceHelper::NiChange::operator < (const InterferenceHelper::NiChange& o) const
 {
@@ -179,18 +190,13 @@ Time
 InterferenceHelper::GetEnergyDuration (double energyW)
 {
   Time now = Simulator::Now ();
-  double noiseInterferenceW = 0.0;
   Time end = now;
-  noiseInterferenceW = m_firstPower;
-  for (NiChanges::const_iterator i = m_niChanges.begin (); i != m_niChanges.end (); i++)
+  // the changes before now do not matter, except for the power they
+  // leave, which each change records.
+  for (NiTimeline::const_iterator i = m_niChanges.lower_bound (now); i != m_niChanges.end (); i++)
     {
-      noiseInterferenceW += i->GetDelta ();
-      end = i->GetTime ();
-      if (end < now)
-        {
-          continue;
-        }
-      if (noiseInterferenceW < energyW)
+      end = i->second.GetTime ();
+      if (i->second.GetPower () < energyW)
         {
           break;
         }
@@ -204,18 +210,10 @@ InterferenceHelper::AppendEvent (Ptr<InterferenceHelper::Event> event)
   Time now = Simulator::Now ();
   if (!m_rxing)
     {
-      NiChanges::iterator nowIterator = GetPosition (now);
-      for (NiChanges::iterator i = m_niChanges.begin (); i != nowIterator; i++)
-        {
-          m_firstPower += i->GetDelta ();
-        }
-      m_niChanges.erase (m_niChanges.begin (), nowIterator);
-      m_niChanges.insert (m_niChanges.begin (), NiChange (event->GetStartTime (), event->GetRxPowerW ()));
-    }
-  else
-    {
-      AddNiChangeEvent (NiChange (event->GetStartTime (), event->GetRxPowerW ()));
+      // the start of this event becomes the first change
+      EraseNiChanges (now);
     }
+  AddNiChangeEvent (NiChange (event->GetStartTime (), event->GetRxPowerW ()));
   AddNiChangeEvent (NiChange (event->GetEndTime (), -event->GetRxPowerW ()));
 
 }
@@ -240,13 +238,14 @@ InterferenceHelper::CalculateNoiseInterferenceW (Ptr<InterferenceHelper::Event>
 {
   double noiseInterference = m_firstPower;
   NS_ASSERT (m_rxing);
-  for (NiChanges::const_iterator i = m_niChanges.begin () + 1; i != m_niChanges.end (); i++)
+  NS_ASSERT (!m_niChanges.empty ());
+  for (NiTimeline::const_iterator i = ++m_niChanges.begin (); i != m_niChanges.end (); i++)
     {
-      if ((event->GetEndTime () == i->GetTime ()) && event->GetRxPowerW () == -i->GetDelta ())
+      if ((event->GetEndTime () == i->second.GetTime ()) && event->GetRxPowerW () == -i->second.GetDelta ())
         {
           break;
         }
-      ni->push_back (*i);
+      ni->push_back (i->second);
     }
   ni->insert (ni->begin (), NiChange (event->GetStartTime (), noiseInterference));
   ni->push_back (NiChange (event->GetEndTime (), 0));
@@ -565,16 +564,37 @@ InterferenceHelper::EraseEvents (void)
   m_rxing = false;
   m_firstPower = 0.0;
 }
-InterferenceHelper::NiChanges::iterator
-InterferenceHelper::GetPosition (Time moment)
+void
+InterferenceHelper::EraseNiChanges (Time moment)
 {
-  return std::upper_bound (m_niChanges.begin (), m_niChanges.end (), NiChange (moment, 0));
-
+  NiTimeline::iterator end = m_niChanges.upper_bound (moment);
+  if (end != m_niChanges.begin ())
+    {
+      NiTimeline::iterator last = end;
+      last--;
+      m_firstPower = last->second.GetPower ();
+      m_niChanges.erase (m_niChanges.begin (), end);
+    }
 }
 void
 InterferenceHelper::AddNiChangeEvent (NiChange change)
 {
-  m_niChanges.insert (GetPosition (change.GetTime ()), change);
+  // inserted after the changes of the same time
+  NiTimeline::iterator i = m_niChanges.insert (std::make_pair (change.GetTime (), change));
+  double power = m_firstPower;
+  if (i != m_niChanges.begin ())
+    {
+      NiTimeline::iterator previous = i;
+      previous--;
+      power = previous->second.GetPower ();
+    }
+  // the changes are summed in time order, as they would be by a walk
+  // over the whole timeline. Most changes are added at the end.
+  for (; i != m_niChanges.end (); i++)
+    {
+      power += i->second.GetDelta ();
+      i->second.SetPower (power);
+    }
 }
 void
 InterferenceHelper::NotifyRxStart ()
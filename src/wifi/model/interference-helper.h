@@ -23,6 +23,7 @@
 #include <stdint.h>
 #include <vector>
 #include <list>
+#include <map>
 #include "wifi-mode.h"
 #include "wifi-preamble.h"
 #include "wifi-phy-standard.h"
@@ -227,6 +228,18 @@ public:
      * \return the power
      */
     double GetDelta (void) const;
+    /**
+     * Return the total noise and interference power after this change.
+     *
+     * \return the power after this change
+     */
+    double GetPower (void) const;
+    /**
+     * Set the total noise and interference power after this change.
+     *
+     * \param power the power after this change
+     */
+    void SetPower (double power);
     /**
      * Compare the event time of two NiChange objects (a < o).
      *
@@ -237,11 +250,17 @@ public:
 private:
     Time m_time;
     double m_delta;
+    double m_power;
   };
   /**
    * typedef for a vector of NiChanges
    */
   typedef std::vector <NiChange> NiChanges;
+  /**
+   * typedef for the timeline of NiChanges, sorted by time. Changes of
+   * the same time are kept in insertion order.
+   */
+  typedef std::multimap <Time, NiChange> NiTimeline;
   /**
    * typedef for a list of Events
    */
@@ -295,18 +314,29 @@ private:
 
   double m_noiseFigure; /**< noise figure (linear) */
   Ptr<ErrorRateModel> m_errorRateModel;
-  /// Experimental: needed for energy duration calculation
-  NiChanges m_niChanges;
+  /**
+   * Changes of the noise and interference power since the start of
+   * the last reception, each with the total power after it, so that
+   * the power at any time is found without summing the changes.
+   */
+  NiTimeline m_niChanges;
+  /// total power before the first change of m_niChanges
   double m_firstPower;
   bool m_rxing;
-  /// Returns an iterator to the first nichange, which is later than moment
-  NiChanges::iterator GetPosition (Time moment);
   /**
-   * Add NiChange to the list at the appropriate position.
+   * Add NiChange to the timeline at the appropriate position and
+   * update the power after the later changes.
    *
    * \param change
    */
   void AddNiChangeEvent (NiChange change);
+  /**
+   * Remove the changes which happened up to the given time, folding
+   * them into m_firstPower.
+   *
+   * \param moment
+   */
+  void EraseNiChanges (Time moment);
 };
 
 } // namespace ns3
@@ -0,0 +1,381 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include "table-error-rate-model.h"
+#include "nist-error-rate-model.h"
+#include "ns3/core-config.h"
+#include "ns3/pointer.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/log.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
+
+NS_LOG_COMPONENT_DEFINE ("TableErrorRateModel");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (TableErrorRateModel);
+
+/// Initial step of the SNR grid, in dB
+static const double INITIAL_STEP = 0.5;
+/// Minimum step of the SNR grid, in dB
+static const double MIN_STEP = 1.0 / 64;
+/// Number of lengths of a class at which a table is checked
+static const uint32_t N_CHECKED_LENGTHS = 5;
+/// Number of parts an interval is divided in to check a table
+static const uint32_t N_CHECKED_POINTS = 4;
+/// Number of length classes: lengths up to 2^31 bits
+static const uint32_t N_LENGTH_CLASSES = 32;
+/// Logarithm of the smallest success rate which is not rounded to 0
+static const double MIN_LOG = -708.0;
+
+#ifdef HAVE_PTHREAD_H
+/// Protects the shared tables: the partitions of a parallel simulation
+/// build their tables concurrently
+static pthread_mutex_t g_tablesMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif /* HAVE_PTHREAD_H */
+
+TypeId
+TableErrorRateModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TableErrorRateModel")
+    .SetParent<ErrorRateModel> ()
+    .AddConstructor<TableErrorRateModel> ()
+    .AddAttribute ("ErrorRateModel",
+                   "The analytic error rate model the tables are computed from. "
+                   "If not set, a NistErrorRateModel is used.",
+                   PointerValue (),
+                   MakePointerAccessor (&TableErrorRateModel::SetErrorRateModel,
+                                        &TableErrorRateModel::GetErrorRateModel),
+                   MakePointerChecker<ErrorRateModel> ())
+    .AddAttribute ("Tolerance",
+                   "The maximum absolute error on the chunk success rate of the tables, "
+                   "checked at the quarter points of every interval of the SNR grid.",
+                   DoubleValue (1e-3),
+                   MakeDoubleAccessor (&TableErrorRateModel::SetTolerance,
+                                       &TableErrorRateModel::GetTolerance),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("CacheFile",
+                   "A file the tables are read from, and the tables built are appended to. "
+                   "If empty, the tables are only shared within the process.",
+                   StringValue (""),
+                   MakeStringAccessor (&TableErrorRateModel::m_cacheFile),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+TableErrorRateModel::TableErrorRateModel ()
+  : m_tolerance (1e-3),
+    m_minSnrDb (-10.0),
+    m_maxSnrDb (40.0)
+{
+}
+
+void
+TableErrorRateModel::SetErrorRateModel (Ptr<ErrorRateModel> model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_model = model;
+  Reset ();
+}
+
+Ptr<ErrorRateModel>
+TableErrorRateModel::GetErrorRateModel (void) const
+{
+  return m_model;
+}
+
+void
+TableErrorRateModel::SetTolerance (double tolerance)
+{
+  NS_LOG_FUNCTION (this << tolerance);
+  m_tolerance = tolerance;
+  Reset ();
+}
+
+double
+TableErrorRateModel::GetTolerance (void) const
+{
+  return m_tolerance;
+}
+
+void
+TableErrorRateModel::Reset (void)
+{
+  m_tables.clear ();
+}
+
+uint32_t
+TableErrorRateModel::GetLengthClass (uint32_t nbits)
+{
+  NS_ASSERT (nbits > 0);
+  uint32_t lengthClass = static_cast<uint32_t> (std::floor (std::log (static_cast<double> (nbits)) / std::log (2.0) + 0.5));
+  return std::min (lengthClass, N_LENGTH_CLASSES - 1);
+}
+
+double
+TableErrorRateModel::GetLogSuccess (WifiMode mode, double snrDb, uint32_t nbits) const
+{
+  double csr = m_model->GetChunkSuccessRate (mode, std::pow (10.0, snrDb / 10.0), nbits);
+  if (csr <= 0)
+    {
+      return MIN_LOG / nbits;
+    }
+  return std::log (std::min (csr, 1.0)) / nbits;
+}
+
+uint32_t
+TableErrorRateModel::GetInterval (const Table &table, double snrDb) const
+{
+  double position = (snrDb - m_minSnrDb) / table.step;
+  return std::min (static_cast<uint32_t> (position), static_cast<uint32_t> (table.logSuccess.size () - 2));
+}
+
+double
+TableErrorRateModel::Interpolate (const Table &table, uint32_t i, double snrDb) const
+{
+  double fraction = (snrDb - m_minSnrDb) / table.step - i;
+  return table.logSuccess[i] + fraction * (table.logSuccess[i + 1] - table.logSuccess[i]);
+}
+
+bool
+TableErrorRateModel::IsAccurate (WifiMode mode, const Table &table, uint32_t i, const uint32_t *lengths) const
+{
+  for (uint32_t k = 1; k < N_CHECKED_POINTS; k++)
+    {
+      double fraction = static_cast<double> (k) / N_CHECKED_POINTS;
+      double snrDb = m_minSnrDb + (i + fraction) * table.step;
+      double logSuccess = table.logSuccess[i] + fraction * (table.logSuccess[i + 1] - table.logSuccess[i]);
+      for (uint32_t j = 0; j < N_CHECKED_LENGTHS; j++)
+        {
+          double exact = std::exp (GetLogSuccess (mode, snrDb, lengths[j]) * lengths[j]);
+          if (std::fabs (std::exp (logSuccess * lengths[j]) - exact) > m_tolerance)
+            {
+              return false;
+            }
+        }
+    }
+  return true;
+}
+
+void
+TableErrorRateModel::BuildTable (WifiMode mode, uint32_t lengthClass, Table &table) const
+{
+  NS_LOG_FUNCTION (this << mode << lengthClass);
+  // The table is computed for the center of the class and checked at
+  // both of its ends and in between.
+  uint32_t center = 1u << lengthClass;
+  uint32_t lengths[N_CHECKED_LENGTHS];
+  for (uint32_t j = 0; j < N_CHECKED_LENGTHS; j++)
+    {
+      double length = center * std::pow (2.0, static_cast<double> (j) / (N_CHECKED_LENGTHS - 1) - 0.5);
+      lengths[j] = std::max<uint32_t> (1, static_cast<uint32_t> (j == 0 ? std::ceil (length) : std::floor (length)));
+    }
+
+  table.step = INITIAL_STEP;
+  while (true)
+    {
+      uint32_t n = static_cast<uint32_t> (std::ceil ((m_maxSnrDb - m_minSnrDb) / table.step)) + 1;
+      table.logSuccess.resize (n);
+      for (uint32_t i = 0; i < n; i++)
+        {
+          table.logSuccess[i] = GetLogSuccess (mode, m_minSnrDb + i * table.step, center);
+        }
+      bool accurate = true;
+      for (uint32_t i = 0; i + 1 < n && accurate; i++)
+        {
+          accurate = IsAccurate (mode, table, i, lengths);
+        }
+      if (accurate)
+        {
+          break;
+        }
+      if (table.step <= MIN_STEP)
+        {
+          // the analytic model is discontinuous, or too steep for the
+          // minimum step, somewhere
+          table.analytic.assign (n - 1, false);
+          for (uint32_t i = 0; i + 1 < n; i++)
+            {
+              table.analytic[i] = !IsAccurate (mode, table, i, lengths);
+            }
+          NS_LOG_DEBUG ("mode " << mode << " length class " << lengthClass << ": "
+                                << std::count (table.analytic.begin (), table.analytic.end (), true)
+                                << " intervals left to the analytic model");
+          break;
+        }
+      table.step /= 2;
+    }
+  NS_LOG_DEBUG ("mode " << mode << " length class " << lengthClass << ": "
+                        << table.logSuccess.size () << " points, step " << table.step << " dB");
+}
+
+std::string
+TableErrorRateModel::GetTableKey (WifiMode mode, uint32_t lengthClass) const
+{
+  std::ostringstream key;
+  key << m_model->GetInstanceTypeId ().GetName () << " " << std::setprecision (17) << m_tolerance
+      << " " << mode.GetUniqueName () << " " << lengthClass;
+  return key.str ();
+}
+
+TableErrorRateModel::SharedTables &
+TableErrorRateModel::GetSharedTables (void)
+{
+  static SharedTables tables;
+  return tables;
+}
+
+void
+TableErrorRateModel::LoadCacheFile (SharedTables &tables) const
+{
+  NS_LOG_FUNCTION (this << m_cacheFile);
+  std::ifstream file (m_cacheFile.c_str ());
+  std::string line;
+  while (std::getline (file, line))
+    {
+      // <model> <tolerance> <mode> <length class> <step> <n> <n values>
+      // <number of analytic intervals> <analytic intervals>
+      std::istringstream fields (line);
+      std::string model, tolerance, mode, lengthClass;
+      Table table;
+      uint32_t n = 0;
+      fields >> model >> tolerance >> mode >> lengthClass >> table.step >> n;
+      table.logSuccess.resize (n);
+      for (uint32_t i = 0; i < n && fields; i++)
+        {
+          fields >> table.logSuccess[i];
+        }
+      uint32_t nAnalytic = 0;
+      fields >> nAnalytic;
+      for (uint32_t i = 0; i < nAnalytic && fields; i++)
+        {
+          uint32_t interval = n;
+          fields >> interval;
+          if (interval + 1 >= n)
+            {
+              fields.setstate (std::ios::failbit);
+              break;
+            }
+          table.analytic.resize (n - 1, false);
+          table.analytic[interval] = true;
+        }
+      if (!fields || n < 2)
+        {
+          NS_LOG_WARN ("Ignoring malformed line of " << m_cacheFile);
+          continue;
+        }
+      tables.insert (std::make_pair (model + " " + tolerance + " " + mode + " " + lengthClass, table));
+    }
+}
+
+void
+TableErrorRateModel::SaveTable (const std::string &key, const Table &table) const
+{
+  std::ofstream file (m_cacheFile.c_str (), std::ios::app);
+  // with 17 digits, the tables read back are the ones which were built
+  file << key << " " << std::setprecision (17) << table.step << " " << table.logSuccess.size ();
+  for (std::vector<double>::const_iterator i = table.logSuccess.begin (); i != table.logSuccess.end (); ++i)
+    {
+      file << " " << *i;
+    }
+  file << " " << std::count (table.analytic.begin (), table.analytic.end (), true);
+  for (uint32_t i = 0; i < table.analytic.size (); i++)
+    {
+      if (table.analytic[i])
+        {
+          file << " " << i;
+        }
+    }
+  file << std::endl;
+  if (!file)
+    {
+      NS_LOG_WARN ("Could not write to " << m_cacheFile);
+    }
+}
+
+const TableErrorRateModel::Table &
+TableErrorRateModel::GetTable (WifiMode mode, uint32_t lengthClass) const
+{
+  std::vector<const Table *> &tables = m_tables[mode.GetUid ()];
+  if (tables.empty ())
+    {
+      tables.resize (N_LENGTH_CLASSES, 0);
+    }
+  if (tables[lengthClass] != 0)
+    {
+      return *tables[lengthClass];
+    }
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&g_tablesMutex);
+#endif /* HAVE_PTHREAD_H */
+  SharedTables &shared = GetSharedTables ();
+  static std::set<std::string> loaded;
+  if (!m_cacheFile.empty () && loaded.insert (m_cacheFile).second)
+    {
+      LoadCacheFile (shared);
+    }
+  std::string key = GetTableKey (mode, lengthClass);
+  SharedTables::iterator i = shared.find (key);
+  if (i == shared.end ())
+    {
+      i = shared.insert (std::make_pair (key, Table ())).first;
+      BuildTable (mode, lengthClass, i->second);
+      if (!m_cacheFile.empty ())
+        {
+          SaveTable (key, i->second);
+        }
+    }
+  // the tables are never modified nor removed once inserted
+  tables[lengthClass] = &i->second;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&g_tablesMutex);
+#endif /* HAVE_PTHREAD_H */
+  return *tables[lengthClass];
+}
+
+double
+TableErrorRateModel::GetChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const
+{
+  if (m_model == 0)
+    {
+      const_cast<TableErrorRateModel *> (this)->m_model = CreateObject<NistErrorRateModel> ();
+    }
+  double snrDb = snr > 0 ? 10.0 * std::log10 (snr) : m_minSnrDb - 1;
+  if (nbits == 0 || snrDb < m_minSnrDb || snrDb > m_maxSnrDb)
+    {
+      return m_model->GetChunkSuccessRate (mode, snr, nbits);
+    }
+  const Table &table = GetTable (mode, GetLengthClass (nbits));
+  uint32_t i = GetInterval (table, snrDb);
+  if (!table.analytic.empty () && table.analytic[i])
+    {
+      return m_model->GetChunkSuccessRate (mode, snr, nbits);
+    }
+  return std::exp (nbits * Interpolate (table, i, snrDb));
+}
+
+} // namespace ns3
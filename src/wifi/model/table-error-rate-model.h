@@ -0,0 +1,154 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef TABLE_ERROR_RATE_MODEL_H
+#define TABLE_ERROR_RATE_MODEL_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "wifi-mode.h"
+#include "error-rate-model.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup wifi
+ *
+ * An error rate model which interpolates precomputed tables of another,
+ * analytic, model (NistErrorRateModel by default).
+ *
+ * For each WifiMode and each chunk length class (lengths within a
+ * factor sqrt(2) of a power of two), the table samples the success
+ * rate per bit, log (csr) / nbits, of the analytic model over a regular
+ * grid of SNR values in dB. The grid step is halved until linear
+ * interpolation reproduces the analytic chunk success rate within the
+ * Tolerance attribute at the quarter points of every interval, for five
+ * lengths spread over the length class from one end to the other, down
+ * to a minimum step of 1/64 dB. The intervals where the tolerance is
+ * still not met with that step, e.g., around a discontinuity of the
+ * analytic model, are left to the analytic model. A lookup then costs one log10, one exp
+ * and a linear interpolation, instead of the evaluation of the coded
+ * bit error probability, which involves high powers, erfc and, for
+ * DSSS, a numerical integration.
+ *
+ * Tables are built the first time a given mode and length class are
+ * used, and shared by every TableErrorRateModel of the process with
+ * the same analytic model type and tolerance: every YansWifiPhy owns its
+ * own error rate model, but only the first one pays for the tables.
+ * When the CacheFile attribute is set, the tables found in that file
+ * are used instead of being built, and the tables built are appended
+ * to it, so that later runs skip the construction too. SNR values
+ * outside of [MinSnr, MaxSnr] are passed to the analytic model.
+ */
+class TableErrorRateModel : public ErrorRateModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TableErrorRateModel ();
+
+  /**
+   * \param model the analytic model the tables are computed from
+   */
+  void SetErrorRateModel (Ptr<ErrorRateModel> model);
+  /**
+   * \returns the analytic model the tables are computed from
+   */
+  Ptr<ErrorRateModel> GetErrorRateModel (void) const;
+  /**
+   * \param tolerance the maximum absolute error on the chunk success rate
+   */
+  void SetTolerance (double tolerance);
+  /**
+   * \returns the maximum absolute error on the chunk success rate
+   */
+  double GetTolerance (void) const;
+
+  virtual double GetChunkSuccessRate (WifiMode mode, double snr, uint32_t nbits) const;
+
+private:
+  /// Per-bit log success rate, sampled every step dB from m_minSnrDb
+  struct Table
+  {
+    double step;
+    std::vector<double> logSuccess;
+    /// intervals left to the analytic model, empty if there is none
+    std::vector<bool> analytic;
+  };
+  /// Tables shared by all the instances, by GetTableKey
+  typedef std::map<std::string, Table> SharedTables;
+
+  /**
+   * \returns the length class of a number of bits: the nearest power
+   *          of two, in log scale.
+   */
+  static uint32_t GetLengthClass (uint32_t nbits);
+  /**
+   * \returns the per-bit log success rate of the analytic model
+   */
+  double GetLogSuccess (WifiMode mode, double snrDb, uint32_t nbits) const;
+  /**
+   * \returns the table of a mode and length class, built on first use
+   */
+  const Table &GetTable (WifiMode mode, uint32_t lengthClass) const;
+  void BuildTable (WifiMode mode, uint32_t lengthClass, Table &table) const;
+  /**
+   * \returns true if the interpolation over an interval of a table is
+   *          within the tolerance for all the lengths, at the checked
+   *          points
+   */
+  bool IsAccurate (WifiMode mode, const Table &table, uint32_t i, const uint32_t *lengths) const;
+  /**
+   * \returns the key of a table in the shared tables and in the cache
+   *          file: the analytic model, the tolerance, the mode and the
+   *          length class.
+   */
+  std::string GetTableKey (WifiMode mode, uint32_t lengthClass) const;
+  /**
+   * Add the tables of a cache file to the shared tables.
+   *
+   * \param tables the shared tables
+   */
+  void LoadCacheFile (SharedTables &tables) const;
+  /**
+   * Append a table to the cache file.
+   */
+  void SaveTable (const std::string &key, const Table &table) const;
+  /**
+   * \returns the tables shared by all the instances; the caller must
+   *          hold the lock of the shared tables
+   */
+  static SharedTables &GetSharedTables (void);
+  /**
+   * \returns the interval of a table an SNR falls in
+   */
+  uint32_t GetInterval (const Table &table, double snrDb) const;
+  double Interpolate (const Table &table, uint32_t i, double snrDb) const;
+  void Reset (void);
+
+  Ptr<ErrorRateModel> m_model;
+  double m_tolerance;
+  double m_minSnrDb;
+  double m_maxSnrDb;
+  std::string m_cacheFile;
+  /// shared tables used by this instance, by mode uid, then by length class
+  mutable std::map<uint32_t, std::vector<const Table *> > m_tables;
+};
+
+} // namespace ns3
+
+#endif /* TABLE_ERROR_RATE_MODEL_H */
@@ -324,16 +324,15 @@ WifiRemoteStationManager::~WifiRemoteStationManager ()
 void
 WifiRemoteStationManager::DoDispose (void)
 {
-  for (StationStates::const_iterator i = m_states.begin (); i != m_states.end (); i++)
+  for (StationEntries::iterator i = m_entries.begin (); i != m_entries.end (); i++)
     {
-      delete (*i);
-    }
-  m_states.clear ();
-  for (Stations::const_iterator i = m_stations.begin (); i != m_stations.end (); i++)
-    {
-      delete (*i);
+      delete i->second.state;
+      for (Stations::const_iterator j = i->second.stations.begin (); j != i->second.stations.end (); j++)
+        {
+          delete (*j);
+        }
     }
-  m_stations.clear ();
+  m_entries.clear ();
 }
 void
 WifiRemoteStationManager::SetupPhy (Ptr<WifiPhy> phy)
@@ -1135,12 +1134,16 @@ WifiRemoteStationManager::GetInfo (Mac48Address address)
 WifiRemoteStationState *
 WifiRemoteStationManager::LookupState (Mac48Address address) const
 {
-  for (StationStates::const_iterator i = m_states.begin (); i != m_states.end (); i++)
+  return LookupEntry (address).state;
+}
+WifiRemoteStationManager::StationEntry &
+WifiRemoteStationManager::LookupEntry (Mac48Address address) const
+{
+  StationEntries &entries = const_cast<WifiRemoteStationManager *> (this)->m_entries;
+  StationEntries::iterator i = entries.find (address);
+  if (i != entries.end ())
     {
-      if ((*i)->m_address == address)
-        {
-          return (*i);
-        }
+      return i->second;
     }
   WifiRemoteStationState *state = new WifiRemoteStationState ();
   state->m_state = WifiRemoteStationState::BRAND_NEW;
@@ -1152,8 +1155,9 @@ WifiRemoteStationManager::LookupState (Mac48Address address) const
   state->m_rx=1;
   state->m_tx=1;
   state->m_stbc=false;
-  const_cast<WifiRemoteStationManager *> (this)->m_states.push_back (state);
-  return state;
+  StationEntry &entry = entries[address];
+  entry.state = state;
+  return entry;
 }
 WifiRemoteStation *
 WifiRemoteStationManager::Lookup (Mac48Address address, const WifiMacHeader *header) const
@@ -1172,23 +1176,22 @@ WifiRemoteStationManager::Lookup (Mac48Address address, const WifiMacHeader *hea
 WifiRemoteStation *
 WifiRemoteStationManager::Lookup (Mac48Address address, uint8_t tid) const
 {
-  for (Stations::const_iterator i = m_stations.begin (); i != m_stations.end (); i++)
+  StationEntry &entry = LookupEntry (address);
+  if (tid < entry.stations.size () && entry.stations[tid] != 0)
     {
-      if ((*i)->m_tid == tid
-          && (*i)->m_state->m_address == address)
-        {
-          return (*i);
-        }
+      return entry.stations[tid];
     }
-  WifiRemoteStationState *state = LookupState (address);
 
   WifiRemoteStation *station = DoCreateStation ();
-  station->m_state = state;
+  station->m_state = entry.state;
   station->m_tid = tid;
   station->m_ssrc = 0;
   station->m_slrc = 0;
-  // XXX
-  const_cast<WifiRemoteStationManager *> (this)->m_stations.push_back (station);
+  if (tid >= entry.stations.size ())
+    {
+      entry.stations.resize (tid + 1, 0);
+    }
+  entry.stations[tid] = station;
   return station;
 
 }
@@ -1221,11 +1224,14 @@ WifiRemoteStationManager::GetDefaultMcs (void) const
 void
 WifiRemoteStationManager::Reset (void)
 {
-  for (Stations::const_iterator i = m_stations.begin (); i != m_stations.end (); i++)
+  for (StationEntries::iterator i = m_entries.begin (); i != m_entries.end (); i++)
     {
-      delete (*i);
+      for (Stations::const_iterator j = i->second.stations.begin (); j != i->second.stations.end (); j++)
+        {
+          delete (*j);
+        }
+      i->second.stations.clear ();
     }
-  m_stations.clear ();
   m_bssBasicRateSet.clear ();
   m_bssBasicRateSet.push_back (m_defaultTxMode);
   m_bssBasicMcsSet.clear();
@@ -23,6 +23,7 @@
 #include <vector>
 #include <utility>
 #include "ns3/mac48-address.h"
+#include "ns3/sgi-hashmap.h"
 #include "ns3/traced-callback.h"
 #include "ns3/packet.h"
 #include "ns3/object.h"
@@ -850,6 +851,18 @@ private:
    * \return WifiRemoteStation corresponding to the address
    */
   WifiRemoteStation* Lookup (Mac48Address address, const WifiMacHeader *header) const;
+  /**
+   * The state of a remote station and its WifiRemoteStation objects.
+   */
+  struct StationEntry;
+  /**
+   * Return the entry of the given address, created with a new state
+   * if the address is not known yet.
+   *
+   * \param address the address of the station
+   * \return the entry of the address
+   */
+  StationEntry& LookupEntry (Mac48Address address) const;
   WifiMode GetControlAnswerMode (Mac48Address address, WifiMode reqMode);
 
   /**
@@ -875,16 +888,20 @@ private:
   uint32_t GetNFragments (const WifiMacHeader *header, Ptr<const Packet> packet);
 
   /**
-   * A vector of WifiRemoteStations
+   * A vector of WifiRemoteStations, indexed by TID
    */
   typedef std::vector <WifiRemoteStation *> Stations;
+  struct StationEntry
+  {
+    WifiRemoteStationState *state;  //!< state of the station
+    Stations stations;  //!< stations created so far, 0 for the other TIDs
+  };
   /**
-   * A vector of WifiRemoteStationStates
+   * A hash table of StationEntries, indexed by address
    */
-  typedef std::vector <WifiRemoteStationState *> StationStates;
+  typedef sgi::hash_map <Mac48Address, StationEntry, Mac48AddressHash> StationEntries;
 
-  StationStates m_states;  //!< States of known stations
-  Stations m_stations;  //!< Information for each known stations
+  StationEntries m_entries;  //!< Information for each known station
   /**
    * This is a pointer to the WifiPhy associated with this
    * WifiRemoteStationManager that is set on call to
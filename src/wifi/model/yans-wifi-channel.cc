@@ -25,10 +25,15 @@
 #include "ns3/log.h"
 #include "ns3/pointer.h"
 #include "ns3/object-factory.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/constant-position-mobility-model.h"
 #include "yans-wifi-channel.h"
 #include "yans-wifi-phy.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/propagation-delay-model.h"
+#include <algorithm>
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("YansWifiChannel");
 
@@ -50,11 +55,43 @@ YansWifiChannel::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&YansWifiChannel::m_delay),
                    MakePointerChecker<PropagationDelayModel> ())
+    .AddAttribute ("EnableCulling", "Do not schedule receptions for PHYs out of the culling range.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&YansWifiChannel::m_culling),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CullingRange", "Distance beyond which receivers are culled, m. "
+                   "Zero derives it from the loss model, tx powers and ED thresholds; "
+                   "it must be set when the loss model is not deterministic.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&YansWifiChannel::m_cullingRange),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("CullingMargin", "Margin below the ED threshold used to derive the culling range, dB.",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&YansWifiChannel::m_cullingMargin),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("CullingRefreshInterval", "Interval between full refreshes of the culling grid.",
+                   TimeValue (Seconds (1.0)),
+                   MakeTimeAccessor (&YansWifiChannel::m_cullingRefresh),
+                   MakeTimeChecker ())
+    .AddAttribute ("MinimumDistance", "Distance under which the PHYs of two different nodes never come, m. "
+                   "If positive, the nodes may run in different partitions of a parallel simulator.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&YansWifiChannel::m_minimumDistance),
+                   MakeDoubleChecker<double> (0.0))
   ;
   return tid;
 }
 
 YansWifiChannel::YansWifiChannel ()
+  : m_culling (false),
+    m_cullingRange (0.0),
+    m_cullingMargin (10.0),
+    m_cullingRefresh (Seconds (1.0)),
+    m_minimumDistance (0.0),
+    m_partitions (0),
+    m_cullingInitialized (false),
+    m_range (0.0),
+    m_maxSpeed (0.0)
 {
 }
 YansWifiChannel::~YansWifiChannel ()
@@ -63,6 +100,29 @@ YansWifiChannel::~YansWifiChannel ()
   m_phyList.clear ();
 }
 
+void
+YansWifiChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  // The CourseChange callbacks hold a raw pointer to this channel
+  for (std::vector<Ptr<MobilityModel> >::const_iterator i = m_connectedMobility.begin ();
+       i != m_connectedMobility.end (); i++)
+    {
+      (*i)->TraceDisconnectWithoutContext ("CourseChange",
+                                           MakeCallback (&YansWifiChannel::CourseChanged, this));
+    }
+  m_connectedMobility.clear ();
+  m_mobilityPhys.clear ();
+  m_phyCell.clear ();
+  m_grid.clear ();
+  m_cullingInitialized = false;
+  m_phyList.clear ();
+  m_senders.clear ();
+  m_loss = 0;
+  m_delay = 0;
+  WifiChannel::DoDispose ();
+}
+
 void
 YansWifiChannel::SetPropagationLossModel (Ptr<PropagationLossModel> loss)
 {
@@ -80,42 +140,336 @@ YansWifiChannel::Send (Ptr<YansWifiPhy> sender, Ptr<const Packet> packet, double
 {
   Ptr<MobilityModel> senderMobility = sender->GetMobility ()->GetObject<MobilityModel> ();
   NS_ASSERT (senderMobility != 0);
-  uint32_t j = 0;
-  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++, j++)
+  // The sender may still modify its packet: the receivers share a
+  // snapshot of it, which none of them modifies
+  Ptr<const Packet> frame = packet->Copy ();
+  if (m_culling && !m_cullingInitialized)
     {
-      if (sender != (*i))
+      InitializeCulling ();
+    }
+  if (!m_phyPartition.empty ())
+    {
+      // The receivers of another partition may not be touched from
+      // here: hand them a copy of the frame which shares nothing with
+      // this one, one per partition, and let them do the rest.
+      uint32_t from = 0;
+      while (m_phyList[from] != sender)
+        {
+          from++;
+        }
+      Transmission tx;
+      tx.position = senderMobility->GetPosition ();
+      tx.txPowerDbm = txPowerDbm;
+      tx.channelNumber = sender->GetChannelNumber ();
+      tx.txVector = txVector;
+      tx.preamble = preamble;
+      std::vector<Ptr<const Packet> > copies (m_partitions);
+      for (uint32_t j = 0; j < m_phyList.size (); j++)
         {
-          // For now don't account for inter channel interference
-          if ((*i)->GetChannelNumber () != sender->GetChannelNumber ())
+          uint32_t p = m_phyPartition[j];
+          if (p == m_phyPartition[from])
             {
+              ScheduleReceive (j, sender, senderMobility, frame, txPowerDbm, txVector, preamble);
               continue;
             }
+          if (copies[p] == 0)
+            {
+              copies[p] = frame->DeepCopy ();
+            }
+          tx.packet = copies[p];
+          Simulator::ScheduleWithContext (m_phyNode[j], m_lookahead, &YansWifiChannel::Arrive, this, j, tx);
+        }
+      return;
+    }
+  if (!m_culling || m_range <= 0.0)
+    {
+      for (uint32_t j = 0; j < m_phyList.size (); j++)
+        {
+          ScheduleReceive (j, sender, senderMobility, frame, txPowerDbm, txVector, preamble);
+        }
+      return;
+    }
 
-          Ptr<MobilityModel> receiverMobility = (*i)->GetMobility ()->GetObject<MobilityModel> ();
-          Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
-          double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
-          NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
-                        "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
-          Ptr<Packet> copy = packet->Copy ();
-          Ptr<Object> dstNetDevice = m_phyList[j]->GetDevice ();
-          uint32_t dstNode;
-          if (dstNetDevice == 0)
+  double drift = m_maxSpeed * (Simulator::Now () - m_gridTime).GetSeconds ();
+  if (Simulator::Now () >= m_gridTime + m_cullingRefresh || drift > m_range / 2)
+    {
+      RefreshGrid ();
+      drift = 0.0;
+    }
+  // Receivers may have moved by up to drift since they were bucketed
+  double radius = m_range + drift;
+  int64_t span = static_cast<int64_t> (std::ceil (radius / m_range));
+  Cell center = GetCell (senderMobility->GetPosition ());
+  std::vector<uint32_t> candidates;
+  for (int64_t dx = -span; dx <= span; dx++)
+    {
+      for (int64_t dy = -span; dy <= span; dy++)
+        {
+          Grid::const_iterator c = m_grid.find (Cell (center.first + dx, center.second + dy));
+          if (c != m_grid.end ())
             {
-              dstNode = 0xffffffff;
+              candidates.insert (candidates.end (), c->second.begin (), c->second.end ());
             }
-          else
+        }
+    }
+  // Keep the PHY list order so that same-time receptions are scheduled
+  // exactly as without culling
+  std::sort (candidates.begin (), candidates.end ());
+  for (std::vector<uint32_t>::const_iterator i = candidates.begin (); i != candidates.end (); i++)
+    {
+      Ptr<MobilityModel> receiverMobility = m_phyList[*i]->GetMobility ()->GetObject<MobilityModel> ();
+      if (senderMobility->GetDistanceFrom (receiverMobility) > m_range)
+        {
+          continue;
+        }
+      ScheduleReceive (*i, sender, senderMobility, frame, txPowerDbm, txVector, preamble);
+    }
+}
+
+void
+YansWifiChannel::ScheduleReceive (uint32_t j, Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility,
+                                  Ptr<const Packet> packet, double txPowerDbm,
+                                  WifiTxVector txVector, WifiPreamble preamble) const
+{
+  if (sender == m_phyList[j])
+    {
+      return;
+    }
+  // For now don't account for inter channel interference
+  if (m_phyList[j]->GetChannelNumber () != sender->GetChannelNumber ())
+    {
+      return;
+    }
+
+  Ptr<MobilityModel> receiverMobility = m_phyList[j]->GetMobility ()->GetObject<MobilityModel> ();
+  Time delay = m_delay->GetDelay (senderMobility, receiverMobility);
+  double rxPowerDbm = m_loss->CalcRxPower (txPowerDbm, senderMobility, receiverMobility);
+  NS_LOG_DEBUG ("propagation: txPower=" << txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
+                "distance=" << senderMobility->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
+  Ptr<Object> dstNetDevice = m_phyList[j]->GetDevice ();
+  uint32_t dstNode;
+  if (dstNetDevice == 0)
+    {
+      dstNode = 0xffffffff;
+    }
+  else
+    {
+      dstNode = dstNetDevice->GetObject<NetDevice> ()->GetNode ()->GetId ();
+    }
+  Simulator::ScheduleWithContext (dstNode,
+                                  delay, &YansWifiChannel::Receive, this,
+                                  j, packet, rxPowerDbm, txVector, preamble);
+}
+
+YansWifiChannel::Cell
+YansWifiChannel::GetCell (const Vector &position) const
+{
+  return Cell (static_cast<int64_t> (std::floor (position.x / m_range)),
+               static_cast<int64_t> (std::floor (position.y / m_range)));
+}
+
+void
+YansWifiChannel::InitializeCulling (void) const
+{
+  NS_LOG_FUNCTION (this);
+  m_cullingInitialized = true;
+  m_range = m_cullingRange;
+  if (m_range <= 0.0 && !m_phyList.empty () && !IsDeterministicLoss ())
+    {
+      // Probing a random model would draw from the simulation streams,
+      // and a single draw is no bound on the range anyway
+      NS_LOG_WARN ("The propagation loss model is not deterministic and no CullingRange "
+                   "is set, culling disabled");
+    }
+  else if (m_range <= 0.0 && !m_phyList.empty ())
+    {
+      double txPowerDbm = -1e9;
+      double thresholdDbm = 1e9;
+      for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++)
+        {
+          txPowerDbm = std::max (txPowerDbm, (*i)->GetTxPowerEnd () + (*i)->GetTxGain ());
+          thresholdDbm = std::min (thresholdDbm, (*i)->GetEdThreshold () - (*i)->GetRxGain ());
+        }
+      thresholdDbm -= m_cullingMargin;
+
+      Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+      Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+      a->SetPosition (Vector (0.0, 0.0, 0.0));
+      // Find a distance at which the signal is below the threshold, then
+      // bisect down to the crossing.
+      double far = 1.0;
+      const double maxRange = 1e7;
+      b->SetPosition (Vector (far, 0.0, 0.0));
+      while (far < maxRange && m_loss->CalcRxPower (txPowerDbm, a, b) >= thresholdDbm)
+        {
+          far *= 2;
+          b->SetPosition (Vector (far, 0.0, 0.0));
+        }
+      if (far >= maxRange)
+        {
+          NS_LOG_WARN ("Could not derive a culling range from the loss model, culling disabled");
+          m_range = 0.0;
+        }
+      else
+        {
+          double near = far / 2;
+          for (uint32_t k = 0; k < 32; k++)
             {
-              dstNode = dstNetDevice->GetObject<NetDevice> ()->GetNode ()->GetId ();
+              double mid = (near + far) / 2;
+              b->SetPosition (Vector (mid, 0.0, 0.0));
+              if (m_loss->CalcRxPower (txPowerDbm, a, b) >= thresholdDbm)
+                {
+                  near = mid;
+                }
+              else
+                {
+                  far = mid;
+                }
             }
-          Simulator::ScheduleWithContext (dstNode,
-                                          delay, &YansWifiChannel::Receive, this,
-                                          j, copy, rxPowerDbm, txVector, preamble);
+          m_range = far;
+        }
+      NS_LOG_DEBUG ("derived culling range " << m_range << "m for txPower=" << txPowerDbm <<
+                    "dbm, threshold=" << thresholdDbm << "dbm");
+    }
+  if (m_range <= 0.0)
+    {
+      return;
+    }
+
+  // Mobility models stay in the map once connected, so that a rebuild
+  // after Add does not connect them twice
+  for (std::map<const MobilityModel *, std::vector<uint32_t> >::iterator i = m_mobilityPhys.begin ();
+       i != m_mobilityPhys.end (); i++)
+    {
+      i->second.clear ();
+    }
+  for (uint32_t j = 0; j < m_phyList.size (); j++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[j]->GetMobility ()->GetObject<MobilityModel> ();
+      NS_ASSERT (mobility != 0);
+      std::map<const MobilityModel *, std::vector<uint32_t> >::iterator i =
+        m_mobilityPhys.find (PeekPointer (mobility));
+      if (i == m_mobilityPhys.end ())
+        {
+          mobility->TraceConnectWithoutContext ("CourseChange",
+                                                MakeCallback (&YansWifiChannel::CourseChanged, this));
+          m_connectedMobility.push_back (mobility);
+          i = m_mobilityPhys.insert (std::make_pair (PeekPointer (mobility), std::vector<uint32_t> ())).first;
+        }
+      i->second.push_back (j);
+    }
+  RefreshGrid ();
+}
+
+bool
+YansWifiChannel::IsDeterministicLoss (void) const
+{
+  // Models known to neither draw random variables nor keep per-link state
+  static const char *deterministic[] = {
+    "ns3::FriisPropagationLossModel",
+    "ns3::TwoRayGroundPropagationLossModel",
+    "ns3::LogDistancePropagationLossModel",
+    "ns3::ThreeLogDistancePropagationLossModel",
+    "ns3::FixedRssLossModel",
+    "ns3::MatrixPropagationLossModel",
+    "ns3::RangePropagationLossModel",
+    "ns3::Cost231PropagationLossModel",
+    "ns3::OkumuraHataPropagationLossModel",
+    "ns3::Kun2600MhzPropagationLossModel",
+    "ns3::ItuR1411LosPropagationLossModel",
+    "ns3::ItuR1411NlosOverRooftopPropagationLossModel"
+  };
+  const uint32_t n = sizeof (deterministic) / sizeof (deterministic[0]);
+  for (Ptr<PropagationLossModel> loss = m_loss; loss != 0; loss = loss->GetNext ())
+    {
+      std::string name = loss->GetInstanceTypeId ().GetName ();
+      if (std::find (deterministic, deterministic + n, name) == deterministic + n)
+        {
+          NS_LOG_DEBUG ("loss model " << name << " is not known to be deterministic");
+          return false;
         }
     }
+  return true;
+}
+
+void
+YansWifiChannel::RefreshGrid (void) const
+{
+  NS_LOG_FUNCTION (this);
+  m_grid.clear ();
+  m_phyCell.resize (m_phyList.size ());
+  m_maxSpeed = 0.0;
+  for (uint32_t j = 0; j < m_phyList.size (); j++)
+    {
+      Ptr<MobilityModel> mobility = m_phyList[j]->GetMobility ()->GetObject<MobilityModel> ();
+      Vector v = mobility->GetVelocity ();
+      m_maxSpeed = std::max (m_maxSpeed, std::sqrt (v.x * v.x + v.y * v.y + v.z * v.z));
+      m_phyCell[j] = GetCell (mobility->GetPosition ());
+      m_grid[m_phyCell[j]].push_back (j);
+    }
+  m_gridTime = Simulator::Now ();
+}
+
+void
+YansWifiChannel::MovePhy (uint32_t j, const Cell &cell) const
+{
+  if (m_phyCell[j] == cell)
+    {
+      return;
+    }
+  std::vector<uint32_t> &old = m_grid[m_phyCell[j]];
+  old.erase (std::find (old.begin (), old.end (), j));
+  if (old.empty ())
+    {
+      m_grid.erase (m_phyCell[j]);
+    }
+  m_grid[cell].push_back (j);
+  m_phyCell[j] = cell;
 }
 
 void
-YansWifiChannel::Receive (uint32_t i, Ptr<Packet> packet, double rxPowerDbm,
+YansWifiChannel::CourseChanged (Ptr<const MobilityModel> mobility) const
+{
+  std::map<const MobilityModel *, std::vector<uint32_t> >::const_iterator it =
+    m_mobilityPhys.find (PeekPointer (mobility));
+  if (it == m_mobilityPhys.end () || m_range <= 0.0)
+    {
+      return;
+    }
+  Vector v = mobility->GetVelocity ();
+  m_maxSpeed = std::max (m_maxSpeed, std::sqrt (v.x * v.x + v.y * v.y + v.z * v.z));
+  Cell cell = GetCell (mobility->GetPosition ());
+  for (std::vector<uint32_t>::const_iterator j = it->second.begin (); j != it->second.end (); j++)
+    {
+      MovePhy (*j, cell);
+    }
+}
+
+void
+YansWifiChannel::Arrive (uint32_t j, Transmission tx) const
+{
+  // For now don't account for inter channel interference
+  if (m_phyList[j]->GetChannelNumber () != tx.channelNumber)
+    {
+      return;
+    }
+  m_senders[j]->SetPosition (tx.position);
+  Ptr<MobilityModel> receiverMobility = m_phyList[j]->GetMobility ()->GetObject<MobilityModel> ();
+  Time delay = m_delay->GetDelay (m_senders[j], receiverMobility);
+  if (delay < m_lookahead)
+    {
+      NS_FATAL_ERROR ("PHYs " << m_senders[j]->GetDistanceFrom (receiverMobility) << "m apart, "
+                      "closer than the MinimumDistance " << m_minimumDistance << "m of the channel");
+    }
+  double rxPowerDbm = m_loss->CalcRxPower (tx.txPowerDbm, m_senders[j], receiverMobility);
+  NS_LOG_DEBUG ("propagation: txPower=" << tx.txPowerDbm << "dbm, rxPower=" << rxPowerDbm << "dbm, " <<
+                "distance=" << m_senders[j]->GetDistanceFrom (receiverMobility) << "m, delay=" << delay);
+  Simulator::Schedule (delay - m_lookahead, &YansWifiChannel::Receive, this,
+                       j, tx.packet, rxPowerDbm, tx.txVector, tx.preamble);
+}
+
+void
+YansWifiChannel::Receive (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
                           WifiTxVector txVector, WifiPreamble preamble) const
 {
   m_phyList[i]->StartReceivePacket (packet, rxPowerDbm, txVector, preamble);
@@ -132,10 +486,60 @@ YansWifiChannel::GetDevice (uint32_t i) const
   return m_phyList[i]->GetDevice ()->GetObject<NetDevice> ();
 }
 
+Time
+YansWifiChannel::GetLookahead (void) const
+{
+  Ptr<ConstantSpeedPropagationDelayModel> delay = DynamicCast<ConstantSpeedPropagationDelayModel> (m_delay);
+  if (m_minimumDistance <= 0.0 || m_culling || delay == 0 || !IsDeterministicLoss ())
+    {
+      return Seconds (0);
+    }
+  for (Ptr<PropagationLossModel> loss = m_loss; loss != 0; loss = loss->GetNext ())
+    {
+      // The matrix model looks the loss up by mobility model, which the
+      // receivers of another partition see through a stand-in
+      if (loss->GetInstanceTypeId () == MatrixPropagationLossModel::GetTypeId ())
+        {
+          return Seconds (0);
+        }
+    }
+  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++)
+    {
+      Ptr<Object> device = (*i)->GetDevice ();
+      if (device == 0 || device->GetObject<NetDevice> ()->GetNode () == 0)
+        {
+          return Seconds (0);
+        }
+    }
+  return Seconds (m_minimumDistance / delay->GetSpeed ());
+}
+
+void
+YansWifiChannel::SetPartitions (const std::vector<uint32_t> &nodePartition)
+{
+  NS_LOG_FUNCTION (this);
+  m_lookahead = GetLookahead ();
+  m_phyPartition.clear ();
+  m_phyNode.clear ();
+  m_senders.clear ();
+  m_partitions = 0;
+  for (PhyList::const_iterator i = m_phyList.begin (); i != m_phyList.end (); i++)
+    {
+      uint32_t node = (*i)->GetDevice ()->GetObject<NetDevice> ()->GetNode ()->GetId ();
+      m_phyNode.push_back (node);
+      m_phyPartition.push_back (nodePartition[node]);
+      m_senders.push_back (CreateObject<ConstantPositionMobilityModel> ());
+      m_partitions = std::max (m_partitions, nodePartition[node] + 1);
+    }
+}
+
 void
 YansWifiChannel::Add (Ptr<YansWifiPhy> phy)
 {
+  NS_ASSERT_MSG (m_phyPartition.empty (), "PHY added to a channel split between partitions");
   m_phyList.push_back (phy);
+  // The culling grid, if any, is rebuilt on the next Send
+  m_cullingInitialized = false;
 }
 
 int64_t
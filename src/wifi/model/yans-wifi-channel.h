@@ -21,8 +21,11 @@
 #define YANS_WIFI_CHANNEL_H
 
 #include <vector>
+#include <map>
 #include <stdint.h>
 #include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
 #include "wifi-channel.h"
 #include "wifi-mode.h"
 #include "wifi-preamble.h"
@@ -34,6 +37,7 @@ class NetDevice;
 class PropagationLossModel;
 class PropagationDelayModel;
 class YansWifiPhy;
+class MobilityModel;
 
 /**
  * \brief A Yans wifi channel
@@ -46,6 +50,40 @@ class YansWifiPhy;
  * class and contains a ns3::PropagationLossModel and a ns3::PropagationDelayModel.
  * By default, no propagation models are set so, it is the caller's responsability
  * to set them before using the channel.
+ *
+ * When the EnableCulling attribute is set, Send does not schedule a
+ * reception for PHYs that are further away than the culling range. The
+ * PHY positions are kept in a uniform grid with one cell per culling
+ * range, updated on every mobility course change and re-bucketed every
+ * CullingRefreshInterval; between refreshes the query radius is widened by
+ * the distance the fastest PHY may have travelled. If CullingRange is zero,
+ * the range is derived once from the propagation loss model as the
+ * distance at which the highest transmit power of the attached PHYs falls
+ * below the lowest energy detection threshold minus CullingMargin. This
+ * derivation assumes a loss that does not decrease with distance, and is
+ * only done when every model of the loss chain is known to be
+ * deterministic: probing a random model would consume draws of the
+ * simulation streams. With any other model culling stays disabled unless
+ * CullingRange is set. Culled frames no longer contribute to the interference seen
+ * by distant receivers, so the margin should cover the aggregate
+ * sub-threshold interference the scenario cares about.
+ *
+ * Send takes a single copy of the frame, which every receiver shares
+ * read-only; a YansWifiPhy copies it again only when it synchronizes to
+ * the frame, so the receivers which drop it copy nothing.
+ *
+ * When MinimumDistance is set, the propagation delay model is a
+ * ConstantSpeedPropagationDelayModel, the loss chain is deterministic
+ * and culling is disabled, the nodes of the channel may run in
+ * different partitions of a MultithreadedSimulatorImpl, with the
+ * propagation delay over MinimumDistance as lookahead. A receiver of
+ * another partition then gets a deep copy of the frame, shared by all
+ * the receivers of its partition, after the lookahead; the rest of the
+ * propagation delay, the received power and the channel number check
+ * are computed there, from the position of the sender at the start of
+ * the transmission and the position of the receiver at the end of the
+ * lookahead. Two PHYs of different nodes closer than MinimumDistance
+ * are a fatal error.
  */
 class YansWifiChannel : public WifiChannel
 {
@@ -58,6 +96,8 @@ public:
   // inherited from Channel.
   virtual uint32_t GetNDevices (void) const;
   virtual Ptr<NetDevice> GetDevice (uint32_t i) const;
+  virtual Time GetLookahead (void) const;
+  virtual void SetPartitions (const std::vector<uint32_t> &nodePartition);
 
   /**
    * Adds the given YansWifiPhy to the PHY list
@@ -104,6 +144,8 @@ private:
   //YansWifiChannel& operator = (const YansWifiChannel &);
   //YansWifiChannel (const YansWifiChannel &);
 
+  virtual void DoDispose (void);
+
   /**
    * A vector of pointers to YansWifiPhy.
    */
@@ -114,18 +156,115 @@ private:
    * bit of the packet has arrived.
    *
    * \param i index of the corresponding YansWifiPhy in the PHY list
-   * \param packet the packet being sent
+   * \param packet the packet being sent, shared by all the receivers
    * \param rxPowerDbm the received power of the packet
    * \param txVector the TXVECTOR of the packet
    * \param preamble the type of preamble being used to send the packet
    */
-  void Receive (uint32_t i, Ptr<Packet> packet, double rxPowerDbm,
+  void Receive (uint32_t i, Ptr<const Packet> packet, double rxPowerDbm,
                 WifiTxVector txVector, WifiPreamble preamble) const;
 
+  /**
+   * Schedule the reception of the packet by the PHY at index j.
+   *
+   * \param j index of the receiving YansWifiPhy in the PHY list
+   * \param sender the sending YansWifiPhy
+   * \param senderMobility the mobility model of the sender
+   * \param packet the packet being sent, shared by all the receivers
+   * \param txPowerDbm the tx power associated to the packet
+   * \param txVector the TXVECTOR of the packet
+   * \param preamble the type of preamble being used to send the packet
+   */
+  void ScheduleReceive (uint32_t j, Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility,
+                        Ptr<const Packet> packet, double txPowerDbm,
+                        WifiTxVector txVector, WifiPreamble preamble) const;
+
+  /// A transmission handed over to the partition of a receiver
+  struct Transmission
+  {
+    Ptr<const Packet> packet; //!< copy of the frame owned by the partition of the receiver
+    Vector position; //!< position of the sender at the start of the transmission
+    double txPowerDbm; //!< tx power of the frame
+    uint16_t channelNumber; //!< channel number of the sender
+    WifiTxVector txVector; //!< TXVECTOR of the frame
+    WifiPreamble preamble; //!< preamble of the frame
+  };
+
+  /**
+   * This method is scheduled by Send, after the lookahead, for each
+   * YansWifiPhy of another partition. It runs in the partition of the
+   * receiver, and schedules its Receive after the rest of the
+   * propagation delay.
+   *
+   * \param j index of the receiving YansWifiPhy in the PHY list
+   * \param tx the transmission
+   */
+  void Arrive (uint32_t j, Transmission tx) const;
+
+  /// Cell of the culling grid
+  typedef std::pair<int64_t, int64_t> Cell;
+  /// Culling grid: PHY indices per cell
+  typedef std::map<Cell, std::vector<uint32_t> > Grid;
+
+  /**
+   * \param position a position
+   * \return the grid cell containing the position
+   */
+  Cell GetCell (const Vector &position) const;
+  /**
+   * Derive the culling range from the loss model, if it was not
+   * configured, and connect to the course change of every PHY.
+   */
+  void InitializeCulling (void) const;
+  /**
+   * \return true if every model of the loss chain is known to compute
+   * the loss from the positions alone, without random draws
+   */
+  bool IsDeterministicLoss (void) const;
+  /**
+   * Re-bucket every PHY at its current position.
+   */
+  void RefreshGrid (void) const;
+  /**
+   * Move the PHYs using this mobility model to the cell of its current
+   * position.
+   *
+   * \param mobility the mobility model whose course changed
+   */
+  void CourseChanged (Ptr<const MobilityModel> mobility) const;
+  /**
+   * Move the PHY at index j to the given cell.
+   *
+   * \param j index of the PHY in the PHY list
+   * \param cell the new cell
+   */
+  void MovePhy (uint32_t j, const Cell &cell) const;
+
 
   PhyList m_phyList; //!< List of YansWifiPhys connected to this YansWifiChannel
   Ptr<PropagationLossModel> m_loss; //!< Propagation loss model
   Ptr<PropagationDelayModel> m_delay; //!< Propagation delay model
+
+  bool m_culling; //!< Whether out of range receivers are culled
+  double m_cullingRange; //!< Configured culling range, m (0 means derived)
+  double m_cullingMargin; //!< Margin below the ED threshold for the derived range, dB
+  Time m_cullingRefresh; //!< Interval between full grid refreshes
+  double m_minimumDistance; //!< Minimum distance between the PHYs of different nodes, m (0 means unknown)
+
+  Time m_lookahead; //!< Lookahead of the channel, when split between partitions
+  std::vector<uint32_t> m_phyPartition; //!< Partition of each PHY, empty unless split
+  std::vector<uint32_t> m_phyNode; //!< Node id of each PHY, empty unless split
+  uint32_t m_partitions; //!< Number of partitions the PHYs are in
+  std::vector<Ptr<MobilityModel> > m_senders; //!< Stand-in for the sender, per receiving PHY
+
+  mutable bool m_cullingInitialized; //!< Whether InitializeCulling ran
+  mutable double m_range; //!< Effective culling range, m
+  mutable Grid m_grid; //!< PHY indices per cell
+  mutable std::vector<Cell> m_phyCell; //!< Current cell of each PHY
+  mutable std::map<const MobilityModel *, std::vector<uint32_t> > m_mobilityPhys; //!< PHYs per mobility model
+  mutable std::vector<Ptr<MobilityModel> > m_connectedMobility; //!< Mobility models whose CourseChange is connected
+  mutable Time m_gridTime; //!< Time of the last full grid refresh
+  mutable double m_maxSpeed; //!< Highest PHY speed seen since the last refresh, m/s
 };
 
 } // namespace ns3
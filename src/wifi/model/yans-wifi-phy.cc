@@ -443,7 +443,7 @@ YansWifiPhy::SetReceiveErrorCallback (RxErrorCallback callback)
   m_state->SetReceiveErrorCallback (callback);
 }
 void
-YansWifiPhy::StartReceivePacket (Ptr<Packet> packet,
+YansWifiPhy::StartReceivePacket (Ptr<const Packet> packet,
                                  double rxPowerDbm,
                                  WifiTxVector txVector,
                                  enum WifiPreamble preamble)
@@ -515,10 +515,12 @@ YansWifiPhy::StartReceivePacket (Ptr<Packet> packet,
               // sync to signal
               m_state->SwitchToRx (rxDuration);
               NS_ASSERT (m_endRxEvent.IsExpired ());
-              NotifyRxBegin (packet);
+              // the packet is tagged and handed up from here on
+              Ptr<Packet> copy = packet->Copy ();
+              NotifyRxBegin (copy);
               m_interference.NotifyRxStart ();
               m_endRxEvent = Simulator::Schedule (rxDuration, &YansWifiPhy::EndReceive, this,
-                                                  packet,
+                                                  copy,
                                                   event);
             }
           else
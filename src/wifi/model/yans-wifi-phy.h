@@ -98,12 +98,15 @@ public:
   /**
    * Starting receiving the packet (i.e. the first bit of the preamble has arrived).
    *
+   * The packet may be shared with the other receivers of the frame: the
+   * PHY makes its own copy only if it synchronizes to the frame.
+   *
    * \param packet the arriving packet
    * \param rxPowerDbm the receive power in dBm
    * \param txVector the TXVECTOR of the arriving packet
    * \param preamble the preamble of the arriving packet
    */
-  void StartReceivePacket (Ptr<Packet> packet,
+  void StartReceivePacket (Ptr<const Packet> packet,
                            double rxPowerDbm,
                            WifiTxVector txVector,
                            WifiPreamble preamble);
@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/table-error-rate-model.h"
+#include "ns3/nist-error-rate-model.h"
+#include "ns3/yans-error-rate-model.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+#include <cmath>
+#include <fstream>
+#include <string>
+
+using namespace ns3;
+
+/**
+ * Check that TableErrorRateModel stays within its tolerance of the
+ * analytic model it is built from, for OFDM and DSSS modes, over a sweep
+ * of SNR values and chunk lengths which are not powers of two.
+ */
+class TableErrorRateModelTest : public TestCase
+{
+public:
+  TableErrorRateModelTest (Ptr<ErrorRateModel> model, std::string name);
+
+private:
+  virtual void DoRun (void);
+  void Check (Ptr<TableErrorRateModel> table, WifiMode mode, uint32_t nbits,
+              double minSnrDb = -15.0, double maxSnrDb = 45.0, double stepDb = 0.37);
+
+  Ptr<ErrorRateModel> m_model;
+};
+
+TableErrorRateModelTest::TableErrorRateModelTest (Ptr<ErrorRateModel> model, std::string name)
+  : TestCase ("Check the accuracy of TableErrorRateModel against " + name),
+    m_model (model)
+{
+}
+
+void
+TableErrorRateModelTest::Check (Ptr<TableErrorRateModel> table, WifiMode mode, uint32_t nbits,
+                                double minSnrDb, double maxSnrDb, double stepDb)
+{
+  double tolerance = table->GetTolerance ();
+  for (double snrDb = minSnrDb; snrDb <= maxSnrDb; snrDb += stepDb)
+    {
+      double snr = std::pow (10.0, snrDb / 10.0);
+      double expected = m_model->GetChunkSuccessRate (mode, snr, nbits);
+      double actual = table->GetChunkSuccessRate (mode, snr, nbits);
+      NS_TEST_ASSERT_MSG_EQ_TOL (actual, expected, tolerance,
+                                 "Wrong success rate for " << mode << ", " << nbits << " bits at " << snrDb << " dB");
+    }
+}
+
+void
+TableErrorRateModelTest::DoRun (void)
+{
+  Ptr<TableErrorRateModel> table = CreateObject<TableErrorRateModel> ();
+  table->SetErrorRateModel (m_model);
+  uint32_t lengths[] = { 14 * 8, 700, 1500 * 8 };
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Check (table, WifiPhy::GetOfdmRate6Mbps (), lengths[i]);
+      Check (table, WifiPhy::GetOfdmRate54Mbps (), lengths[i]);
+      Check (table, WifiPhy::GetDsssRate1Mbps (), lengths[i]);
+      Check (table, WifiPhy::GetDsssRate11Mbps (), lengths[i]);
+      // without GSL, the DSSS models jump to a zero BER at 10 dB
+      Check (table, WifiPhy::GetDsssRate11Mbps (), lengths[i], 9.0, 11.0, 0.001);
+    }
+  NS_TEST_ASSERT_MSG_EQ (table->GetChunkSuccessRate (WifiPhy::GetOfdmRate6Mbps (), 10.0, 0), 1.0,
+                         "An empty chunk is always received");
+}
+
+/**
+ * Check that the tables are shared by the models with the same analytic
+ * model and tolerance, read from the cache file and appended to it.
+ */
+class TableErrorRateModelCacheTest : public TestCase
+{
+public:
+  TableErrorRateModelCacheTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+TableErrorRateModelCacheTest::TableErrorRateModelCacheTest ()
+  : TestCase ("Check the sharing and the cache file of the TableErrorRateModel tables")
+{
+}
+
+void
+TableErrorRateModelCacheTest::DoRun (void)
+{
+  // A table of length class 7 which receives everything, under a
+  // tolerance no other test uses
+  std::string cacheFile = CreateTempDirFilename ("table-error-rate-model-cache.txt");
+  {
+    std::ofstream file (cacheFile.c_str ());
+    file << "ns3::NistErrorRateModel 0.25 OfdmRate6Mbps 7 0.5 101";
+    for (uint32_t i = 0; i < 101; i++)
+      {
+        file << " 0";
+      }
+    file << " 0" << std::endl;
+  }
+
+  Ptr<TableErrorRateModel> table = CreateObject<TableErrorRateModel> ();
+  table->SetErrorRateModel (CreateObject<NistErrorRateModel> ());
+  table->SetTolerance (0.25);
+  table->SetAttribute ("CacheFile", StringValue (cacheFile));
+  NS_TEST_ASSERT_MSG_EQ (table->GetChunkSuccessRate (WifiPhy::GetOfdmRate6Mbps (), 1.0, 128), 1.0,
+                         "The table was not read from the cache file");
+  table->GetChunkSuccessRate (WifiPhy::GetOfdmRate6Mbps (), 1.0, 1024);
+  std::ifstream file (cacheFile.c_str ());
+  std::string line;
+  uint32_t lines = 0;
+  while (std::getline (file, line))
+    {
+      lines++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (lines, 2, "The table built was not appended to the cache file");
+
+  // Another model with the same analytic model and tolerance uses the
+  // same tables, without a cache file
+  Ptr<TableErrorRateModel> other = CreateObject<TableErrorRateModel> ();
+  other->SetErrorRateModel (CreateObject<NistErrorRateModel> ());
+  other->SetTolerance (0.25);
+  NS_TEST_ASSERT_MSG_EQ (other->GetChunkSuccessRate (WifiPhy::GetOfdmRate6Mbps (), 1.0, 128), 1.0,
+                         "The tables are not shared");
+}
+
+class TableErrorRateModelTestSuite : public TestSuite
+{
+public:
+  TableErrorRateModelTestSuite ();
+};
+
+TableErrorRateModelTestSuite::TableErrorRateModelTestSuite ()
+  : TestSuite ("devices-wifi-table-error-rate", UNIT)
+{
+  AddTestCase (new TableErrorRateModelTest (CreateObject<NistErrorRateModel> (), "NistErrorRateModel"), TestCase::QUICK);
+  AddTestCase (new TableErrorRateModelTest (CreateObject<YansErrorRateModel> (), "YansErrorRateModel"), TestCase::QUICK);
+  AddTestCase (new TableErrorRateModelCacheTest, TestCase::QUICK);
+}
+
+static TableErrorRateModelTestSuite g_tableErrorRateModelTestSuite;
@@ -25,6 +25,7 @@
 #include "ns3/adhoc-wifi-mac.h"
 #include "ns3/yans-wifi-phy.h"
 #include "ns3/arf-wifi-manager.h"
+#include "ns3/constant-rate-wifi-manager.h"
 #include "ns3/propagation-delay-model.h"
 #include "ns3/propagation-loss-model.h"
 #include "ns3/error-rate-model.h"
@@ -41,6 +42,9 @@
 #include "ns3/edca-txop-n.h"
 #include "ns3/config.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/snr-tag.h"
 
 using namespace ns3;
 
@@ -478,6 +482,241 @@ Bug555TestCase::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (m_secondTransmissionTime, expectedSecondTransmissionTime, "The second transmission time not correct!");
 }
 
+//-----------------------------------------------------------------------------
+/**
+ * Make sure that channel culling still delivers a broadcast to a PHY in
+ * range and no longer schedules a reception for a PHY far beyond it.
+ */
+class YansWifiChannelCullingTest : public TestCase
+{
+public:
+  YansWifiChannelCullingTest ();
+
+  virtual void DoRun (void);
+
+private:
+  void RunOne (bool culling, bool random, double range);
+  Ptr<WifiNetDevice> CreateOne (Vector pos, Ptr<YansWifiChannel> channel, uint32_t *rx);
+  void SendOnePacket (Ptr<WifiNetDevice> dev);
+  static void CountRx (uint32_t *counter, Ptr<const Packet> packet);
+
+  uint32_t m_nearRx; //!< receptions started or dropped by the PHY in range
+  uint32_t m_farRx; //!< receptions started or dropped by the PHY out of range
+};
+
+YansWifiChannelCullingTest::YansWifiChannelCullingTest ()
+  : TestCase ("Test YansWifiChannel culling of out of range receivers")
+{
+}
+
+void
+YansWifiChannelCullingTest::CountRx (uint32_t *counter, Ptr<const Packet> packet)
+{
+  (*counter)++;
+}
+
+void
+YansWifiChannelCullingTest::SendOnePacket (Ptr<WifiNetDevice> dev)
+{
+  Ptr<Packet> p = Create<Packet> (100);
+  dev->Send (p, dev->GetBroadcast (), 1);
+}
+
+Ptr<WifiNetDevice>
+YansWifiChannelCullingTest::CreateOne (Vector pos, Ptr<YansWifiChannel> channel, uint32_t *rx)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<WifiNetDevice> dev = CreateObject<WifiNetDevice> ();
+
+  Ptr<WifiMac> mac = CreateObject<AdhocWifiMac> ();
+  mac->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+  Ptr<ErrorRateModel> error = CreateObject<YansErrorRateModel> ();
+  phy->SetErrorRateModel (error);
+  phy->SetChannel (channel);
+  phy->SetDevice (dev);
+  phy->SetMobility (node);
+  phy->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<WifiRemoteStationManager> manager = CreateObject<ConstantRateWifiManager> ();
+
+  mobility->SetPosition (pos);
+  node->AggregateObject (mobility);
+  mac->SetAddress (Mac48Address::Allocate ());
+  dev->SetMac (mac);
+  dev->SetPhy (phy);
+  dev->SetRemoteStationManager (manager);
+  node->AddDevice (dev);
+
+  if (rx != 0)
+    {
+      phy->TraceConnectWithoutContext ("PhyRxBegin", MakeBoundCallback (&YansWifiChannelCullingTest::CountRx, rx));
+      phy->TraceConnectWithoutContext ("PhyRxDrop", MakeBoundCallback (&YansWifiChannelCullingTest::CountRx, rx));
+    }
+  return dev;
+}
+
+void
+YansWifiChannelCullingTest::RunOne (bool culling, bool random, double range)
+{
+  m_nearRx = 0;
+  m_farRx = 0;
+  Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel> ();
+  channel->SetAttribute ("EnableCulling", BooleanValue (culling));
+  channel->SetAttribute ("CullingRange", DoubleValue (range));
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  Ptr<PropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  if (random)
+    {
+      Ptr<RandomPropagationLossModel> fading = CreateObject<RandomPropagationLossModel> ();
+      fading->SetAttribute ("Variable", StringValue ("ns3::ConstantRandomVariable[Constant=0.0]"));
+      loss->SetNext (fading);
+    }
+  channel->SetPropagationLossModel (loss);
+
+  Ptr<WifiNetDevice> sender = CreateOne (Vector (0.0, 0.0, 0.0), channel, 0);
+  CreateOne (Vector (50.0, 0.0, 0.0), channel, &m_nearRx);
+  CreateOne (Vector (5000.0, 0.0, 0.0), channel, &m_farRx);
+  Simulator::Schedule (Seconds (1.0), &YansWifiChannelCullingTest::SendOnePacket, this, sender);
+
+  Simulator::Stop (Seconds (2.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+YansWifiChannelCullingTest::DoRun (void)
+{
+  RunOne (false, false, 0.0);
+  NS_TEST_ASSERT_MSG_EQ (m_nearRx, 1, "The PHY in range must see the frame");
+  NS_TEST_ASSERT_MSG_EQ (m_farRx, 1, "Without culling the far PHY gets (and drops) the frame");
+
+  RunOne (true, false, 0.0);
+  NS_TEST_ASSERT_MSG_EQ (m_nearRx, 1, "Culling must not drop the PHY in range");
+  NS_TEST_ASSERT_MSG_EQ (m_farRx, 0, "Culling must not schedule a reception for the far PHY");
+
+  // No range is derived from a random loss model
+  RunOne (true, true, 0.0);
+  NS_TEST_ASSERT_MSG_EQ (m_nearRx, 1, "Culling must not drop the PHY in range");
+  NS_TEST_ASSERT_MSG_EQ (m_farRx, 1, "Culling must be disabled with a random loss and no range");
+
+  RunOne (true, true, 1000.0);
+  NS_TEST_ASSERT_MSG_EQ (m_nearRx, 1, "Culling must not drop the PHY in range");
+  NS_TEST_ASSERT_MSG_EQ (m_farRx, 0, "An explicit range must cull the far PHY");
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Make sure that the receivers of a broadcast, which share the frame sent
+ * on the channel, each get their own copy of it: the SNR tag each PHY
+ * adds must not show up at the other receivers or in the packet sent.
+ */
+class YansWifiChannelSharedFrameTest : public TestCase
+{
+public:
+  YansWifiChannelSharedFrameTest ();
+
+  virtual void DoRun (void);
+
+private:
+  Ptr<WifiNetDevice> CreateOne (Vector pos, Ptr<YansWifiChannel> channel);
+  void SendOnePacket (Ptr<WifiNetDevice> dev);
+  bool Receive (Ptr<NetDevice> dev, Ptr<const Packet> packet, uint16_t protocol, const Address &from);
+  void CountDrop (Ptr<const Packet> packet);
+
+  Ptr<Packet> m_sent; //!< the packet sent
+  std::vector<Ptr<const Packet> > m_received; //!< the packets received, in order
+  std::vector<double> m_snr; //!< the SNR tagged on each packet received
+  uint32_t m_drops; //!< frames dropped by the PHYs
+};
+
+YansWifiChannelSharedFrameTest::YansWifiChannelSharedFrameTest ()
+  : TestCase ("Test that the receivers of a broadcast do not share their copy of the frame"),
+    m_drops (0)
+{
+}
+
+void
+YansWifiChannelSharedFrameTest::SendOnePacket (Ptr<WifiNetDevice> dev)
+{
+  m_sent = Create<Packet> (100);
+  dev->Send (m_sent, dev->GetBroadcast (), 1);
+}
+
+bool
+YansWifiChannelSharedFrameTest::Receive (Ptr<NetDevice> dev, Ptr<const Packet> packet,
+                                         uint16_t protocol, const Address &from)
+{
+  SnrTag tag;
+  m_received.push_back (packet);
+  m_snr.push_back (packet->PeekPacketTag (tag) ? tag.Get () : 0.0);
+  return true;
+}
+
+void
+YansWifiChannelSharedFrameTest::CountDrop (Ptr<const Packet> packet)
+{
+  m_drops++;
+}
+
+Ptr<WifiNetDevice>
+YansWifiChannelSharedFrameTest::CreateOne (Vector pos, Ptr<YansWifiChannel> channel)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<WifiNetDevice> dev = CreateObject<WifiNetDevice> ();
+
+  Ptr<WifiMac> mac = CreateObject<AdhocWifiMac> ();
+  mac->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+  Ptr<ErrorRateModel> error = CreateObject<YansErrorRateModel> ();
+  phy->SetErrorRateModel (error);
+  phy->SetChannel (channel);
+  phy->SetDevice (dev);
+  phy->SetMobility (node);
+  phy->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  Ptr<WifiRemoteStationManager> manager = CreateObject<ConstantRateWifiManager> ();
+
+  mobility->SetPosition (pos);
+  node->AggregateObject (mobility);
+  mac->SetAddress (Mac48Address::Allocate ());
+  dev->SetMac (mac);
+  dev->SetPhy (phy);
+  dev->SetRemoteStationManager (manager);
+  node->AddDevice (dev);
+
+  dev->SetReceiveCallback (MakeCallback (&YansWifiChannelSharedFrameTest::Receive, this));
+  phy->TraceConnectWithoutContext ("PhyRxDrop", MakeCallback (&YansWifiChannelSharedFrameTest::CountDrop, this));
+  return dev;
+}
+
+void
+YansWifiChannelSharedFrameTest::DoRun (void)
+{
+  Ptr<YansWifiChannel> channel = CreateObject<YansWifiChannel> ();
+  channel->SetPropagationDelayModel (CreateObject<ConstantSpeedPropagationDelayModel> ());
+  channel->SetPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  Ptr<WifiNetDevice> sender = CreateOne (Vector (0.0, 0.0, 0.0), channel);
+  CreateOne (Vector (10.0, 0.0, 0.0), channel);
+  CreateOne (Vector (50.0, 0.0, 0.0), channel);
+  CreateOne (Vector (5000.0, 0.0, 0.0), channel);
+  Simulator::Schedule (Seconds (1.0), &YansWifiChannelSharedFrameTest::SendOnePacket, this, sender);
+
+  Simulator::Stop (Seconds (2.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 2, "The two PHYs in range must receive the frame");
+  NS_TEST_EXPECT_MSG_EQ (m_drops, 1, "The far PHY must drop the frame");
+  NS_TEST_EXPECT_MSG_NE (m_received[0], m_received[1], "The receivers must not share their packet");
+  NS_TEST_EXPECT_MSG_GT (m_snr[0], m_snr[1], "Each receiver must tag its own SNR");
+  SnrTag tag;
+  NS_TEST_EXPECT_MSG_EQ (m_sent->PeekPacketTag (tag), false, "The packet sent must not be tagged");
+  m_sent = 0;
+  m_received.clear ();
+}
+
 //-----------------------------------------------------------------------------
 class WifiTestSuite : public TestSuite
 {
@@ -492,6 +731,8 @@ WifiTestSuite::WifiTestSuite ()
   AddTestCase (new QosUtilsIsOldPacketTest, TestCase::QUICK);
   AddTestCase (new InterferenceHelperSequenceTest, TestCase::QUICK); // Bug 991
   AddTestCase (new Bug555TestCase, TestCase::QUICK); // Bug 555
+  AddTestCase (new YansWifiChannelCullingTest, TestCase::QUICK);
+  AddTestCase (new YansWifiChannelSharedFrameTest, TestCase::QUICK);
 }
 
 static WifiTestSuite g_wifiTestSuite;
@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+#define LOG(x)   std::cout << x << std::endl
+
+class BenchEvent
+{
+public:
+  BenchEvent ();
+  void Member2 (uint32_t a, double b);
+  uint64_t m_count;
+};
+
+BenchEvent::BenchEvent ()
+  : m_count (0)
+{
+}
+
+void
+BenchEvent::Member2 (uint32_t a, double b)
+{
+  m_count += a;
+}
+
+static void
+PrintRate (std::string name, uint32_t n, double ms)
+{
+  LOG (std::left << std::setw (36) << name
+                 << std::right << std::setw (12) << ms / 1000
+                 << std::setw (16) << (n / (ms / 1000)));
+}
+
+/*
+ * Create and destroy events without scheduling them: this only
+ * measures the allocation of the EventImpl holding the bound arguments.
+ */
+static void
+BenchMakeEvent (uint32_t n, uint32_t live)
+{
+  BenchEvent bench;
+  std::vector<EventImpl *> events (live, (EventImpl *) 0);
+  SystemWallClockMs time;
+
+  time.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t slot = i % live;
+      if (events[slot] != 0)
+        {
+          events[slot]->Unref ();
+        }
+      events[slot] = MakeEvent (&BenchEvent::Member2, &bench, i, 1.0);
+    }
+  for (uint32_t i = 0; i < live; i++)
+    {
+      if (events[i] != 0)
+        {
+          events[i]->Unref ();
+        }
+    }
+  PrintRate ("MakeEvent/Unref (2 args)", n, time.End ());
+}
+
+/*
+ * Keep a population of events which each schedule their successor, as
+ * timers and backoffs do: the full Simulator::Schedule and Run path,
+ * including the event allocation, with a small event list.
+ */
+class BenchChain
+{
+public:
+  BenchChain (uint32_t n);
+  void Next (uint32_t a, double b);
+  void Cancelled (void);
+  uint32_t m_left;
+};
+
+BenchChain::BenchChain (uint32_t n)
+  : m_left (n)
+{
+}
+
+void
+BenchChain::Next (uint32_t a, double b)
+{
+  if (m_left == 0)
+    {
+      return;
+    }
+  m_left--;
+  Simulator::Schedule (NanoSeconds (1 + a % 100), &BenchChain::Next, this, a + 1, b);
+  if (a % 4 == 0)
+    {
+      // a timer which is rearmed before it expires
+      EventId id = Simulator::Schedule (NanoSeconds (200), &BenchChain::Cancelled, this);
+      id.Cancel ();
+    }
+}
+
+void
+BenchChain::Cancelled (void)
+{
+}
+
+static void
+BenchSchedule (uint32_t n, uint32_t live)
+{
+  BenchChain chain (n);
+  SystemWallClockMs time;
+
+  for (uint32_t i = 0; i < live; i++)
+    {
+      Simulator::Schedule (NanoSeconds (i), &BenchChain::Next, &chain, i, 1.0);
+    }
+  time.Start ();
+  Simulator::Run ();
+  PrintRate ("Schedule+Run, 1/4 cancelled timers", n, time.End ());
+  Simulator::Destroy ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 5000000;
+  uint32_t live = 1000;
+  uint32_t runs = 3;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the creation and scheduling of events.");
+  cmd.AddValue ("n",    "number of events per test (default 5E6)", n);
+  cmd.AddValue ("live", "number of events alive at once (default 1000)", live);
+  cmd.AddValue ("runs", "number of runs (default 3)", runs);
+  cmd.Parse (argc, argv);
+
+  LOG (std::left << std::setw (36) << "Test"
+                 << std::right << std::setw (12) << "Time (s)"
+                 << std::setw (16) << "Rate (ev/s)");
+  for (uint32_t i = 0; i < runs; i++)
+    {
+      BenchMakeEvent (n, live);
+      BenchSchedule (n, live);
+    }
+  return 0;
+}
@@ -273,6 +273,10 @@ int main (int argc, char *argv[])
         {
           Packet::EnablePrinting ();
         }
+      if (strncmp ("--enable-lazy-printing", argv[0], strlen ("--enable-lazy-printing")) == 0)
+        {
+          Packet::EnableLazyPrinting ();
+        }
       argc--;
       argv++;
   }
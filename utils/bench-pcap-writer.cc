@@ -0,0 +1,86 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+using namespace ns3;
+
+/*
+ * Benchmark the pcap tracing of many devices: packets are written in
+ * turn to one PcapFileWrapper per device, as the trace sinks of
+ * PcapHelper do, synchronously or from the background threads of the
+ * asynchronous writers.
+ */
+int main (int argc, char *argv[])
+{
+  uint32_t files = 200;
+  uint32_t packets = 1000000;
+  uint32_t size = 500;
+  bool asynchronous = false;
+  std::string prefix = "bench-pcap-writer";
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the writing of pcap files.");
+  cmd.AddValue ("files",        "number of pcap files (default 200)", files);
+  cmd.AddValue ("packets",      "number of packets written (default 1E6)", packets);
+  cmd.AddValue ("size",         "size of the packets (default 500)", size);
+  cmd.AddValue ("asynchronous", "write from background threads (default false)", asynchronous);
+  cmd.AddValue ("prefix",       "prefix of the pcap files", prefix);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::PcapFileWrapper::Asynchronous", BooleanValue (asynchronous));
+  PcapHelper helper;
+  std::vector<Ptr<PcapFileWrapper> > wrappers;
+  for (uint32_t i = 0; i < files; i++)
+    {
+      std::ostringstream oss;
+      oss << prefix << "-" << i << ".pcap";
+      wrappers.push_back (helper.CreateFile (oss.str (), std::ios::out, PcapHelper::DLT_IEEE802_11));
+    }
+
+  Ptr<Packet> packet = Create<Packet> (size);
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < packets; i++)
+    {
+      wrappers[i % files]->Write (MicroSeconds (i), packet);
+    }
+  double writeMs = time.End ();
+  for (uint32_t i = 0; i < files; i++)
+    {
+      wrappers[i]->Close ();
+    }
+  double totalMs = time.End ();
+
+  std::cout << (asynchronous ? "asynchronous" : "synchronous") << ", "
+            << files << " files: " << packets << " packets written in "
+            << writeMs / 1000 << " s (" << packets / (writeMs / 1000) << " packets/s), "
+            << totalMs / 1000 << " s with the final flush" << std::endl;
+
+  for (uint32_t i = 0; i < files; i++)
+    {
+      std::ostringstream oss;
+      oss << prefix << "-" << i << ".pcap";
+      std::remove (oss.str ().c_str ());
+    }
+  return 0;
+}
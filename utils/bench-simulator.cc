@@ -186,6 +186,8 @@ int main (int argc, char *argv[])
   bool schedHeap = false;
   bool schedList = false;
   bool schedMap  = true;
+  bool schedPooled = false;
+  bool schedLadder = false;
 
   uint32_t pop   =  100000;
   uint32_t total = 1000000;
@@ -205,6 +207,8 @@ int main (int argc, char *argv[])
   cmd.AddValue ("heap",  "use HeapScheduler",             schedHeap);
   cmd.AddValue ("list",  "use ListSheduler",              schedList);
   cmd.AddValue ("map",   "use MapScheduler (default)",    schedMap);
+  cmd.AddValue ("pooled", "use PooledHeapScheduler",      schedPooled);
+  cmd.AddValue ("ladder", "use LadderScheduler",          schedLadder);
   cmd.AddValue ("debug", "enable debugging output",       g_debug);
   cmd.AddValue ("pop",   "event population size (default 1E5)",         pop);
   cmd.AddValue ("total", "total number of events to run (default 1E6)", total);
@@ -219,6 +223,8 @@ int main (int argc, char *argv[])
   if (schedCal)  { factory.SetTypeId ("ns3::CalendarScheduler"); }
   if (schedHeap) { factory.SetTypeId ("ns3::HeapScheduler");     }
   if (schedList) { factory.SetTypeId ("ns3::ListScheduler");     }  
+  if (schedPooled) { factory.SetTypeId ("ns3::PooledHeapScheduler"); }
+  if (schedLadder) { factory.SetTypeId ("ns3::LadderScheduler"); }
   Simulator::SetScheduler (factory);
 
   LOGME (std::setprecision (g_fwidth - 6));
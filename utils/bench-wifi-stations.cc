@@ -0,0 +1,93 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/wifi-remote-station-manager.h"
+#include "ns3/yans-wifi-phy.h"
+#include "ns3/wifi-mac-header.h"
+
+using namespace ns3;
+
+/*
+ * Benchmark the per-frame queries of a WifiRemoteStationManager talking
+ * to many peers: the RTS decision, the TX vector, and the report of the
+ * outcome, for frames sent to the peers in a random order.
+ */
+int main (int argc, char *argv[])
+{
+  uint32_t peers = 500;
+  uint32_t frames = 1000000;
+  std::string manager = "ns3::ArfWifiManager";
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the station lookups of a WifiRemoteStationManager.");
+  cmd.AddValue ("peers",   "number of remote stations (default 500)", peers);
+  cmd.AddValue ("frames",  "number of frames sent (default 1E6)", frames);
+  cmd.AddValue ("manager", "the WifiRemoteStationManager type (default ns3::ArfWifiManager)", manager);
+  cmd.Parse (argc, argv);
+
+  Ptr<YansWifiPhy> phy = CreateObject<YansWifiPhy> ();
+  phy->ConfigureStandard (WIFI_PHY_STANDARD_80211a);
+  ObjectFactory factory (manager);
+  Ptr<WifiRemoteStationManager> stations = factory.Create<WifiRemoteStationManager> ();
+  stations->SetHtSupported (false);
+  stations->SetupPhy (phy);
+
+  std::vector<Mac48Address> addresses;
+  for (uint32_t i = 0; i < peers; i++)
+    {
+      addresses.push_back (Mac48Address::Allocate ());
+    }
+  Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
+  std::vector<uint32_t> order;
+  for (uint32_t i = 0; i < 4 * peers; i++)
+    {
+      order.push_back (rand->GetInteger (0, peers - 1));
+    }
+
+  Ptr<Packet> packet = Create<Packet> (1000);
+  WifiMacHeader header;
+  header.SetType (WIFI_MAC_DATA);
+  WifiMode ackMode = WifiPhy::GetOfdmRate6Mbps ();
+  bool rts = false;
+
+  SystemWallClockMs time;
+  time.Start ();
+  for (uint32_t i = 0; i < frames; i++)
+    {
+      Mac48Address address = addresses[order[i % order.size ()]];
+      rts ^= stations->NeedRts (address, &header, packet);
+      WifiTxVector txVector = stations->GetDataTxVector (address, &header, packet, 1028);
+      if (i % 10 == 0)
+        {
+          stations->ReportDataFailed (address, &header);
+        }
+      stations->ReportDataOk (address, &header, 20.0, ackMode, 20.0);
+      stations->ReportRxOk (address, &header, 20.0, txVector.GetMode ());
+    }
+  double ms = time.End ();
+
+  std::cout << manager << ", " << peers << " peers: "
+            << frames << " frames in " << ms / 1000 << " s, "
+            << frames / (ms / 1000) << " frames/s" << std::endl;
+  stations->Dispose ();
+  return 0;
+}